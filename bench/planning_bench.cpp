@@ -0,0 +1,429 @@
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <reactive_assistance/planning_engine.hpp>
+#include <reactive_assistance/dist_util.hpp>
+#include <reactive_assistance/flight_log.hpp>
+
+#include "synthetic_scenes.hpp"
+
+using namespace reactive_assistance;
+
+namespace
+{
+  // Engine and processed map of one scene at one beam count
+  class SceneFixture
+  {
+    public:
+      SceneFixture(const benchmark::State &state)
+                  : scene(static_cast<SceneType>(state.range(0)))
+                  , beams(state.range(1))
+                  , engine(makeSceneRobot())
+      {
+        makeSceneScan(scene, beams, scan);
+        laser_to_base.rotation.w = 1.0;
+
+        engine.updateScan(scan, laser_to_base);
+        map = engine.getObstacleMap().getSnapshot();
+
+        // Gaps to evaluate, the raw ones if filtering left none (duplicate gaps eliminate each other)
+        gaps = map->gaps;
+        if (gaps.empty())
+        {
+          engine.getObstacleMap().searchGaps(*map, gaps);
+        }
+
+        // Straight ahead through the scene, blocked in the doorway and dead end
+        goal.x = 2.5;
+        goal.y = epsilon;
+        goal.z = 0.0;
+      }
+
+      const ObstacleMap &obsMap() const { return engine.getObstacleMap(); }
+
+      SceneType scene;
+      int beams;
+      PlanningEngine engine;
+      sensor_msgs::LaserScan scan;
+      geometry_msgs::Transform laser_to_base;
+      MapSnapshotConstPtr map;
+      std::vector<Gap> gaps;
+      geometry_msgs::Point goal;
+  };
+
+  void finish(benchmark::State &state, const SceneFixture &fx)
+  {
+    state.SetLabel(SCENE_NAMES[fx.scene]);
+    state.SetItemsProcessed(state.iterations() * fx.beams);
+    state.counters["gaps"] = fx.map->gaps.size();
+  }
+}
+
+static void BM_UpdateObstacles(benchmark::State &state)
+{
+  SceneFixture fx(state);
+
+  for (auto _ : state)
+  {
+    MapSnapshot map;
+    fx.obsMap().updateObstacles(fx.scan, fx.laser_to_base, map);
+    benchmark::DoNotOptimize(map.obstacles.data());
+  }
+
+  finish(state, fx);
+}
+
+static void BM_UpdateGaps(benchmark::State &state)
+{
+  SceneFixture fx(state);
+  MapSnapshot map = *fx.map;
+
+  for (auto _ : state)
+  {
+    map.gaps.clear();
+    fx.obsMap().updateGaps(map);
+    benchmark::DoNotOptimize(map.gaps.data());
+  }
+
+  finish(state, fx);
+}
+
+static void BM_FilterGaps(benchmark::State &state)
+{
+  SceneFixture fx(state);
+  std::vector<Gap> raw_gaps;
+  fx.obsMap().searchGaps(*fx.map, raw_gaps);
+
+  for (auto _ : state)
+  {
+    std::vector<Gap> gaps;
+    fx.obsMap().filterGaps(raw_gaps, gaps);
+    benchmark::DoNotOptimize(gaps.data());
+  }
+
+  state.counters["raw_gaps"] = raw_gaps.size();
+  finish(state, fx);
+}
+
+static void BM_IsNavigable(benchmark::State &state)
+{
+  SceneFixture fx(state);
+
+  // Straight trajectory when the second argument is zero, else an arc to the front left
+  geometry_msgs::Point goal = fx.goal;
+  if (state.range(2) != 0)
+  {
+    goal.x = 1.5;
+    goal.y = 1.0;
+  }
+  Trajectory traj(goal);
+
+  for (auto _ : state)
+  {
+    std::vector<Obstacle> coll_obstacles;
+    benchmark::DoNotOptimize(fx.obsMap().isNavigable(traj, fx.map->obstacles, coll_obstacles));
+  }
+
+  finish(state, fx);
+}
+
+// Same trajectories through the range index of the snapshot first, the exact geometry only when it is inconclusive
+static void BM_IsNavigableTiered(benchmark::State &state)
+{
+  SceneFixture fx(state);
+
+  geometry_msgs::Point goal = fx.goal;
+  if (state.range(2) != 0)
+  {
+    goal.x = 1.5;
+    goal.y = 1.0;
+  }
+  Trajectory traj(goal);
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(fx.obsMap().isNavigable(*fx.map, traj));
+  }
+
+  state.counters["bound"] = fx.obsMap().boundNavigable(*fx.map, traj);
+  finish(state, fx);
+}
+
+// Range index over the obstacles of a scan, as built with every snapshot
+static void BM_BuildRangeIndex(benchmark::State &state)
+{
+  SceneFixture fx(state);
+
+  RangeIndex index;
+  for (auto _ : state)
+  {
+    index.build(fx.map->obstacles);
+    benchmark::DoNotOptimize(index.minDistance());
+  }
+
+  finish(state, fx);
+}
+
+// Same trajectories over the scan fitted into line segments within 2 cm, the range index left out
+static void BM_IsNavigableSegmented(benchmark::State &state)
+{
+  SceneFixture fx(state);
+  ObstacleMap seg_map(makeSceneRobot(), NULL, NULL, 0.02);
+  MapSnapshot map;
+  seg_map.updateObstacles(fx.scan, fx.laser_to_base, map);
+  map.range_index = RangeIndex();
+
+  geometry_msgs::Point goal = fx.goal;
+  if (state.range(2) != 0)
+  {
+    goal.x = 1.5;
+    goal.y = 1.0;
+  }
+  Trajectory traj(goal);
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(seg_map.isNavigable(map, traj));
+  }
+
+  state.counters["segments"] = map.segments.size();
+  state.counters["residuals"] = map.residuals.size();
+  finish(state, fx);
+}
+
+// Line segments fitted to the obstacles of a scan within 2 cm
+static void BM_UpdateSegments(benchmark::State &state)
+{
+  SceneFixture fx(state);
+  ObstacleMap seg_map(makeSceneRobot(), NULL, NULL, 0.02);
+  MapSnapshot map = *fx.map;
+
+  for (auto _ : state)
+  {
+    seg_map.updateSegments(map);
+    benchmark::DoNotOptimize(map.segments.data());
+  }
+
+  state.counters["segments"] = map.segments.size();
+  finish(state, fx);
+}
+
+static void BM_FindVirtualGaps(benchmark::State &state)
+{
+  SceneFixture fx(state);
+  Trajectory traj(fx.goal);
+
+  int idx;
+  GapPtr closest = fx.obsMap().findClosestGap(traj, fx.gaps, false, idx);
+  if (closest == NULL)
+  {
+    state.SkipWithError("No gap in the scene");
+    return;
+  }
+
+  for (auto _ : state)
+  {
+    std::vector<GapPtr> virt_gaps;
+    std::vector<double> clearances;
+    fx.obsMap().findVirtualGaps(*fx.map, *closest, virt_gaps, clearances);
+    benchmark::DoNotOptimize(virt_gaps.data());
+  }
+
+  finish(state, fx);
+}
+
+static void BM_FindSubGoal(benchmark::State &state)
+{
+  SceneFixture fx(state);
+  const std::vector<Gap> &gaps = fx.gaps;
+  if (gaps.empty())
+  {
+    state.SkipWithError("No gap in the scene");
+    return;
+  }
+
+  // One sub-goal per gap of the scene per iteration
+  for (auto _ : state)
+  {
+    for (std::size_t i = 0; i < gaps.size(); ++i)
+    {
+      geometry_msgs::Point sub_goal;
+      fx.obsMap().findSubGoal(gaps[i], sub_goal);
+      benchmark::DoNotOptimize(sub_goal);
+    }
+  }
+
+  finish(state, fx);
+}
+
+static void BM_FindAssistiveCommand(benchmark::State &state)
+{
+  SceneFixture fx(state);
+  Trajectory traj(fx.goal);
+
+  for (auto _ : state)
+  {
+    geometry_msgs::Twist assist;
+    TraceRecord rec;
+    rec.gaps_evaluated = 0;
+    rec.stage_ns[STAGE_FIND_VIRTUAL_GAPS] = 0;
+    fx.engine.findAssistiveCommand(*fx.map, traj, false, assist, rec);
+    benchmark::DoNotOptimize(assist);
+  }
+
+  finish(state, fx);
+}
+
+// Shared control cycles of a joystick held still, jittering within the assist cache quanta, with the cache on or off
+static void BM_ComputeCommand(benchmark::State &state)
+{
+  EngineConfig config;
+  config.assist_cache_size = (state.range(2) != 0) ? 64 : 0;
+  PlanningEngine engine(makeSceneRobot(), config);
+
+  sensor_msgs::LaserScan scan;
+  makeSceneScan(static_cast<SceneType>(state.range(0)), state.range(1), scan);
+  engine.updateScan(scan);
+
+  nav_msgs::Odometry odom;
+  odom.pose.pose.orientation.w = 1.0;
+  odom.twist.twist.linear.x = 0.5;
+
+  geometry_msgs::Twist input;
+  int i = 0;
+  for (auto _ : state)
+  {
+    input.linear.x = 0.8 + 0.001 * (i & 3);
+    input.angular.z = 0.1 - 0.001 * (i & 1);
+    ++i;
+
+    PlanningResult result;
+    engine.computeCommand(input, odom, NULL, result);
+    benchmark::DoNotOptimize(result.cmd);
+  }
+
+  state.SetLabel(SCENE_NAMES[state.range(0)]);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Sampling fallback over the default command grid, from a robot cruising ahead and asking to go straight on
+static void BM_SampleCommand(benchmark::State &state)
+{
+  SceneFixture fx(state);
+
+  nav_msgs::Odometry odom;
+  odom.pose.pose.orientation.w = 1.0;
+  odom.twist.twist.linear.x = 0.5;
+
+  geometry_msgs::Twist input;
+  input.linear.x = 0.8;
+
+  bool found = false;
+  for (auto _ : state)
+  {
+    geometry_msgs::Twist cmd;
+    found = fx.engine.sampleCommand(*fx.map, input, odom, cmd);
+    benchmark::DoNotOptimize(cmd);
+  }
+
+  state.counters["found"] = found;
+  finish(state, fx);
+}
+
+// Simulated goals of a batch of joystick commands, from a robot already at the commanded speed (steady) or not
+static void BM_SimulateGoals(benchmark::State &state)
+{
+  PlanningEngine engine(makeSceneRobot());
+  bool steady = (state.range(1) != 0);
+
+  nav_msgs::Odometry odom;
+  odom.pose.pose.orientation.w = 1.0;
+  odom.twist.twist.linear.x = 0.5;
+  odom.twist.twist.angular.z = 0.2;
+
+  std::vector<geometry_msgs::Twist> inputs(state.range(0));
+  for (std::size_t i = 0; i < inputs.size(); ++i)
+  {
+    inputs[i].linear.x = steady ? 0.5 : (-1.0 + 2.0 * i / inputs.size());
+    inputs[i].angular.z = steady ? 0.2 : (1.0 - 2.0 * i / inputs.size());
+  }
+
+  std::vector<geometry_msgs::Point> goals;
+  for (auto _ : state)
+  {
+    engine.simulateGoals(inputs, odom, goals);
+    benchmark::DoNotOptimize(goals.data());
+  }
+
+  state.SetLabel(steady ? "steady" : "ramping");
+  state.SetItemsProcessed(state.iterations() * inputs.size());
+}
+
+// Flight recorder range codec at its default 1 mm quantum
+static void BM_EncodeRanges(benchmark::State &state)
+{
+  SceneFixture fx(state);
+  std::vector<boost::uint8_t> encoded;
+
+  for (auto _ : state)
+  {
+    encoded.clear();
+    encodeRanges(fx.scan.ranges, 0.001f, encoded);
+    benchmark::DoNotOptimize(encoded.data());
+  }
+
+  state.counters["bytes_per_beam"] = static_cast<double>(encoded.size()) / fx.beams;
+  finish(state, fx);
+}
+
+static void BM_DecodeRanges(benchmark::State &state)
+{
+  SceneFixture fx(state);
+  std::vector<boost::uint8_t> encoded;
+  encodeRanges(fx.scan.ranges, 0.001f, encoded);
+
+  for (auto _ : state)
+  {
+    std::vector<float> ranges;
+    decodeRanges(encoded.data(), encoded.size(), fx.beams, 0.001f, ranges);
+    benchmark::DoNotOptimize(ranges.data());
+  }
+
+  finish(state, fx);
+}
+
+// Every stage over every scene at the common scanner resolutions
+static void sceneArgs(benchmark::internal::Benchmark *b)
+{
+  b->ArgNames({"scene", "beams"});
+  b->ArgsProduct({{SCENE_OPEN_ROOM, SCENE_CORRIDOR, SCENE_DOORWAY, SCENE_CLUTTERED_LEGS, SCENE_DEAD_END},
+                  {360, 720, 1440, 4096}});
+}
+
+static void arcArgs(benchmark::internal::Benchmark *b)
+{
+  b->ArgNames({"scene", "beams", "arc"});
+  b->ArgsProduct({{SCENE_OPEN_ROOM, SCENE_CORRIDOR, SCENE_DOORWAY, SCENE_CLUTTERED_LEGS, SCENE_DEAD_END},
+                  {360, 720, 1440, 4096}, {0, 1}});
+}
+
+BENCHMARK(BM_UpdateObstacles)->Apply(sceneArgs);
+BENCHMARK(BM_UpdateGaps)->Apply(sceneArgs);
+BENCHMARK(BM_FilterGaps)->Apply(sceneArgs);
+BENCHMARK(BM_IsNavigable)->Apply(arcArgs);
+BENCHMARK(BM_IsNavigableTiered)->Apply(arcArgs);
+BENCHMARK(BM_BuildRangeIndex)->Apply(sceneArgs);
+BENCHMARK(BM_IsNavigableSegmented)->Apply(arcArgs);
+BENCHMARK(BM_UpdateSegments)->Apply(sceneArgs);
+BENCHMARK(BM_FindVirtualGaps)->Apply(sceneArgs);
+BENCHMARK(BM_FindSubGoal)->Apply(sceneArgs);
+BENCHMARK(BM_FindAssistiveCommand)->Apply(sceneArgs);
+BENCHMARK(BM_ComputeCommand)->ArgNames({"scene", "beams", "cache"})
+    ->ArgsProduct({{SCENE_OPEN_ROOM, SCENE_DOORWAY, SCENE_DEAD_END}, {360, 1440}, {0, 1}});
+BENCHMARK(BM_SampleCommand)->Apply(sceneArgs);
+BENCHMARK(BM_SimulateGoals)->ArgNames({"inputs", "steady"})->ArgsProduct({{1, 64, 1024}, {0, 1}});
+BENCHMARK(BM_EncodeRanges)->Apply(sceneArgs);
+BENCHMARK(BM_DecodeRanges)->Apply(sceneArgs);
+
+BENCHMARK_MAIN();
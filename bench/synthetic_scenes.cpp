@@ -0,0 +1,98 @@
+#include <cmath>
+
+#include <boost/cstdint.hpp>
+
+#include <geometry_msgs/Pose2D.h>
+
+#include <reactive_assistance/scan_simulator.hpp>
+
+#include "synthetic_scenes.hpp"
+
+namespace reactive_assistance
+{
+  static const double SCENE_RANGE_MAX = 10.0;
+
+  void makeSceneWorld(SceneType scene, ScanWorld &world)
+  {
+    switch (scene)
+    {
+      case SCENE_OPEN_ROOM:
+      {
+        double xs[4] = {-3.0, 5.0, 5.0, -3.0};
+        double ys[4] = {-3.0, -3.0, 3.0, 3.0};
+        world.addPolygon(xs, ys, 4);
+        break;
+      }
+      case SCENE_CORRIDOR:
+      {
+        // Open ended, the ends are out of range
+        world.addSegment(-12.0, -0.9, 12.0, -0.9);
+        world.addSegment(-12.0, 0.9, 12.0, 0.9);
+        break;
+      }
+      case SCENE_DOORWAY:
+      {
+        // Room with a 0.9 m door in the facing wall, leading into a second room
+        double xs[4] = {-3.0, 6.0, 6.0, -3.0};
+        double ys[4] = {-4.0, -4.0, 4.0, 4.0};
+        world.addPolygon(xs, ys, 4);
+        world.addSegment(1.5, -4.0, 1.5, -0.45);
+        world.addSegment(1.5, 0.45, 1.5, 4.0);
+        world.addSegment(4.0, -1.0, 4.0, 1.0);
+        break;
+      }
+      case SCENE_CLUTTERED_LEGS:
+      {
+        double xs[4] = {-3.0, 5.0, 5.0, -3.0};
+        double ys[4] = {-3.0, -3.0, 3.0, 3.0};
+        world.addPolygon(xs, ys, 4);
+
+        // Legs scattered with a fixed LCG so every run sees the same scene, none within reach of the footprint
+        boost::uint32_t seed = 12345;
+        std::size_t legs = 0;
+        while (legs < 32)
+        {
+          seed = seed * 1664525u + 1013904223u;
+          double x = -2.5 + 7.0 * ((seed >> 8) / 16777216.0);
+          seed = seed * 1664525u + 1013904223u;
+          double y = -2.5 + 5.0 * ((seed >> 8) / 16777216.0);
+
+          if (std::hypot(x, y) > 0.8)
+          {
+            world.addCircle(x, y, 0.03);
+            ++legs;
+          }
+        }
+        break;
+      }
+      case SCENE_DEAD_END:
+      {
+        double xs[4] = {-6.0, 2.0, 2.0, -6.0};
+        double ys[4] = {-0.9, -0.9, 0.9, 0.9};
+        world.addPolyline(xs, ys, 4);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  void makeSceneScan(SceneType scene, int beams, sensor_msgs::LaserScan &scan)
+  {
+    ScanWorld world;
+    makeSceneWorld(scene, world);
+
+    // Noise free, nothing in range reads as max range, a non-obstacle point
+    ScanConfig config;
+    config.beams = beams;
+    config.range_max = SCENE_RANGE_MAX;
+
+    ScanSimulator sim(world, config);
+    sim.simulate(geometry_msgs::Pose2D(), 0, scan);
+  }
+
+  RobotProfile makeSceneRobot()
+  {
+    return RobotProfile::circular(0.3, 0.9, 1.0, 1.0, 1.0, 1.0);
+  }
+} /* namespace reactive_assistance */
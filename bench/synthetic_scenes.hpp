@@ -0,0 +1,41 @@
+#ifndef REACTIVE_ASSISTANCE_NS_SYNTHETIC_SCENES_H
+#define REACTIVE_ASSISTANCE_NS_SYNTHETIC_SCENES_H
+
+#include <sensor_msgs/LaserScan.h>
+
+#include <reactive_assistance/robot_profile.hpp>
+#include <reactive_assistance/scan_world.hpp>
+
+namespace reactive_assistance 
+{
+  // Analytic scenes around a robot at the origin facing +x
+  enum SceneType
+  {
+    SCENE_OPEN_ROOM = 0,
+    SCENE_CORRIDOR,
+    SCENE_DOORWAY,
+    SCENE_CLUTTERED_LEGS,
+    SCENE_DEAD_END,
+    NUM_SCENES
+  };
+
+  // Short scene names, used in the benchmark labels
+  static const char *const SCENE_NAMES[NUM_SCENES] = {
+    "open_room",
+    "corridor",
+    "doorway",
+    "cluttered_legs",
+    "dead_end"
+  };
+
+  // Walls and legs of the 'scene'
+  void makeSceneWorld(SceneType scene, ScanWorld &world);
+
+  // Ray cast a full field-of-view scan of 'beams' readings in the 'scene'
+  void makeSceneScan(SceneType scene, int beams, sensor_msgs::LaserScan &scan);
+
+  // Circular robot profile the scenes are laid out for
+  RobotProfile makeSceneRobot();
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
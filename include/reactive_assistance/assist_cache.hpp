@@ -0,0 +1,82 @@
+#ifndef REACTIVE_ASSISTANCE_NS_ASSIST_CACHE_H
+#define REACTIVE_ASSISTANCE_NS_ASSIST_CACHE_H
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <geometry_msgs/Twist.h>
+#include <nav_msgs/Odometry.h>
+
+#include <reactive_assistance/trace_recorder.hpp>
+
+namespace reactive_assistance
+{
+  // Inputs a shared control cycle depends on: the map snapshot, and the input and odometry velocities quantised
+  struct AssistKey
+  {
+    boost::uint64_t map_version;
+    boost::int32_t in_vx;
+    boost::int32_t in_wz;
+    boost::int32_t odom_vx;
+    boost::int32_t odom_wz;
+
+    bool operator==(const AssistKey &other) const
+    {
+      return (map_version == other.map_version) && (in_vx == other.in_vx) && (in_wz == other.in_wz) &&
+             (odom_vx == other.odom_vx) && (odom_wz == other.odom_wz);
+    }
+  };
+
+  // Small direct-mapped cache of the outcome of recent shared control cycles
+  // Joysticks publish far faster than scans arrive and mostly repeat themselves, so between two scans most inputs
+  // were already planned against the same map. Entries of older snapshots are never matched and just get overwritten
+  class AssistCache
+  {
+    public:
+      // Constructor & destructor, capacity is rounded up to a power of two. Linear velocities are quantised to
+      // 'lin_quantum' m/s and angular ones to 'ang_quantum' rad/s
+      AssistCache(std::size_t capacity, double lin_quantum, double ang_quantum);
+      ~AssistCache() {}
+
+      // Key of a cycle planned against snapshot 'map_version'
+      void makeKey(boost::uint64_t map_version, const geometry_msgs::Twist &input, const nav_msgs::Odometry &odom,
+                   AssistKey &key) const;
+
+      // Command and decision trace of the cycle cached under 'key', false on a miss
+      bool lookup(const AssistKey &key, geometry_msgs::Twist &cmd, TraceRecord &rec) const;
+      // Cache the command and decision trace of a cycle
+      void insert(const AssistKey &key, const geometry_msgs::Twist &cmd, const TraceRecord &rec);
+
+      // Lookups so far
+      boost::uint64_t getHits() const { return hits_.load(boost::memory_order_relaxed); }
+      boost::uint64_t getMisses() const { return misses_.load(boost::memory_order_relaxed); }
+
+    private:
+      struct Entry
+      {
+        bool valid;
+        AssistKey key;
+        geometry_msgs::Twist cmd;
+        TraceRecord rec;
+      };
+
+      // Slot of a key
+      std::size_t slot(const AssistKey &key) const;
+
+      double lin_scale_;
+      double ang_scale_;
+
+      mutable boost::mutex mutex_;
+      std::vector<Entry> entries_;
+      std::size_t mask_;
+
+      mutable boost::atomic<boost::uint64_t> hits_;
+      mutable boost::atomic<boost::uint64_t> misses_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
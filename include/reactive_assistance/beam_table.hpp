@@ -0,0 +1,68 @@
+#ifndef REACTIVE_ASSISTANCE_NS_BEAM_TABLE_H
+#define REACTIVE_ASSISTANCE_NS_BEAM_TABLE_H
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+#include <sensor_msgs/LaserScan.h>
+
+namespace reactive_assistance
+{
+  // Angle, cosine and sine of every beam of a scan geometry, computed once and then only read
+  // Angles are computed exactly as from the scan fields, so that a table gives the same obstacles as the trigonometry
+  class BeamTable
+  {
+    public:
+      // Constructor & destructor
+      BeamTable(float angle_min, float angle_increment, std::size_t beams);
+      ~BeamTable() {}
+
+      // Whether the 'scan' has the geometry of this table
+      bool matches(const sensor_msgs::LaserScan &scan) const
+      {
+        return (scan.angle_min == angle_min_) && (scan.angle_increment == angle_increment_) && (scan.ranges.size() == angles_.size());
+      }
+
+      std::size_t size() const { return angles_.size(); }
+      double angle(std::size_t i) const { return angles_[i]; }
+      double cosAt(std::size_t i) const { return cos_[i]; }
+      double sinAt(std::size_t i) const { return sin_[i]; }
+
+    private:
+      float angle_min_;
+      float angle_increment_;
+
+      std::vector<double> angles_;
+      std::vector<double> cos_;
+      std::vector<double> sin_;
+  };
+
+  typedef boost::shared_ptr<const BeamTable> BeamTableConstPtr;
+
+  // Geometries a cache keeps, scanners whose beam count varies from scan to scan would otherwise grow it forever
+  static const std::size_t MAX_BEAM_TABLES = 16;
+
+  // Beam tables of every scan geometry met so far, shared between the maps of many planner instances
+  // Lookups only take a shared lock, a geometry is computed under the exclusive lock the first time it is met
+  class BeamTableCache
+  {
+    public:
+      BeamTableCache() {}
+      ~BeamTableCache() {}
+
+      // Table of the geometry of 'scan', NULL if it is new and the cache is full
+      BeamTableConstPtr get(const sensor_msgs::LaserScan &scan);
+
+      // Number of geometries met
+      std::size_t size() const;
+
+    private:
+      mutable boost::shared_mutex mutex_;
+      std::vector<BeamTableConstPtr> tables_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
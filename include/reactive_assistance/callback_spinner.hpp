@@ -0,0 +1,51 @@
+#ifndef REACTIVE_ASSISTANCE_NS_CALLBACK_SPINNER_H
+#define REACTIVE_ASSISTANCE_NS_CALLBACK_SPINNER_H
+
+#include <string>
+
+#include <boost/thread.hpp>
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+
+namespace reactive_assistance
+{
+  // Scheduling of a spinner thread
+  struct SpinnerSchedule
+  {
+    SpinnerSchedule() : priority(0), cpu(-1) {}
+
+    // Above zero, the SCHED_FIFO real-time priority (1-99). Below zero, lowered to that nice value, e.g. -10 runs
+    // at nice 10. Zero keeps the default scheduling
+    int priority;
+    // CPU the thread is pinned to, none if negative
+    int cpu;
+  };
+
+  // Apply a schedule to the calling thread, warning under 'name' about the settings that could not be applied
+  // Real-time threads also get their stack pre-faulted
+  void applyThreadSchedule(const std::string &name, const SpinnerSchedule &schedule);
+
+  // Services a callback queue on a dedicated thread, so that its callbacks never wait behind those of other queues
+  class CallbackSpinner
+  {
+    public:
+      // Constructor & destructor, the destructor stops servicing the queue and waits for the running callback
+      CallbackSpinner(const std::string &name, const SpinnerSchedule &schedule);
+      ~CallbackSpinner();
+
+      // Queue to subscribe on
+      ros::CallbackQueue *getQueue() { return &queue_; }
+
+    private:
+      void spinLoop();
+
+      std::string name_;
+      SpinnerSchedule schedule_;
+
+      ros::CallbackQueue queue_;
+      boost::thread *spin_thread_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
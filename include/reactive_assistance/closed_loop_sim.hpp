@@ -0,0 +1,159 @@
+#ifndef REACTIVE_ASSISTANCE_NS_CLOSED_LOOP_SIM_H
+#define REACTIVE_ASSISTANCE_NS_CLOSED_LOOP_SIM_H
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <geometry_msgs/Pose2D.h>
+#include <geometry_msgs/Twist.h>
+#include <nav_msgs/Odometry.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <reactive_assistance/robot_profile.hpp>
+#include <reactive_assistance/planning_engine.hpp>
+#include <reactive_assistance/stage_profiler.hpp>
+#include <reactive_assistance/scan_simulator.hpp>
+
+namespace reactive_assistance 
+{
+  // Who drives the robot during an episode
+  enum EpisodeMode
+  {
+    // A simulated user steers straight at the goal, the planner makes the input safe
+    EPISODE_SHARED_CONTROL = 0,
+    // The planner drives to the goal on its own
+    EPISODE_AUTONOMOUS
+  };
+
+  // How an episode ended
+  enum EpisodeOutcome
+  {
+    EPISODE_REACHED = 0,
+    EPISODE_COLLISION,
+    EPISODE_TIMEOUT,
+    NUM_EPISODE_OUTCOMES
+  };
+
+  static const char *const EPISODE_OUTCOME_NAMES[NUM_EPISODE_OUTCOMES] = {
+    "reached",
+    "collision",
+    "timeout"
+  };
+
+  // Closed-loop settings shared by every episode
+  class EpisodeConfig
+  {
+    public:
+      EpisodeConfig()
+                   : mode(EPISODE_SHARED_CONTROL)
+                   , control_period(0.1)
+                   , substeps(5)
+                   , max_time(60.0)
+                   , goal_tolerance(0.3)
+                   , user_gain(2.0)
+                   , inflation(0.0)
+      {}
+      ~EpisodeConfig() {}
+
+      EpisodeMode mode;
+
+      // Simulated time between two scans and commands (s), and number of integration steps in between
+      double control_period;
+      int substeps;
+
+      // Episode time limit (s) and distance at which the goal counts as reached (m)
+      double max_time;
+      double goal_tolerance;
+
+      // Proportional gain of the simulated user's heading towards the goal
+      double user_gain;
+
+      // Margin the planner inflates the footprint by, collisions are still checked against the actual footprint (m)
+      double inflation;
+  };
+
+  // Start and goal poses of an episode, in the world frame
+  class Episode
+  {
+    public:
+      Episode() {}
+      ~Episode() {}
+
+      geometry_msgs::Pose2D start;
+      geometry_msgs::Pose2D goal;
+  };
+
+  // Outcome and statistics of an episode
+  class EpisodeResult
+  {
+    public:
+      EpisodeResult()
+                   : outcome(EPISODE_TIMEOUT)
+                   , time(0.0)
+                   , path_length(0.0)
+                   , min_clearance(0.0)
+                   , cycles(0)
+                   , assisted_cycles(0)
+                   , cmd_variation(0.0)
+                   , planner_ns(0)
+      {}
+      ~EpisodeResult() {}
+
+      EpisodeOutcome outcome;
+
+      // Simulated time until the episode ended (s), distance driven (m) and closest approach of the footprint (m)
+      double time;
+      double path_length;
+      double min_clearance;
+
+      // Planning cycles run and how many of those altered the input
+      int cycles;
+      int assisted_cycles;
+
+      // Total variation of the commanded linear (m/s) and angular (rad/s) velocities per second, lower is smoother
+      double cmd_variation;
+
+      // Wall-clock time spent in the planner
+      boost::int64_t planner_ns;
+  };
+
+  // Draw 'count' episodes between poses at least 'clearance' away from every shape of the 'world' and 'min_dist' apart,
+  // both in the largest connected region of such poses, so never inside a closed obstacle nor outside the walls.
+  // Returns false if the free space is too small to find them
+  bool sampleEpisodes(const ScanWorld &world, std::size_t count, double clearance, double min_dist, boost::uint64_t seed,
+                      std::vector<Episode> &episodes);
+
+  // Headless closed loop around the planning engine: a differential-drive robot is integrated under the planner's
+  // commands, and ray cast scans and odometry of the new pose are fed back. An instance runs one episode at a time
+  // and may share the scan simulator with instances on other threads
+  class ClosedLoopSimulator
+  {
+    public:
+      // Constructor & destructor
+      ClosedLoopSimulator(const ScanSimulator &sim, const RobotProfile &rp, const EpisodeConfig &config = EpisodeConfig(),
+                          const EngineConfig &engine_config = EngineConfig());
+      ~ClosedLoopSimulator();
+
+      // Run an episode, 'id' selects the scan noise so that the same id always gives the same run. Stage latencies of
+      // every cycle go to 'profiler' if given
+      void run(const Episode &episode, boost::uint64_t id, EpisodeResult &result, StageProfiler *profiler = NULL);
+
+      const PlanningEngine &getEngine() const { return *engine_; }
+
+    private:
+      // Joystick input of the simulated user: turn towards the goal, slowing down while facing away from it
+      void userInput(const geometry_msgs::Pose2D &pose, const geometry_msgs::Pose2D &goal, geometry_msgs::Twist &input) const;
+      // Distance from the actual footprint at 'pose' to the closest shape of the 'world', 0 on contact
+      double footprintClearance(const ScanWorld &world, const geometry_msgs::Pose2D &pose) const;
+
+      const ScanSimulator &sim_;
+      RobotProfile robot_profile_;
+      EpisodeConfig config_;
+
+      // Planner under test
+      PlanningEngine *engine_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
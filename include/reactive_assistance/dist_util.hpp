@@ -2,8 +2,12 @@
 #define REACTIVE_ASSISTANCE_NS_DIST_UTIL_H
 
 #include <cmath>
+#include <cstddef>
+#include <vector>
 
 #include <geometry_msgs/Point.h>
+#include <geometry_msgs/Quaternion.h>
+#include <geometry_msgs/Transform.h>
 
 namespace reactive_assistance
 {
@@ -77,9 +81,37 @@ namespace reactive_assistance
     return (std::abs(a - b) <= epsilon);
   }
 
+  // Non-owning view over planar points laid out as separate x/y coordinate arrays
+  struct PointSpan
+  {
+    const double *x;
+    const double *y;
+    std::size_t size;
+  };
+
   // Transform a point 'p' relative to a frame defined by the angle 'th' and origin point 'org'
   void transformPoint(const geometry_msgs::Point &org, double th, geometry_msgs::Point &p);
 
+  // Apply the rigid 'transform' to a point 'p', the rotation need not be normalised
+  void applyTransform(const geometry_msgs::Transform &transform, geometry_msgs::Point &p);
+
+  // Yaw angle of an orientation 'q'
+  inline double getYaw(const geometry_msgs::Quaternion &q)
+  {
+    return std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+  }
+
+  // Orientation of a planar heading 'th'
+  inline geometry_msgs::Quaternion quaternionFromYaw(double th)
+  {
+    geometry_msgs::Quaternion q;
+    q.x = q.y = 0.0;
+    q.z = std::sin(0.5 * th);
+    q.w = std::cos(0.5 * th);
+
+    return q;
+  }
+
   // Check if a 'target' angle is between two other angles (i.e. the interior of the gap)
   // Look at https://www.xarg.org/2010/06/is-an-angle-between-two-other-angles/ for implementation
   bool isBetweenAngles(double target, double first, double second);
@@ -94,6 +126,40 @@ namespace reactive_assistance
   // Return whether an intersection occurred and the closest intersecting point as 'out'
   bool circleIntersect(const geometry_msgs::Point &p1, const geometry_msgs::Point &p2, const geometry_msgs::Point &c,
                        double r, geometry_msgs::Point &out);
+
+  // Distance from a point 'p' to the segment (a->b)
+  double segmentDistance(const geometry_msgs::Point &p, const geometry_msgs::Point &a, const geometry_msgs::Point &b);
+
+  // Check if the point 'p' rotated about 'c' by any angle between zero and 'sweep' (counterclockwise if positive) meets
+  // the segment (a->b), i.e. if the arc it moves along crosses or touches it
+  bool arcCrossesSegment(const geometry_msgs::Point &p, const geometry_msgs::Point &c, double sweep,
+                         const geometry_msgs::Point &a, const geometry_msgs::Point &b);
+
+  // Check if the point 'p' shifted by any fraction of (dx, dy) meets the segment (a->b)
+  bool shiftCrossesSegment(const geometry_msgs::Point &p, double dx, double dy, const geometry_msgs::Point &a,
+                           const geometry_msgs::Point &b);
+
+  // Outline of the polygon 'poly' with every edge pushed out by 'margin', the vertices moving to where the pushed edges
+  // meet, so that it covers every point within the margin of the polygon
+  void offsetPolygon(const std::vector<geometry_msgs::Point> &poly, double margin, std::vector<geometry_msgs::Point> &out);
+
+  //==============================================================================
+  // BATCHED VARIANTS (branch-free loops over whole obstacle sets)
+  //==============================================================================
+
+  // Transform every point of 'pts' relative to the frame (org, th), writing into (out_x, out_y)
+  // Output arrays may alias the input arrays for an in-place transform
+  void transformPoints(const geometry_msgs::Point &org, double th, const PointSpan &pts, double *out_x, double *out_y);
+
+  // Check each line (p1[k]->p2[k]) against the fixed line (p3->p4), setting hit[k] and the intersection (out_x[k], out_y[k])
+  // Intersections are only meaningful where hit[k] is set, returns the number of hits
+  std::size_t lineIntersect(const PointSpan &p1, const PointSpan &p2, const geometry_msgs::Point &p3,
+                            const geometry_msgs::Point &p4, unsigned char *hit, double *out_x, double *out_y);
+
+  // Check the fixed line (p1->p2) against 'n' circles centred at 'c' with radii 'r[k]', setting hit[k] and the closest
+  // intersection (out_x[k], out_y[k]). Intersections are only meaningful where hit[k] is set, returns the number of hits
+  std::size_t circleIntersect(const geometry_msgs::Point &p1, const geometry_msgs::Point &p2, const geometry_msgs::Point &c,
+                              const double *r, std::size_t n, unsigned char *hit, double *out_x, double *out_y);
 } /* namespace reactive_assistance */
 
 #endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef REACTIVE_ASSISTANCE_NS_ENGINE_HOST_H
+#define REACTIVE_ASSISTANCE_NS_ENGINE_HOST_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <reactive_assistance/beam_table.hpp>
+#include <reactive_assistance/planning_engine.hpp>
+#include <reactive_assistance/robot_profile.hpp>
+
+namespace reactive_assistance
+{
+  // Work run by the host against the engine of one instance
+  typedef boost::function<void (PlanningEngine &)> EngineJob;
+
+  // Runs many independent planner instances in one process, e.g. the robots of a fleet simulation
+  // Every instance has its own engine built from its own profile and settings, so their maps, traces and profilers
+  // are isolated, while the beam tables are shared and a single pool of worker threads serves them all. The jobs
+  // posted to an instance run one at a time and in order, jobs of different instances run in parallel
+  class EngineHost
+  {
+    public:
+      // Constructor & destructor, a worker per core if 'threads' is zero. The destructor runs the queued jobs first
+      explicit EngineHost(std::size_t threads = 0);
+      ~EngineHost();
+
+      // Add an instance and return its id, 'config' is given the shared beam tables
+      std::size_t addInstance(const RobotProfile &rp, const EngineConfig &config = EngineConfig());
+
+      // Queue 'job' for the instance 'id', never blocks
+      void post(std::size_t id, const EngineJob &job);
+      // Block until every job queued so far has run
+      void wait();
+
+      // Engine of the instance 'id', only to be used while none of its jobs is queued
+      PlanningEngine &getEngine(std::size_t id) { return *instances_[id]->engine; }
+
+      std::size_t getInstanceCount() const;
+      std::size_t getThreadCount() const { return workers_.size(); }
+      const BeamTableCache &getBeamTables() const { return *beam_tables_; }
+
+    private:
+      struct Instance
+      {
+        PlanningEngine *engine;
+        std::deque<EngineJob> jobs;
+        // Whether the instance is ready or running, it is then not put in the ready queue again
+        bool scheduled;
+      };
+
+      void workerLoop();
+
+      boost::shared_ptr<BeamTableCache> beam_tables_;
+      std::vector<Instance *> instances_;
+
+      // Guards the instances, the ready queue and the counts
+      mutable boost::mutex mutex_;
+      boost::condition_variable ready_cond_;
+      boost::condition_variable idle_cond_;
+      // Instances with a job to run and no worker on them
+      std::deque<std::size_t> ready_;
+      // Jobs queued or running
+      std::size_t pending_;
+      bool running_;
+
+      std::vector<boost::thread *> workers_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
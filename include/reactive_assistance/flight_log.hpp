@@ -0,0 +1,202 @@
+#ifndef REACTIVE_ASSISTANCE_NS_FLIGHT_LOG_H
+#define REACTIVE_ASSISTANCE_NS_FLIGHT_LOG_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <geometry_msgs/Transform.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <reactive_assistance/trace_recorder.hpp>
+
+namespace reactive_assistance
+{
+  // Flight log: a directory of fixed-size, memory-mapped segment files that records are appended to. Each segment is
+  //   [FlightSegmentHeader][FlightIndexEntry x index_capacity][records...]
+  // Records are 8-byte aligned, and the index holds the offset of every record keyed by a non-decreasing log time so
+  // that seeks are binary searches. Segments are numbered in writing order, and the oldest ones are deleted to keep
+  // the directory within its disk budget
+  static const boost::uint32_t FLIGHT_LOG_MAGIC = 0x474c4652;  // "RFLG"
+  static const boost::uint16_t FLIGHT_LOG_VERSION = 1;
+
+  enum FlightRecordType
+  {
+    FLIGHT_SCAN = 1,
+    FLIGHT_CYCLE = 2
+  };
+
+  struct FlightSegmentHeader
+  {
+    boost::uint32_t magic;
+    boost::uint16_t version;
+    boost::uint16_t reserved;
+    // Byte offsets of the index and the records, and the number of index entries
+    boost::uint64_t index_offset;
+    boost::uint64_t index_capacity;
+    boost::uint64_t data_offset;
+    // Committed end of the records and number of records, published last so that readers of a live segment only see
+    // complete records
+    boost::uint64_t data_end;
+    boost::uint64_t count;
+  };
+
+  struct FlightIndexEntry
+  {
+    // Log time, the record stamp made non-decreasing over the segment
+    boost::int64_t stamp_ns;
+    boost::uint64_t offset;
+  };
+
+  struct FlightRecordHeader
+  {
+    boost::uint16_t type;
+    boost::uint16_t reserved;
+    // Payload bytes following the header, before padding
+    boost::uint32_t size;
+    boost::int64_t stamp_ns;
+  };
+
+  // Scan payload, followed by the 'encoded_size' bytes of delta coded ranges
+  struct FlightScanRecord
+  {
+    float angle_min;
+    float angle_increment;
+    float range_min;
+    float range_max;
+    // Laser to base transform: translation x, y, z and rotation x, y, z, w
+    float laser_to_base[7];
+    // Metres per range quantum
+    float range_step;
+    boost::uint32_t beams;
+    boost::uint32_t encoded_size;
+  };
+
+  // Planning cycle payload: the decision trace with the odometry and goal it was computed from
+  struct FlightCycleRecord
+  {
+    TraceRecord trace;
+    // Odometry pose (x, y, yaw) and velocities (vx, wz)
+    float odom[5];
+    // Goal in the robot frame, if 'has_goal'
+    float goal_x;
+    float goal_y;
+    boost::uint8_t has_goal;
+    boost::uint8_t reserved[7];
+  };
+
+  // Quantise 'ranges' to uint16 multiples of 'step' (0xFFFF for no return) and append them to 'out' as zigzag
+  // varints of the differences between neighbouring beams
+  void encodeRanges(const std::vector<float> &ranges, float step, std::vector<boost::uint8_t> &out);
+  // Decode 'beams' ranges, returns false if the bytes run out
+  bool decodeRanges(const boost::uint8_t *data, std::size_t size, boost::uint32_t beams, float step, std::vector<float> &ranges);
+
+  // Appends records to the segments of a flight log directory. Not thread-safe, meant to be owned by a single writer
+  class FlightLogWriter
+  {
+    public:
+      // Constructor & destructor. Segments of 'segment_bytes' are written to 'dir', the oldest being deleted to keep
+      // the directory within 'budget_bytes'
+      FlightLogWriter(const std::string &dir, std::size_t segment_bytes, std::size_t budget_bytes);
+      ~FlightLogWriter();
+
+      // Whether the directory could be set up
+      bool isOpen() const { return open_; }
+
+      // Append a record made of a fixed part and an optional variable part, false on I/O error
+      bool append(FlightRecordType type, boost::int64_t stamp_ns, const void *fixed, std::size_t fixed_size,
+                  const void *extra = NULL, std::size_t extra_size = 0);
+
+      // Start writing a new segment, truncating the current one to its used size
+      void roll();
+
+    private:
+      bool openSegment();
+      void closeSegment();
+      // Delete the oldest segments until 'incoming' more bytes fit the budget
+      void enforceBudget(std::size_t incoming);
+
+      std::string dir_;
+      std::size_t segment_bytes_;
+      std::size_t budget_bytes_;
+      bool open_;
+
+      // Number of the next segment and the segments on disk, oldest first
+      boost::uint64_t next_seq_;
+      std::vector<std::string> segments_;
+
+      // Current segment mapping
+      int fd_;
+      boost::uint8_t *base_;
+      std::size_t mapped_bytes_;
+      boost::int64_t last_stamp_ns_;
+  };
+
+  // Zero-copy view of a record within a mapped segment
+  class FlightRecordView
+  {
+    public:
+      FlightRecordView() : header(NULL), payload(NULL) {}
+      ~FlightRecordView() {}
+
+      FlightRecordType type() const { return static_cast<FlightRecordType>(header->type); }
+      boost::int64_t stamp() const { return header->stamp_ns; }
+
+      // Cycle record in place, NULL for other records
+      const FlightCycleRecord *cycle() const;
+      // Decode a scan record, false for other records or if corrupt
+      bool decodeScan(sensor_msgs::LaserScan &scan, geometry_msgs::Transform &laser_to_base) const;
+
+      const FlightRecordHeader *header;
+      const boost::uint8_t *payload;
+  };
+
+  // Reads the segments of a flight log directory, or a single segment file, through read-only mappings. Records are
+  // visited in writing order, and seeks by log time take a binary search over the segments and over an index
+  class FlightLogReader
+  {
+    public:
+      // Constructor & destructor
+      FlightLogReader();
+      ~FlightLogReader();
+
+      // Map every segment of 'path', false if there is none
+      bool open(const std::string &path);
+
+      // Next record, false at the end of the log
+      bool next(FlightRecordView &view);
+      // Position at the first record logged at or after 'stamp_ns'
+      void seek(boost::int64_t stamp_ns);
+      // Back to the first record
+      void rewind() { seg_ = 0; rec_ = 0; }
+
+      std::size_t getNumSegments() const { return segments_.size(); }
+      // Total number of records currently committed
+      boost::uint64_t getCount() const;
+
+    private:
+      struct Segment
+      {
+        const boost::uint8_t *base;
+        std::size_t size;
+
+        const FlightSegmentHeader *header() const { return reinterpret_cast<const FlightSegmentHeader *>(base); }
+        const FlightIndexEntry *index() const { return reinterpret_cast<const FlightIndexEntry *>(base + header()->index_offset); }
+        // Committed records, safe to read while the writer appends, never more than the index holds
+        boost::uint64_t count() const;
+        // Record 'i' of the index, NULL if it runs past the committed records or the mapping, e.g. in a damaged file
+        const FlightRecordHeader *record(boost::uint64_t i) const;
+      };
+
+      void close();
+
+      std::vector<Segment> segments_;
+      // Cursor: segment and record within it
+      std::size_t seg_;
+      boost::uint64_t rec_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#ifndef REACTIVE_ASSISTANCE_NS_FLIGHT_RECORDER_H
+#define REACTIVE_ASSISTANCE_NS_FLIGHT_RECORDER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread.hpp>
+
+#include <geometry_msgs/Point.h>
+#include <geometry_msgs/Transform.h>
+#include <nav_msgs/Odometry.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <reactive_assistance/flight_log.hpp>
+#include <reactive_assistance/trace_recorder.hpp>
+
+namespace reactive_assistance
+{
+  // Settings of the always-on flight recorder
+  class FlightRecorderConfig
+  {
+    public:
+      FlightRecorderConfig()
+                          : segment_bytes(64 << 20)
+                          , budget_bytes(static_cast<std::size_t>(1) << 30)
+                          , queue_capacity(256)
+                          , max_beams(4096)
+                          , range_step(0.001f)
+      {}
+      ~FlightRecorderConfig() {}
+
+      // Flight log directory, its segment size and the disk budget the oldest segments are deleted to stay within
+      std::string dir;
+      std::size_t segment_bytes;
+      std::size_t budget_bytes;
+
+      // Records that can wait for the writer thread, and the largest scan they can hold
+      std::size_t queue_capacity;
+      std::size_t max_beams;
+
+      // Range quantum (m), the largest range kept is 65534 quanta
+      float range_step;
+  };
+
+  // Records scans and planning cycles to a flight log from the control threads without ever blocking them
+  // Callers copy their record into a slot of a bounded lock-free queue, and a background thread encodes the slots
+  // and appends them to the memory-mapped log. Records are dropped and counted when the queue is full
+  class FlightRecorder
+  {
+    public:
+      // Constructor & destructor, the destructor writes out the queued records
+      explicit FlightRecorder(const FlightRecorderConfig &config);
+      ~FlightRecorder();
+
+      // Whether the log directory could be set up
+      bool isOpen() const { return writer_->isOpen(); }
+
+      // Queue a scan, with the transform from the laser to the robot base frame
+      void recordScan(const sensor_msgs::LaserScan &scan, const geometry_msgs::Transform &laser_to_base);
+      // Queue a finished planning cycle with the odometry and the robot frame goal, if any, it was computed from
+      void recordCycle(const TraceRecord &rec, const nav_msgs::Odometry &odom, const geometry_msgs::Point *goal);
+
+      // Records written to the log and dropped so far
+      boost::uint64_t getWritten() const { return written_.load(boost::memory_order_relaxed); }
+      boost::uint64_t getDropped() const { return dropped_.load(boost::memory_order_relaxed); }
+
+    private:
+      struct Slot
+      {
+        // Vyukov sequence: equal to the enqueue position when free, one past it once filled
+        boost::atomic<std::size_t> seq;
+
+        FlightRecordType type;
+        boost::int64_t stamp_ns;
+        FlightScanRecord scan;
+        std::vector<float> ranges;
+        FlightCycleRecord cycle;
+      };
+
+      // Claim a free slot, NULL if the queue is full
+      Slot *claim(std::size_t &pos);
+      void writerLoop();
+      // Append the records queued so far, return the number written
+      std::size_t drain();
+
+      FlightRecorderConfig config_;
+
+      boost::scoped_array<Slot> slots_;
+      std::size_t mask_;
+      boost::atomic<std::size_t> enqueue_pos_;
+      // Only touched by the writer thread
+      std::size_t dequeue_pos_;
+      std::vector<boost::uint8_t> encoded_;
+
+      FlightLogWriter *writer_;
+      boost::thread *thread_;
+      boost::atomic<bool> running_;
+
+      boost::atomic<boost::uint64_t> written_;
+      boost::atomic<boost::uint64_t> dropped_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
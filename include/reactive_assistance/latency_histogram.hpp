@@ -0,0 +1,52 @@
+#ifndef REACTIVE_ASSISTANCE_NS_LATENCY_HISTOGRAM_H
+#define REACTIVE_ASSISTANCE_NS_LATENCY_HISTOGRAM_H
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+
+namespace reactive_assistance 
+{
+  // Summary statistics of the latencies recorded over a period, ns
+  struct LatencySummary
+  {
+    boost::uint64_t count;
+    double mean;
+    double p50;
+    double p99;
+    double max;
+  };
+
+  // HDR-style log-linear histogram of latencies in ns, with a relative precision of ~3% up to ~68 s
+  // Recording is wait-free (a single relaxed increment per sample) and can be done from any thread
+  class LatencyHistogram
+  {
+    public:
+      // Sub-buckets per power of two, sets the relative precision
+      static const int SUB_BUCKET_BITS = 5;
+      static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+      // Largest power of two tracked, larger samples are clamped
+      static const int MAX_EXPONENT = 36;
+      static const int NUM_BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+      // Constructor & destructor
+      LatencyHistogram();
+      ~LatencyHistogram() {}
+
+      // Record a latency sample
+      void record(boost::int64_t ns);
+
+      // Summarise the samples recorded since the last call and start a new period
+      void collect(LatencySummary &summary);
+
+    private:
+      // Bucket index of a sample and highest value falling into a bucket
+      static int bucketIndex(boost::uint64_t v);
+      static boost::uint64_t bucketUpperBound(int idx);
+
+      boost::atomic<boost::uint64_t> counts_[NUM_BUCKETS];
+      boost::atomic<boost::uint64_t> total_;
+      boost::atomic<boost::uint64_t> max_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef REACTIVE_ASSISTANCE_NS_MAP_SNAPSHOT_H
+#define REACTIVE_ASSISTANCE_NS_MAP_SNAPSHOT_H
+
+#include <limits>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <ros/time.h>
+
+#include <reactive_assistance/obstacle.hpp>
+#include <reactive_assistance/gap.hpp>
+#include <reactive_assistance/range_index.hpp>
+#include <reactive_assistance/segment.hpp>
+
+namespace reactive_assistance 
+{
+  // Immutable view of the obstacles and gaps computed from a single laser scan
+  class MapSnapshot
+  { 
+    public:
+      MapSnapshot() 
+                 : version(0)
+                 , range_max(0.0)
+                 , min_obs_dist(std::numeric_limits<double>::max())
+                 , obstacles_ns(0)
+                 , gaps_ns(0)
+      {}
+      ~MapSnapshot() {}
+
+      // Incremented for every processed scan, zero before the first scan arrives
+      boost::uint64_t version;
+      // Stamp of the scan the snapshot was computed from
+      ros::Time stamp;
+      // Max range of the scanner, obstacles at this distance are non-obstacle points
+      double range_max;
+      // Closest obstacle distance
+      double min_obs_dist;
+
+      // Obstacles and filtered gaps detected in the environment
+      std::vector<Obstacle> obstacles;
+      std::vector<Gap> gaps;
+      // Closest obstacle distance per direction, built along with the obstacles
+      RangeIndex range_index;
+      // Obstacles fitted into line segments, and the indices of those left over as single points. Both are empty if the
+      // obstacles were not segmented
+      std::vector<Segment> segments;
+      std::vector<std::size_t> residuals;
+
+      // Time spent computing the obstacles and gaps, ns
+      boost::uint32_t obstacles_ns;
+      boost::uint32_t gaps_ns;
+  };
+
+  typedef boost::shared_ptr<MapSnapshot> MapSnapshotPtr;
+  typedef boost::shared_ptr<const MapSnapshot> MapSnapshotConstPtr;
+} /* namespace reactive_assistance */
+     
+#endif
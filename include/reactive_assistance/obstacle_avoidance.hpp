@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 
+#include <boost/atomic.hpp>
 #include <boost/thread.hpp>
 
 #include <ros/ros.h>
@@ -11,83 +12,130 @@
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/Twist.h>
 #include <nav_msgs/Odometry.h>
+#include <sensor_msgs/LaserScan.h>
+#include <std_srvs/Trigger.h>
 
 #include <tf2_ros/buffer.h>
 
-#include <reactive_assistance/react_ass_types.hpp>
-#include <reactive_assistance/robot_profile.hpp>
-#include <reactive_assistance/trajectory.hpp>
-#include <reactive_assistance/obstacle_map.hpp>
+#include <reactive_assistance/callback_spinner.hpp>
+#include <reactive_assistance/flight_recorder.hpp>
+#include <reactive_assistance/planning_engine.hpp>
+#include <reactive_assistance/realtime.hpp>
+#include <reactive_assistance/scan_pipeline.hpp>
+#include <reactive_assistance/snapshot_export.hpp>
+#include <reactive_assistance/visualiser.hpp>
 
 namespace reactive_assistance 
 {
-  // Represents the obstacle avoidance algorithm that generates safe navigation commands
+  // ROS node adapter over the planning engine: loads the parameters, resolves the tf frames, and wires the topics
   class ObstacleAvoidance 
   {
     public:
-      // Constructor & destructor
-      ObstacleAvoidance(tf2_ros::Buffer &tf);
+      // Constructor & destructor, topics are resolved in 'nh' and parameters read from 'nh_priv', the handles of the
+      // nodelet when loaded into a manager. A nodelet does not own its process, whose memory is then left unlocked by
+      // the real-time profile. Throws std::invalid_argument if the parameters cannot describe a robot
+      ObstacleAvoidance(tf2_ros::Buffer &tf, ros::NodeHandle nh = ros::NodeHandle(), ros::NodeHandle nh_priv = ros::NodeHandle("~"),
+                        bool owns_process = true);
       ~ObstacleAvoidance();
 
+      void scanCallback(const sensor_msgs::LaserScan::ConstPtr &scan);
       void odomCallback(const nav_msgs::Odometry::ConstPtr &odom);
       void goalCallback(const geometry_msgs::PoseStamped::ConstPtr &goal);
-      void cmdCallback(const geometry_msgs::Twist::ConstPtr &twist);
+      // Joystick commands come with their receipt time, for the input to safe command latency
+      void cmdCallback(const ros::MessageEvent<geometry_msgs::Twist const> &event);
+
+      // Service to dump the decision trace of the most recent planning cycles to a CSV file
+      bool dumpTraceCallback(std_srvs::Trigger::Request &req, std_srvs::Trigger::Response &res);
+      // Periodically publish the stage latency percentiles as diagnostics
+      void diagnosticsCallback(const ros::WallTimerEvent &event);
 
     private:
-      // Compute motion command to navigate a safe trajectory
-      void computeMotionCommand(const Trajectory &safe_traj, geometry_msgs::Twist &assist) const;
-      // Find assistive command for the simulated trajectory 'traj'
-      void findAssistiveCommand(const Trajectory &traj, geometry_msgs::Twist &assist) const;
-      // Return goal point specified by a 'global' planner
-      TrajPtr getGlobalTrajectory() const;
-      // Return goal point of simulated trajectory
-      TrajPtr simulateTrajectory(const geometry_msgs::Twist &twist_msg) const;
+      // Publish the command of a planning cycle and record the cycle, handing its debug data to the visualiser
+      // The odometry and robot frame goal the command was computed from go to the flight recorder
+      void publishResult(const ros::Publisher &pub, PlanningResult &result, const VisualFramePtr &frame,
+                         const nav_msgs::Odometry &odom, const geometry_msgs::Point *goal);
+      // Whether a planning call should gather its debug data for the visualiser
+      bool wantsFrame() const;
+      // Return the goal point specified by a 'global' planner in the robot frame
+      bool getGlobalGoal(geometry_msgs::Point &goal) const;
       // Checks to see if the robot has reached the global goal yet
       bool isGoalReached() const;
       // Navigate towards a global goal
       void navigationLoop(double rate);
+      // Slow tier of two-tier shared control: plan the assistive decision for the latest input on every new snapshot
+      void assistLoop(double rate);
       // Local planner patience during navigation loop
       double planner_patience_;
       
       tf2_ros::Buffer &tf_buffer_;
 
-      // Robot footprint and kinematic constraints
-      RobotProfile *robot_profile_;
-      // Obstacle map where gaps are computed and navigation functions are performed
-      ObstacleMap *obs_map_;
+      // Headless planner computing the safe commands
+      PlanningEngine *engine_;
+      // Debug visualisations, published off the control path
+      Visualiser *visualiser_;
+      // Flight log of the scans and planning cycles, NULL unless enabled
+      FlightRecorder *flight_recorder_;
+      // Shared-memory export of the planning cycles, NULL unless enabled
+      SnapshotExporter *snapshot_exporter_;
+      // Threaded scan processing stages, NULL if scans are processed in their callback
+      ScanPipeline *scan_pipeline_;
+      // Directory the decision trace is dumped into
+      std::string trace_dump_dir_;
 
       // TF frames
       std::string robot_frame_;
       std::string odom_frame_;
       std::string world_frame_;
 
-      // Simulation time and discretisation
-      double sim_time_;
-      double sim_granularity_;
-
       // Obstacle avoidance  control loop thread
       boost::thread *control_thread_;
+      // Cleared on destruction, a nodelet can be unloaded while its node handles are still valid
+      boost::atomic<bool> running_;
+      // Plan as soon as each map snapshot is ready, the control rate being only the minimum rate
+      bool replan_on_scan_;
+      SpinnerSchedule navigation_schedule_;
+      // Paces the fixed-rate loop under the real-time profile, NULL otherwise
+      JitterMonitor *jitter_monitor_;
+
+      // Joystick commands only go through the fast tier, the gap search running per scan on the slow tier thread
+      bool two_tier_control_;
+      // Slow tier thread, NULL unless two-tier control is enabled
+      boost::thread *assist_thread_;
+      SpinnerSchedule assist_schedule_;
+
+      // Spinner threads of the scan, command, odometry and goal callback queues
+      CallbackSpinner *scan_spinner_;
+      CallbackSpinner *cmd_spinner_;
+      CallbackSpinner *odom_spinner_;
+      CallbackSpinner *goal_spinner_;
 
       // Odom and mutex objects
-      boost::mutex odom_mutex_;
+      mutable boost::mutex odom_mutex_;
       nav_msgs::Odometry curr_odom_;
 
-      // Global goal pose and flag to confirm availability
-      bool available_goal_;
+      // Latest joystick input and whether one has arrived yet, for the slow tier
+      mutable boost::mutex input_mutex_;
+      geometry_msgs::Twist curr_input_;
+      bool has_input_;
+
+      // Global goal pose and flag to confirm availability, the pose and plan time are guarded by the mutex
+      boost::atomic<bool> available_goal_;
+      mutable boost::mutex goal_mutex_;
       geometry_msgs::PoseStamped curr_goal_;
       ros::Time last_valid_plan_;
       
       // Publishers & subscribers
       ros::Publisher safe_cmd_pub_;
       ros::Publisher auto_cmd_pub_;
-      ros::Publisher traj_pub_;
-      ros::Publisher obs_pub_;
-      ros::Publisher footprint_pub_;
-      ros::Publisher goal_pub_;
+      ros::Publisher diag_pub_;
 
+      ros::Subscriber laser_sub_;
       ros::Subscriber odom_sub_;
       ros::Subscriber goal_sub_;
       ros::Subscriber cmd_sub_;
+
+      ros::ServiceServer dump_trace_srv_;
+      ros::WallTimer diag_timer_;
   };
 } /* namespace reactive_assistance */
            
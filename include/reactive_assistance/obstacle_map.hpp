@@ -1,90 +1,163 @@
 #ifndef REACTIVE_ASSISTANCE_NS_OBSTACLE_MAP_H
 #define REACTIVE_ASSISTANCE_NS_OBSTACLE_MAP_H
 
-#include <string>
+#include <cstddef>
 #include <vector>
 
-#include <boost/thread.hpp>
-
-#include <ros/ros.h>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <sensor_msgs/LaserScan.h>
 #include <geometry_msgs/Point.h>
-
-#include <tf2_ros/buffer.h>
+#include <geometry_msgs/Transform.h>
 
 #include <reactive_assistance/react_ass_types.hpp>
+#include <reactive_assistance/beam_table.hpp>
 #include <reactive_assistance/robot_profile.hpp>
 #include <reactive_assistance/obstacle.hpp>
 #include <reactive_assistance/gap.hpp>
+#include <reactive_assistance/segment.hpp>
 #include <reactive_assistance/trajectory.hpp>
+#include <reactive_assistance/map_snapshot.hpp>
+#include <reactive_assistance/stage_profiler.hpp>
 
 namespace reactive_assistance 
 {
+  // Verdict of the range index on a trajectory, settled without the exact geometry when it is not NAV_UNKNOWN
+  enum NavBound
+  {
+    NAV_UNKNOWN = 0,
+    NAV_CLEAR,
+    NAV_BLOCKED
+  };
+
+  // Fewest obstacle points a line segment stands for, shorter runs are left as single points
+  static const std::size_t MIN_SEGMENT_POINTS = 4;
+
   // Represents the map construct for maintaining obstacles and gaps based on laser scan data
   class ObstacleMap 
   {
     public:
-      // Constructor & destructor
-      ObstacleMap(tf2_ros::Buffer &tf, const RobotProfile &rp);
+      // Constructor & destructor, scan stage latencies are recorded into 'profiler' if given, and the beam directions
+      // are looked up in 'beam_tables' if given rather than computed for every scan. The obstacles of every scan are
+      // fitted into line segments within 'segment_tolerance' if it is positive
+      ObstacleMap(const RobotProfile &rp, StageProfiler *profiler = NULL, BeamTableCache *beam_tables = NULL,
+                  double segment_tolerance = 0.0);
       ~ObstacleMap() {}
 
-      // Callback for laser scan
-      void scanCallback(const sensor_msgs::LaserScan::ConstPtr &scan);
+      // Compute a new snapshot from a laser 'scan', given the transform from the laser frame to the robot base frame
+      void updateScan(const sensor_msgs::LaserScan &scan, const geometry_msgs::Transform &laser_to_base);
+      // Swap in a snapshot whose obstacles and gaps were computed by the caller through the stages below, numbering
+      // it after the current one. Snapshots must be published in scan order
+      void publishSnapshot(const MapSnapshotPtr &map);
+
+      // Return the latest map snapshot, every query for one planning call should be made against the same snapshot
+      MapSnapshotConstPtr getSnapshot() const;
+      // Block until a snapshot newer than 'version' is swapped in or 'timeout' elapses, return the latest snapshot
+      // Waiting also ends once 'wake' is set, if given
+      MapSnapshotConstPtr waitForSnapshot(boost::uint64_t version, const boost::posix_time::time_duration &timeout,
+                                          const boost::atomic<bool> *wake = NULL) const;
+      // Make the callers of waitForSnapshot check their 'wake' flag again
+      void wakeWaiters() const;
 
       // Return the closest gap from in_gaps according to either the angular or Euclidean distance
       GapPtr findClosestGap(const Trajectory &traj, const std::vector<Gap> &in_gaps, bool euclid, int &idx) const;
-      // Find whether an input 'gap' is admissible or not, and return the vectors of "virtual" gaps and their clearances
-      void findVirtualGaps(const Gap &gap, std::vector<GapPtr> &virt_gaps, std::vector<double> &clearances) const;
+      // Find whether an input 'gap' of the 'map' is admissible or not, and return the vectors of "virtual" gaps and their clearances
+      void findVirtualGaps(const MapSnapshot &map, const Gap &gap, std::vector<GapPtr> &virt_gaps, std::vector<double> &clearances) const;
       // Compute sub-goal associated with the input gap
       void findSubGoal(const Gap &gap, geometry_msgs::Point &sub_goal) const;
 
       // Check for safety in navigating a trajectory around a provided list of 'obstacles' and return the list of colliding obstacles
       bool isNavigable(const Trajectory &traj, const std::vector<Obstacle> &obstacles, std::vector<Obstacle> &coll_obstacles) const;
-
-      // Getter for the obstacles detected in the environment
-      const std::vector<Obstacle> &getObstacles() const { return obstacles_; }
-      // Getter for the gaps detected in the environment
-      const std::vector<Gap> &getGaps() const { return gaps_; }
-      // Getter for the closest obstacle distance
-      double getClosestDistance() const { return min_obs_dist_; }
-
-    private:
-      // Compute the obstacles in the environment based on scanner readings
-      void updateObstacles();
-      // Performs the gap search either clockwise/counterclockwise dependening on right/left
-      void gapSearch(const Obstacle &obs, int n, bool right, std::vector<Gap> &gaps, int &next_ind) const;
-      // Compute the gaps based on the 'obstacles' surrounding the robot
-      void updateGaps();
+      // Check every trajectory of 'trajs' around the same 'obstacles' in one pass, setting 'navigable' per trajectory
+      // Same verdicts as above, but only the obstacles within reach of the footprint along each arc are tested
+      void isNavigable(const std::vector<Trajectory> &trajs, const std::vector<Obstacle> &obstacles,
+                       std::vector<unsigned char> &navigable) const;
+      // Same verdict for a single trajectory, stopping at the first colliding obstacle
+      bool isNavigable(const Trajectory &traj, const std::vector<Obstacle> &obstacles) const;
+      // Same verdict around the obstacles of the 'map', settled by its range index whenever that is conclusive. If the
+      // map is segmented, its segments are checked against the footprint grown by the tolerance rather than point by
+      // point, which may find a collision the points alone would not
+      bool isNavigable(const MapSnapshot &map, const Trajectory &traj) const;
+      // Conservative verdict of the range index of the 'map' alone: NAV_CLEAR if no obstacle comes within reach of the
+      // footprint along 'traj', NAV_BLOCKED if one lies inside the footprint somewhere along it, else NAV_UNKNOWN
+      NavBound boundNavigable(const MapSnapshot &map, const Trajectory &traj) const;
+
+      // Stages of updateScan, also run on their own by the benchmarks and offline tools
+      // Compute the obstacles of the 'map' based on the scanner readings
+      void updateObstacles(const sensor_msgs::LaserScan &scan, const geometry_msgs::Transform &laser_to_base, MapSnapshot &map) const;
+      // Fit the obstacles of the 'map' into line segments, by splitting and merging the runs of consecutive points, and
+      // keep the points no segment stands for as residuals. Run by 'updateObstacles' when segmentation is on
+      void updateSegments(MapSnapshot &map) const;
+      // Detect the raw gaps between the obstacles of the 'map', before filtering
+      void searchGaps(const MapSnapshot &map, std::vector<Gap> &gaps) const;
+      // Compute the gaps of the 'map' based on its obstacles surrounding the robot
+      void updateGaps(MapSnapshot &map) const;
       // Filter out 'in_gaps' that are duplicates or do not exceed the min gap width and return filtered 'out_gaps'
       void filterGaps(const std::vector<Gap> &in_gaps, std::vector<Gap> &out_gaps) const;
-      // Compute clearance to obstacles while traversing a gap via an input trajectory
-      double computeClearance(const Trajectory &traj) const;
 
-      tf2_ros::Buffer &tf_buffer_;
+    private:
+      // Buffers of the batched intersection tests, reused across trajectories
+      struct CollisionScratch
+      {
+        std::vector<unsigned char> in_band;
+        std::vector<double> band_x;
+        std::vector<double> band_y;
+        std::vector<std::size_t> coll;
+        std::vector<double> aux;
+        std::vector<unsigned char> hits;
+        std::vector<double> pe_x;
+        std::vector<double> pe_y;
+      };
+
+      // Performs the gap search either clockwise/counterclockwise dependening on right/left
+      void gapSearch(const MapSnapshot &map, const Obstacle &obs, int n, bool right, std::vector<Gap> &gaps, int &next_ind) const;
+      // Compute clearance to the obstacles of the 'map' while traversing a gap via an input trajectory. Over a segmented
+      // map it is at most the tolerance above that of the points, and lower where a segment closes a narrow opening
+      double computeClearance(const MapSnapshot &map, const Trajectory &traj) const;
+      // Bounding box (x_min, x_max, y_min, y_max) of the path along 'traj', grown by 'lim'
+      void reachBox(const Trajectory &traj, double lim, double box[4]) const;
+      // Whether 'traj' is clear of the segments and residual points of the 'map'
+      bool isClearOfSegments(const MapSnapshot &map, const Trajectory &traj) const;
+      // Whether the 'seg' meets the grown footprint at the start of the path
+      bool touchesSegmentFootprint(const Segment &seg) const;
+      // Whether 'traj' is clear of the obstacles 'obs', only testing those within reach of the footprint along it
+      bool isClear(const Trajectory &traj, const PointSpan &obs, CollisionScratch &scratch) const;
+      // Append the indices into 'obs' of the obstacles colliding along 'traj', once per footprint edge they meet, stopping
+      // at the first one if 'first_only'
+      void findCollisions(const Trajectory &traj, const PointSpan &obs, bool first_only, CollisionScratch &scratch,
+                          std::vector<std::size_t> &coll) const;
 
       // Robot footprint and kinematic constraints
       RobotProfile robot_profile_;
 
-      // Robot base frame
-      std::string robot_frame_;
-
-      // Closest obstacle distance
-      double min_obs_dist_;
-
-      // Scan and mutex objects
+      // Serialises the snapshot updates
       boost::mutex scan_mutex_;
-      sensor_msgs::LaserScan scan_;
-
-      // Vectors of obstacles and gaps
-      std::vector<Obstacle> obstacles_;
-      std::vector<Gap> gaps_;
-
-      ros::Subscriber laser_sub_;
 
-      ros::Publisher gaps_pub_;
-      ros::Publisher virt_gaps_pub_;
-      ros::Publisher closest_gap_pub_;
+      // Latest map snapshot, swapped in whole once a scan has been processed
+      mutable boost::mutex snapshot_mutex_;
+      MapSnapshotConstPtr snapshot_;
+      // Signalled whenever a new snapshot is swapped in
+      mutable boost::condition_variable snapshot_cond_;
+
+      // Stage latency histograms, not owned
+      StageProfiler *profiler_;
+      // Beam directions, possibly shared with other maps, not owned
+      BeamTableCache *beam_tables_;
+      // Distance from the robot base to the furthest footprint vertex
+      double fp_radius_;
+      // Distance from the robot base to the closest footprint edge, zero if the base lies outside the footprint
+      double fp_inner_;
+
+      // Max distance of the obstacle points from the segments standing for them, zero if segmentation is off
+      double segment_tol_;
+      // Footprint grown by the segment tolerance, so that a segment meets it wherever its points meet the footprint,
+      // and the distance from the robot base to its furthest vertex
+      std::vector<geometry_msgs::Point> seg_footprint_;
+      double seg_fp_radius_;
   };
 } /* namespace reactive_assistance */
            
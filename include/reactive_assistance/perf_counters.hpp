@@ -0,0 +1,55 @@
+#ifndef REACTIVE_ASSISTANCE_NS_PERF_COUNTERS_H
+#define REACTIVE_ASSISTANCE_NS_PERF_COUNTERS_H
+
+#include <boost/cstdint.hpp>
+
+namespace reactive_assistance 
+{
+  // Hardware events counted around the planning stages
+  enum PerfCounter
+  {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    NUM_PERF_COUNTERS
+  };
+
+  // Short counter names, used as keys when reporting
+  static const char *const PERF_COUNTER_NAMES[NUM_PERF_COUNTERS] = {
+    "cycles",
+    "instructions",
+    "cache_misses",
+    "branch_misses"
+  };
+
+  // Running counts of every hardware event of a counter group
+  struct PerfSample
+  {
+    boost::uint64_t values[NUM_PERF_COUNTERS];
+  };
+
+  // Group of hardware counters of the calling thread (user space only), read together through perf_event_open
+  class PerfCounterGroup
+  {
+    public:
+      // Constructor & destructor, opening and closing the counters of the calling thread
+      PerfCounterGroup();
+      ~PerfCounterGroup();
+
+      // Whether all counters could be opened, fails without PMU access (e.g. perf_event_paranoid > 2 or in a VM)
+      bool isOpen() const { return open_; }
+
+      // Read the running counts of the group, one syscall
+      bool read(PerfSample &sample) const;
+
+      // Return the counter group of the calling thread, opened on first use
+      static PerfCounterGroup &forThisThread();
+
+    private:
+      int fds_[NUM_PERF_COUNTERS];
+      bool open_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
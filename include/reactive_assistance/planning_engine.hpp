@@ -0,0 +1,229 @@
+#ifndef REACTIVE_ASSISTANCE_NS_PLANNING_ENGINE_H
+#define REACTIVE_ASSISTANCE_NS_PLANNING_ENGINE_H
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <ros/time.h>
+
+#include <geometry_msgs/Point.h>
+#include <geometry_msgs/Transform.h>
+#include <geometry_msgs/Twist.h>
+#include <nav_msgs/Odometry.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <reactive_assistance/react_ass_types.hpp>
+#include <reactive_assistance/assist_cache.hpp>
+#include <reactive_assistance/beam_table.hpp>
+#include <reactive_assistance/robot_profile.hpp>
+#include <reactive_assistance/trajectory.hpp>
+#include <reactive_assistance/obstacle_map.hpp>
+#include <reactive_assistance/map_snapshot.hpp>
+#include <reactive_assistance/visual_frame.hpp>
+#include <reactive_assistance/trace_recorder.hpp>
+#include <reactive_assistance/stage_profiler.hpp>
+
+namespace reactive_assistance
+{
+  // Tunables of the planning engine that are not part of the robot profile
+  class EngineConfig
+  {
+    public:
+      EngineConfig()
+                  : sim_time(1.0)
+                  , sim_granularity(0.1)
+                  , fallback_samples_vx(11)
+                  , fallback_samples_vth(21)
+                  , assist_cache_size(0)
+                  , assist_cache_lin_quantum(0.01)
+                  , assist_cache_ang_quantum(0.01)
+                  , segment_tolerance(0.0)
+                  , decision_lin_tolerance(0.05)
+                  , decision_ang_tolerance(0.1)
+                  , trace_capacity(4096)
+      {
+        laser_to_base.rotation.w = 1.0;
+      }
+      ~EngineConfig() {}
+
+      // Simulation time and discretisation of the desired trajectory
+      double sim_time;
+      double sim_granularity;
+
+      // Grid of (v, w) commands sampled when no gap is admissible, the fallback is off if either count is zero
+      std::size_t fallback_samples_vx;
+      std::size_t fallback_samples_vth;
+
+      // Shared control cycles cached per snapshot, keyed by the input and odometry velocities quantised to the given
+      // m/s and rad/s. A hit may return the command planned for an input up to a quantum away. Zero turns it off
+      std::size_t assist_cache_size;
+      double assist_cache_lin_quantum;
+      double assist_cache_ang_quantum;
+
+      // Max distance of the obstacle points from the line segments fitted to every scan, collisions and clearances being
+      // computed over the segments and the points left over. Zero turns the segmentation off
+      double segment_tolerance;
+
+      // Two-tier control: a blocked input only follows the slow tier decision if that was planned for an input in the
+      // same direction and within these m/s and rad/s, else it stops until the slow tier has planned for the input
+      double decision_lin_tolerance;
+      double decision_ang_tolerance;
+
+      // Number of most recent planning cycles kept in the decision trace
+      std::size_t trace_capacity;
+
+      // Mounting of the laser on the robot base, used when a scan is given without a transform
+      geometry_msgs::Transform laser_to_base;
+
+      // Beam directions shared with other engines, e.g. those of an engine host, a private cache is made if NULL
+      boost::shared_ptr<BeamTableCache> beam_tables;
+  };
+
+  // Outcome of a single planning cycle
+  class PlanningResult
+  {
+    public:
+      PlanningResult() : start_ns(0) {}
+      ~PlanningResult() {}
+
+      // Safe command to execute
+      geometry_msgs::Twist cmd;
+      // Decision trace of the cycle: outcome, selected gap, clearances and stage latencies
+      TraceRecord trace;
+      // Map snapshot the cycle was planned against
+      MapSnapshotConstPtr map;
+      // Monotonic start of the cycle, ns
+      boost::int64_t start_ns;
+  };
+
+  // Assistive decision of the slow tier of two-tier shared control, applied by the fast tier until the next one
+  class AssistDecision
+  {
+    public:
+      AssistDecision() : valid(false)
+      {
+        std::memset(&trace, 0, sizeof(TraceRecord));
+      }
+      ~AssistDecision() {}
+
+      // Whether a decision has been planned yet
+      bool valid;
+      // Trace of the full planning: TRACE_ASSISTED with the robot frame 'goal' of the safe trajectory to follow,
+      // TRACE_SAMPLED with the fallback 'cmd' and the goal of its trajectory, or TRACE_NO_GAP with neither. The fast
+      // tier samples the fallback again from its own odometry rather than replay 'cmd'
+      TraceRecord trace;
+      geometry_msgs::Point goal;
+      geometry_msgs::Twist cmd;
+  };
+
+  // Headless reactive planner, free of any node handle, topic or tf dependency
+  // Scans may be processed on one thread while commands are computed on others
+  class PlanningEngine
+  {
+    public:
+      // Constructor & destructor
+      PlanningEngine(const RobotProfile &rp, const EngineConfig &config = EngineConfig());
+      ~PlanningEngine();
+
+      // Process a laser scan, given the transform from the laser frame to the robot base frame
+      void updateScan(const sensor_msgs::LaserScan &scan, const geometry_msgs::Transform &laser_to_base);
+      // Process a laser scan from the configured laser mounting
+      void updateScan(const sensor_msgs::LaserScan &scan);
+      // Swap in a snapshot computed through the obstacle map stages, e.g. by a pipeline spreading them over threads
+      void publishSnapshot(const MapSnapshotPtr &map) { obs_map_->publishSnapshot(map); }
+
+      // Shared control: make the 'input' command of the user safe. The trajectory pursued is the forward simulation of
+      // 'input' from the 'odom' state, or the straight arc to 'goal' (robot frame) if one is given. Without a goal or
+      // a 'frame', the outcome may come from the assist cache
+      void computeCommand(const geometry_msgs::Twist &input, const nav_msgs::Odometry &odom, const geometry_msgs::Point *goal,
+                          PlanningResult &result, VisualFrame *frame = NULL) const;
+      // Two-tier shared control, without a global goal
+      // Slow tier: run the full gap search for 'input' from the 'odom' state against the latest snapshot, and keep the
+      // decision for the fast tier. Meant to run once per new snapshot, off the command path
+      void planAssist(const geometry_msgs::Twist &input, const nav_msgs::Odometry &odom);
+      // Slow tier: block until a snapshot newer than 'version' is swapped in or the fast tier asks for a decision for
+      // a new input, and update 'version'. False if 'timeout' elapsed first
+      bool waitForAssist(boost::uint64_t &version, const boost::posix_time::time_duration &timeout);
+      // Fast tier: make 'input' safe with only the arc simulation, an early-exit collision check and the speed scaling,
+      // following the latest decision of the slow tier where the input is blocked. A blocked input the decision was
+      // not planned for is stopped, and the slow tier woken up to plan for it
+      void computeFastCommand(const geometry_msgs::Twist &input, const nav_msgs::Odometry &odom, PlanningResult &result,
+                              VisualFrame *frame = NULL) const;
+
+      // Autonomous navigation: drive towards 'goal' (robot frame)
+      void computeAutonomousCommand(const geometry_msgs::Point &goal, PlanningResult &result, VisualFrame *frame = NULL) const;
+
+      // Record a finished cycle into the decision trace and the latency histograms, 'now' is on the clock of the scan stamps
+      void recordCycle(PlanningResult &result, const ros::Time &now);
+
+      // One complete headless cycle: process 'scan', then compute and record the shared control command
+      void step(const sensor_msgs::LaserScan &scan, const nav_msgs::Odometry &odom, const geometry_msgs::Twist &input,
+                const geometry_msgs::Point *goal, PlanningResult &result);
+
+      // Simulated goal (robot frame) of the trajectory of every input twist from the 'odom' state, as used by shared control
+      void simulateGoals(const std::vector<geometry_msgs::Twist> &inputs, const nav_msgs::Odometry &odom,
+                         std::vector<geometry_msgs::Point> &goals) const;
+
+      // Find assistive command for the trajectory 'traj' blocked in the 'map', tracing the decision in 'rec' and optionally
+      // recording the gaps evaluated in 'frame'. Gaps are ranked by Euclidean distance if 'euclid', else by angular distance
+      void findAssistiveCommand(const MapSnapshot &map, const Trajectory &traj, bool euclid, geometry_msgs::Twist &assist,
+                                TraceRecord &rec, VisualFrame *frame = NULL) const;
+      // Fallback for shared control when no gap is admissible: sample the (v, w) commands reachable from the 'odom'
+      // velocities within the acceleration limits over the simulation time, check all of their trajectories in the
+      // 'map' in one pass and return the navigable one closest to 'input' as 'cmd'. False if none is navigable
+      bool sampleCommand(const MapSnapshot &map, const geometry_msgs::Twist &input, const nav_msgs::Odometry &odom,
+                         geometry_msgs::Twist &cmd) const;
+
+      // Accessors
+      const RobotProfile &getRobotProfile() const { return *robot_profile_; }
+      const ObstacleMap &getObstacleMap() const { return *obs_map_; }
+      StageProfiler &getProfiler() { return *profiler_; }
+      TraceRecorder &getTrace() { return *trace_; }
+      // NULL if the assist cache is off
+      const AssistCache *getAssistCache() const { return assist_cache_; }
+
+    private:
+      // Compute motion command to navigate a safe trajectory
+      void computeMotionCommand(const MapSnapshot &map, const Trajectory &safe_traj, geometry_msgs::Twist &assist) const;
+      // Gap search of findAssistiveCommand: the robot frame goal of the safe trajectory through the closest admissible
+      // gap, false if none is admissible
+      bool findSafeGoal(const MapSnapshot &map, const Trajectory &traj, bool euclid, geometry_msgs::Point &safe_goal,
+                        TraceRecord &rec, VisualFrame *frame) const;
+      // Initialise the result of a planning cycle against the latest map snapshot
+      void initResult(TraceSource source, PlanningResult &result) const;
+      // Return goal point of the trajectory simulated from the 'odom' state, optionally recording the simulated poses in 'frame'
+      TrajPtr simulateTrajectory(const geometry_msgs::Twist &twist_msg, const nav_msgs::Odometry &odom, VisualFrame *frame) const;
+      // End point (robot frame) and heading of the acceleration-limited rollout of 'twist_msg', without the poses on the way
+      void simulateGoal(const geometry_msgs::Twist &twist_msg, const nav_msgs::Odometry &odom, geometry_msgs::Point &goal,
+                        double &y_goal) const;
+      // Append the poses (odom frame) of every step of the rollout, for the visualisation
+      void simulatePoses(const geometry_msgs::Twist &twist_msg, const nav_msgs::Odometry &odom, std::vector<geometry_msgs::Pose> &poses) const;
+
+      EngineConfig config_;
+
+      // Robot footprint and kinematic constraints
+      RobotProfile *robot_profile_;
+      // Latency histograms of the planning stages
+      StageProfiler *profiler_;
+      // Obstacle map where gaps are computed and navigation functions are performed
+      ObstacleMap *obs_map_;
+      // Decision trace of the most recent planning cycles
+      TraceRecorder *trace_;
+      // Outcomes of recent shared control cycles, if enabled
+      AssistCache *assist_cache_;
+
+      // Latest decision of the slow tier
+      mutable boost::mutex decision_mutex_;
+      AssistDecision decision_;
+      // Set by the fast tier when the decision was not planned for its input
+      mutable boost::atomic<bool> assist_requested_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef REACTIVE_ASSISTANCE_NS_RANGE_INDEX_H
+#define REACTIVE_ASSISTANCE_NS_RANGE_INDEX_H
+
+#include <cstddef>
+#include <vector>
+
+#include <reactive_assistance/obstacle.hpp>
+
+namespace reactive_assistance
+{
+  // Angular bins of a range index, about a third of a degree each
+  static const std::size_t RANGE_INDEX_BINS = 1024;
+
+  // Closest obstacle distance over any window of directions around the robot base, in constant time
+  // The obstacles are binned by their direction in the robot base frame, so that the laser mounting does not matter, and
+  // a sparse table holds the minimum of every power-of-two run of bins. A window is answered by the two runs covering it,
+  // or by two more when it wraps around behind the robot
+  class RangeIndex
+  {
+    public:
+      // Constructor & destructor, an empty index knows nothing about the obstacles
+      RangeIndex()
+                : bins_(0)
+                , levels_(0)
+                , global_min_(0.0)
+      {}
+      ~RangeIndex() {}
+
+      // Index the 'obstacles', the buffers of a previous build are reused
+      void build(const std::vector<Obstacle> &obstacles, std::size_t bins = RANGE_INDEX_BINS);
+
+      // Whether the index was built
+      bool empty() const { return bins_ == 0; }
+
+      // Closest obstacle distance to the robot base over the directions from 'from' counterclockwise to 'to', rad in the
+      // robot base frame, or over the whole turn if they are a turn apart. Whole bins are looked up, so obstacles up to
+      // 'getSlack()' outside the window may count too, but the distance is never above the exact one. Infinity if there
+      // is no obstacle, zero if the index is empty
+      double minDistance(double from, double to) const;
+      // Closest obstacle distance over all the directions
+      double minDistance() const { return global_min_; }
+
+      // Largest angle an obstacle looked up by 'minDistance' may lie outside its window
+      double getSlack() const;
+
+    private:
+      // Bin of the direction 'th'
+      std::size_t binOf(double th) const;
+      // Closest distance over the bins 'first' to 'last' included, 'first' <= 'last'
+      float runMin(std::size_t first, std::size_t last) const;
+
+      std::size_t bins_;
+      std::size_t levels_;
+      // Level 'k' holds at 'k * bins_ + i' the min over the bins 'i' to 'i + 2^k - 1', rounded down to floats
+      std::vector<float> table_;
+      double global_min_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
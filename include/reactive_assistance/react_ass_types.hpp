@@ -3,16 +3,11 @@
 
 #include <boost/shared_ptr.hpp>
 
-#include <pcl_ros/point_cloud.h>
-#include <pcl/point_types.h>
-
 #include <reactive_assistance/gap.hpp>
 #include <reactive_assistance/trajectory.hpp>
 
 namespace reactive_assistance
 {
-  typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
-  typedef PointCloud::Ptr PointCloudPtr;
   typedef boost::shared_ptr<Gap> GapPtr;
   typedef boost::shared_ptr<Trajectory> TrajPtr;
 } /* namespace reactive_assistance */
@@ -0,0 +1,50 @@
+#ifndef REACTIVE_ASSISTANCE_NS_REALTIME_H
+#define REACTIVE_ASSISTANCE_NS_REALTIME_H
+
+#include <cstddef>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+
+#include <reactive_assistance/latency_histogram.hpp>
+
+namespace reactive_assistance
+{
+  // Stack touched by every real-time thread before its loop, so that it never page faults on its own stack
+  static const std::size_t REALTIME_STACK_BYTES = 256 * 1024;
+
+  // Lock the current and future pages of the process in memory, and pre-fault a heap of 'heap_bytes' that is never
+  // given back to the system, so that later allocations neither fault nor call into the kernel. Needs CAP_IPC_LOCK
+  // or a large enough memlock limit, returns false if the pages could not be locked
+  bool lockProcessMemory(std::size_t heap_bytes);
+
+  // Touch 'bytes' of the calling thread's stack
+  void prefaultStack(std::size_t bytes = REALTIME_STACK_BYTES);
+
+  // Paces a periodic loop on the monotonic clock and measures how late every wakeup is
+  // A deadline is missed for every period start a cycle is still running at, the loop then skips the
+  // periods it overran rather than trying to catch up
+  class JitterMonitor
+  {
+    public:
+      // Constructor & destructor, the first period starts now
+      explicit JitterMonitor(double rate);
+      ~JitterMonitor() {}
+
+      // Sleep until the start of the next period
+      void waitNextPeriod();
+
+      // Summarise the wakeup lateness and the deadlines missed since the last call, from any thread
+      void collect(LatencySummary &jitter, boost::uint64_t &missed);
+
+    private:
+      boost::int64_t period_ns_;
+      // Start of the next period, monotonic ns
+      boost::int64_t next_ns_;
+
+      LatencyHistogram wakeup_;
+      boost::atomic<boost::uint64_t> missed_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
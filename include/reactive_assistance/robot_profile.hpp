@@ -1,10 +1,13 @@
 #ifndef REACTIVE_ASSISTANCE_NS_ROBOT_PROFILE_H
 #define REACTIVE_ASSISTANCE_NS_ROBOT_PROFILE_H
 
+#include <cmath>
 #include <vector>
 
 #include <geometry_msgs/Point.h>
 
+#include <reactive_assistance/dist_util.hpp>
+
 namespace reactive_assistance 
 {
   // Represents the geometric and kinematic profile of the mobile robot
@@ -25,6 +28,50 @@ namespace reactive_assistance
       {}
       ~RobotProfile() {}
 
+      // Circular base: octagon footprint within the 'r' radius, fits through gaps of its diameter
+      static RobotProfile circular(double r, double dvs, double vx, double vth, double acc_x, double acc_th)
+      {
+        // Loop over 8 angles around a circle making a point each time
+        std::vector<geometry_msgs::Point> fp;
+        int N = 8;
+        geometry_msgs::Point pt;
+        for (int i = 0; i < N; ++i)
+        {
+          double angle = i * 2.0 * M_PI / N;
+          pt.x = std::cos(angle) * r;
+          pt.y = std::sin(angle) * r;
+
+          fp.push_back(pt);
+        }
+
+        return RobotProfile(fp, r, dvs, 2.0 * r, vx, vth, acc_x, acc_th);
+      }
+
+      // Rectangular base of halved width 'half_wid' and length 'half_len', the virtual radius is the halved width
+      static RobotProfile rectangular(double half_wid, double half_len, double dvs, double vx, double vth, double acc_x, double acc_th)
+      {
+        std::vector<geometry_msgs::Point> fp(4);
+        fp[0].x = -half_len;
+        fp[0].y = -half_wid;
+        fp[1].x = -half_len;
+        fp[1].y = half_wid;
+        fp[2].x = half_len;
+        fp[2].y = half_wid;
+        fp[3].x = half_len;
+        fp[3].y = -half_wid;
+
+        return RobotProfile(fp, half_wid, dvs, 2.0 * half_wid, vx, vth, acc_x, acc_th);
+      }
+
+      // Same robot with every edge of the footprint pushed outwards by 'margin', e.g. to plan with a safety inflation
+      RobotProfile inflate(double margin) const
+      {
+        std::vector<geometry_msgs::Point> fp;
+        offsetPolygon(footprint, margin, fp);
+
+        return RobotProfile(fp, radius + margin, dvel_safe, min_gap_width + 2.0 * margin, max_vx, max_vth, acc_vx_lim, acc_vth_lim);
+      }
+
       // Shape of robot approximated by a polygon
       std::vector<geometry_msgs::Point> footprint;
 
@@ -0,0 +1,86 @@
+#ifndef REACTIVE_ASSISTANCE_NS_SCAN_PIPELINE_H
+#define REACTIVE_ASSISTANCE_NS_SCAN_PIPELINE_H
+
+#include <cstddef>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <geometry_msgs/Transform.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <reactive_assistance/callback_spinner.hpp>
+#include <reactive_assistance/planning_engine.hpp>
+#include <reactive_assistance/spsc_queue.hpp>
+
+namespace reactive_assistance
+{
+  // Threaded stages of the scan pipeline, after the ingest in the scan callback and before the planning threads
+  enum PipelineStage
+  {
+    PIPELINE_OBSTACLES = 0,   // Obstacles from the scan ranges
+    PIPELINE_GAPS,            // Gap search and filtering, then the snapshot is published
+    NUM_PIPELINE_STAGES
+  };
+
+  static const char *const PIPELINE_STAGE_NAMES[NUM_PIPELINE_STAGES] = {"obstacles", "gaps"};
+
+  // Work done and dropped by a stage since the start
+  struct PipelineStageStats
+  {
+    // Scans the stage processed
+    boost::uint64_t processed;
+    // Scans dropped because the stage's input queue was full
+    boost::uint64_t overflow;
+    // Queued scans dropped because a newer one was waiting behind them
+    boost::uint64_t stale;
+  };
+
+  // Spreads the scan processing of the engine over a thread per stage, connected by single-producer single-consumer
+  // queues, so that a scan can be searched for gaps while the next one is turned into obstacles
+  // Each stage always works on the newest scan it has been handed, older queued ones are dropped and counted, and
+  // a scan that finds the next queue full is dropped and counted too. Snapshots are published in scan order
+  class ScanPipeline
+  {
+    public:
+      // Constructor & destructor, the destructor lets the stages finish their current scan
+      ScanPipeline(PlanningEngine &engine, std::size_t queue_size, const SpinnerSchedule schedules[NUM_PIPELINE_STAGES]);
+      ~ScanPipeline();
+
+      // Ingest: hand a scan over to the pipeline, with the transform from the laser frame to the robot base frame
+      // Never blocks, returns false if the scan was dropped
+      bool push(const sensor_msgs::LaserScan::ConstPtr &scan, const geometry_msgs::Transform &laser_to_base);
+
+      // Counts of every stage
+      void getStats(PipelineStageStats stats[NUM_PIPELINE_STAGES]) const;
+
+    private:
+      // A scan on its way through the stages, along with the snapshot it builds up
+      struct Job
+      {
+        sensor_msgs::LaserScan::ConstPtr scan;
+        geometry_msgs::Transform laser_to_base;
+        MapSnapshotPtr map;
+      };
+      typedef boost::shared_ptr<Job> JobPtr;
+
+      void stageLoop(PipelineStage stage);
+      void process(PipelineStage stage, Job &job);
+
+      PlanningEngine &engine_;
+      SpinnerSchedule schedules_[NUM_PIPELINE_STAGES];
+
+      // Input queue of every stage
+      SpscQueue<JobPtr> *queues_[NUM_PIPELINE_STAGES];
+      boost::thread *threads_[NUM_PIPELINE_STAGES];
+      boost::atomic<bool> running_;
+
+      boost::atomic<boost::uint64_t> processed_[NUM_PIPELINE_STAGES];
+      boost::atomic<boost::uint64_t> overflow_[NUM_PIPELINE_STAGES];
+      boost::atomic<boost::uint64_t> stale_[NUM_PIPELINE_STAGES];
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
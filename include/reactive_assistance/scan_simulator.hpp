@@ -0,0 +1,99 @@
+#ifndef REACTIVE_ASSISTANCE_NS_SCAN_SIMULATOR_H
+#define REACTIVE_ASSISTANCE_NS_SCAN_SIMULATOR_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <geometry_msgs/Pose2D.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <reactive_assistance/scan_world.hpp>
+
+namespace reactive_assistance 
+{
+  // Laser scanner model of the scan simulator
+  class ScanConfig
+  {
+    public:
+      ScanConfig()
+                : beams(720)
+                , fov(2.0 * M_PI)
+                , range_min(0.05)
+                , range_max(10.0)
+                , noise_std(0.0)
+                , noise_range_std(0.0)
+                , dropout_prob(0.0)
+                , no_return_inf(false)
+                , seed(0)
+                , cell_size(0.5)
+                , frame_id("base_link")
+      {}
+      ~ScanConfig() {}
+
+      // Number of beams spread over the field-of-view (rad) centred on the heading, a full circle has no repeated beam
+      int beams;
+      double fov;
+      double range_min;
+      double range_max;
+
+      // Gaussian range noise, stddev of 'noise_std' + 'noise_range_std' * range (m)
+      double noise_std;
+      double noise_range_std;
+      // Probability that a beam returns nothing, e.g. off glass or dark surfaces
+      double dropout_prob;
+      // Report beams without a return as +inf rather than range_max
+      bool no_return_inf;
+
+      // Seed of the noise and dropouts, every scan draws from its own stream derived from this and the scan id
+      boost::uint64_t seed;
+
+      // Edge length of the uniform grid accelerating the ray casts (m)
+      double cell_size;
+
+      std::string frame_id;
+  };
+
+  // Deterministic laser scan generator, ray casting a scan world through a uniform grid
+  // Const methods are safe to call from several threads at once
+  class ScanSimulator
+  {
+    public:
+      // Constructor & destructor
+      ScanSimulator(const ScanWorld &world, const ScanConfig &config = ScanConfig());
+      ~ScanSimulator() {}
+
+      // Distance along the ray from (x, y) in direction 'angle' to the closest shape, +inf if nothing within 'max_range'
+      double castRay(double x, double y, double angle, double max_range) const;
+
+      // Generate scan number 'scan_id' from the laser 'pose', the same id always gives the same scan
+      void simulate(const geometry_msgs::Pose2D &pose, boost::uint64_t scan_id, sensor_msgs::LaserScan &scan) const;
+
+      const ScanConfig &getConfig() const { return config_; }
+      const ScanWorld &getWorld() const { return world_; }
+
+    private:
+      // Bin every shape into the grid cells it overlaps
+      void buildGrid();
+      // Distance to the closest of the shapes binned in a cell, +inf if none is hit
+      double castCell(int cell, double ox, double oy, double dx, double dy) const;
+
+      ScanWorld world_;
+      ScanConfig config_;
+
+      // Grid origin, cell counts and inverse cell size
+      double grid_x0_;
+      double grid_y0_;
+      int grid_nx_;
+      int grid_ny_;
+      double inv_cell_;
+
+      // Shapes of each cell in CSR layout, circle indices are offset by the number of segments
+      std::vector<boost::uint32_t> cell_start_;
+      std::vector<boost::uint32_t> cell_items_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
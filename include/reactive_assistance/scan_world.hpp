@@ -0,0 +1,60 @@
+#ifndef REACTIVE_ASSISTANCE_NS_SCAN_WORLD_H
+#define REACTIVE_ASSISTANCE_NS_SCAN_WORLD_H
+
+#include <string>
+#include <vector>
+
+namespace reactive_assistance 
+{
+  // Straight wall (x1, y1)->(x2, y2)
+  struct WorldSegment
+  {
+    double x1, y1, x2, y2;
+  };
+
+  // Round obstacle, e.g. a pillar or a table leg
+  struct WorldCircle
+  {
+    double x, y, r;
+  };
+
+  // Static 2D world of walls and round obstacles that laser scans are ray cast in
+  //
+  // Text description, one shape per line, '#' starts a comment:
+  //   polygon x1 y1 x2 y2 x3 y3 ...   closed outline
+  //   polyline x1 y1 x2 y2 ...        open chain of walls
+  //   circle x y r
+  class ScanWorld
+  {
+    public:
+      // Constructor & destructor
+      ScanWorld() {}
+      ~ScanWorld() {}
+
+      // Add a closed outline through the 'n' points (xs[i], ys[i])
+      void addPolygon(const double *xs, const double *ys, int n);
+      // Add an open chain of walls through the 'n' points (xs[i], ys[i])
+      void addPolyline(const double *xs, const double *ys, int n);
+      void addSegment(double x1, double y1, double x2, double y2);
+      void addCircle(double x, double y, double r);
+
+      // Append the shapes of a text description, returns false with the offending line in 'error' if malformed
+      bool parse(const std::string &text, std::string &error);
+      // Append the shapes of a description file
+      bool load(const std::string &path, std::string &error);
+
+      // Distance from (x, y) to the closest shape, 0 inside a circle and +inf if the world is empty
+      double distanceTo(double x, double y) const;
+      // Distance from the closed outline through the 'n' points (xs[i], ys[i]) to the closest shape, 0 if any shape
+      // touches or lies inside it, and +inf if the world is empty
+      double distanceTo(const double *xs, const double *ys, int n) const;
+
+      // Bounding box of every shape, false if the world is empty
+      bool getBounds(double &x_min, double &y_min, double &x_max, double &y_max) const;
+
+      std::vector<WorldSegment> segments;
+      std::vector<WorldCircle> circles;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef REACTIVE_ASSISTANCE_NS_SEGMENT_H
+#define REACTIVE_ASSISTANCE_NS_SEGMENT_H
+
+#include <cstddef>
+
+#include <geometry_msgs/Point.h>
+
+namespace reactive_assistance 
+{
+  // Represents a run of consecutive obstacle points lying along a line, e.g. a wall
+  class Segment
+  { 
+    public:
+      Segment(const geometry_msgs::Point& s, const geometry_msgs::Point& e, std::size_t f, std::size_t l) 
+             : start(s)
+             , end(e)
+             , first(f)
+             , last(l)
+      {}
+      ~Segment() {}
+
+      // End points, the first and last obstacle points of the run, robot frame
+      geometry_msgs::Point start;
+      geometry_msgs::Point end;
+      // Indices of the first and last obstacles of the run, in beam order
+      std::size_t first;
+      std::size_t last;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
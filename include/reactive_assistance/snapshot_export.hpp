@@ -0,0 +1,229 @@
+#ifndef REACTIVE_ASSISTANCE_NS_SNAPSHOT_EXPORT_H
+#define REACTIVE_ASSISTANCE_NS_SNAPSHOT_EXPORT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+
+#include <reactive_assistance/trace_recorder.hpp>
+#include <reactive_assistance/visual_frame.hpp>
+
+namespace reactive_assistance
+{
+  // Snapshot export: a POSIX shared-memory object holding a ring of the most recent planning cycles. It is laid out as
+  //   [ShmExportHeader][slot 0]...[slot n-1], every slot being
+  //   [ShmSlotHeader][ShmObstacle x max_obstacles][ShmGap x max_gaps][ShmGap x max_virt_gaps][ShmPose x max_traj_poses]
+  // Every slot is guarded by a seqlock: its sequence is odd while the slot is being written, and readers retry a copy
+  // that saw the sequence change. Readers map the object read-only and never hold up the writer
+  static const boost::uint32_t SHM_EXPORT_MAGIC = 0x58455352;  // "RSEX"
+  static const boost::uint16_t SHM_EXPORT_VERSION = 1;
+
+  // Flags of an exported gap
+  enum ShmGapFlags
+  {
+    SHM_GAP_VALID = 1,          // Unset for the non-admissible virtual gaps
+    SHM_GAP_FRONT = 2,
+    SHM_GAP_CLOSE_RIGHT = 4
+  };
+
+  struct ShmObstacle
+  {
+    // Robot frame point, angle and distance wrt the robot base
+    float x;
+    float y;
+    float angle;
+    float distance;
+  };
+
+  struct ShmGap
+  {
+    // Right and left side points, robot frame
+    float right_x;
+    float right_y;
+    float left_x;
+    float left_y;
+    boost::uint32_t flags;
+  };
+
+  struct ShmPose
+  {
+    // Odom frame pose
+    float x;
+    float y;
+    float yaw;
+  };
+
+  struct ShmExportHeader
+  {
+    boost::uint32_t magic;
+    boost::uint16_t version;
+    boost::uint16_t slot_count;
+    // Capacities of the arrays of every slot
+    boost::uint32_t max_obstacles;
+    boost::uint32_t max_gaps;
+    boost::uint32_t max_virt_gaps;
+    boost::uint32_t max_traj_poses;
+    // Byte offset of the first slot and size of each slot
+    boost::uint64_t slots_offset;
+    boost::uint64_t slot_bytes;
+    // Number of the latest complete cycle, which lives in slot 'latest % slot_count', zero before the first one
+    boost::atomic<boost::uint64_t> latest;
+  };
+
+  struct ShmSlotHeader
+  {
+    // Seqlock sequence, twice the cycle number once the slot is complete
+    boost::atomic<boost::uint64_t> seq;
+
+    // Decision trace of the cycle
+    TraceRecord trace;
+    // Snapshot the cycle was planned against
+    boost::uint64_t map_version;
+    boost::int64_t map_stamp_ns;
+    float range_max;
+    float min_obs_dist;
+
+    // Chosen gap, invalid if none
+    ShmGap closest_gap;
+
+    // Elements used in each array, the arrays are truncated to their capacity
+    boost::uint32_t num_obstacles;
+    boost::uint32_t num_gaps;
+    boost::uint32_t num_virt_gaps;
+    boost::uint32_t num_traj_poses;
+  };
+
+  // A planning cycle as read back from the export
+  class ExportedCycle
+  {
+    public:
+      ExportedCycle()
+                   : cycle(0)
+                   , map_version(0)
+                   , map_stamp_ns(0)
+                   , range_max(0.0f)
+                   , min_obs_dist(0.0f)
+      {}
+      ~ExportedCycle() {}
+
+      // Number of the cycle since the export was created
+      boost::uint64_t cycle;
+
+      TraceRecord trace;
+      boost::uint64_t map_version;
+      boost::int64_t map_stamp_ns;
+      float range_max;
+      float min_obs_dist;
+      ShmGap closest_gap;
+
+      // Obstacle ring and filtered gaps of the snapshot
+      std::vector<ShmObstacle> obstacles;
+      std::vector<ShmGap> gaps;
+      // Virtual gaps of the chosen gap, and the forward simulated desired trajectory
+      std::vector<ShmGap> virt_gaps;
+      std::vector<ShmPose> traj_poses;
+  };
+
+  // Settings of the snapshot export
+  class SnapshotExportConfig
+  {
+    public:
+      SnapshotExportConfig()
+                          : slot_count(4)
+                          , max_obstacles(4096)
+                          , max_gaps(1024)
+                          , max_virt_gaps(256)
+                          , max_traj_poses(256)
+      {}
+      ~SnapshotExportConfig() {}
+
+      // Shared-memory object name, e.g. "/reactive_assistance"
+      std::string name;
+      // Cycles kept, readers slower than a cycle get the newest one rather than a torn one
+      std::size_t slot_count;
+
+      std::size_t max_obstacles;
+      std::size_t max_gaps;
+      std::size_t max_virt_gaps;
+      std::size_t max_traj_poses;
+  };
+
+  // Writes the planning cycles into the shared-memory export on a background thread
+  // The planning threads only swap the snapshot and trace of a cycle into a single lock-free slot, the newest cycle
+  // replacing any not yet written, so exporting neither takes a lock nor makes them gather any debug data
+  class SnapshotExporter
+  {
+    public:
+      // Constructor & destructor, the object is created anew and removed on destruction
+      explicit SnapshotExporter(const SnapshotExportConfig &config);
+      ~SnapshotExporter();
+
+      // Whether the shared-memory object could be set up
+      bool isOpen() const { return base_ != NULL; }
+
+      // Hand over the snapshot and decision trace of a planning cycle, and its debug data if it was gathered anyway
+      // The virtual gaps and the simulated trajectory are only exported for the cycles that come with a 'frame'
+      void post(const MapSnapshotConstPtr &map, const TraceRecord &trace, const VisualFramePtr &frame = VisualFramePtr());
+
+      // Cycles written so far
+      boost::uint64_t getWritten() const { return written_.load(boost::memory_order_relaxed); }
+
+    private:
+      // Planning cycle handed over to the export thread
+      struct PendingCycle
+      {
+        MapSnapshotConstPtr map;
+        TraceRecord trace;
+        VisualFramePtr frame;
+      };
+
+      void exportLoop();
+      void write(const PendingCycle &pending);
+
+      SnapshotExportConfig config_;
+
+      boost::uint8_t *base_;
+      std::size_t size_;
+      ShmExportHeader *header_;
+      // Only touched by the export thread
+      boost::uint64_t cycle_;
+
+      // Newest cycle not yet written, and a written one kept for reuse. Each is owned by whichever thread swaps it out
+      boost::atomic<PendingCycle *> pending_;
+      boost::atomic<PendingCycle *> spare_;
+
+      boost::thread *thread_;
+      boost::atomic<bool> running_;
+      boost::atomic<boost::uint64_t> written_;
+  };
+
+  // Reads the planning cycles of a snapshot export from another process
+  class SnapshotReader
+  {
+    public:
+      // Constructor & destructor, maps the export 'name' read-only
+      explicit SnapshotReader(const std::string &name);
+      ~SnapshotReader();
+
+      // Whether the export exists and has a known layout
+      bool isOpen() const { return header_ != NULL; }
+
+      // Number of the latest complete cycle, cheap enough to poll for new cycles
+      boost::uint64_t latestCycle() const;
+
+      // Copy the latest cycle into 'out', reusing its buffers. False if no cycle has been written yet, or if the
+      // writer kept overtaking the copy
+      bool readLatest(ExportedCycle &out, int max_retries = 8) const;
+
+    private:
+      const boost::uint8_t *base_;
+      std::size_t size_;
+      const ShmExportHeader *header_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
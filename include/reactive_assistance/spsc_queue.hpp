@@ -0,0 +1,127 @@
+#ifndef REACTIVE_ASSISTANCE_NS_SPSC_QUEUE_H
+#define REACTIVE_ASSISTANCE_NS_SPSC_QUEUE_H
+
+#include <cstddef>
+
+#include <boost/atomic.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace reactive_assistance
+{
+  // Bounded single-producer single-consumer queue
+  // Pushing and popping are a pair of atomic index updates. The consumer may block until an item arrives, in which
+  // case the producer takes a mutex to wake it, but only while the consumer is actually waiting
+  template <class T>
+  class SpscQueue
+  {
+    public:
+      // Constructor & destructor, the capacity is rounded up to a power of two
+      explicit SpscQueue(std::size_t capacity)
+                        : mask_(0)
+                        , head_(0)
+                        , tail_(0)
+                        , waiting_(false)
+      {
+        std::size_t size = 1;
+        while (size < capacity)
+        {
+          size <<= 1;
+        }
+        mask_ = size - 1;
+        slots_.reset(new T[size]);
+      }
+      ~SpscQueue() {}
+
+      // Producer: append 'item', false if the queue is full
+      bool push(const T &item)
+      {
+        std::size_t tail = tail_.load(boost::memory_order_relaxed);
+        if (tail - head_.load(boost::memory_order_acquire) > mask_)
+        {
+          return false;
+        }
+
+        slots_[tail & mask_] = item;
+        tail_.store(tail + 1, boost::memory_order_release);
+
+        // Pairs with the fence of a consumer about to wait, one of the two sides sees the other
+        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+        if (waiting_.load(boost::memory_order_relaxed))
+        {
+          boost::mutex::scoped_lock lock(wait_mutex_);
+          wait_cond_.notify_one();
+        }
+        return true;
+      }
+
+      // Consumer: take the newest item, dropping the older ones and counting them into 'skipped'
+      // False if the queue is empty
+      bool popLatest(T &item, std::size_t &skipped)
+      {
+        std::size_t head = head_.load(boost::memory_order_relaxed);
+        std::size_t tail = tail_.load(boost::memory_order_acquire);
+        if (head == tail)
+        {
+          return false;
+        }
+
+        // Release what the skipped slots hold right away rather than when they get overwritten
+        for (; head + 1 != tail; ++head)
+        {
+          slots_[head & mask_] = T();
+        }
+
+        item = slots_[head & mask_];
+        slots_[head & mask_] = T();
+        skipped = tail - 1 - head_.load(boost::memory_order_relaxed);
+        head_.store(tail, boost::memory_order_release);
+        return true;
+      }
+
+      // Consumer: as popLatest, waiting at most 'timeout' for an item
+      bool waitPopLatest(T &item, std::size_t &skipped, const boost::posix_time::time_duration &timeout)
+      {
+        if (popLatest(item, skipped))
+        {
+          return true;
+        }
+
+        {
+          boost::mutex::scoped_lock lock(wait_mutex_);
+          waiting_.store(true, boost::memory_order_relaxed);
+          boost::atomic_thread_fence(boost::memory_order_seq_cst);
+
+          if (empty())
+          {
+            wait_cond_.timed_wait(lock, timeout);
+          }
+          waiting_.store(false, boost::memory_order_relaxed);
+        }
+
+        return popLatest(item, skipped);
+      }
+
+      bool empty() const
+      {
+        return head_.load(boost::memory_order_acquire) == tail_.load(boost::memory_order_acquire);
+      }
+
+    private:
+      boost::scoped_array<T> slots_;
+      std::size_t mask_;
+
+      // Next slot to pop, only written by the consumer, and next slot to push, only written by the producer
+      boost::atomic<std::size_t> head_;
+      boost::atomic<std::size_t> tail_;
+
+      // Set while the consumer is blocked
+      boost::atomic<bool> waiting_;
+      boost::mutex wait_mutex_;
+      boost::condition_variable wait_cond_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
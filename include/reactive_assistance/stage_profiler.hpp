@@ -0,0 +1,108 @@
+#ifndef REACTIVE_ASSISTANCE_NS_STAGE_PROFILER_H
+#define REACTIVE_ASSISTANCE_NS_STAGE_PROFILER_H
+
+#include <ostream>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+
+#include <reactive_assistance/stage_timing.hpp>
+#include <reactive_assistance/latency_histogram.hpp>
+#include <reactive_assistance/perf_counters.hpp>
+#include <reactive_assistance/trace_recorder.hpp>
+
+namespace reactive_assistance 
+{
+  // Latency summaries of the planning pipeline over a reporting period
+  struct StageReport
+  {
+    LatencySummary stages[NUM_PLANNING_STAGES];
+    // Whole command cycle, from receiving the input to publishing the command
+    LatencySummary cycle;
+    // Age of the scan the published command was planned against
+    LatencySummary scan_to_cmd;
+    // From receiving a joystick input to publishing its safe command, including the time queued
+    LatencySummary input_to_cmd;
+
+    // Hardware counter totals of every stage and the number of stage runs they cover, if enabled
+    bool counters_enabled;
+    boost::uint64_t counter_runs[NUM_PLANNING_STAGES];
+    boost::uint64_t counters[NUM_PLANNING_STAGES][NUM_PERF_COUNTERS];
+  };
+
+  // Print the latency percentiles of a report as a table in us, leaving out the stages that never ran
+  void printStageReport(const StageReport &report, std::ostream &out);
+
+  // Latency histograms of every stage of the planning pipeline, shared by the scan and command threads
+  class StageProfiler
+  {
+    public:
+      // Constructor & destructor
+      StageProfiler();
+      ~StageProfiler() {}
+
+      // Record the latency of a single stage
+      void record(PlanningStage stage, boost::int64_t ns);
+      // Record the command path stages of a planning cycle traced in 'rec', skipping the ones that did not run
+      void recordCycle(const TraceRecord &rec, boost::int64_t cycle_ns, boost::int64_t scan_to_cmd_ns);
+      // Record the latency from receiving a joystick input to publishing its safe command
+      void recordInputToCmd(boost::int64_t ns) { input_to_cmd_.record(ns); }
+
+      // Turn hardware counter sampling around the stages on or off
+      void enableCounters(bool enable) { counters_enabled_.store(enable, boost::memory_order_relaxed); }
+      bool countersEnabled() const { return counters_enabled_.load(boost::memory_order_relaxed); }
+      // Accumulate the hardware counts of a single run of a stage
+      void recordCounters(PlanningStage stage, const PerfSample &begin, const PerfSample &end);
+
+      // Summarise the latencies since the last call and start a new period
+      void collect(StageReport &report);
+
+    private:
+      LatencyHistogram stages_[NUM_PLANNING_STAGES];
+      LatencyHistogram cycle_;
+      LatencyHistogram scan_to_cmd_;
+      LatencyHistogram input_to_cmd_;
+
+      boost::atomic<bool> counters_enabled_;
+      boost::atomic<boost::uint64_t> counter_runs_[NUM_PLANNING_STAGES];
+      boost::atomic<boost::uint64_t> counters_[NUM_PLANNING_STAGES][NUM_PERF_COUNTERS];
+  };
+
+  // Samples the hardware counters of the calling thread around a stage for as long as it is in scope,
+  // costs a single flag check when counter sampling is off
+  class StageCounterScope
+  {
+    public:
+      StageCounterScope(StageProfiler *profiler, PlanningStage stage)
+                       : profiler_(NULL)
+                       , group_(NULL)
+                       , stage_(stage)
+      {
+        if ((profiler != NULL) && profiler->countersEnabled())
+        {
+          group_ = &PerfCounterGroup::forThisThread();
+          if (group_->read(begin_))
+          {
+            profiler_ = profiler;
+          }
+        }
+      }
+
+      ~StageCounterScope()
+      {
+        PerfSample end;
+        if ((profiler_ != NULL) && group_->read(end))
+        {
+          profiler_->recordCounters(stage_, begin_, end);
+        }
+      }
+
+    private:
+      StageProfiler *profiler_;
+      const PerfCounterGroup *group_;
+      PlanningStage stage_;
+      PerfSample begin_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef REACTIVE_ASSISTANCE_NS_STAGE_TIMING_H
+#define REACTIVE_ASSISTANCE_NS_STAGE_TIMING_H
+
+#include <time.h>
+
+#include <boost/cstdint.hpp>
+
+namespace reactive_assistance 
+{
+  // Stages of the scan processing and planning pipeline that are timed
+  enum PlanningStage
+  {
+    STAGE_UPDATE_OBSTACLES = 0,
+    STAGE_UPDATE_GAPS,
+    STAGE_SIMULATE_TRAJECTORY,
+    STAGE_IS_NAVIGABLE,
+    STAGE_FIND_VIRTUAL_GAPS,
+    STAGE_ASSISTIVE_COMMAND,
+    STAGE_PUBLISH,
+    NUM_PLANNING_STAGES
+  };
+
+  // Short stage names, used as keys when reporting
+  static const char *const PLANNING_STAGE_NAMES[NUM_PLANNING_STAGES] = {
+    "update_obstacles",
+    "update_gaps",
+    "simulate_trajectory",
+    "is_navigable",
+    "find_virtual_gaps",
+    "assistive_command",
+    "publish"
+  };
+
+  // Monotonic clock reading in nanoseconds (vDSO call, no syscall)
+  inline boost::int64_t monotonicNanos()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return static_cast<boost::int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+  }
+} /* namespace reactive_assistance */
+     
+#endif
@@ -0,0 +1,127 @@
+#ifndef REACTIVE_ASSISTANCE_NS_TRACE_RECORDER_H
+#define REACTIVE_ASSISTANCE_NS_TRACE_RECORDER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <reactive_assistance/stage_timing.hpp>
+
+namespace reactive_assistance 
+{
+  // Source of a planning cycle
+  enum TraceSource
+  {
+    TRACE_SHARED_CONTROL = 0,
+    TRACE_AUTONOMOUS
+  };
+
+  // How the output command of a planning cycle was decided
+  enum TraceOutcome
+  {
+    TRACE_DEADZONE = 0,   // Input within the joystick deadzone or transform error, zero command
+    TRACE_FREE_PATH,      // Desired trajectory navigable, command passed through
+    TRACE_ASSISTED,       // Admissible gap found, assistive command computed
+    TRACE_NO_GAP,         // No admissible gap left, zero command
+    TRACE_SAMPLED,        // No admissible gap left, closest navigable sampled command
+    NUM_TRACE_OUTCOMES
+  };
+
+  // Flags of a planning cycle
+  enum TraceFlags
+  {
+    TRACE_FLAG_CACHED = 1,    // Outcome of an earlier cycle with the same snapshot and quantised velocities, no stage ran
+    TRACE_FLAG_DEFERRED = 2   // Fast tier cycle, the gap search was that of the latest slow tier decision
+  };
+
+  // Names used in the CSV traces
+  static const char *const TRACE_SOURCE_NAMES[] = {"shared", "autonomous"};
+  static const char *const TRACE_OUTCOME_NAMES[NUM_TRACE_OUTCOMES] = {"deadzone", "free_path", "assisted", "no_gap", "sampled"};
+
+  // Fixed-size binary record of the decisions taken during a single planning cycle
+  struct TraceRecord
+  {
+    // Wall clock time of the cycle, ns since epoch
+    boost::int64_t stamp_ns;
+    // Version of the map snapshot the cycle was planned against
+    boost::uint64_t map_version;
+
+    boost::uint8_t source;
+    boost::uint8_t outcome;
+    // Closest gaps tried before an admissible one was found
+    boost::uint16_t gaps_evaluated;
+    // Virtual gaps constructed for the last gap tried
+    boost::uint16_t virt_iterations;
+    // TraceFlags
+    boost::uint16_t flags;
+
+    // Input and output twists (linear x, angular z)
+    float in_vx;
+    float in_wz;
+    float out_vx;
+    float out_wz;
+
+    // Right and left side points of the chosen gap, robot frame
+    float gap_right_x;
+    float gap_right_y;
+    float gap_left_x;
+    float gap_left_y;
+
+    // Clearance range over the virtual gaps of the chosen gap
+    float clearance_min;
+    float clearance_max;
+
+    // Time spent in each stage, scan stages are those of the snapshot used
+    boost::uint32_t stage_ns[NUM_PLANNING_STAGES];
+  };
+
+  // Write 'records' to 'path' as CSV, one cycle per line, return false on I/O error
+  bool writeTraceCsv(const std::vector<TraceRecord> &records, const std::string &path);
+  // Read back the records of a CSV trace, return false if it cannot be opened or a line is malformed
+  bool readTraceCsv(const std::string &path, std::vector<TraceRecord> &records);
+
+  // Lock-free ring buffer of the most recent trace records
+  // Writers claim a slot with a single atomic increment and publish it through a per-slot sequence number, so
+  // recording never blocks the control path and readers can copy out records while cycles keep being recorded
+  class TraceRecorder
+  {
+    public:
+      // Constructor & destructor, capacity is rounded up to a power of two
+      explicit TraceRecorder(std::size_t capacity);
+      ~TraceRecorder() {}
+
+      // Append a record, overwriting the oldest one once the ring is full
+      void record(const TraceRecord &rec);
+
+      // Copy the consistent records currently held, oldest first
+      void getRecords(std::vector<TraceRecord> &records) const;
+
+      // Write the records currently held to 'path' as CSV, return false on I/O error
+      bool dump(const std::string &path) const;
+
+      // Total number of records written so far
+      boost::uint64_t getCount() const { return head_.load(boost::memory_order_relaxed); }
+
+    private:
+      struct Slot
+      {
+        Slot() : seq(0) {}
+
+        // Odd whilst the record is being written, 2 * (index + 1) once written
+        boost::atomic<boost::uint64_t> seq;
+        TraceRecord rec;
+      };
+
+      std::size_t mask_;
+      boost::scoped_array<Slot> slots_;
+
+      // Index of the next slot to be claimed
+      boost::atomic<boost::uint64_t> head_;
+  };
+} /* namespace reactive_assistance */
+     
+#endif
@@ -0,0 +1,41 @@
+#ifndef REACTIVE_ASSISTANCE_NS_VISUAL_FRAME_H
+#define REACTIVE_ASSISTANCE_NS_VISUAL_FRAME_H
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <geometry_msgs/Pose.h>
+#include <geometry_msgs/PoseStamped.h>
+
+#include <reactive_assistance/react_ass_types.hpp>
+#include <reactive_assistance/obstacle.hpp>
+#include <reactive_assistance/gap.hpp>
+#include <reactive_assistance/map_snapshot.hpp>
+
+namespace reactive_assistance 
+{
+  // Debug data gathered during a single planning call, handed off to the visualiser as a whole
+  class VisualFrame
+  {
+    public:
+      VisualFrame() {}
+      ~VisualFrame() {}
+
+      // Map snapshot the planning call was made against
+      MapSnapshotConstPtr map;
+      // Obstacles colliding with the desired trajectory
+      std::vector<Obstacle> coll_obstacles;
+      // Last closest gap and its virtual gaps evaluated while searching for an assistive command
+      GapPtr closest_gap;
+      std::vector<GapPtr> virt_gaps;
+      // Forward simulated poses of the desired trajectory (odom frame)
+      std::vector<geometry_msgs::Pose> traj_poses;
+      // Simulated goal of the desired trajectory (robot frame), if any
+      boost::shared_ptr<geometry_msgs::PoseStamped> sim_goal;
+  };
+
+  typedef boost::shared_ptr<VisualFrame> VisualFramePtr;
+} /* namespace reactive_assistance */
+     
+#endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef REACTIVE_ASSISTANCE_NS_VISUALISER_H
+#define REACTIVE_ASSISTANCE_NS_VISUALISER_H
+
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+
+#include <ros/ros.h>
+
+#include <geometry_msgs/PoseStamped.h>
+#include <nav_msgs/Odometry.h>
+#include <visualization_msgs/Marker.h>
+
+#include <pcl_ros/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <reactive_assistance/react_ass_types.hpp>
+#include <reactive_assistance/robot_profile.hpp>
+#include <reactive_assistance/gap.hpp>
+#include <reactive_assistance/visual_frame.hpp>
+
+namespace reactive_assistance 
+{
+  class ObstacleMap;
+
+  typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
+  typedef PointCloud::Ptr PointCloudPtr;
+
+  // Publishes the debug visualisations on a low-priority thread at a capped rate, and only for topics with subscribers
+  class Visualiser
+  {
+    public:
+      // Constructor & destructor
+      Visualiser(const ObstacleMap &obs_map, const RobotProfile &rp, ros::NodeHandle nh, ros::NodeHandle nh_priv);
+      ~Visualiser();
+
+      // Whether any per-call debug topic is subscribed to, planning calls skip building a frame otherwise
+      bool isActive() const { return active_.load(boost::memory_order_relaxed); }
+
+      // Hand off the debug data of a planning call, replacing any frame not yet published
+      void post(const VisualFramePtr &frame);
+      // Hand off the latest odometry for the footprint visualisation
+      void postOdometry(const nav_msgs::Odometry::ConstPtr &odom);
+      // Hand off a newly received global goal to be echoed
+      void postGoal(const geometry_msgs::PoseStamped::ConstPtr &goal);
+
+    private:
+      // Publish the pending data to the subscribed topics
+      void publish();
+      // Visualisation loop, runs at the given rate with a lowered thread priority
+      void visualisationLoop(double rate);
+
+      // Append the right and left side points of each gap to a point cloud
+      void addGaps(const std::vector<GapPtr> &gaps, PointCloud &cloud) const;
+
+      // Obstacle map providing the latest snapshot for the gaps visualisation
+      const ObstacleMap &obs_map_;
+
+      // TF frames
+      std::string robot_frame_;
+      std::string odom_frame_;
+
+      // Footprint polygon as a list of lines, constant apart from its pose and stamp
+      visualization_msgs::Marker footprint_marker_;
+
+      // Pending data handed off by the planning calls and callbacks
+      boost::mutex pending_mutex_;
+      VisualFramePtr pending_frame_;
+      nav_msgs::Odometry::ConstPtr pending_odom_;
+      geometry_msgs::PoseStamped::ConstPtr pending_goal_;
+
+      // Version of the last snapshot whose gaps were published
+      boost::uint64_t gaps_version_;
+
+      // Set by the visualisation thread from the subscriber counts
+      boost::atomic<bool> active_;
+      boost::atomic<bool> running_;
+
+      boost::thread *vis_thread_;
+
+      // Publishers for debugging/visualisation purposes
+      ros::Publisher gaps_pub_;
+      ros::Publisher virt_gaps_pub_;
+      ros::Publisher closest_gap_pub_;
+      ros::Publisher traj_pub_;
+      ros::Publisher obs_pub_;
+      ros::Publisher footprint_pub_;
+      ros::Publisher goal_pub_;
+  };
+} /* namespace reactive_assistance */
+           
+#endif
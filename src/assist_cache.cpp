@@ -0,0 +1,84 @@
+#include <cmath>
+
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/assist_cache.hpp>
+
+namespace reactive_assistance
+{
+  AssistCache::AssistCache(std::size_t capacity, double lin_quantum, double ang_quantum)
+                          : lin_scale_(1.0 / lin_quantum)
+                          , ang_scale_(1.0 / ang_quantum)
+                          , mask_(0)
+                          , hits_(0)
+                          , misses_(0)
+  {
+    std::size_t size = 1;
+    while (size < capacity)
+    {
+      size <<= 1;
+    }
+
+    mask_ = size - 1;
+    entries_.resize(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      entries_[i].valid = false;
+    }
+  }
+
+  void AssistCache::makeKey(boost::uint64_t map_version, const geometry_msgs::Twist &input, const nav_msgs::Odometry &odom,
+                            AssistKey &key) const
+  {
+    key.map_version = map_version;
+    key.in_vx = static_cast<boost::int32_t>(std::lround(input.linear.x * lin_scale_));
+    key.in_wz = static_cast<boost::int32_t>(std::lround(input.angular.z * ang_scale_));
+    key.odom_vx = static_cast<boost::int32_t>(std::lround(odom.twist.twist.linear.x * lin_scale_));
+    key.odom_wz = static_cast<boost::int32_t>(std::lround(odom.twist.twist.angular.z * ang_scale_));
+  }
+
+  bool AssistCache::lookup(const AssistKey &key, geometry_msgs::Twist &cmd, TraceRecord &rec) const
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      const Entry &entry = entries_[slot(key)];
+      if (entry.valid && (entry.key == key))
+      {
+        cmd = entry.cmd;
+        rec = entry.rec;
+        lock.unlock();
+
+        hits_.fetch_add(1, boost::memory_order_relaxed);
+        return true;
+      }
+    }
+
+    misses_.fetch_add(1, boost::memory_order_relaxed);
+    return false;
+  }
+
+  void AssistCache::insert(const AssistKey &key, const geometry_msgs::Twist &cmd, const TraceRecord &rec)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    Entry &entry = entries_[slot(key)];
+    entry.valid = true;
+    entry.key = key;
+    entry.cmd = cmd;
+    entry.rec = rec;
+  }
+
+  //==============================================================================
+  // PRIVATE ASSIST CACHE METHODS (Utilities)
+  //==============================================================================
+
+  std::size_t AssistCache::slot(const AssistKey &key) const
+  {
+    // Mix the snapshot version and the quantised velocities
+    boost::uint64_t h = key.map_version;
+    h = h * 0x9E3779B97F4A7C15ull + static_cast<boost::uint32_t>(key.in_vx);
+    h = h * 0x9E3779B97F4A7C15ull + static_cast<boost::uint32_t>(key.in_wz);
+    h = h * 0x9E3779B97F4A7C15ull + static_cast<boost::uint32_t>(key.odom_vx);
+    h = h * 0x9E3779B97F4A7C15ull + static_cast<boost::uint32_t>(key.odom_wz);
+
+    return static_cast<std::size_t>(h ^ (h >> 29)) & mask_;
+  }
+} /* namespace reactive_assistance */
@@ -0,0 +1,62 @@
+#include <cmath>
+
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/beam_table.hpp>
+
+namespace reactive_assistance
+{
+  BeamTable::BeamTable(float angle_min, float angle_increment, std::size_t beams)
+                      : angle_min_(angle_min)
+                      , angle_increment_(angle_increment)
+                      , angles_(beams)
+                      , cos_(beams)
+                      , sin_(beams)
+  {
+    for (unsigned int i = 0; i < beams; ++i)
+    {
+      // Same expression as the obstacle update over the message fields
+      angles_[i] = angle_min + i * angle_increment;
+      cos_[i] = std::cos(angles_[i]);
+      sin_[i] = std::sin(angles_[i]);
+    }
+  }
+
+  BeamTableConstPtr BeamTableCache::get(const sensor_msgs::LaserScan &scan)
+  {
+    {
+      boost::shared_lock<boost::shared_mutex> lock(mutex_);
+      for (std::size_t i = 0; i < tables_.size(); ++i)
+      {
+        if (tables_[i]->matches(scan))
+        {
+          return tables_[i];
+        }
+      }
+    }
+
+    boost::unique_lock<boost::shared_mutex> lock(mutex_);
+    // Another instance may have added it in the meantime
+    for (std::size_t i = 0; i < tables_.size(); ++i)
+    {
+      if (tables_[i]->matches(scan))
+      {
+        return tables_[i];
+      }
+    }
+
+    if (tables_.size() >= MAX_BEAM_TABLES)
+    {
+      return BeamTableConstPtr();
+    }
+
+    BeamTableConstPtr table(new BeamTable(scan.angle_min, scan.angle_increment, scan.ranges.size()));
+    tables_.push_back(table);
+    return table;
+  }
+
+  std::size_t BeamTableCache::size() const
+  {
+    boost::shared_lock<boost::shared_mutex> lock(mutex_);
+    return tables_.size();
+  }
+} /* namespace reactive_assistance */
@@ -0,0 +1,85 @@
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <reactive_assistance/realtime.hpp>
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/callback_spinner.hpp>
+
+namespace reactive_assistance
+{
+  CallbackSpinner::CallbackSpinner(const std::string &name, const SpinnerSchedule &schedule)
+                                  : name_(name)
+                                  , schedule_(schedule)
+                                  , spin_thread_(NULL)
+  {
+    spin_thread_ = new boost::thread(boost::bind(&CallbackSpinner::spinLoop, this));
+  }
+
+  CallbackSpinner::~CallbackSpinner()
+  {
+    if (spin_thread_ != NULL)
+    {
+      queue_.disable();
+      spin_thread_->join();
+      delete spin_thread_;
+    }
+
+    queue_.clear();
+  }
+
+  void CallbackSpinner::spinLoop()
+  {
+    applyThreadSchedule(name_ + " spinner", schedule_);
+
+    ros::NodeHandle nh;
+    while (nh.ok() && queue_.isEnabled())
+    {
+      queue_.callAvailable(ros::WallDuration(0.1));
+    }
+  }
+
+  void applyThreadSchedule(const std::string &name, const SpinnerSchedule &schedule)
+  {
+    if (schedule.cpu >= 0)
+    {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(schedule.cpu, &cpus);
+
+      int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      if (err != 0)
+      {
+        ROS_WARN("Could not pin the %s thread to CPU %d: %s", name.c_str(), schedule.cpu, std::strerror(err));
+      }
+    }
+
+    if (schedule.priority > 0)
+    {
+      // Real-time scheduling needs CAP_SYS_NICE or an rtprio limit, the thread keeps running without it
+      sched_param param;
+      param.sched_priority = schedule.priority;
+
+      int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+      if (err != 0)
+      {
+        ROS_WARN("Could not give the %s thread real-time priority %d: %s", name.c_str(), schedule.priority,
+                 std::strerror(err));
+      }
+
+      // Fault the stack in now rather than in the middle of a cycle
+      prefaultStack();
+    }
+    else if (schedule.priority < 0)
+    {
+      if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), -schedule.priority) != 0)
+      {
+        ROS_WARN("Could not lower the priority of the %s thread", name.c_str());
+      }
+    }
+  }
+} /* namespace reactive_assistance */
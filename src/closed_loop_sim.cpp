@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <geometry_msgs/Point.h>
+
+#include <reactive_assistance/dist_util.hpp>
+#include <reactive_assistance/stage_timing.hpp>
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/closed_loop_sim.hpp>
+
+namespace reactive_assistance
+{
+  // Free space of a world on a square grid, labelled by 4-connected component. The grid spans the bounds of the world
+  // plus a border of cells, so that whatever lies outside the walls is a single component
+  struct FreeSpaceGrid
+  {
+    double x0;
+    double y0;
+    double cell;
+    int cols;
+    int rows;
+    // Component of every cell, -1 where the centre is closer than the clearance to a shape
+    std::vector<int> labels;
+
+    // Component of the cell around (x, y), -1 outside the grid
+    int labelAt(double x, double y) const
+    {
+      int col = static_cast<int>(std::floor((x - x0) / cell));
+      int row = static_cast<int>(std::floor((y - y0) / cell));
+      return ((col >= 0) && (col < cols) && (row >= 0) && (row < rows)) ? labels[row * cols + col] : -1;
+    }
+  };
+
+  // Label the free space of the 'world' within its bounds, return the largest component, -1 if there is no free cell
+  static int labelFreeSpace(const ScanWorld &world, double clearance, double x_min, double y_min, double x_max, double y_max,
+                            FreeSpaceGrid &grid)
+  {
+    // Fine enough for the passages the robot fits through to stay open
+    grid.cell = std::max(std::min(0.5 * clearance, 0.1), 0.01);
+    grid.x0 = x_min - grid.cell;
+    grid.y0 = y_min - grid.cell;
+    grid.cols = static_cast<int>(std::ceil((x_max - x_min) / grid.cell)) + 2;
+    grid.rows = static_cast<int>(std::ceil((y_max - y_min) / grid.cell)) + 2;
+
+    const int num_cells = grid.cols * grid.rows;
+    const int FREE = -2;
+    grid.labels.assign(num_cells, -1);
+    for (int c = 0; c < num_cells; ++c)
+    {
+      double x = grid.x0 + ((c % grid.cols) + 0.5) * grid.cell;
+      double y = grid.y0 + ((c / grid.cols) + 0.5) * grid.cell;
+      if (world.distanceTo(x, y) >= clearance)
+      {
+        grid.labels[c] = FREE;
+      }
+    }
+
+    // Flood fill, components are sized by their cells within the bounds, the border only connects the outside
+    int largest = -1;
+    std::size_t largest_size = 0;
+    std::vector<int> stack;
+    for (int seed = 0, label = 0; seed < num_cells; ++seed)
+    {
+      if (grid.labels[seed] != FREE)
+      {
+        continue;
+      }
+
+      std::size_t size = 0;
+      grid.labels[seed] = label;
+      stack.push_back(seed);
+      while (!stack.empty())
+      {
+        int c = stack.back();
+        stack.pop_back();
+
+        int col = c % grid.cols;
+        int row = c / grid.cols;
+        if ((col > 0) && (col < grid.cols - 1) && (row > 0) && (row < grid.rows - 1))
+        {
+          size++;
+        }
+
+        const int neighbours[4] = {(col > 0) ? c - 1 : -1, (col < grid.cols - 1) ? c + 1 : -1,
+                                   (row > 0) ? c - grid.cols : -1, (row < grid.rows - 1) ? c + grid.cols : -1};
+        for (int k = 0; k < 4; ++k)
+        {
+          if ((neighbours[k] >= 0) && (grid.labels[neighbours[k]] == FREE))
+          {
+            grid.labels[neighbours[k]] = label;
+            stack.push_back(neighbours[k]);
+          }
+        }
+      }
+
+      if (size > largest_size)
+      {
+        largest = label;
+        largest_size = size;
+      }
+      label++;
+    }
+
+    return largest;
+  }
+
+  bool sampleEpisodes(const ScanWorld &world, std::size_t count, double clearance, double min_dist, boost::uint64_t seed,
+                      std::vector<Episode> &episodes)
+  {
+    double x_min, y_min, x_max, y_max;
+    if (!world.getBounds(x_min, y_min, x_max, y_max))
+    {
+      return false;
+    }
+
+    // Poses are only drawn in the largest free region, which leaves out the insides of closed obstacles, the outside of
+    // a closed room, and any pocket the robot could not drive out of
+    FreeSpaceGrid grid;
+    int region = labelFreeSpace(world, clearance, x_min, y_min, x_max, y_max, grid);
+    if (region < 0)
+    {
+      return false;
+    }
+
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> ux(x_min, x_max), uy(y_min, y_max), uth(-M_PI, M_PI);
+
+    episodes.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      Episode &ep = episodes[i];
+      geometry_msgs::Pose2D *poses[2] = {&ep.start, &ep.goal};
+      bool found = false;
+
+      // Rejection sampling, bounded in case the world is too cluttered
+      for (int attempt = 0; (attempt < 100000) && !found; ++attempt)
+      {
+        for (int k = 0; k < 2; ++k)
+        {
+          poses[k]->x = ux(rng);
+          poses[k]->y = uy(rng);
+          poses[k]->theta = uth(rng);
+        }
+
+        found = (grid.labelAt(ep.start.x, ep.start.y) == region) && (grid.labelAt(ep.goal.x, ep.goal.y) == region) &&
+                (world.distanceTo(ep.start.x, ep.start.y) >= clearance) && (world.distanceTo(ep.goal.x, ep.goal.y) >= clearance) &&
+                (std::hypot(ep.goal.x - ep.start.x, ep.goal.y - ep.start.y) >= min_dist);
+      }
+
+      if (!found)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  ClosedLoopSimulator::ClosedLoopSimulator(const ScanSimulator &sim, const RobotProfile &rp, const EpisodeConfig &config,
+                                           const EngineConfig &engine_config)
+                                          : sim_(sim)
+                                          , robot_profile_(rp)
+                                          , config_(config)
+                                          , engine_(NULL)
+  {
+    engine_ = new PlanningEngine(robot_profile_.inflate(config_.inflation), engine_config);
+  }
+
+  ClosedLoopSimulator::~ClosedLoopSimulator()
+  {
+    if (engine_ != NULL)
+    {
+      delete engine_;
+    }
+  }
+
+  void ClosedLoopSimulator::run(const Episode &episode, boost::uint64_t id, EpisodeResult &result, StageProfiler *profiler)
+  {
+    result = EpisodeResult();
+
+    const ScanWorld &world = sim_.getWorld();
+    const int substeps = std::max(1, config_.substeps);
+    const double dt = config_.control_period / substeps;
+
+    geometry_msgs::Pose2D pose = episode.start;
+    double vx = 0.0;
+    double vth = 0.0;
+    double t = 0.0;
+    result.min_clearance = footprintClearance(world, pose);
+
+    sensor_msgs::LaserScan scan;
+    nav_msgs::Odometry odom;
+    geometry_msgs::Twist input;
+    PlanningResult plan;
+    geometry_msgs::Twist last_cmd;
+
+    for (boost::uint64_t step = 0; ; ++step)
+    {
+      if (std::hypot(episode.goal.x - pose.x, episode.goal.y - pose.y) <= config_.goal_tolerance)
+      {
+        result.outcome = EPISODE_REACHED;
+        break;
+      }
+
+      if (t >= config_.max_time)
+      {
+        result.outcome = EPISODE_TIMEOUT;
+        break;
+      }
+
+      // Sense: scan and odometry of the current state, the world frame doubles as the odometry frame
+      sim_.simulate(pose, (id << 32) | step, scan);
+      scan.header.stamp.fromNSec(static_cast<boost::uint64_t>(t * 1e9));
+
+      odom.pose.pose.position.x = pose.x;
+      odom.pose.pose.position.y = pose.y;
+      odom.pose.pose.orientation = quaternionFromYaw(pose.theta);
+      odom.twist.twist.linear.x = vx;
+      odom.twist.twist.angular.z = vth;
+
+      // Plan
+      boost::int64_t start = monotonicNanos();
+      engine_->updateScan(scan);
+
+      if (config_.mode == EPISODE_AUTONOMOUS)
+      {
+        // Goal in the robot frame
+        double dx = episode.goal.x - pose.x;
+        double dy = episode.goal.y - pose.y;
+        geometry_msgs::Point goal;
+        goal.x = std::cos(pose.theta) * dx + std::sin(pose.theta) * dy;
+        goal.y = -std::sin(pose.theta) * dx + std::cos(pose.theta) * dy;
+
+        engine_->computeAutonomousCommand(goal, plan);
+      }
+      else
+      {
+        userInput(pose, episode.goal, input);
+        engine_->computeCommand(input, odom, NULL, plan);
+      }
+
+      boost::int64_t cycle_ns = monotonicNanos() - start;
+      result.cmd_variation += std::abs(plan.cmd.linear.x - last_cmd.linear.x) + std::abs(plan.cmd.angular.z - last_cmd.angular.z);
+      last_cmd = plan.cmd;
+      result.planner_ns += cycle_ns;
+      result.cycles++;
+
+      if ((plan.trace.outcome == TRACE_ASSISTED) || (plan.trace.outcome == TRACE_NO_GAP) ||
+          (plan.trace.outcome == TRACE_SAMPLED))
+      {
+        result.assisted_cycles++;
+      }
+
+      if (profiler != NULL)
+      {
+        // Every cycle processes a fresh scan here, so the scan stages are recorded along with the cycle
+        profiler->record(STAGE_UPDATE_OBSTACLES, plan.trace.stage_ns[STAGE_UPDATE_OBSTACLES]);
+        profiler->record(STAGE_UPDATE_GAPS, plan.trace.stage_ns[STAGE_UPDATE_GAPS]);
+        profiler->recordCycle(plan.trace, cycle_ns, 0);
+      }
+
+      // Act: differential drive under the command, within the acceleration limits of the robot
+      double cmd_vx = sat(plan.cmd.linear.x, -robot_profile_.max_vx, robot_profile_.max_vx);
+      double cmd_vth = sat(plan.cmd.angular.z, -robot_profile_.max_vth, robot_profile_.max_vth);
+      bool collided = false;
+
+      for (int i = 0; (i < substeps) && !collided; ++i)
+      {
+        vx = (vx < cmd_vx) ? std::min(cmd_vx, vx + robot_profile_.acc_vx_lim * dt) : std::max(cmd_vx, vx - robot_profile_.acc_vx_lim * dt);
+        vth = (vth < cmd_vth) ? std::min(cmd_vth, vth + robot_profile_.acc_vth_lim * dt) : std::max(cmd_vth, vth - robot_profile_.acc_vth_lim * dt);
+
+        // Exact unicycle motion over the step, along an arc or a straight line
+        if (std::abs(vth) > 1e-9)
+        {
+          double th1 = pose.theta + vth * dt;
+          pose.x += (vx / vth) * (std::sin(th1) - std::sin(pose.theta));
+          pose.y -= (vx / vth) * (std::cos(th1) - std::cos(pose.theta));
+          pose.theta = proj(th1);
+        }
+        else
+        {
+          pose.x += vx * std::cos(pose.theta) * dt;
+          pose.y += vx * std::sin(pose.theta) * dt;
+        }
+
+        t += dt;
+        result.path_length += std::abs(vx) * dt;
+
+        double clearance = footprintClearance(world, pose);
+        result.min_clearance = std::min(result.min_clearance, clearance);
+        collided = (clearance <= 0.0);
+      }
+
+      if (collided)
+      {
+        result.outcome = EPISODE_COLLISION;
+        break;
+      }
+    }
+
+    result.time = t;
+    result.cmd_variation = (t > 0.0) ? result.cmd_variation / t : 0.0;
+  }
+
+  // Joystick input of the simulated user
+  void ClosedLoopSimulator::userInput(const geometry_msgs::Pose2D &pose, const geometry_msgs::Pose2D &goal,
+                                      geometry_msgs::Twist &input) const
+  {
+    double heading_err = proj(std::atan2(goal.y - pose.y, goal.x - pose.x) - pose.theta);
+
+    input.linear.x = robot_profile_.max_vx * std::max(0.0, std::cos(heading_err));
+    input.angular.z = sat(config_.user_gain * heading_err, -robot_profile_.max_vth, robot_profile_.max_vth);
+  }
+
+  double ClosedLoopSimulator::footprintClearance(const ScanWorld &world, const geometry_msgs::Pose2D &pose) const
+  {
+    const std::vector<geometry_msgs::Point> &fp = robot_profile_.footprint;
+    if (fp.empty())
+    {
+      return world.distanceTo(pose.x, pose.y) - robot_profile_.radius;
+    }
+
+    // Footprint in the world frame
+    double c = std::cos(pose.theta);
+    double s = std::sin(pose.theta);
+    std::vector<double> xs(fp.size()), ys(fp.size());
+    for (std::size_t i = 0; i < fp.size(); ++i)
+    {
+      xs[i] = pose.x + c * fp[i].x - s * fp[i].y;
+      ys[i] = pose.y + s * fp[i].x + c * fp[i].y;
+    }
+
+    return world.distanceTo(&xs[0], &ys[0], static_cast<int>(fp.size()));
+  }
+} /* namespace reactive_assistance */
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <reactive_assistance/dist_util.hpp>
 
 namespace reactive_assistance
@@ -5,16 +7,27 @@ namespace reactive_assistance
   // Transform a point 'p' relative to a frame defined by the angle 'th' and origin point 'org'
   void transformPoint(const geometry_msgs::Point &org, double th, geometry_msgs::Point &p)
   {
-    double s = std::sin(th);
-    double c = std::cos(th);
+    PointSpan pts = {&p.x, &p.y, 1};
+    transformPoints(org, th, pts, &p.x, &p.y);
+  }
+
+  // Apply the rigid 'transform' to a point 'p', the rotation need not be normalised
+  void applyTransform(const geometry_msgs::Transform &transform, geometry_msgs::Point &p)
+  {
+    const geometry_msgs::Quaternion &q = transform.rotation;
 
-    // Deviation from origin
-    double x = p.x - org.x;
-    double y = p.y - org.y;
+    // Rotation matrix of the quaternion, scaled by its squared norm
+    double d = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+    double s = 2.0 / d;
+    double xs = q.x * s, ys = q.y * s, zs = q.z * s;
+    double wx = q.w * xs, wy = q.w * ys, wz = q.w * zs;
+    double xx = q.x * xs, xy = q.x * ys, xz = q.x * zs;
+    double yy = q.y * ys, yz = q.y * zs, zz = q.z * zs;
 
-    // Apply translation and 2d rotation about th (inverse transformation matrix)
-    p.x = c * x + s * y;
-    p.y = c * y - s * x;
+    double x = p.x, y = p.y, z = p.z;
+    p.x = (1.0 - (yy + zz)) * x + (xy - wz) * y + (xz + wy) * z + transform.translation.x;
+    p.y = (xy + wz) * x + (1.0 - (xx + zz)) * y + (yz - wx) * z + transform.translation.y;
+    p.z = (xz - wy) * x + (yz + wx) * y + (1.0 - (xx + yy)) * z + transform.translation.z;
   }
 
   // Check if a 'target' angle is between two other angles (i.e. the interior of the gap)
@@ -42,107 +55,287 @@ namespace reactive_assistance
   bool lineIntersect(const geometry_msgs::Point &p1, const geometry_msgs::Point &p2, const geometry_msgs::Point &p3,
                      const geometry_msgs::Point &p4, geometry_msgs::Point &out)
   {
-    double denom = (p4.y - p3.y) * (p2.x - p1.x) - (p4.x - p3.x) * (p2.y - p1.y);
-    double numera = (p4.x - p3.x) * (p1.y - p3.y) - (p4.y - p3.y) * (p1.x - p3.x);
-    double numerb = (p2.x - p1.x) * (p1.y - p3.y) - (p2.y - p1.y) * (p1.x - p3.x);
+    PointSpan s1 = {&p1.x, &p1.y, 1};
+    PointSpan s2 = {&p2.x, &p2.y, 1};
+
+    unsigned char hit;
+    double x, y;
+    lineIntersect(s1, s2, p3, p4, &hit, &x, &y);
 
-    // The two lines are coincident (i.e. overlay exactly one another)
-    if (almostEqual(numera, 0.0) && almostEqual(numerb, 0.0) && almostEqual(denom, 0.0))
+    if (hit)
     {
-      // Take halfway point as intersection
-      out.x = (p1.x + p2.x) / 2.0;
-      out.y = (p1.y + p2.y) / 2.0;
+      out.x = x;
+      out.y = y;
       out.z = 0.0;
+    }
+
+    return hit;
+  }
+
+  // Check if a line defined by p1->p2 intersects with a circle (c.x, c.y) of radius 'r'
+  // Look at https://stackoverflow.com/questions/1073336/circle-line-segment-collision-detection-algorithm for explanation
+  // Return whether an intersection occurred and the closest intersecting point as 'out'
+  bool circleIntersect(const geometry_msgs::Point &p1, const geometry_msgs::Point &p2, const geometry_msgs::Point &c,
+                       double r, geometry_msgs::Point &out)
+  {
+    unsigned char hit;
+    double x, y;
+    circleIntersect(p1, p2, c, &r, 1, &hit, &x, &y);
 
-      return true;
+    if (hit)
+    {
+      out.x = x;
+      out.y = y;
+      out.z = 0.0;
     }
 
-    // The two lines are parallel
-    if (almostEqual(denom, 0.0))
+    return hit;
+  }
+
+  // Distance from a point 'p' to the segment (a->b)
+  double segmentDistance(const geometry_msgs::Point &p, const geometry_msgs::Point &a, const geometry_msgs::Point &b)
+  {
+    double ex = b.x - a.x;
+    double ey = b.y - a.y;
+    double len2 = ex * ex + ey * ey;
+    double t = (len2 > 0.0) ? sat(((p.x - a.x) * ex + (p.y - a.y) * ey) / len2, 0.0, 1.0) : 0.0;
+
+    return std::hypot(a.x + t * ex - p.x, a.y + t * ey - p.y);
+  }
+
+  // Check if the point 'p' rotated about 'c' by any angle between zero and 'sweep' meets the segment (a->b)
+  bool arcCrossesSegment(const geometry_msgs::Point &p, const geometry_msgs::Point &c, double sweep,
+                         const geometry_msgs::Point &a, const geometry_msgs::Point &b)
+  {
+    // Points a + t (b - a) on the circle through 'p' about 'c': A t^2 + B t + C = 0
+    double px = p.x - c.x;
+    double py = p.y - c.y;
+    double ax = a.x - c.x;
+    double ay = a.y - c.y;
+    double ex = b.x - a.x;
+    double ey = b.y - a.y;
+
+    double A = ex * ex + ey * ey;
+    double B = 2.0 * (ex * ax + ey * ay);
+    double C = (ax * ax + ay * ay) - (px * px + py * py);
+    if (A <= 0.0)
     {
       return false;
     }
 
-    double ua = numera / denom;
-    double ub = numerb / denom;
-
-    // Test if 'ua' and 'ub' both lie between 0 and 1
-    if ((ua < 0.0) || (ua > 1.0) || (ub < 0.0) || (ub > 1.0))
+    // Grazing circles count as touching
+    double disc = B * B - 4.0 * A * C;
+    if (disc < -epsilon * A)
     {
-      // Return false as both unknowns were not within the range
       return false;
     }
+    double root = std::sqrt(std::max(disc, 0.0));
+
+    for (int i = 0; i < 2; ++i)
+    {
+      double t = (-B + ((i == 0) ? -root : root)) / (2.0 * A);
+      if ((t < -epsilon) || (t > 1.0 + epsilon))
+      {
+        continue;
+      }
 
-    // Intersection is within both line segments
-    out.x = p1.x + ua * (p2.x - p1.x);
-    out.y = p1.y + ua * (p2.y - p1.y);
-    out.z = 0.0;
+      // Angle from 'p' to the crossing about 'c', within the sweep
+      double qx = ax + sat(t, 0.0, 1.0) * ex;
+      double qy = ay + sat(t, 0.0, 1.0) * ey;
+      double th = std::atan2(px * qy - py * qx, px * qx + py * qy);
+      if ((sweep >= 0.0) ? ((th >= -epsilon) && (th <= sweep + epsilon)) : ((th <= epsilon) && (th >= sweep - epsilon)))
+      {
+        return true;
+      }
+    }
 
-    return true;
+    return false;
   }
 
-  // Check if a line defined by p1->p2 intersects with a circle (c.x, c.y) of radius 'r'
-  // Look at https://stackoverflow.com/questions/1073336/circle-line-segment-collision-detection-algorithm for explanation
-  // Return whether an intersection occurred and the closest intersecting point as 'out'
-  bool circleIntersect(const geometry_msgs::Point &p1, const geometry_msgs::Point &p2, const geometry_msgs::Point &c,
-                       double r, geometry_msgs::Point &out)
+  // Check if the point 'p' shifted by any fraction of (dx, dy) meets the segment (a->b)
+  bool shiftCrossesSegment(const geometry_msgs::Point &p, double dx, double dy, const geometry_msgs::Point &a,
+                           const geometry_msgs::Point &b)
   {
-    geometry_msgs::Point d, f;
+    double ex = b.x - a.x;
+    double ey = b.y - a.y;
+    double wx = a.x - p.x;
+    double wy = a.y - p.y;
 
-    // Direction vector from start to end
-    d.x = p2.x - p1.x;
-    d.y = p2.y - p1.y;
+    double denom = dx * ey - dy * ex;
+    double len = std::hypot(dx, dy) * std::hypot(ex, ey);
+    if (std::abs(denom) <= 1e-12 * len)
+    {
+      // Parallel: only collinear segments meet, where their extents along the shift overlap
+      if ((len <= 0.0) || (std::abs(wx * dy - wy * dx) > epsilon * std::hypot(dx, dy)))
+      {
+        return false;
+      }
+      double d2 = dx * dx + dy * dy;
+      double ta = (wx * dx + wy * dy) / d2;
+      double tb = ((b.x - p.x) * dx + (b.y - p.y) * dy) / d2;
+      return (std::max(ta, tb) >= -epsilon) && (std::min(ta, tb) <= 1.0 + epsilon);
+    }
 
-    // Vector from circle centre to start
-    f.x = p1.x - c.x;
-    f.y = p1.y - c.y;
+    double t = (wx * ey - wy * ex) / denom;
+    double u = (wx * dy - wy * dx) / denom;
+    return (t >= -epsilon) && (t <= 1.0 + epsilon) && (u >= -epsilon) && (u <= 1.0 + epsilon);
+  }
 
-    // Quadratic equation to solve for intersects, with coefficients A, B, C:
-    // t^2*d.dot(d) + 2t*f.dot(d) + (f.dot(f) - r*r) = 0
-    double A = d.x * d.x + d.y * d.y;         // d.dot(d)
-    double B = 2.0 * (f.x * d.x + f.y * d.y); // 2 * f.dot(d)
-    double C = f.x * f.x + f.y * f.y - r * r; // f.dot(f) - r*r
+  // Outline of the polygon 'poly' with every edge pushed out by 'margin'
+  void offsetPolygon(const std::vector<geometry_msgs::Point> &poly, double margin, std::vector<geometry_msgs::Point> &out)
+  {
+    // Outwards is to the right of the edges of a counterclockwise outline
+    double area = 0.0;
+    for (std::size_t i = 0, j = poly.size() - 1; i < poly.size(); j = i++)
+    {
+      area += poly[j].x * poly[i].y - poly[i].x * poly[j].y;
+    }
+    double side = (area >= 0.0) ? 1.0 : -1.0;
+
+    out = poly;
+    for (std::size_t i = 0; i < poly.size(); ++i)
+    {
+      const geometry_msgs::Point &prev = poly[(i + poly.size() - 1) % poly.size()];
+      const geometry_msgs::Point &next = poly[(i + 1) % poly.size()];
 
-    double discr = B * B - 4.0 * A * C;
+      // Outward normals of the edges before and after the vertex
+      double l1 = std::max(std::hypot(poly[i].x - prev.x, poly[i].y - prev.y), epsilon);
+      double l2 = std::max(std::hypot(next.x - poly[i].x, next.y - poly[i].y), epsilon);
+      double n1x = side * (poly[i].y - prev.y) / l1, n1y = -side * (poly[i].x - prev.x) / l1;
+      double n2x = side * (next.y - poly[i].y) / l2, n2y = -side * (next.x - poly[i].x) / l2;
+      double k = margin / std::max(1.0 + n1x * n2x + n1y * n2y, epsilon);
+
+      out[i].x += k * (n1x + n2x);
+      out[i].y += k * (n1y + n2y);
+    }
+  }
+
+  //==============================================================================
+  // BATCHED VARIANTS
+  //==============================================================================
+  // Loop bodies are kept free of branches (selects only) and outputs are marked as non-aliasing so
+  // the compiler can vectorise them
+
+  // Transform every point of 'pts' relative to the frame (org, th), writing into (out_x, out_y)
+  void transformPoints(const geometry_msgs::Point &org, double th, const PointSpan &pts, double *out_x, double *out_y)
+  {
+    // NOTE: No restrict qualifiers here as in-place transforms are allowed
+    const double s = std::sin(th);
+    const double c = std::cos(th);
+    const double ox = org.x;
+    const double oy = org.y;
+    const double *px = pts.x;
+    const double *py = pts.y;
+    const std::size_t n = pts.size;
 
-    // No intersecting point
-    if (discr < 0.0)
+    for (std::size_t k = 0; k < n; ++k)
     {
-      return false;
+      // Deviation from origin
+      double x = px[k] - ox;
+      double y = py[k] - oy;
+
+      // Apply translation and 2d rotation about th (inverse transformation matrix)
+      out_x[k] = c * x + s * y;
+      out_y[k] = c * y - s * x;
     }
-    else
+  }
+
+  // Check each line (p1[k]->p2[k]) against the fixed line (p3->p4)
+  std::size_t lineIntersect(const PointSpan &p1, const PointSpan &p2, const geometry_msgs::Point &p3,
+                            const geometry_msgs::Point &p4, unsigned char *__restrict__ hit,
+                            double *__restrict__ out_x, double *__restrict__ out_y)
+  {
+    const double dx34 = p4.x - p3.x;
+    const double dy34 = p4.y - p3.y;
+    const double x3 = p3.x;
+    const double y3 = p3.y;
+    const double *x1 = p1.x;
+    const double *y1 = p1.y;
+    const double *x2 = p2.x;
+    const double *y2 = p2.y;
+    const std::size_t n = p1.size;
+
+    std::size_t hits = 0;
+    for (std::size_t k = 0; k < n; ++k)
     {
-      // There exists a solution to the quadratic equation
-      double sqrt_discr = std::sqrt(discr);
+      double dx12 = x2[k] - x1[k];
+      double dy12 = y2[k] - y1[k];
 
-      // Either solution may be on/off the line segment, need to test both
-      // t1 always smaller as 'discr' & 'A' are always > 0
-      double t1 = (-B - sqrt_discr) / (2.0 * A);
-      double t2 = (-B + sqrt_discr) / (2.0 * A);
+      double denom = dy34 * dx12 - dx34 * dy12;
+      double numera = dx34 * (y1[k] - y3) - dy34 * (x1[k] - x3);
+      double numerb = dx12 * (y1[k] - y3) - dy12 * (x1[k] - x3);
 
-      // Closer intersection is t1
-      if (t1 >= 0.0 && t1 <= 1.0)
-      {
-        out.x = p1.x + t1 * d.x;
-        out.y = p1.y + t1 * d.y;
-        out.z = 0.0;
+      // The two lines are parallel, or coincident if the numerators vanish as well
+      bool parallel = (std::abs(denom) <= epsilon);
+      bool coincident = parallel & (std::abs(numera) <= epsilon) & (std::abs(numerb) <= epsilon);
 
-        return true;
-      }
+      double ua = numera / denom;
+      double ub = numerb / denom;
 
-      // No t1 intersect so either within circle
-      // or completely beyond it, check t2
-      if (t2 >= 0.0 && t2 <= 1.0)
-      {
-        out.x = p1.x + t2 * d.x;
-        out.y = p1.y + t2 * d.y;
-        out.z = 0.0;
+      // Test if 'ua' and 'ub' both lie between 0 and 1
+      bool within = !((ua < 0.0) | (ua > 1.0) | (ub < 0.0) | (ub > 1.0));
 
-        return true;
-      }
+      // Coincident lines take the halfway point as intersection
+      bool h = coincident | (!parallel & within);
+      double t = coincident ? 0.5 : ua;
+      out_x[k] = x1[k] + t * dx12;
+      out_y[k] = y1[k] + t * dy12;
+      hit[k] = h;
+      hits += h;
+    }
 
-      // No intersection solution along line segment
-      return false;
+    return hits;
+  }
+
+  // Check the fixed line (p1->p2) against 'n' circles centred at 'c' with radii 'r[k]'
+  std::size_t circleIntersect(const geometry_msgs::Point &p1, const geometry_msgs::Point &p2, const geometry_msgs::Point &c,
+                              const double *r, std::size_t n, unsigned char *__restrict__ hit,
+                              double *__restrict__ out_x, double *__restrict__ out_y)
+  {
+    // Direction vector from start to end
+    const double dx = p2.x - p1.x;
+    const double dy = p2.y - p1.y;
+
+    // Vector from circle centre to start
+    const double fx = p1.x - c.x;
+    const double fy = p1.y - c.y;
+
+    // Quadratic equation to solve for intersects, with coefficients A, B, C:
+    // t^2*d.dot(d) + 2t*f.dot(d) + (f.dot(f) - r*r) = 0
+    const double A = dx * dx + dy * dy;         // d.dot(d)
+    const double B = 2.0 * (fx * dx + fy * dy); // 2 * f.dot(d)
+    const double ff = fx * fx + fy * fy;        // f.dot(f)
+    const double two_a = 2.0 * A;
+    const double x1 = p1.x;
+    const double y1 = p1.y;
+
+    std::size_t hits = 0;
+    for (std::size_t k = 0; k < n; ++k)
+    {
+      double C = ff - r[k] * r[k];
+      double discr = B * B - 4.0 * A * C;
+
+      // A negative discriminant means no intersecting point, the root of its magnitude is masked out below
+      bool real = (discr >= 0.0);
+      double sqrt_discr = std::sqrt(std::abs(discr));
+
+      // Either solution may be on/off the line segment, need to test both
+      // t1 always smaller as 'discr' & 'A' are always > 0
+      double t1 = (-B - sqrt_discr) / two_a;
+      double t2 = (-B + sqrt_discr) / two_a;
+
+      // Closer intersection is t1, otherwise either within circle or completely beyond it, check t2
+      bool in1 = real & (t1 >= 0.0) & (t1 <= 1.0);
+      bool in2 = real & (t2 >= 0.0) & (t2 <= 1.0);
+      double t = in1 ? t1 : t2;
+
+      bool h = in1 | in2;
+      out_x[k] = x1 + t * dx;
+      out_y[k] = y1 + t * dy;
+      hit[k] = h;
+      hits += h;
     }
+
+    return hits;
   }
 } /* namespace reactive_assistance */
\ No newline at end of file
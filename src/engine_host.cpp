@@ -0,0 +1,142 @@
+#include <algorithm>
+
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/engine_host.hpp>
+
+namespace reactive_assistance
+{
+  EngineHost::EngineHost(std::size_t threads)
+                        : beam_tables_(new BeamTableCache)
+                        , pending_(0)
+                        , running_(true)
+  {
+    if (threads == 0)
+    {
+      threads = std::max(1u, boost::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < threads; ++i)
+    {
+      workers_.push_back(new boost::thread(boost::bind(&EngineHost::workerLoop, this)));
+    }
+  }
+
+  EngineHost::~EngineHost()
+  {
+    wait();
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      running_ = false;
+    }
+    ready_cond_.notify_all();
+
+    for (std::size_t i = 0; i < workers_.size(); ++i)
+    {
+      workers_[i]->join();
+      delete workers_[i];
+    }
+
+    for (std::size_t i = 0; i < instances_.size(); ++i)
+    {
+      delete instances_[i]->engine;
+      delete instances_[i];
+    }
+  }
+
+  std::size_t EngineHost::addInstance(const RobotProfile &rp, const EngineConfig &config)
+  {
+    EngineConfig instance_config(config);
+    instance_config.beam_tables = beam_tables_;
+
+    Instance *instance = new Instance;
+    instance->engine = new PlanningEngine(rp, instance_config);
+    instance->scheduled = false;
+
+    boost::mutex::scoped_lock lock(mutex_);
+    instances_.push_back(instance);
+    return instances_.size() - 1;
+  }
+
+  void EngineHost::post(std::size_t id, const EngineJob &job)
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      Instance *instance = instances_[id];
+      instance->jobs.push_back(job);
+      pending_++;
+
+      if (instance->scheduled)
+      {
+        // The worker on it, or the one about to be, picks the job up after the earlier ones
+        return;
+      }
+
+      instance->scheduled = true;
+      ready_.push_back(id);
+    }
+    ready_cond_.notify_one();
+  }
+
+  void EngineHost::wait()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (pending_ > 0)
+    {
+      idle_cond_.wait(lock);
+    }
+  }
+
+  std::size_t EngineHost::getInstanceCount() const
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return instances_.size();
+  }
+
+  void EngineHost::workerLoop()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    while (true)
+    {
+      while (running_ && ready_.empty())
+      {
+        ready_cond_.wait(lock);
+      }
+
+      if (ready_.empty())
+      {
+        // Shutting down with nothing left to run
+        break;
+      }
+
+      std::size_t id = ready_.front();
+      ready_.pop_front();
+      Instance *instance = instances_[id];
+      EngineJob job;
+      job.swap(instance->jobs.front());
+      instance->jobs.pop_front();
+
+      lock.unlock();
+      job(*instance->engine);
+      lock.lock();
+
+      // Requeue the instance behind the others rather than running its next job, so that one busy instance cannot
+      // starve the rest
+      if (!instance->jobs.empty())
+      {
+        ready_.push_back(id);
+      }
+      else
+      {
+        instance->scheduled = false;
+      }
+
+      pending_--;
+      if (pending_ == 0)
+      {
+        idle_cond_.notify_all();
+      }
+    }
+  }
+} /* namespace reactive_assistance */
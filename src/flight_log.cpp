@@ -0,0 +1,541 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/flight_log.hpp>
+
+namespace reactive_assistance
+{
+  namespace
+  {
+    const boost::uint16_t NO_RETURN = 0xFFFF;
+
+    std::size_t alignUp(std::size_t n, std::size_t align)
+    {
+      return (n + align - 1) & ~(align - 1);
+    }
+
+    // Segment files of a directory, oldest first
+    void listSegments(const std::string &dir, std::vector<std::string> &segments, boost::uint64_t &next_seq)
+    {
+      segments.clear();
+      next_seq = 0;
+
+      DIR *d = opendir(dir.c_str());
+      if (d == NULL)
+      {
+        return;
+      }
+
+      std::vector<std::pair<boost::uint64_t, std::string> > found;
+      for (struct dirent *entry = readdir(d); entry != NULL; entry = readdir(d))
+      {
+        unsigned long long seq;
+        char tail;
+        if (std::sscanf(entry->d_name, "flight_%llu.lo%c", &seq, &tail) == 2 && tail == 'g')
+        {
+          found.push_back(std::make_pair(static_cast<boost::uint64_t>(seq), dir + "/" + entry->d_name));
+        }
+      }
+      closedir(d);
+
+      std::sort(found.begin(), found.end());
+      for (std::size_t i = 0; i < found.size(); ++i)
+      {
+        segments.push_back(found[i].second);
+        next_seq = found[i].first + 1;
+      }
+    }
+  }
+
+  //==============================================================================
+  // RANGE CODING
+  //==============================================================================
+
+  void encodeRanges(const std::vector<float> &ranges, float step, std::vector<boost::uint8_t> &out)
+  {
+    boost::int32_t prev = 0;
+
+    for (std::size_t i = 0; i < ranges.size(); ++i)
+    {
+      float r = ranges[i];
+      boost::int32_t q = (std::isfinite(r) && r >= 0.0f) ? std::min(static_cast<long>(NO_RETURN - 1), std::lround(r / step))
+                                                         : NO_RETURN;
+
+      // Zigzag the difference so that small steps either way take a single byte
+      boost::int32_t d = q - prev;
+      boost::uint32_t zz = (static_cast<boost::uint32_t>(d) << 1) ^ static_cast<boost::uint32_t>(d >> 31);
+      while (zz >= 0x80)
+      {
+        out.push_back(static_cast<boost::uint8_t>(zz | 0x80));
+        zz >>= 7;
+      }
+      out.push_back(static_cast<boost::uint8_t>(zz));
+
+      prev = q;
+    }
+  }
+
+  bool decodeRanges(const boost::uint8_t *data, std::size_t size, boost::uint32_t beams, float step, std::vector<float> &ranges)
+  {
+    ranges.resize(beams);
+    boost::int32_t prev = 0;
+    std::size_t pos = 0;
+
+    for (boost::uint32_t i = 0; i < beams; ++i)
+    {
+      boost::uint32_t zz = 0;
+      for (int shift = 0; ; shift += 7)
+      {
+        if (pos >= size || shift > 28)
+        {
+          return false;
+        }
+
+        boost::uint8_t byte = data[pos++];
+        zz |= static_cast<boost::uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+          break;
+        }
+      }
+
+      boost::int32_t q = prev + static_cast<boost::int32_t>((zz >> 1) ^ (~(zz & 1) + 1));
+      ranges[i] = (q == NO_RETURN) ? std::numeric_limits<float>::infinity() : q * step;
+      prev = q;
+    }
+
+    return true;
+  }
+
+  //==============================================================================
+  // WRITER
+  //==============================================================================
+
+  FlightLogWriter::FlightLogWriter(const std::string &dir, std::size_t segment_bytes, std::size_t budget_bytes)
+                                  : dir_(dir)
+                                  , segment_bytes_(std::max(segment_bytes, static_cast<std::size_t>(1 << 16)))
+                                  , budget_bytes_(budget_bytes)
+                                  , open_(false)
+                                  , next_seq_(0)
+                                  , fd_(-1)
+                                  , base_(NULL)
+                                  , mapped_bytes_(0)
+                                  , last_stamp_ns_(std::numeric_limits<boost::int64_t>::min())
+  {
+    if (mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+      return;
+    }
+
+    // Carry on from the segments already there, so that the budget covers them too
+    listSegments(dir_, segments_, next_seq_);
+    open_ = true;
+  }
+
+  FlightLogWriter::~FlightLogWriter()
+  {
+    closeSegment();
+  }
+
+  bool FlightLogWriter::append(FlightRecordType type, boost::int64_t stamp_ns, const void *fixed, std::size_t fixed_size,
+                               const void *extra, std::size_t extra_size)
+  {
+    if (!open_)
+    {
+      return false;
+    }
+
+    std::size_t payload = fixed_size + extra_size;
+    std::size_t record_bytes = alignUp(sizeof(FlightRecordHeader) + payload, 8);
+
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+      if (base_ == NULL && !openSegment())
+      {
+        return false;
+      }
+
+      FlightSegmentHeader *hdr = reinterpret_cast<FlightSegmentHeader *>(base_);
+      if (hdr->data_end + record_bytes <= mapped_bytes_ && hdr->count < hdr->index_capacity)
+      {
+        boost::uint8_t *dst = base_ + hdr->data_end;
+
+        FlightRecordHeader rec;
+        rec.type = type;
+        rec.reserved = 0;
+        rec.size = payload;
+        rec.stamp_ns = stamp_ns;
+        std::memcpy(dst, &rec, sizeof(rec));
+        std::memcpy(dst + sizeof(rec), fixed, fixed_size);
+        if (extra_size > 0)
+        {
+          std::memcpy(dst + sizeof(rec) + fixed_size, extra, extra_size);
+        }
+
+        // Index keys never go back in time, so that seeks can bisect even if producers race on the stamps
+        last_stamp_ns_ = std::max(last_stamp_ns_, stamp_ns);
+        FlightIndexEntry *index = reinterpret_cast<FlightIndexEntry *>(base_ + hdr->index_offset);
+        index[hdr->count].stamp_ns = last_stamp_ns_;
+        index[hdr->count].offset = hdr->data_end;
+
+        // Publish the record to readers of the live segment
+        __atomic_store_n(&hdr->data_end, hdr->data_end + record_bytes, __ATOMIC_RELEASE);
+        __atomic_store_n(&hdr->count, hdr->count + 1, __ATOMIC_RELEASE);
+        return true;
+      }
+
+      // Full, or the record can never fit
+      if (hdr->count == 0)
+      {
+        return false;
+      }
+      roll();
+    }
+
+    return false;
+  }
+
+  void FlightLogWriter::roll()
+  {
+    closeSegment();
+  }
+
+  bool FlightLogWriter::openSegment()
+  {
+    enforceBudget(segment_bytes_);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "/flight_%020llu.log", static_cast<unsigned long long>(next_seq_));
+    std::string path = dir_ + name;
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+    {
+      return false;
+    }
+
+    void *base = MAP_FAILED;
+    if (ftruncate(fd_, segment_bytes_) == 0)
+    {
+      base = mmap(NULL, segment_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    }
+
+    if (base == MAP_FAILED)
+    {
+      ::close(fd_);
+      fd_ = -1;
+      unlink(path.c_str());
+      return false;
+    }
+
+    base_ = static_cast<boost::uint8_t *>(base);
+    mapped_bytes_ = segment_bytes_;
+
+    // About one index entry per 256 bytes of records
+    FlightSegmentHeader *hdr = reinterpret_cast<FlightSegmentHeader *>(base_);
+    hdr->magic = FLIGHT_LOG_MAGIC;
+    hdr->version = FLIGHT_LOG_VERSION;
+    hdr->reserved = 0;
+    hdr->index_offset = alignUp(sizeof(FlightSegmentHeader), 64);
+    hdr->index_capacity = segment_bytes_ / 256;
+    hdr->data_offset = alignUp(hdr->index_offset + hdr->index_capacity * sizeof(FlightIndexEntry), 64);
+    hdr->data_end = hdr->data_offset;
+    hdr->count = 0;
+
+    segments_.push_back(path);
+    next_seq_++;
+    return true;
+  }
+
+  void FlightLogWriter::closeSegment()
+  {
+    if (base_ == NULL)
+    {
+      return;
+    }
+
+    // Give back the unused tail of the segment
+    std::size_t used = reinterpret_cast<FlightSegmentHeader *>(base_)->data_end;
+    msync(base_, used, MS_ASYNC);
+    munmap(base_, mapped_bytes_);
+    if (ftruncate(fd_, used) != 0)
+    {
+      // The segment stays at full size, still readable
+    }
+    ::close(fd_);
+
+    base_ = NULL;
+    fd_ = -1;
+    mapped_bytes_ = 0;
+  }
+
+  void FlightLogWriter::enforceBudget(std::size_t incoming)
+  {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < segments_.size(); ++i)
+    {
+      struct stat st;
+      if (stat(segments_[i].c_str(), &st) == 0)
+      {
+        total += st.st_size;
+      }
+    }
+
+    while (!segments_.empty() && total + incoming > budget_bytes_)
+    {
+      struct stat st;
+      if (stat(segments_.front().c_str(), &st) == 0)
+      {
+        total -= std::min(total, static_cast<std::size_t>(st.st_size));
+      }
+
+      unlink(segments_.front().c_str());
+      segments_.erase(segments_.begin());
+    }
+  }
+
+  //==============================================================================
+  // READER
+  //==============================================================================
+
+  const FlightCycleRecord *FlightRecordView::cycle() const
+  {
+    if (header->type != FLIGHT_CYCLE || header->size < sizeof(FlightCycleRecord))
+    {
+      return NULL;
+    }
+
+    return reinterpret_cast<const FlightCycleRecord *>(payload);
+  }
+
+  bool FlightRecordView::decodeScan(sensor_msgs::LaserScan &scan, geometry_msgs::Transform &laser_to_base) const
+  {
+    if (header->type != FLIGHT_SCAN || header->size < sizeof(FlightScanRecord))
+    {
+      return false;
+    }
+
+    FlightScanRecord rec;
+    std::memcpy(&rec, payload, sizeof(rec));
+    if (sizeof(rec) + rec.encoded_size > header->size)
+    {
+      return false;
+    }
+
+    scan.header.stamp.fromNSec(header->stamp_ns);
+    scan.angle_min = rec.angle_min;
+    scan.angle_increment = rec.angle_increment;
+    scan.angle_max = rec.angle_min + (rec.beams > 0 ? rec.beams - 1 : 0) * rec.angle_increment;
+    scan.range_min = rec.range_min;
+    scan.range_max = rec.range_max;
+    scan.intensities.clear();
+
+    laser_to_base.translation.x = rec.laser_to_base[0];
+    laser_to_base.translation.y = rec.laser_to_base[1];
+    laser_to_base.translation.z = rec.laser_to_base[2];
+    laser_to_base.rotation.x = rec.laser_to_base[3];
+    laser_to_base.rotation.y = rec.laser_to_base[4];
+    laser_to_base.rotation.z = rec.laser_to_base[5];
+    laser_to_base.rotation.w = rec.laser_to_base[6];
+
+    return decodeRanges(payload + sizeof(rec), rec.encoded_size, rec.beams, rec.range_step, scan.ranges);
+  }
+
+  boost::uint64_t FlightLogReader::Segment::count() const
+  {
+    return std::min(__atomic_load_n(&header()->count, __ATOMIC_ACQUIRE), header()->index_capacity);
+  }
+
+  const FlightRecordHeader *FlightLogReader::Segment::record(boost::uint64_t i) const
+  {
+    // The count is published after the end of the records, so this end covers every record counted
+    boost::uint64_t end = std::min<boost::uint64_t>(__atomic_load_n(&header()->data_end, __ATOMIC_ACQUIRE), size);
+    boost::uint64_t offset = index()[i].offset;
+    if (offset < header()->data_offset || offset > end || end - offset < sizeof(FlightRecordHeader))
+    {
+      return NULL;
+    }
+
+    const FlightRecordHeader *rec = reinterpret_cast<const FlightRecordHeader *>(base + offset);
+    if (rec->size > end - offset - sizeof(FlightRecordHeader))
+    {
+      return NULL;
+    }
+
+    return rec;
+  }
+
+  FlightLogReader::FlightLogReader()
+                                  : seg_(0)
+                                  , rec_(0)
+  {}
+
+  FlightLogReader::~FlightLogReader()
+  {
+    close();
+  }
+
+  bool FlightLogReader::open(const std::string &path)
+  {
+    close();
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+    {
+      return false;
+    }
+
+    std::vector<std::string> files;
+    if (S_ISDIR(st.st_mode))
+    {
+      boost::uint64_t next_seq;
+      listSegments(path, files, next_seq);
+    }
+    else
+    {
+      files.push_back(path);
+    }
+
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+      int fd = ::open(files[i].c_str(), O_RDONLY);
+      if (fd < 0)
+      {
+        continue;
+      }
+
+      struct stat fst;
+      void *base = MAP_FAILED;
+      if (fstat(fd, &fst) == 0 && static_cast<std::size_t>(fst.st_size) >= sizeof(FlightSegmentHeader))
+      {
+        base = mmap(NULL, fst.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      }
+      ::close(fd);
+
+      if (base == MAP_FAILED)
+      {
+        continue;
+      }
+
+      Segment seg;
+      seg.base = static_cast<const boost::uint8_t *>(base);
+      seg.size = fst.st_size;
+
+      // Skip anything that is not a segment of this version
+      const FlightSegmentHeader *hdr = seg.header();
+      if (hdr->magic != FLIGHT_LOG_MAGIC || hdr->version != FLIGHT_LOG_VERSION ||
+          hdr->index_offset + hdr->index_capacity * sizeof(FlightIndexEntry) > seg.size)
+      {
+        munmap(base, seg.size);
+        continue;
+      }
+
+      segments_.push_back(seg);
+    }
+
+    rewind();
+    return !segments_.empty();
+  }
+
+  bool FlightLogReader::next(FlightRecordView &view)
+  {
+    while (seg_ < segments_.size())
+    {
+      const Segment &seg = segments_[seg_];
+      boost::uint64_t count = seg.count();
+      while (rec_ < count)
+      {
+        // Records out of bounds are skipped
+        const FlightRecordHeader *rec = seg.record(rec_++);
+        if (rec != NULL)
+        {
+          view.header = rec;
+          view.payload = reinterpret_cast<const boost::uint8_t *>(rec) + sizeof(FlightRecordHeader);
+          return true;
+        }
+      }
+
+      seg_++;
+      rec_ = 0;
+    }
+
+    return false;
+  }
+
+  void FlightLogReader::seek(boost::int64_t stamp_ns)
+  {
+    // Last segment starting at or before the stamp, empty segments only ever trail the log
+    std::size_t lo = 0, hi = segments_.size();
+    while (lo < hi)
+    {
+      std::size_t mid = lo + (hi - lo) / 2;
+      const Segment &seg = segments_[mid];
+
+      if (seg.count() > 0 && seg.index()[0].stamp_ns <= stamp_ns)
+      {
+        lo = mid + 1;
+      }
+      else
+      {
+        hi = mid;
+      }
+    }
+    seg_ = (lo > 0) ? lo - 1 : 0;
+
+    if (seg_ >= segments_.size())
+    {
+      rec_ = 0;
+      return;
+    }
+
+    // First record of the segment at or after the stamp, or the start of the next segment
+    const Segment &seg = segments_[seg_];
+    const FlightIndexEntry *index = seg.index();
+    boost::uint64_t count = seg.count();
+    boost::uint64_t first = 0, last = count;
+    while (first < last)
+    {
+      boost::uint64_t mid = first + (last - first) / 2;
+      if (index[mid].stamp_ns < stamp_ns)
+      {
+        first = mid + 1;
+      }
+      else
+      {
+        last = mid;
+      }
+    }
+    rec_ = first;
+  }
+
+  boost::uint64_t FlightLogReader::getCount() const
+  {
+    boost::uint64_t total = 0;
+    for (std::size_t i = 0; i < segments_.size(); ++i)
+    {
+      total += segments_[i].count();
+    }
+    return total;
+  }
+
+  void FlightLogReader::close()
+  {
+    for (std::size_t i = 0; i < segments_.size(); ++i)
+    {
+      munmap(const_cast<boost::uint8_t *>(segments_[i].base), segments_[i].size);
+    }
+    segments_.clear();
+    rewind();
+  }
+} /* namespace reactive_assistance */
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstring>
+
+#include <reactive_assistance/dist_util.hpp>
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/flight_recorder.hpp>
+
+namespace reactive_assistance
+{
+  FlightRecorder::FlightRecorder(const FlightRecorderConfig &config)
+                                : config_(config)
+                                , mask_(0)
+                                , enqueue_pos_(0)
+                                , dequeue_pos_(0)
+                                , writer_(NULL)
+                                , thread_(NULL)
+                                , running_(true)
+                                , written_(0)
+                                , dropped_(0)
+  {
+    std::size_t size = 1;
+    while (size < config_.queue_capacity)
+    {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+
+    // Scan buffers are sized up front so that queueing a scan never allocates
+    slots_.reset(new Slot[size]);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      slots_[i].seq.store(i, boost::memory_order_relaxed);
+      slots_[i].ranges.reserve(config_.max_beams);
+    }
+
+    writer_ = new FlightLogWriter(config_.dir, config_.segment_bytes, config_.budget_bytes);
+    thread_ = new boost::thread(boost::bind(&FlightRecorder::writerLoop, this));
+  }
+
+  FlightRecorder::~FlightRecorder()
+  {
+    running_.store(false, boost::memory_order_release);
+
+    if (thread_ != NULL)
+    {
+      thread_->join();
+      delete thread_;
+    }
+
+    if (writer_ != NULL)
+    {
+      delete writer_;
+    }
+  }
+
+  void FlightRecorder::recordScan(const sensor_msgs::LaserScan &scan, const geometry_msgs::Transform &laser_to_base)
+  {
+    std::size_t pos;
+    Slot *slot = (scan.ranges.size() <= config_.max_beams) ? claim(pos) : NULL;
+    if (slot == NULL)
+    {
+      dropped_.fetch_add(1, boost::memory_order_relaxed);
+      return;
+    }
+
+    slot->type = FLIGHT_SCAN;
+    slot->stamp_ns = scan.header.stamp.toNSec();
+
+    FlightScanRecord &rec = slot->scan;
+    rec.angle_min = scan.angle_min;
+    rec.angle_increment = scan.angle_increment;
+    rec.range_min = scan.range_min;
+    rec.range_max = scan.range_max;
+    rec.laser_to_base[0] = laser_to_base.translation.x;
+    rec.laser_to_base[1] = laser_to_base.translation.y;
+    rec.laser_to_base[2] = laser_to_base.translation.z;
+    rec.laser_to_base[3] = laser_to_base.rotation.x;
+    rec.laser_to_base[4] = laser_to_base.rotation.y;
+    rec.laser_to_base[5] = laser_to_base.rotation.z;
+    rec.laser_to_base[6] = laser_to_base.rotation.w;
+    rec.range_step = config_.range_step;
+    rec.beams = scan.ranges.size();
+    rec.encoded_size = 0;
+    slot->ranges.assign(scan.ranges.begin(), scan.ranges.end());
+
+    slot->seq.store(pos + 1, boost::memory_order_release);
+  }
+
+  void FlightRecorder::recordCycle(const TraceRecord &rec, const nav_msgs::Odometry &odom, const geometry_msgs::Point *goal)
+  {
+    std::size_t pos;
+    Slot *slot = claim(pos);
+    if (slot == NULL)
+    {
+      dropped_.fetch_add(1, boost::memory_order_relaxed);
+      return;
+    }
+
+    slot->type = FLIGHT_CYCLE;
+    slot->stamp_ns = rec.stamp_ns;
+
+    FlightCycleRecord &cycle = slot->cycle;
+    std::memset(&cycle, 0, sizeof(cycle));
+    cycle.trace = rec;
+    cycle.odom[0] = odom.pose.pose.position.x;
+    cycle.odom[1] = odom.pose.pose.position.y;
+    cycle.odom[2] = getYaw(odom.pose.pose.orientation);
+    cycle.odom[3] = odom.twist.twist.linear.x;
+    cycle.odom[4] = odom.twist.twist.angular.z;
+    if (goal != NULL)
+    {
+      cycle.goal_x = goal->x;
+      cycle.goal_y = goal->y;
+      cycle.has_goal = 1;
+    }
+
+    slot->seq.store(pos + 1, boost::memory_order_release);
+  }
+
+  FlightRecorder::Slot *FlightRecorder::claim(std::size_t &pos)
+  {
+    pos = enqueue_pos_.load(boost::memory_order_relaxed);
+
+    while (true)
+    {
+      Slot &slot = slots_[pos & mask_];
+      std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(slot.seq.load(boost::memory_order_acquire)) - static_cast<std::ptrdiff_t>(pos);
+
+      if (diff == 0)
+      {
+        // Free slot, take it unless another producer got there first
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, boost::memory_order_relaxed))
+        {
+          return &slot;
+        }
+      }
+      else if (diff < 0)
+      {
+        // The writer has not freed the slot yet, the queue is full
+        return NULL;
+      }
+      else
+      {
+        pos = enqueue_pos_.load(boost::memory_order_relaxed);
+      }
+    }
+  }
+
+  void FlightRecorder::writerLoop()
+  {
+    // Poll rather than wait on a condition, so that producers never take a lock or make a system call
+    while (running_.load(boost::memory_order_acquire))
+    {
+      if (drain() == 0)
+      {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+      }
+    }
+
+    drain();
+  }
+
+  std::size_t FlightRecorder::drain()
+  {
+    std::size_t count = 0;
+
+    while (true)
+    {
+      Slot &slot = slots_[dequeue_pos_ & mask_];
+      if (slot.seq.load(boost::memory_order_acquire) != dequeue_pos_ + 1)
+      {
+        break;
+      }
+
+      bool ok;
+      if (slot.type == FLIGHT_SCAN)
+      {
+        encoded_.clear();
+        encodeRanges(slot.ranges, slot.scan.range_step, encoded_);
+        slot.scan.encoded_size = encoded_.size();
+
+        ok = writer_->append(FLIGHT_SCAN, slot.stamp_ns, &slot.scan, sizeof(slot.scan), encoded_.data(), encoded_.size());
+      }
+      else
+      {
+        ok = writer_->append(FLIGHT_CYCLE, slot.stamp_ns, &slot.cycle, sizeof(slot.cycle));
+      }
+
+      (ok ? written_ : dropped_).fetch_add(1, boost::memory_order_relaxed);
+
+      // Hand the slot back to the producers
+      slot.seq.store(dequeue_pos_ + mask_ + 1, boost::memory_order_release);
+      dequeue_pos_++;
+      count++;
+    }
+
+    return count;
+  }
+} /* namespace reactive_assistance */
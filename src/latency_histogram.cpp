@@ -0,0 +1,110 @@
+// All the other necessary headers included in the class declaration files
+#include <algorithm>
+
+#include <reactive_assistance/latency_histogram.hpp>
+
+namespace reactive_assistance
+{
+  LatencyHistogram::LatencyHistogram()
+                                    : total_(0)
+                                    , max_(0)
+  {
+    for (int i = 0; i < NUM_BUCKETS; ++i)
+    {
+      counts_[i].store(0, boost::memory_order_relaxed);
+    }
+  }
+
+  void LatencyHistogram::record(boost::int64_t ns)
+  {
+    boost::uint64_t v = (ns > 0) ? static_cast<boost::uint64_t>(ns) : 0;
+
+    counts_[bucketIndex(v)].fetch_add(1, boost::memory_order_relaxed);
+    total_.fetch_add(v, boost::memory_order_relaxed);
+
+    boost::uint64_t curr_max = max_.load(boost::memory_order_relaxed);
+    while ((v > curr_max) && !max_.compare_exchange_weak(curr_max, v, boost::memory_order_relaxed))
+    {
+    }
+  }
+
+  void LatencyHistogram::collect(LatencySummary &summary)
+  {
+    // Move the counts of this period out, samples racing with the collection land in either period
+    boost::uint64_t counts[NUM_BUCKETS];
+    boost::uint64_t count = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i)
+    {
+      counts[i] = counts_[i].exchange(0, boost::memory_order_relaxed);
+      count += counts[i];
+    }
+
+    boost::uint64_t total = total_.exchange(0, boost::memory_order_relaxed);
+    boost::uint64_t max = max_.exchange(0, boost::memory_order_relaxed);
+
+    summary.count = count;
+    summary.mean = (count > 0) ? (static_cast<double>(total) / count) : 0.0;
+    summary.max = max;
+    summary.p50 = summary.p99 = 0.0;
+
+    if (count == 0)
+    {
+      return;
+    }
+
+    // Ranks of the percentiles, highest equivalent value of the bucket reached is reported (capped at the max)
+    boost::uint64_t rank50 = (count * 50 + 99) / 100;
+    boost::uint64_t rank99 = (count * 99 + 99) / 100;
+    boost::uint64_t seen = 0;
+    bool p50_found = false;
+    for (int i = 0; i < NUM_BUCKETS; ++i)
+    {
+      seen += counts[i];
+
+      if (!p50_found && (seen >= rank50))
+      {
+        summary.p50 = std::min(bucketUpperBound(i), max);
+        p50_found = true;
+      }
+
+      if (seen >= rank99)
+      {
+        summary.p99 = std::min(bucketUpperBound(i), max);
+        break;
+      }
+    }
+  }
+
+  int LatencyHistogram::bucketIndex(boost::uint64_t v)
+  {
+    // Values below the sub-bucket count are tracked exactly
+    if (v < static_cast<boost::uint64_t>(SUB_BUCKET_COUNT))
+    {
+      return v;
+    }
+
+    int exponent = 63 - __builtin_clzll(v);
+    if (exponent > MAX_EXPONENT)
+    {
+      return NUM_BUCKETS - 1;
+    }
+
+    int sub_bucket = (v >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + sub_bucket;
+  }
+
+  boost::uint64_t LatencyHistogram::bucketUpperBound(int idx)
+  {
+    if (idx < SUB_BUCKET_COUNT)
+    {
+      return idx;
+    }
+
+    int exponent = (idx / SUB_BUCKET_COUNT) + SUB_BUCKET_BITS - 1;
+    boost::uint64_t sub_bucket = idx % SUB_BUCKET_COUNT;
+    int shift = exponent - SUB_BUCKET_BITS;
+
+    return ((SUB_BUCKET_COUNT + sub_bucket + 1) << shift) - 1;
+  }
+} /* namespace reactive_assistance */
@@ -1,34 +1,133 @@
+#include <algorithm>
 #include <cmath>
+#include <sstream>
+#include <stdexcept>
 
-#include <geometry_msgs/PoseArray.h>
-#include <visualization_msgs/Marker.h>
+#include <boost/lexical_cast.hpp>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
 
 #include <tf2_ros/transform_listener.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 
-#include <reactive_assistance/obstacle.hpp>
-#include <reactive_assistance/gap.hpp>
 #include <reactive_assistance/dist_util.hpp>
 // All the other necessary headers included in the class declaration files
 #include <reactive_assistance/obstacle_avoidance.hpp>
 
 namespace reactive_assistance
 {
+  // Append the percentiles of a latency 'summary', in us, as diagnostic key values
+  static void addLatencyValues(const std::string &name, const LatencySummary &summary,
+                               std::vector<diagnostic_msgs::KeyValue> &values)
+  {
+    const char *const keys[] = {"p50_us", "p99_us", "max_us"};
+    const double vals[] = {summary.p50, summary.p99, summary.max};
+
+    diagnostic_msgs::KeyValue kv;
+    for (int i = 0; i < 3; ++i)
+    {
+      std::ostringstream ss;
+      ss.precision(1);
+      ss << std::fixed << (vals[i] / 1000.0);
+
+      kv.key = name + "." + keys[i];
+      kv.value = ss.str();
+      values.push_back(kv);
+    }
+
+    kv.key = name + ".count";
+    kv.value = boost::lexical_cast<std::string>(summary.count);
+    values.push_back(kv);
+  }
+
+  // Append the hardware counts per stage run and the instructions per cycle as diagnostic key values
+  static void addCounterValues(const std::string &name, boost::uint64_t runs, const boost::uint64_t counters[NUM_PERF_COUNTERS],
+                               std::vector<diagnostic_msgs::KeyValue> &values)
+  {
+    if (runs == 0)
+    {
+      return;
+    }
+
+    diagnostic_msgs::KeyValue kv;
+    for (int j = 0; j < NUM_PERF_COUNTERS; ++j)
+    {
+      kv.key = name + "." + PERF_COUNTER_NAMES[j] + "_per_run";
+      kv.value = boost::lexical_cast<std::string>(counters[j] / runs);
+      values.push_back(kv);
+    }
+
+    std::ostringstream ss;
+    ss.precision(2);
+    ss << std::fixed << ((counters[PERF_CYCLES] > 0) ? (static_cast<double>(counters[PERF_INSTRUCTIONS]) / counters[PERF_CYCLES]) : 0.0);
+
+    kv.key = name + ".ipc";
+    kv.value = ss.str();
+    values.push_back(kv);
+  }
+
   //==============================================================================
   // PUBLIC OBSTACLE AVOIDANCE METHODS
   //==============================================================================
 
-  ObstacleAvoidance::ObstacleAvoidance(tf2_ros::Buffer &tf) 
+  // Append the work done and dropped by every scan pipeline stage as diagnostic key values
+  static void addPipelineValues(const PipelineStageStats stats[NUM_PIPELINE_STAGES], std::vector<diagnostic_msgs::KeyValue> &values)
+  {
+    diagnostic_msgs::KeyValue kv;
+    for (int i = 0; i < NUM_PIPELINE_STAGES; ++i)
+    {
+      const std::string prefix = std::string("pipeline.") + PIPELINE_STAGE_NAMES[i];
+      const char *const keys[] = {".processed", ".overflow", ".stale"};
+      const boost::uint64_t vals[] = {stats[i].processed, stats[i].overflow, stats[i].stale};
+
+      for (int j = 0; j < 3; ++j)
+      {
+        kv.key = prefix + keys[j];
+        kv.value = boost::lexical_cast<std::string>(vals[j]);
+        values.push_back(kv);
+      }
+    }
+  }
+
+  // Subscribe to 'topic' with the callbacks serviced by the thread of 'spinner'
+  template <class M>
+  static ros::Subscriber subscribeOn(ros::NodeHandle &nh, const std::string &topic, CallbackSpinner *spinner,
+                                     const boost::function<void (const boost::shared_ptr<M const> &)> &callback)
+  {
+    ros::SubscribeOptions ops = ros::SubscribeOptions::create<M>(topic, 1, callback, ros::VoidPtr(), spinner->getQueue());
+    return nh.subscribe(ops);
+  }
+
+  // Load the scheduling of the spinner thread of a subscription from its '<name>_priority' and '<name>_cpu' parameters
+  static SpinnerSchedule loadSchedule(const ros::NodeHandle &nh_priv, const std::string &name, int default_priority)
+  {
+    SpinnerSchedule schedule;
+    nh_priv.param<int>(name + "_priority", schedule.priority, default_priority);
+    nh_priv.param<int>(name + "_cpu", schedule.cpu, -1);
+    return schedule;
+  }
+
+  ObstacleAvoidance::ObstacleAvoidance(tf2_ros::Buffer &tf, ros::NodeHandle nh, ros::NodeHandle nh_priv, bool owns_process) 
                                       : tf_buffer_(tf)
-                                      , robot_profile_(NULL)
-                                      , obs_map_(NULL)
+                                      , engine_(NULL)
+                                      , visualiser_(NULL)
+                                      , flight_recorder_(NULL)
+                                      , snapshot_exporter_(NULL)
+                                      , scan_pipeline_(NULL)
                                       , control_thread_(NULL)
+                                      , running_(true)
+                                      , replan_on_scan_(false)
+                                      , jitter_monitor_(NULL)
+                                      , two_tier_control_(false)
+                                      , assist_thread_(NULL)
+                                      , scan_spinner_(NULL)
+                                      , cmd_spinner_(NULL)
+                                      , odom_spinner_(NULL)
+                                      , goal_spinner_(NULL)
+                                      , has_input_(false)
                                       , available_goal_(false)
                                       , last_valid_plan_(ros::Time::now())
   {
-    ros::NodeHandle nh;
-    ros::NodeHandle nh_priv("~");
-
     nh_priv.param<std::string>("base_frame", robot_frame_, std::string("base_link"));
     nh_priv.param<std::string>("odom_frame", odom_frame_, std::string("odom"));
     nh_priv.param<std::string>("world_frame", world_frame_, std::string("map"));
@@ -51,8 +150,8 @@ namespace reactive_assistance
       ROS_ERROR("footprint_width: %.3f", fp_wid);
       ROS_ERROR("footprint_length: %.3f", fp_len);
       ROS_ERROR("radius: %.3f", radius);
-      // Shutdown node
-      ros::shutdown();
+      // Leave it to the node or nodelet to stop, a nodelet shares the process with the others of its manager
+      throw std::invalid_argument("ambiguous robot base footprint parameters");
     }
     else if (rectangular_base)
     {
@@ -76,43 +175,31 @@ namespace reactive_assistance
 
     ROS_INFO("Minimum gap width: %.3f", min_gap_width);
 
-    std::vector<geometry_msgs::Point> footprint;
-    if (rectangular_base)
+    // Opt-in real-time profile: locked and pre-faulted memory, and SCHED_FIFO by default for the threads on the
+    // command path. Needs CAP_IPC_LOCK and CAP_SYS_NICE, or large enough memlock and rtprio limits
+    bool realtime_profile;
+    nh_priv.param<bool>("realtime_profile", realtime_profile, false);
+    if (realtime_profile && !owns_process)
     {
-      geometry_msgs::Point bleft;
-      bleft.x = -fp_len;
-      bleft.y = -fp_wid;
-      footprint.push_back(bleft);
-
-      geometry_msgs::Point bright;
-      bright.x = -fp_len;
-      bright.y = fp_wid;
-      footprint.push_back(bright);
-
-      geometry_msgs::Point tright;
-      tright.x = fp_len;
-      tright.y = fp_wid;
-      footprint.push_back(tright);
-
-      geometry_msgs::Point tleft;
-      tleft.x = fp_len;
-      tleft.y = -fp_wid;
-      footprint.push_back(tleft);
+      // Locking would pin the memory of every nodelet of the manager, and the heap would be grown for all of them
+      ROS_WARN("Not locking the memory of a shared process, the real-time profile only sets the thread scheduling");
     }
-    else
+    else if (realtime_profile)
     {
-      // Loop over 8 angles around a circle making a point each time
-      int N = 8;
-      geometry_msgs::Point pt;
-      for (int i = 0; i < N; ++i)
-      {
-        double angle = i * M_2PI / N;
-        pt.x = cos(angle) * radius;
-        pt.y = sin(angle) * radius;
+      int heap_mb;
+      nh_priv.param<int>("realtime_heap_mb", heap_mb, 64);
 
-        footprint.push_back(pt);
+      if (lockProcessMemory(static_cast<std::size_t>(std::max(heap_mb, 0)) << 20))
+      {
+        ROS_INFO("Locked the process memory with a pre-faulted heap of %d MB", heap_mb);
+      }
+      else
+      {
+        ROS_WARN("Could not lock the process memory, check the memlock limit");
       }
     }
+    const int command_priority = realtime_profile ? 80 : 0;
+    const int scan_priority = realtime_profile ? 70 : 0;
 
     // Limit safety speed distance
     double dvel_safe;
@@ -124,398 +211,541 @@ namespace reactive_assistance
     nh_priv.param<double>("acc_vx_lim", acc_x, 1.0);
     nh_priv.param<double>("acc_vth_lim", acc_th, 1.0);
 
-    robot_profile_ = new RobotProfile(footprint, radius, dvel_safe, min_gap_width, max_vx, max_vth, acc_x, acc_th);
+    // Footprint polygon depending on the base shape
+    RobotProfile robot_profile = rectangular_base ? RobotProfile::rectangular(fp_wid, fp_len, dvel_safe, max_vx, max_vth, acc_x, acc_th)
+                                                  : RobotProfile::circular(radius, dvel_safe, max_vx, max_vth, acc_x, acc_th);
     ROS_INFO_STREAM("Loaded the robot profile...");
 
-    obs_map_ = new ObstacleMap(tf_buffer_, *robot_profile_);
-    ROS_INFO_STREAM("Loaded the obstacle map...");
+    EngineConfig config;
+    nh_priv.param<double>("sim_time", config.sim_time, 1.0);
+    nh_priv.param<double>("sim_granularity", config.sim_granularity, 0.1);
+
+    // Grid of commands sampled when no gap is admissible, zero turns the fallback off
+    int fallback_samples_vx, fallback_samples_vth;
+    nh_priv.param<int>("fallback_samples_vx", fallback_samples_vx, 11);
+    nh_priv.param<int>("fallback_samples_vth", fallback_samples_vth, 21);
+    config.fallback_samples_vx = std::max(fallback_samples_vx, 0);
+    config.fallback_samples_vth = std::max(fallback_samples_vth, 0);
+
+    // Joysticks repeat themselves between scans, their cycles are served from a cache of the current snapshot
+    int assist_cache_size;
+    nh_priv.param<int>("assist_cache_size", assist_cache_size, 64);
+    nh_priv.param<double>("assist_cache_lin_quantum", config.assist_cache_lin_quantum, 0.01);
+    nh_priv.param<double>("assist_cache_ang_quantum", config.assist_cache_ang_quantum, 0.01);
+    config.assist_cache_size = std::max(assist_cache_size, 0);
+
+    // Walls are fitted into line segments within this distance before the collision checks, zero keeps every point
+    nh_priv.param<double>("segment_tolerance", config.segment_tolerance, 0.02);
+
+    // Decision trace of the most recent planning cycles, dumped on request
+    int trace_capacity;
+    nh_priv.param<int>("trace_capacity", trace_capacity, 4096);
+    nh_priv.param<std::string>("trace_dump_dir", trace_dump_dir_, std::string("/tmp"));
+    config.trace_capacity = std::max(trace_capacity, 1);
+
+    engine_ = new PlanningEngine(robot_profile, config);
+    ROS_INFO_STREAM("Loaded the planning engine...");
+
+    // Optional hardware counter sampling around the stages, needs access to the PMU
+    bool perf_counters;
+    nh_priv.param<bool>("perf_counters", perf_counters, false);
+    if (perf_counters)
+    {
+      if (PerfCounterGroup::forThisThread().isOpen())
+      {
+        engine_->getProfiler().enableCounters(true);
+        ROS_INFO("Sampling hardware performance counters around the planning stages");
+      }
+      else
+      {
+        ROS_WARN("Hardware performance counters unavailable, check kernel.perf_event_paranoid");
+      }
+    }
+
+    // Always-on flight recorder of the scans and planning cycles, disabled without a directory
+    std::string flight_recorder_dir;
+    nh_priv.param<std::string>("flight_recorder_dir", flight_recorder_dir, std::string(""));
+    if (!flight_recorder_dir.empty())
+    {
+      int budget_mb, segment_mb;
+      nh_priv.param<int>("flight_recorder_budget_mb", budget_mb, 1024);
+      nh_priv.param<int>("flight_recorder_segment_mb", segment_mb, 64);
+
+      FlightRecorderConfig recorder_config;
+      recorder_config.dir = flight_recorder_dir;
+      recorder_config.segment_bytes = static_cast<std::size_t>(std::max(segment_mb, 1)) << 20;
+      recorder_config.budget_bytes = static_cast<std::size_t>(std::max(budget_mb, segment_mb)) << 20;
+
+      flight_recorder_ = new FlightRecorder(recorder_config);
+      if (flight_recorder_->isOpen())
+      {
+        ROS_INFO("Recording the flight log to %s", flight_recorder_dir.c_str());
+      }
+      else
+      {
+        ROS_ERROR("Could not set up the flight log in %s", flight_recorder_dir.c_str());
+      }
+    }
+
+    // Shared-memory export of every planning cycle for local consumers, disabled without an object name
+    std::string snapshot_export_name;
+    nh_priv.param<std::string>("snapshot_export_name", snapshot_export_name, std::string(""));
+    if (!snapshot_export_name.empty())
+    {
+      int slots, max_obstacles;
+      nh_priv.param<int>("snapshot_export_slots", slots, 4);
+      nh_priv.param<int>("snapshot_export_max_obstacles", max_obstacles, 4096);
+
+      SnapshotExportConfig export_config;
+      export_config.name = snapshot_export_name;
+      export_config.slot_count = std::max(slots, 2);
+      export_config.max_obstacles = std::max(max_obstacles, 1);
+      export_config.max_gaps = export_config.max_obstacles;
+
+      snapshot_exporter_ = new SnapshotExporter(export_config);
+      if (snapshot_exporter_->isOpen())
+      {
+        ROS_INFO("Exporting the planning cycles to the shared memory object %s", snapshot_export_name.c_str());
+      }
+      else
+      {
+        ROS_ERROR("Could not create the shared memory object %s", snapshot_export_name.c_str());
+      }
+    }
+
+    visualiser_ = new Visualiser(engine_->getObstacleMap(), engine_->getRobotProfile(), nh, nh_priv);
 
-    nh_priv.param<double>("sim_time", sim_time_, 1.0);
-    nh_priv.param<double>("sim_granularity", sim_granularity_, 0.1);
+    dump_trace_srv_ = nh_priv.advertiseService("dump_trace", &ObstacleAvoidance::dumpTraceCallback, this);
 
     double control_rate;
     nh_priv.param<double>("control_rate", control_rate, 10);
     nh_priv.param<double>("planner_patience", planner_patience_, 15.0);
+    nh_priv.param<bool>("replan_on_scan", replan_on_scan_, false);
+    navigation_schedule_ = loadSchedule(nh_priv, "navigation", command_priority);
+
+    // The real-time profile paces the loop on the monotonic clock and watches its deadlines
+    if (realtime_profile && !replan_on_scan_)
+    {
+      jitter_monitor_ = new JitterMonitor(control_rate);
+    }
+
     // Set up the autonomous control thread
     control_thread_ = new boost::thread(boost::bind(&ObstacleAvoidance::navigationLoop, this, control_rate));
 
+    // Optionally split shared control into a fast tier on every input and a slow tier planning the gaps per scan
+    nh_priv.param<bool>("two_tier_control", two_tier_control_, false);
+    if (two_tier_control_)
+    {
+      assist_schedule_ = loadSchedule(nh_priv, "assist", 0);
+      assist_thread_ = new boost::thread(boost::bind(&ObstacleAvoidance::assistLoop, this, control_rate));
+      ROS_INFO("Two-tier shared control, the gaps are searched once per scan");
+    }
+
     // Publishers & Subscribers
-    std::string safe_cmd_pub_topic, auto_cmd_pub_topic, traj_pub_topic, obs_pub_topic, footprint_pub_topic, goal_pub_topic;
+    std::string safe_cmd_pub_topic, auto_cmd_pub_topic;
     nh_priv.param<std::string>("safe_cmd_pub_topic", safe_cmd_pub_topic, std::string("cmd_vel"));
     nh_priv.param<std::string>("auto_cmd_pub_topic", auto_cmd_pub_topic, std::string("auto_vel"));
-    nh_priv.param<std::string>("traj_pub_topic", traj_pub_topic, std::string("desired_traj"));
-    nh_priv.param<std::string>("obs_pub_topic", obs_pub_topic, std::string("collision_obstacles"));
-    nh_priv.param<std::string>("footprint_pub_topic", footprint_pub_topic, std::string("footprint"));
-    nh_priv.param<std::string>("goal_pub_topic", goal_pub_topic, std::string("nav_goal"));
 
     safe_cmd_pub_ = nh.advertise<geometry_msgs::Twist>(safe_cmd_pub_topic, 10);
     auto_cmd_pub_ = nh.advertise<geometry_msgs::Twist>(auto_cmd_pub_topic, 10);
 
-    // Below publishers are for debugging/visualisation purposes
-    traj_pub_ = nh.advertise<geometry_msgs::PoseArray>(traj_pub_topic, 10);
-    obs_pub_ = nh.advertise<PointCloud>(obs_pub_topic, 10);
-    footprint_pub_ = nh.advertise<visualization_msgs::Marker>(footprint_pub_topic, 10);
-    goal_pub_ = nh.advertise<geometry_msgs::PoseStamped>(goal_pub_topic, 10);
+    // Stage latency percentiles, reported over every diagnostics period
+    double diagnostics_period;
+    nh_priv.param<double>("diagnostics_period", diagnostics_period, 1.0);
+    diag_pub_ = nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+    diag_timer_ = nh.createWallTimer(ros::WallDuration(diagnostics_period), &ObstacleAvoidance::diagnosticsCallback, this);
 
-    std::string odom_sub_topic, goal_sub_topic, cmd_sub_topic;
+    std::string laser_sub_topic, odom_sub_topic, goal_sub_topic, cmd_sub_topic;
+    nh_priv.param<std::string>("laser_sub_topic", laser_sub_topic, std::string("scan"));
     nh_priv.param<std::string>("odom_sub_topic", odom_sub_topic, std::string("odom"));
     nh_priv.param<std::string>("goal_sub_topic", goal_sub_topic, std::string("goal"));
     nh_priv.param<std::string>("cmd_sub_topic", cmd_sub_topic, std::string("input_vel"));
 
-    odom_sub_ = nh.subscribe<nav_msgs::Odometry>(odom_sub_topic.c_str(), 1, &ObstacleAvoidance::odomCallback, this);
-    goal_sub_ = nh.subscribe<geometry_msgs::PoseStamped>(goal_sub_topic.c_str(), 1, &ObstacleAvoidance::goalCallback, this);
-    cmd_sub_ = nh.subscribe<geometry_msgs::Twist>(cmd_sub_topic.c_str(), 1, &ObstacleAvoidance::cmdCallback, this);
+    // Optionally spread the scan processing over a thread per stage, the scan callback only ingesting the scans
+    bool scan_pipeline;
+    nh_priv.param<bool>("scan_pipeline", scan_pipeline, false);
+    if (scan_pipeline)
+    {
+      int queue_size;
+      nh_priv.param<int>("scan_pipeline_queue_size", queue_size, 2);
+
+      SpinnerSchedule schedules[NUM_PIPELINE_STAGES];
+      for (int i = 0; i < NUM_PIPELINE_STAGES; ++i)
+      {
+        schedules[i] = loadSchedule(nh_priv, std::string(PIPELINE_STAGE_NAMES[i]) + "_stage", scan_priority);
+      }
+
+      scan_pipeline_ = new ScanPipeline(*engine_, std::max(queue_size, 1), schedules);
+      ROS_INFO("Processing the scans through a pipeline of %d stage threads", NUM_PIPELINE_STAGES);
+    }
+
+    // Every subscription has its own callback queue and spinner thread, so that a joystick command never waits behind
+    // the gap search of a scan. The odometry only feeds the shared control and the visualisation, and runs below
+    // normal priority by default. Services and timers stay on the global queue
+    scan_spinner_ = new CallbackSpinner("scan", loadSchedule(nh_priv, "scan_spinner", scan_priority));
+    cmd_spinner_ = new CallbackSpinner("cmd", loadSchedule(nh_priv, "cmd_spinner", command_priority));
+    odom_spinner_ = new CallbackSpinner("odom", loadSchedule(nh_priv, "odom_spinner", -5));
+    goal_spinner_ = new CallbackSpinner("goal", loadSchedule(nh_priv, "goal_spinner", 0));
+
+    laser_sub_ = subscribeOn<sensor_msgs::LaserScan>(nh, laser_sub_topic, scan_spinner_,
+                                                     boost::bind(&ObstacleAvoidance::scanCallback, this, _1));
+    odom_sub_ = subscribeOn<nav_msgs::Odometry>(nh, odom_sub_topic, odom_spinner_,
+                                                boost::bind(&ObstacleAvoidance::odomCallback, this, _1));
+    goal_sub_ = subscribeOn<geometry_msgs::PoseStamped>(nh, goal_sub_topic, goal_spinner_,
+                                                        boost::bind(&ObstacleAvoidance::goalCallback, this, _1));
+
+    // Commands need their receipt time, to measure the latency to the safe command queueing included
+    ros::SubscribeOptions cmd_ops;
+    cmd_ops.initByFullCallbackType<const ros::MessageEvent<geometry_msgs::Twist const> &>(
+        cmd_sub_topic, 1, boost::bind(&ObstacleAvoidance::cmdCallback, this, _1));
+    cmd_ops.callback_queue = cmd_spinner_->getQueue();
+    cmd_sub_ = nh.subscribe(cmd_ops);
 
     ROS_INFO_STREAM("Loaded the obstacle avoidance...");
   }
 
   ObstacleAvoidance::~ObstacleAvoidance()
   {
-    if (robot_profile_ != NULL)
+    // Unsubscribe first, so that no message is pushed into the callback queues of the spinners once they are gone
+    laser_sub_.shutdown();
+    odom_sub_.shutdown();
+    goal_sub_.shutdown();
+    cmd_sub_.shutdown();
+
+    // Stop the callbacks before anything they use goes away
+    CallbackSpinner *spinners[] = {scan_spinner_, cmd_spinner_, odom_spinner_, goal_spinner_};
+    for (int i = 0; i < 4; ++i)
     {
-      delete robot_profile_;
+      if (spinners[i] != NULL)
+      {
+        delete spinners[i];
+      }
     }
 
-    if (obs_map_ != NULL)
+    if (scan_pipeline_ != NULL)
     {
-      delete obs_map_;
+      delete scan_pipeline_;
     }
 
+    running_.store(false, boost::memory_order_release);
     if (control_thread_ != NULL)
     {
       control_thread_->join();
       delete control_thread_;
     }
+
+    if (assist_thread_ != NULL)
+    {
+      assist_thread_->join();
+      delete assist_thread_;
+    }
+
+    if (jitter_monitor_ != NULL)
+    {
+      delete jitter_monitor_;
+    }
+
+    if (visualiser_ != NULL)
+    {
+      delete visualiser_;
+    }
+
+    if (flight_recorder_ != NULL)
+    {
+      delete flight_recorder_;
+    }
+
+    if (snapshot_exporter_ != NULL)
+    {
+      delete snapshot_exporter_;
+    }
+
+    if (engine_ != NULL)
+    {
+      delete engine_;
+    }
   }
 
-  void ObstacleAvoidance::odomCallback(const nav_msgs::Odometry::ConstPtr &odom)
+  void ObstacleAvoidance::scanCallback(const sensor_msgs::LaserScan::ConstPtr &scan)
   {
-    boost::mutex::scoped_lock lock(odom_mutex_);
-    curr_odom_ = *odom;
-
-    // Create footprint polygon visualisation as a list of lines
-    visualization_msgs::Marker line_list;
-    line_list.type = visualization_msgs::Marker::LINE_LIST;
-    line_list.header.stamp = ros::Time::now();
-    line_list.header.frame_id = odom_frame_;
-    line_list.action = visualization_msgs::Marker::ADD;
-    line_list.pose = curr_odom_.pose.pose;
-    line_list.scale.x = 0.03;
+    // Get appropriate transform from the laser frame to the robot base frame
+    geometry_msgs::TransformStamped transform;
+    try
+    {
+      transform = tf_buffer_.lookupTransform(
+          robot_frame_,
+          scan->header.frame_id,
+          ros::Time(0),
+          ros::Duration(3.0));
+    }
+    catch (const tf2::TransformException &ex)
+    {
+      ROS_ERROR("Error during transform: %s", ex.what());
+      return;
+    }
 
-    // Coloured green
-    line_list.color.g = 1.0;
-    line_list.color.a = 1.0;
+    if (scan_pipeline_ != NULL)
+    {
+      scan_pipeline_->push(scan, transform.transform);
+    }
+    else
+    {
+      engine_->updateScan(*scan, transform.transform);
+    }
 
-    int fp_length = robot_profile_->footprint.size();
-    // Loop over each edge of robot polygon shape
-    for (int i = 0; i < fp_length; ++i)
+    if (flight_recorder_ != NULL)
     {
-      int next = (i + 1) % fp_length;
-      line_list.points.push_back(robot_profile_->footprint[i]);
-      line_list.points.push_back(robot_profile_->footprint[next]);
+      flight_recorder_->recordScan(*scan, transform.transform);
     }
+  }
 
-    footprint_pub_.publish(line_list);
+  void ObstacleAvoidance::odomCallback(const nav_msgs::Odometry::ConstPtr &odom)
+  {
+    boost::mutex::scoped_lock lock(odom_mutex_);
+    curr_odom_ = *odom;
+
+    // Footprint visualisation is drawn at the latest odometry pose
+    visualiser_->postOdometry(odom);
   }
 
   void ObstacleAvoidance::goalCallback(const geometry_msgs::PoseStamped::ConstPtr &goal)
   {
-    curr_goal_ = *goal;
+    {
+      boost::mutex::scoped_lock lock(goal_mutex_);
+      curr_goal_ = *goal;
+      last_valid_plan_ = ros::Time::now();
+    }
     available_goal_ = true;
-    last_valid_plan_ = ros::Time::now();
 
-    goal_pub_.publish(curr_goal_);
+    visualiser_->postGoal(goal);
     ROS_INFO("Goal pose updated!");
   }
 
-  void ObstacleAvoidance::cmdCallback(const geometry_msgs::Twist::ConstPtr &twist)
+  void ObstacleAvoidance::cmdCallback(const ros::MessageEvent<geometry_msgs::Twist const> &event)
   {
-    const geometry_msgs::Twist &orig = *twist;
+    const geometry_msgs::Twist &orig = *event.getConstMessage();
 
-    // Goal trajectory to pursue
-    TrajPtr goal_traj;
-    // Get simulated goal trajectory if one hasn't been specified by a 'global' source
-    if (available_goal_)
-    {
-      goal_traj = getGlobalTrajectory();
-    }
-    else
+    // Debug data for the visualiser, only gathered if anyone is listening
+    VisualFramePtr frame;
+    if (wantsFrame())
     {
-      goal_traj = simulateTrajectory(orig);
+      frame.reset(new VisualFrame);
     }
 
-    // Assistive command
-    geometry_msgs::Twist assist;
-    // Colliding obstacles vector
-    std::vector<Obstacle> obstacles;
-
-    // Handle different drive scenarios:
-    // a) Joystick deadzone or error in transform
-    if ((std::abs(orig.linear.x) < 0.1 && std::abs(orig.angular.z) < 0.1) || (goal_traj == NULL))
+    PlanningResult result;
+    // The fallback of a blocked cycle samples the velocities reachable from the current ones, goal or not
+    nav_msgs::Odometry odom;
     {
-      assist.linear.x = 0.0;
-      assist.angular.z = 0.0;
+      boost::mutex::scoped_lock lock(odom_mutex_);
+      odom = curr_odom_;
     }
-    // b) Free-path to goal situation
-    else if (obs_map_->isNavigable(*goal_traj, obs_map_->getObstacles(), obstacles))
+
+    geometry_msgs::Point goal;
+    // Pursue the global goal if one has been specified, else the simulated trajectory of the user's command
+    bool use_goal = available_goal_;
+    if (use_goal)
     {
-      assist = orig;
+      if (!getGlobalGoal(goal))
+      {
+        // Stop if the goal cannot be resolved in the robot frame
+        safe_cmd_pub_.publish(geometry_msgs::TwistPtr(new geometry_msgs::Twist()));
+        return;
+      }
+
+      engine_->computeCommand(orig, odom, &goal, result, frame.get());
     }
-    // c) Dangerous-path to goal situation
     else
     {
-      PointCloudPtr cloud(new PointCloud);
-      cloud->header.frame_id = robot_frame_;
+      if (two_tier_control_)
+      {
+        {
+          boost::mutex::scoped_lock lock(input_mutex_);
+          curr_input_ = orig;
+          has_input_ = true;
+        }
 
-      for (std::vector<Obstacle>::const_iterator it = obstacles.begin(); it != obstacles.end(); ++it)
+        engine_->computeFastCommand(orig, odom, result, frame.get());
+      }
+      else
       {
-        cloud->points.push_back(pcl::PointXYZ(it->point.x, it->point.y, 0.0));
+        engine_->computeCommand(orig, odom, NULL, result, frame.get());
       }
+    }
 
-      // Publish the colliding obstacles
-      obs_pub_.publish(cloud);
-
-      // Find the assistive command
-      findAssistiveCommand(*goal_traj, assist);
-
-      ROS_INFO_STREAM("Original: Lin " << orig.linear.x << " Ang " << orig.angular.z);
-      ROS_INFO_STREAM("Assisted: Lin " << assist.linear.x << " Ang " << assist.angular.z);
+    if ((result.trace.outcome == TRACE_ASSISTED) || (result.trace.outcome == TRACE_NO_GAP) ||
+        (result.trace.outcome == TRACE_SAMPLED))
+    {
+      ROS_DEBUG_STREAM("Original: Lin " << orig.linear.x << " Ang " << orig.angular.z);
+      ROS_DEBUG_STREAM("Assisted: Lin " << result.cmd.linear.x << " Ang " << result.cmd.angular.z);
     }
 
     // Publish the safe navigational command
-    safe_cmd_pub_.publish(assist);
+    publishResult(safe_cmd_pub_, result, frame, odom, use_goal ? &goal : NULL);
+    engine_->getProfiler().recordInputToCmd((ros::Time::now() - event.getReceiptTime()).toNSec());
   }
 
-  //==============================================================================
-  // PRIVATE OBSTACLE AVOIDANCE METHODS (Utilities)
-  //==============================================================================
-
-  // Compute motion commands to navigate a safe trajectory
-  void ObstacleAvoidance::computeMotionCommand(const Trajectory &safe_traj, geometry_msgs::Twist &assist) const
+  bool ObstacleAvoidance::dumpTraceCallback(std_srvs::Trigger::Request &req, std_srvs::Trigger::Response &res)
   {
-    // Safe trajectory tangent direction
-    double safe_heading = std::atan(1.0 / safe_traj.getRadius());
+    std::ostringstream path;
+    path << trace_dump_dir_ << "/reactive_assistance_trace_" << ros::WallTime::now().toNSec() << ".csv";
 
-    // Compute velocity limit
-    double vlim = std::sqrt(1.0 - sat((robot_profile_->dvel_safe - obs_map_->getClosestDistance()) / robot_profile_->dvel_safe, 0.0, 1.0)) * robot_profile_->max_vx;
+    res.success = engine_->getTrace().dump(path.str());
+    res.message = path.str();
 
-    // Generate motion commands to simulate trajectory
-    assist.linear.x = sgn(safe_traj.getGoalPoint().x) * vlim * std::cos(safe_heading);
-    assist.angular.z = sgn(safe_traj.getGoalPoint().x) * vlim * std::sin(safe_heading);
+    if (res.success)
+    {
+      ROS_INFO("Dumped the decision trace to %s", res.message.c_str());
+    }
+    else
+    {
+      ROS_ERROR("Could not dump the decision trace to %s", res.message.c_str());
+    }
+
+    return true;
   }
 
-  // Find assistive command for the simulated trajectory 'traj'
-  void ObstacleAvoidance::findAssistiveCommand(const Trajectory &traj, geometry_msgs::Twist &assist) const
+  void ObstacleAvoidance::diagnosticsCallback(const ros::WallTimerEvent &event)
   {
-    bool gap_search_fin = false;
-    std::vector<Gap> gaps_check = obs_map_->getGaps();
+    StageReport report;
+    engine_->getProfiler().collect(report);
 
-    while (!gap_search_fin)
-    {
-      // Retrieve the best gap for "free walking"
-      GapPtr closest;
-      int close_idx;
+    diagnostic_msgs::DiagnosticStatus status;
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.name = ros::this_node::getName() + ": planning latency";
+    status.hardware_id = robot_frame_;
 
-      // If global plan is available then use Euclidean distance
-      closest = obs_map_->findClosestGap(traj, gaps_check, available_goal_, close_idx);
+    std::ostringstream msg;
+    msg << report.cycle.count << " cycles, p99 " << (report.cycle.p99 / 1000.0) << " us";
+    status.message = msg.str();
 
-      // If no best gap identified, break loop
-      if (closest != NULL)
-      {
-        // Construct a vector of virtually admissible gaps for navigation
-        std::vector<GapPtr> virt_gaps;
-        // Clearances to virtual gaps
-        std::vector<double> clearances;
+    for (int i = 0; i < NUM_PLANNING_STAGES; ++i)
+    {
+      addLatencyValues(PLANNING_STAGE_NAMES[i], report.stages[i], status.values);
+    }
+    addLatencyValues("cycle", report.cycle, status.values);
+    addLatencyValues("scan_to_cmd", report.scan_to_cmd, status.values);
+    addLatencyValues("input_to_cmd", report.input_to_cmd, status.values);
 
-        obs_map_->findVirtualGaps(*closest, virt_gaps, clearances);
+    if (jitter_monitor_ != NULL)
+    {
+      LatencySummary jitter;
+      boost::uint64_t missed;
+      jitter_monitor_->collect(jitter, missed);
 
-        // Found an admissible gap
-        if (virt_gaps.back() != NULL)
-        {
-          gap_search_fin = true;
+      addLatencyValues("control.wakeup_jitter", jitter, status.values);
 
-          // Compute clearance max and min values
-          double cl_max = *std::max_element(clearances.begin(), clearances.end());
-          double cl_min = *std::min_element(clearances.begin(), clearances.end());
+      diagnostic_msgs::KeyValue kv;
+      kv.key = "control.missed_deadlines";
+      kv.value = boost::lexical_cast<std::string>(missed);
+      status.values.push_back(kv);
 
-          std::vector<double> gap_weights;
-          double w_total = 0.0;
-          // Loop over virtual gaps and compute weights
-          for (unsigned int i = 0; i < virt_gaps.size(); ++i)
-          {
-            double weight = (cl_max == cl_min) ? 1.0 : sat(1.0 - ((cl_max - clearances[i]) / (cl_max - cl_min)), 0.0, 1.0);
-            w_total += (weight * weight);
-            gap_weights.push_back(weight);
-          }
-
-          geometry_msgs::Point sub_goal;
-          double x, y;
-          x = y = 0.0;
-          // Compute sub goals
-          for (unsigned int i = 0; i < virt_gaps.size(); ++i)
-          {
-            obs_map_->findSubGoal(*virt_gaps[i], sub_goal);
-            double relative_weight = ((gap_weights[i] * gap_weights[i]) / w_total);
-            x += (relative_weight * sub_goal.x);
-            y += (relative_weight * sub_goal.y);
-          }
+      if (missed > 0)
+      {
+        status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+      }
+    }
 
-          geometry_msgs::Point avg_goal;
-          avg_goal.x = x;
-          avg_goal.y = y;
-          avg_goal.z = 0.0;
+    const AssistCache *assist_cache = engine_->getAssistCache();
+    if (assist_cache != NULL)
+    {
+      diagnostic_msgs::KeyValue kv;
+      kv.key = "assist_cache.hits";
+      kv.value = boost::lexical_cast<std::string>(assist_cache->getHits());
+      status.values.push_back(kv);
+      kv.key = "assist_cache.misses";
+      kv.value = boost::lexical_cast<std::string>(assist_cache->getMisses());
+      status.values.push_back(kv);
+    }
 
-          // Trajectories to the weighted average goal and the last constructed virtual gap goal
-          Trajectory avg(avg_goal);
-          Trajectory last_sub(sub_goal);
+    if (scan_pipeline_ != NULL)
+    {
+      PipelineStageStats stats[NUM_PIPELINE_STAGES];
+      scan_pipeline_->getStats(stats);
+      addPipelineValues(stats, status.values);
+    }
 
-          // Obstacles preventing navigability of the path to the weighted average goal
-          std::vector<Obstacle> coll_obstacles;
-          if (obs_map_->isNavigable(avg, obs_map_->getObstacles(), coll_obstacles))
-          {
-            computeMotionCommand(avg, assist);
-          }
-          else
-          {
-            computeMotionCommand(last_sub, assist);
-          }
-        }
-        else
-        {
-          // Delete the non-admissible closest gap and loop through algorithm again
-          gaps_check.erase(gaps_check.begin() + close_idx);
-        }
-      }
-      else
+    if (report.counters_enabled)
+    {
+      for (int i = 0; i < NUM_PLANNING_STAGES; ++i)
       {
-        // Non-admissible gap
-        assist.linear.x = 0.0;
-        assist.angular.z = 0.0;
-
-        gap_search_fin = true;
+        addCounterValues(PLANNING_STAGE_NAMES[i], report.counter_runs[i], report.counters[i], status.values);
       }
     }
+
+    diagnostic_msgs::DiagnosticArray diag;
+    diag.header.stamp = ros::Time::now();
+    diag.status.push_back(status);
+
+    diag_pub_.publish(diag);
   }
 
-  TrajPtr ObstacleAvoidance::getGlobalTrajectory() const
+  //==============================================================================
+  // PRIVATE OBSTACLE AVOIDANCE METHODS (Utilities)
+  //==============================================================================
+
+  // Publish the command of a planning cycle and record the cycle, handing its debug data to the visualiser
+  void ObstacleAvoidance::publishResult(const ros::Publisher &pub, PlanningResult &result, const VisualFramePtr &frame,
+                                        const nav_msgs::Odometry &odom, const geometry_msgs::Point *goal)
   {
-    // Transform global goal coordinates to robot frame
-    geometry_msgs::TransformStamped transform;
-    try
+    boost::int64_t t_pub = monotonicNanos();
     {
-      transform = tf_buffer_.lookupTransform(
-          robot_frame_,
-          world_frame_,
-          ros::Time(0),
-          ros::Duration(3.0));
+      StageCounterScope counters(&engine_->getProfiler(), STAGE_PUBLISH);
+      // Published by pointer, subscribers in the same nodelet manager get this message without a copy
+      pub.publish(geometry_msgs::TwistPtr(new geometry_msgs::Twist(result.cmd)));
     }
-    catch (const tf2::TransformException &ex)
+    result.trace.stage_ns[STAGE_PUBLISH] = monotonicNanos() - t_pub;
+
+    engine_->recordCycle(result, ros::Time::now());
+    if (flight_recorder_ != NULL)
     {
-      ROS_ERROR("Error during transform: %s", ex.what());
-      return NULL;
+      flight_recorder_->recordCycle(result.trace, odom, goal);
     }
 
-    geometry_msgs::PoseStamped goal_robot;
-    tf2::doTransform(curr_goal_, goal_robot, transform);
+    if (frame != NULL)
+    {
+      visualiser_->post(frame);
+    }
 
-    return TrajPtr(new Trajectory(goal_robot.pose.position));
+    if (snapshot_exporter_ != NULL)
+    {
+      snapshot_exporter_->post(result.map, result.trace, frame);
+    }
   }
 
-  TrajPtr ObstacleAvoidance::simulateTrajectory(const geometry_msgs::Twist &twist_msg) const
+  bool ObstacleAvoidance::wantsFrame() const
   {
-    // Transform local odom coordinates to robot frame
+    return visualiser_->isActive();
+  }
+
+  bool ObstacleAvoidance::getGlobalGoal(geometry_msgs::Point &goal) const
+  {
+    // Transform global goal coordinates to robot frame
     geometry_msgs::TransformStamped transform;
     try
     {
       transform = tf_buffer_.lookupTransform(
           robot_frame_,
-          odom_frame_,
+          world_frame_,
           ros::Time(0),
           ros::Duration(3.0));
     }
     catch (const tf2::TransformException &ex)
     {
       ROS_ERROR("Error during transform: %s", ex.what());
-      return NULL;
-    }
-
-    // Create trajectory as a pose array
-    geometry_msgs::PoseArray traj_cloud;
-    traj_cloud.header.frame_id = odom_frame_;
-
-    // Current odometry info
-    double x = curr_odom_.pose.pose.position.x;
-    double y = curr_odom_.pose.pose.position.y;
-
-    double yaw, _pitch, _roll;
-    tf2::Matrix3x3(tf2::Quaternion(curr_odom_.pose.pose.orientation.x, curr_odom_.pose.pose.orientation.y,
-                                   curr_odom_.pose.pose.orientation.z, curr_odom_.pose.pose.orientation.w))
-        .getEulerYPR(yaw, _pitch, _roll);
-    double th = yaw;
-
-    double vx = curr_odom_.twist.twist.linear.x;
-    double vth = curr_odom_.twist.twist.angular.z;
-
-    // User's intended commands
-    double vel_lin = twist_msg.linear.x;
-    double vel_ang = twist_msg.angular.z;
-
-    // Compute the number of steps to project along the trajectory
-    int num_steps = std::ceil(sim_time_ / sim_granularity_);
-    double dt = sim_time_ / num_steps;
-
-    geometry_msgs::PoseStamped pose_stamped;
-    geometry_msgs::PoseStamped goal_stamped;
-    tf2::Quaternion q;
-    // Loop over forward simulation steps to generate trajectory
-    for (int i = 0; i < num_steps; ++i)
-    {
-      // Compute updated velocities given current speed
-      vx = (vx < vel_lin) ? std::min(vel_lin, vx + robot_profile_->acc_vx_lim * dt) : std::max(vel_lin, vx - robot_profile_->acc_vx_lim * dt);
-      vth = (vth < vel_ang) ? std::min(vel_ang, vth + robot_profile_->acc_vth_lim * dt) : std::max(vel_ang, vth - robot_profile_->acc_vth_lim * dt);
-
-      // Compute updated position of robot given the new velocities
-      x += (vx * std::cos(th) * dt);
-      y += (vx * std::sin(th) * dt);
-      th += (vth * dt);
-
-      pose_stamped.pose.position.x = x;
-      pose_stamped.pose.position.y = y;
-      pose_stamped.pose.position.z = 0.0;
-
-      q.setRPY(0, 0, th);
-      tf2::convert(q, pose_stamped.pose.orientation);
-
-      traj_cloud.poses.push_back(pose_stamped.pose);
-      tf2::doTransform(pose_stamped, goal_stamped, transform);
-    }
-
-    // Publish trajectory of robot
-    traj_pub_.publish(traj_cloud);
-
-    // If an invalid circular arc due to a purely rotational motion
-    if (almostEqual(goal_stamped.pose.position.y, 0.0) && almostEqual(goal_stamped.pose.position.x, 0.0))
-    {
-      double y_goal, _p_goal, _r_goal;
-      tf2::Matrix3x3(tf2::Quaternion(goal_stamped.pose.orientation.x, goal_stamped.pose.orientation.y,
-                                     goal_stamped.pose.orientation.z, goal_stamped.pose.orientation.w))
-          .getEulerYPR(y_goal, _p_goal, _r_goal);
-
-      // Assume goal is at rotated edge of robot's virtual radius
-      goal_stamped.pose.position.x = robot_profile_->radius * std::cos(y_goal);
-      goal_stamped.pose.position.y = robot_profile_->radius * std::sin(y_goal);
+      return false;
     }
 
-    // If invalid due to a straight trajectory, slightly offset the 'y'
-    if (almostEqual(goal_stamped.pose.position.y, 0.0))
+    geometry_msgs::PoseStamped curr_goal;
     {
-      goal_stamped.pose.position.y += epsilon;
+      boost::mutex::scoped_lock lock(goal_mutex_);
+      curr_goal = curr_goal_;
     }
 
-    // Publish simulated goal of robot trajectory
-    goal_pub_.publish(goal_stamped);
+    geometry_msgs::PoseStamped goal_robot;
+    tf2::doTransform(curr_goal, goal_robot, transform);
 
-    return TrajPtr(new Trajectory(goal_stamped.pose.position));
+    goal = goal_robot.pose.position;
+    return true;
   }
 
   bool ObstacleAvoidance::isGoalReached() const
@@ -537,21 +767,36 @@ namespace reactive_assistance
     }
 
     geometry_msgs::PoseStamped curr_goal_stamped;
-    curr_goal_stamped.pose = curr_goal_.pose;
+    {
+      boost::mutex::scoped_lock lock(goal_mutex_);
+      curr_goal_stamped.pose = curr_goal_.pose;
+    }
     curr_goal_stamped.header.frame_id = world_frame_;
 
     geometry_msgs::PoseStamped goal_odom;
     tf2::doTransform(curr_goal_stamped, goal_odom, transform);
 
-    return (dist(goal_odom.pose.position, curr_odom_.pose.pose.position) < robot_profile_->radius);
+    geometry_msgs::Point position;
+    {
+      boost::mutex::scoped_lock lock(odom_mutex_);
+      position = curr_odom_.pose.pose.position;
+    }
+
+    return (dist(goal_odom.pose.position, position) < engine_->getRobotProfile().radius);
   }
 
   void ObstacleAvoidance::navigationLoop(double rate)
   {
+    applyThreadSchedule("navigation", navigation_schedule_);
+
     ros::NodeHandle nh;
     ros::Rate r(rate);
 
-    while (nh.ok())
+    // When replanning on scans, the period only bounds the wait for a stalled scanner
+    boost::posix_time::time_duration period = boost::posix_time::microseconds(static_cast<boost::int64_t>(1e6 / rate));
+    boost::uint64_t map_version = 0;
+
+    while (nh.ok() && running_.load(boost::memory_order_acquire))
     {
       // Check if a goal point is available and whether the position has been reached yet
       if (available_goal_ && isGoalReached())
@@ -561,60 +806,101 @@ namespace reactive_assistance
         available_goal_ = false;
 
         // Publish a terminating velocity command
-        geometry_msgs::Twist zero_twist;
-        zero_twist.linear.x = zero_twist.angular.z = 0.0;
+        geometry_msgs::TwistPtr zero_twist(new geometry_msgs::Twist());
+        zero_twist->linear.x = zero_twist->angular.z = 0.0;
         auto_cmd_pub_.publish(zero_twist);
       }
 
       if (available_goal_)
       {
-        // Goal trajectory to pursue
-        TrajPtr goal_traj;
-        goal_traj = getGlobalTrajectory();
-
-        // Assistive command
-        geometry_msgs::Twist assist;
-        // Colliding obstacles vector
-        std::vector<Obstacle> obstacles;
-
-        computeMotionCommand(*goal_traj, assist);
-
-        if (!obs_map_->isNavigable(*goal_traj, obs_map_->getObstacles(), obstacles))
+        geometry_msgs::Point goal;
+        if (getGlobalGoal(goal))
         {
-          PointCloudPtr cloud(new PointCloud);
-          cloud->header.frame_id = robot_frame_;
-
-          for (std::vector<Obstacle>::const_iterator it = obstacles.begin(); it != obstacles.end(); ++it)
+          // Debug data for the visualiser, only gathered if anyone is listening
+          VisualFramePtr frame;
+          if (wantsFrame())
           {
-            cloud->points.push_back(pcl::PointXYZ(it->point.x, it->point.y, 0.0));
+            frame.reset(new VisualFrame);
           }
 
-          // Publish the colliding obstacles
-          obs_pub_.publish(cloud);
+          PlanningResult result;
+          engine_->computeAutonomousCommand(goal, result, frame.get());
 
-          // Find the assistive command
-          findAssistiveCommand(*goal_traj, assist);
+          // Publish the autonomous navigation command if a goal is still available
+          ROS_DEBUG_STREAM("Autonomous: Lin " << result.cmd.linear.x << " Ang " << result.cmd.angular.z);
+          publishResult(auto_cmd_pub_, result, frame, nav_msgs::Odometry(), &goal);
         }
 
-        // Publish the autonomous navigation command if a goal is still available
-        ROS_INFO_STREAM("Autonomous: Lin " << assist.linear.x << " Ang " << assist.angular.z);
-        auto_cmd_pub_.publish(assist);
-
         // Make sure to reset if planner times out on reaching goal
-        if (ros::Time::now() > last_valid_plan_ + ros::Duration(planner_patience_))
+        ros::Time last_valid_plan;
+        {
+          boost::mutex::scoped_lock lock(goal_mutex_);
+          last_valid_plan = last_valid_plan_;
+        }
+
+        if (ros::Time::now() > last_valid_plan + ros::Duration(planner_patience_))
         {
           ROS_INFO("Time out on reaching the published goal pose!");
 
           available_goal_ = false;
 
           // Publish a terminating velocity command
-          geometry_msgs::Twist zero_twist;
-          zero_twist.linear.x = zero_twist.angular.z = 0.0;
+          geometry_msgs::TwistPtr zero_twist(new geometry_msgs::Twist());
+          zero_twist->linear.x = zero_twist->angular.z = 0.0;
           auto_cmd_pub_.publish(zero_twist);
         }
       }
 
-      r.sleep();
+      if (replan_on_scan_)
+      {
+        map_version = engine_->getObstacleMap().waitForSnapshot(map_version, period)->version;
+      }
+      else if (jitter_monitor_ != NULL)
+      {
+        jitter_monitor_->waitNextPeriod();
+      }
+      else
+      {
+        r.sleep();
+      }
+    }
+  }
+
+  void ObstacleAvoidance::assistLoop(double rate)
+  {
+    applyThreadSchedule("assist", assist_schedule_);
+
+    ros::NodeHandle nh;
+
+    // The period only bounds the wait for a stalled scanner
+    boost::posix_time::time_duration period = boost::posix_time::microseconds(static_cast<boost::int64_t>(1e6 / rate));
+    boost::uint64_t map_version = 0;
+
+    while (nh.ok() && running_.load(boost::memory_order_acquire))
+    {
+      // Plan on every new snapshot, and at once when the fast tier finds the decision planned for another input
+      if (!engine_->waitForAssist(map_version, period))
+      {
+        continue;
+      }
+
+      geometry_msgs::Twist input;
+      {
+        boost::mutex::scoped_lock lock(input_mutex_);
+        if (!has_input_)
+        {
+          continue;
+        }
+        input = curr_input_;
+      }
+
+      nav_msgs::Odometry odom;
+      {
+        boost::mutex::scoped_lock lock(odom_mutex_);
+        odom = curr_odom_;
+      }
+
+      engine_->planAssist(input, odom);
     }
   }
 } /* namespace reactive_assistance */
\ No newline at end of file
@@ -1,10 +1,7 @@
+#include <algorithm>
 #include <cmath>
 #include <limits>
-
-#include <geometry_msgs/PointStamped.h>
-
-#include <tf2_ros/transform_listener.h>
-#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+#include <utility>
 
 #include <reactive_assistance/dist_util.hpp>
 // All the other necessary headers included in the class declaration files
@@ -12,43 +9,165 @@
 
 namespace reactive_assistance
 {
+  // Largest distance of the obstacles from 'first' to 'last' to the segment between them, and the furthest one 'far'
+  static double fitError(const std::vector<Obstacle> &obs, std::size_t first, std::size_t last, std::size_t &far)
+  {
+    const geometry_msgs::Point &a = obs[first].point;
+    const geometry_msgs::Point &b = obs[last].point;
+    double ex = b.x - a.x;
+    double ey = b.y - a.y;
+    double inv_len2 = ((ex * ex + ey * ey) > 0.0) ? (1.0 / (ex * ex + ey * ey)) : 0.0;
+
+    // Squared distances, only the furthest needs a root
+    double max_d2 = 0.0;
+    far = first;
+    for (std::size_t k = first + 1; k < last; ++k)
+    {
+      double px = obs[k].point.x - a.x;
+      double py = obs[k].point.y - a.y;
+      double t = sat((px * ex + py * ey) * inv_len2, 0.0, 1.0);
+      double dx = px - t * ex;
+      double dy = py - t * ey;
+      double d2 = dx * dx + dy * dy;
+      if (d2 > max_d2)
+      {
+        max_d2 = d2;
+        far = k;
+      }
+    }
+
+    return std::sqrt(max_d2);
+  }
+
   //==============================================================================
   // PUBLIC OBSTACLE MAP METHODS 发布障碍物地图
   //==============================================================================
 
-  ObstacleMap::ObstacleMap(tf2_ros::Buffer& tf, const RobotProfile& rp) 
-                          : tf_buffer_(tf)
-                          , robot_profile_(rp)
+  ObstacleMap::ObstacleMap(const RobotProfile& rp, StageProfiler *profiler, BeamTableCache *beam_tables,
+                           double segment_tolerance) 
+                          : robot_profile_(rp)
+                          , snapshot_(new MapSnapshot)
+                          , profiler_(profiler)
+                          , beam_tables_(beam_tables)
+                          , fp_radius_(0.0)
+                          , fp_inner_(std::numeric_limits<double>::max())
+                          , segment_tol_(std::max(segment_tolerance, 0.0))
+                          , seg_fp_radius_(0.0)
   {
-    //初始化ros命名空间
-    ros::NodeHandle nh;
-    ros::NodeHandle nh_priv("~");
-    //建立ros的baselink
-    nh_priv.param<std::string>("base_frame", robot_frame_, std::string("base_link"));
-
-    std::string laser_sub_topic; //初始化ros话题名
-    nh_priv.param<std::string>("laser_sub_topic", laser_sub_topic, std::string("scan"));
-    //订阅ros话题，订阅scan话题
-    laser_sub_ = nh.subscribe<sensor_msgs::LaserScan>(laser_sub_topic.c_str(), 1, &ObstacleMap::scanCallback, this);
-
-    // Topics and publishers for gap visualisation
-    std::string gaps_pub_topic, virt_gaps_pub_topic, closest_gap_pub_topic;
-    nh_priv.param<std::string>("gaps_pub_topic", gaps_pub_topic, std::string("gaps"));
-    nh_priv.param<std::string>("virt_gaps_pub_topic", virt_gaps_pub_topic, std::string("virt_gaps"));
-    nh_priv.param<std::string>("closest_gap_pub_topic", closest_gap_pub_topic, std::string("closest_gap"));
-
-    gaps_pub_ = nh.advertise<PointCloud>(gaps_pub_topic, 10); //gap话题发布
-    virt_gaps_pub_ = nh.advertise<PointCloud>(virt_gaps_pub_topic, 10);
-    closest_gap_pub_ = nh.advertise<PointCloud>(closest_gap_pub_topic, 10); // 最相近的gap
+    // Every footprint point lies within 'fp_radius_' of the robot base
+    const std::vector<geometry_msgs::Point> &fp = robot_profile_.footprint;
+    for (std::size_t i = 0; i < fp.size(); ++i)
+    {
+      fp_radius_ = std::max(fp_radius_, std::hypot(fp[i].x, fp[i].y));
+    }
+
+    // Every point within 'fp_inner_' of the robot base lies inside the footprint
+    bool inside = false;
+    for (std::size_t i = 0, j = fp.size() - 1; i < fp.size(); j = i++)
+    {
+      if ((fp[i].y > 0.0) != (fp[j].y > 0.0) && (0.0 < fp[j].x + (0.0 - fp[j].y) * (fp[i].x - fp[j].x) / (fp[i].y - fp[j].y)))
+      {
+        inside = !inside;
+      }
+
+      double ex = fp[i].x - fp[j].x;
+      double ey = fp[i].y - fp[j].y;
+      double len2 = ex * ex + ey * ey;
+      double t = (len2 > 0.0) ? sat(-(fp[j].x * ex + fp[j].y * ey) / len2, 0.0, 1.0) : 0.0;
+      fp_inner_ = std::min(fp_inner_, std::hypot(fp[j].x + t * ex, fp[j].y + t * ey));
+    }
+
+    if (!inside || fp.empty())
+    {
+      fp_inner_ = 0.0;
+    }
+
+    // Every edge pushed out by the segment tolerance, the vertices moving to where the pushed edges meet, so that the
+    // grown footprint covers every point within the tolerance of the footprint
+    if (segment_tol_ > 0.0)
+    {
+      offsetPolygon(fp, segment_tol_, seg_footprint_);
+      for (std::size_t i = 0; i < seg_footprint_.size(); ++i)
+      {
+        seg_fp_radius_ = std::max(seg_fp_radius_, std::hypot(seg_footprint_[i].x, seg_footprint_[i].y));
+      }
+    }
   }
 
-  void ObstacleMap::scanCallback(const sensor_msgs::LaserScan::ConstPtr &scan)
+  // Compute a new snapshot from a laser 'scan', given the transform from the laser frame to the robot base frame
+  void ObstacleMap::updateScan(const sensor_msgs::LaserScan &scan, const geometry_msgs::Transform &laser_to_base)
   {
     boost::mutex::scoped_lock lock(scan_mutex_);
-    scan_ = *scan;
 
-    updateObstacles(); // 更新障碍物和gap
-    updateGaps();
+    // Build a fresh snapshot so that planning calls in flight keep reading the previous one
+    MapSnapshotPtr map(new MapSnapshot);
+    map->stamp = scan.header.stamp;
+    map->range_max = scan.range_max;
+
+    boost::int64_t start = monotonicNanos();
+    {
+      StageCounterScope counters(profiler_, STAGE_UPDATE_OBSTACLES);
+      updateObstacles(scan, laser_to_base, *map); // 更新障碍物和gap
+    }
+    boost::int64_t t_obs = monotonicNanos();
+    {
+      StageCounterScope counters(profiler_, STAGE_UPDATE_GAPS);
+      updateGaps(*map);
+    }
+
+    map->obstacles_ns = t_obs - start;
+    map->gaps_ns = monotonicNanos() - t_obs;
+
+    publishSnapshot(map);
+  }
+
+  // Swap in a snapshot computed by the caller
+  void ObstacleMap::publishSnapshot(const MapSnapshotPtr &map)
+  {
+    if (profiler_ != NULL)
+    {
+      profiler_->record(STAGE_UPDATE_OBSTACLES, map->obstacles_ns);
+      profiler_->record(STAGE_UPDATE_GAPS, map->gaps_ns);
+    }
+
+    {
+      boost::mutex::scoped_lock snapshot_lock(snapshot_mutex_);
+      map->version = snapshot_->version + 1;
+      snapshot_ = map;
+    }
+    snapshot_cond_.notify_all();
+  }
+
+  // Return the latest map snapshot
+  MapSnapshotConstPtr ObstacleMap::getSnapshot() const
+  {
+    boost::mutex::scoped_lock lock(snapshot_mutex_);
+    return snapshot_;
+  }
+
+  // Wait for a snapshot newer than 'version', or at most 'timeout'
+  MapSnapshotConstPtr ObstacleMap::waitForSnapshot(boost::uint64_t version, const boost::posix_time::time_duration &timeout,
+                                                    const boost::atomic<bool> *wake) const
+  {
+    boost::system_time deadline = boost::get_system_time() + timeout;
+
+    boost::mutex::scoped_lock lock(snapshot_mutex_);
+    while ((snapshot_->version <= version) && ((wake == NULL) || !wake->load(boost::memory_order_acquire)))
+    {
+      if (!snapshot_cond_.timed_wait(lock, deadline))
+      {
+        break;
+      }
+    }
+
+    return snapshot_;
+  }
+
+  void ObstacleMap::wakeWaiters() const
+  {
+    // Under the lock, so that a waiter cannot miss the wake-up between checking its flag and waiting
+    boost::mutex::scoped_lock lock(snapshot_mutex_);
+    snapshot_cond_.notify_all();
   }
 
   // Return the closest gap from in_gaps according to either the angular or Euclidean distance
@@ -105,48 +224,30 @@ namespace reactive_assistance
       return NULL;
     }
 
-    // Initialise point cloud to visualise the candidate closest gaps
-    PointCloudPtr point_cloud(new PointCloud);
-    point_cloud->header.frame_id = robot_frame_;
-
-    point_cloud->points.push_back(pcl::PointXYZ(in_gaps[closest_ind].right.point.x, in_gaps[closest_ind].right.point.y, in_gaps[closest_ind].right.point.z));
-    point_cloud->points.push_back(pcl::PointXYZ(in_gaps[closest_ind].left.point.x, in_gaps[closest_ind].left.point.y, in_gaps[closest_ind].left.point.z));
-
-    closest_gap_pub_.publish(point_cloud);
-
     return GapPtr(new Gap(in_gaps[closest_ind].right, in_gaps[closest_ind].left, close_right));
   }
 
-  // Find whether an input 'gap' is admissible or not, and return the vectors of "virtual" gaps and their clearances
+  // Find whether an input 'gap' of the 'map' is admissible or not, and return the vectors of "virtual" gaps and their clearances
   // 将实际的gap转化为虚拟的gap，将原始的较为杂乱的间隙转化为调整之后的间隙，同时计算安全余量保证机器人的通过性
-  void ObstacleMap::findVirtualGaps(const Gap &gap, std::vector<GapPtr> &virt_gaps, std::vector<double> &clearances) const
+  void ObstacleMap::findVirtualGaps(const MapSnapshot &map, const Gap &gap, std::vector<GapPtr> &virt_gaps, std::vector<double> &clearances) const
   {
     // Looping check variable
     bool valid_gap_found = false;
     // Initialise with input gap
     virt_gaps.push_back(GapPtr(new Gap(gap))); // 初始化virtual_gap
 
-    // Initialise point cloud to visualise the virtual gaps
-    PointCloudPtr point_cloud(new PointCloud); // 初始化可视化的列表
-    point_cloud->header.frame_id = robot_frame_; // frame_id的初始化
-
     do // 循环直到找到合适的gap
     {
       // Take the last virtual gap constructed and run it through the iterative algorithm 
       //搜索所有的gap，寻找合适的gap
       GapPtr virt = virt_gaps.back(); // 将虚拟gap的最后一个赋值给 virt
 
-      //将gap的左值与右值都添加到可视化的列表中
-      point_cloud->points.push_back(pcl::PointXYZ(virt->right.point.x, virt->right.point.y, virt->right.point.z));
-      point_cloud->points.push_back(pcl::PointXYZ(virt->left.point.x, virt->left.point.y, virt->left.point.z));
-
-      
       std::vector<Obstacle> o_in, o_ex;
       int i = 0;
       // Compute interior and exterior obstacle points
-      for (std::vector<Obstacle>::const_iterator it = obstacles_.begin(); it != obstacles_.end(); ++it) // 遍历所有的障碍物，将障碍物分配为内部障碍物和外部障碍物
+      for (std::vector<Obstacle>::const_iterator it = map.obstacles.begin(); it != map.obstacles.end(); ++it) // 遍历所有的障碍物，将障碍物分配为内部障碍物和外部障碍物
       {
-        if (!almostEqual(it->distance, scan_.range_max))
+        if (!almostEqual(it->distance, map.range_max))
         {
           if (isBetweenAngles(it->angle, virt->right.angle, virt->left.angle)) // 如果障碍物位于间隙的左右边界之间，则划分为内部障碍物
           {
@@ -178,7 +279,7 @@ namespace reactive_assistance
       Trajectory traj(sub_goal); // 计算subgoal的轨迹
 
       // Update clearances vector for this gap 更新间隙向量
-      clearances.push_back(computeClearance(traj));
+      clearances.push_back(computeClearance(map, traj));
 
       // Vector of colliding obstacles
       std::vector<Obstacle> coll_obs; // 计算碰撞障碍物向量
@@ -308,8 +409,6 @@ namespace reactive_assistance
         }
       }
     } while (!valid_gap_found); 
-
-    virt_gaps_pub_.publish(point_cloud);
   }
 
   // Compute sub-goal associated with the input gap
@@ -417,6 +516,358 @@ namespace reactive_assistance
 
   // Check for safety in navigating a trajectory around a provided list of 'obstacles' and return the list of colliding obstacles
   bool ObstacleMap::isNavigable(const Trajectory &traj, const std::vector<Obstacle> &obstacles, std::vector<Obstacle> &coll_obstacles) const
+  {
+    // Lay out the obstacle coordinates as arrays for the batched intersection tests
+    std::size_t obs_size = obstacles.size();
+    std::vector<double> obs_x(obs_size), obs_y(obs_size);
+    for (std::size_t k = 0; k < obs_size; ++k)
+    {
+      obs_x[k] = obstacles[k].point.x;
+      obs_y[k] = obstacles[k].point.y;
+    }
+
+    PointSpan obs_pts = {obs_x.data(), obs_y.data(), obs_size};
+    CollisionScratch scratch;
+    std::vector<std::size_t> coll;
+    findCollisions(traj, obs_pts, false, scratch, coll);
+
+    for (std::size_t i = 0; i < coll.size(); ++i)
+    {
+      coll_obstacles.push_back(obstacles[coll[i]]);
+    }
+
+    return (coll_obstacles.size() <= 0);
+  }
+
+  // Check for safety in navigating every trajectory of 'trajs' around the same 'obstacles' in one pass
+  void ObstacleMap::isNavigable(const std::vector<Trajectory> &trajs, const std::vector<Obstacle> &obstacles,
+                                std::vector<unsigned char> &navigable) const
+  {
+    // Obstacle coordinates laid out once for all the trajectories
+    std::size_t obs_size = obstacles.size();
+    std::vector<double> obs_x(obs_size), obs_y(obs_size);
+    for (std::size_t k = 0; k < obs_size; ++k)
+    {
+      obs_x[k] = obstacles[k].point.x;
+      obs_y[k] = obstacles[k].point.y;
+    }
+
+    PointSpan obs_pts = {obs_x.data(), obs_y.data(), obs_size};
+    CollisionScratch scratch;
+
+    navigable.resize(trajs.size());
+    for (std::size_t i = 0; i < trajs.size(); ++i)
+    {
+      navigable[i] = isClear(trajs[i], obs_pts, scratch);
+    }
+  }
+
+  // Check for safety in navigating a trajectory around a provided list of 'obstacles', stopping at the first collision
+  bool ObstacleMap::isNavigable(const Trajectory &traj, const std::vector<Obstacle> &obstacles) const
+  {
+    std::size_t obs_size = obstacles.size();
+    std::vector<double> obs_x(obs_size), obs_y(obs_size);
+    for (std::size_t k = 0; k < obs_size; ++k)
+    {
+      obs_x[k] = obstacles[k].point.x;
+      obs_y[k] = obstacles[k].point.y;
+    }
+
+    PointSpan obs_pts = {obs_x.data(), obs_y.data(), obs_size};
+    CollisionScratch scratch;
+    return isClear(traj, obs_pts, scratch);
+  }
+
+  // Check for safety in navigating a trajectory around the obstacles of the 'map', the range index first
+  bool ObstacleMap::isNavigable(const MapSnapshot &map, const Trajectory &traj) const
+  {
+    NavBound bound = boundNavigable(map, traj);
+    if (bound != NAV_UNKNOWN)
+    {
+      return (bound == NAV_CLEAR);
+    }
+
+    if (!map.segments.empty() || !map.residuals.empty())
+    {
+      return isClearOfSegments(map, traj);
+    }
+
+    return isNavigable(traj, map.obstacles);
+  }
+
+  // Conservative verdict of the range index of the 'map' on a trajectory
+  NavBound ObstacleMap::boundNavigable(const MapSnapshot &map, const Trajectory &traj) const
+  {
+    const RangeIndex &index = map.range_index;
+    if (index.empty() || (fp_radius_ <= 0.0))
+    {
+      return NAV_UNKNOWN;
+    }
+
+    // The point of the arc 'rho' away from the base is seen 'asin(rho / 2r)' from the direction the arc leaves the base
+    // in, towards the side it turns to: arcs sweep less than half a turn, so the points get further away as they turn
+    geometry_msgs::Point goal = traj.getGoalPoint();
+    double reach = std::hypot(goal.x, goal.y);
+    bool straight = almostEqual(goal.y, 0.0);
+    double start_dir = (goal.x >= 0.0) ? 0.0 : M_PI;
+    double turn = straight ? 0.0 : ((goal.x >= 0.0) ? sgn(goal.y) : -sgn(goal.y));
+    double diam = 2.0 * std::abs(traj.getRadius());
+    double f = fp_radius_;
+
+    // a) Clear: every obstacle within 'f' of a point of the arc is at most 'f' further than it, and seen at most
+    // 'asin(f / (d - f))' apart from it if 'd' away. Starting clear of the 2f disk about the base, the rings of radii
+    // 2f, 3f, 5f, 9f... are checked over the directions of the arc points they may be near, widened that much
+    if (index.minDistance() > 2.0 * f + epsilon)
+    {
+      bool clear = true;
+      double far = reach + f;
+      for (double d = 2.0 * f; clear && (d < far); d = 2.0 * d - f)
+      {
+        double next = std::min(2.0 * d - f, far);
+        double margin = std::asin(std::min(1.0, f / (d - f)));
+        double lo = straight ? 0.0 : std::asin(std::min(1.0, (d - f) / diam));
+        double hi = straight ? 0.0 : std::asin(std::min(1.0, std::min(next + f, reach) / diam));
+        double from = start_dir + ((turn >= 0.0) ? (turn * lo) : (turn * hi)) - margin;
+        double to = start_dir + ((turn >= 0.0) ? (turn * hi) : (turn * lo)) + margin;
+        clear = (index.minDistance(from, to) > next + epsilon);
+      }
+
+      if (clear)
+      {
+        return NAV_CLEAR;
+      }
+    }
+
+    // b) Blocked: the closest obstacle 'm' away over the directions of a piece of the arc, if the piece has a point 'm'
+    // away, is at most '2m sin(spread / 2)' from it. Within 'fp_inner_', it is inside the footprint at that point but
+    // was not at the start, so the footprint crosses it. The pieces are kept short enough to turn by little
+    if ((fp_inner_ > 0.0) && (reach > f + epsilon))
+    {
+      double lo = straight ? 0.0 : std::asin(std::min(1.0, f / diam));
+      double hi = straight ? 0.0 : std::asin(std::min(1.0, reach / diam));
+      int pieces = std::min(8, std::max(1, static_cast<int>(std::ceil((hi - lo) * reach / (0.5 * fp_inner_)))));
+      double slack = index.getSlack();
+      for (int i = 0; i < pieces; ++i)
+      {
+        double a = lo + (hi - lo) * i / pieces;
+        double b = lo + (hi - lo) * (i + 1) / pieces;
+        double near = straight ? f : std::max(f, diam * std::sin(a));
+        double far = straight ? reach : std::min(reach, diam * std::sin(b));
+        double from = start_dir + ((turn >= 0.0) ? (turn * a) : (turn * b));
+        double to = start_dir + ((turn >= 0.0) ? (turn * b) : (turn * a));
+
+        double m = index.minDistance(from, to);
+        double spread = (b - a) + 2.0 * slack;
+        if ((m > near + epsilon) && (m <= far) && (2.0 * m * std::sin(0.5 * spread) < fp_inner_ - epsilon))
+        {
+          return NAV_BLOCKED;
+        }
+      }
+    }
+
+    return NAV_UNKNOWN;
+  }
+
+  //==============================================================================
+  // PRIVATE OBSTACLE MAP METHODS (Utilities)
+  //==============================================================================
+
+  // Bounding box of the path along 'traj', grown by 'lim'. Arcs sweep less than half a turn from the origin: 'y' is
+  // monotonic along them, and 'x' only reaches out to the radius past a quarter turn
+  void ObstacleMap::reachBox(const Trajectory &traj, double lim, double box[4]) const
+  {
+    double cy = traj.getRadius();
+    geometry_msgs::Point goal = traj.getGoalPoint();
+    bool straight = almostEqual(goal.y, 0.0);
+    double reach = (!straight && (std::abs(goal.y) > std::abs(goal.x))) ? std::abs(cy) : std::abs(goal.x);
+    box[0] = ((goal.x > 0.0) ? 0.0 : -reach) - lim;
+    box[1] = ((goal.x < 0.0) ? 0.0 : reach) + lim;
+    box[2] = (straight ? 0.0 : std::min(goal.y, 0.0)) - lim;
+    box[3] = (straight ? 0.0 : std::max(goal.y, 0.0)) + lim;
+  }
+
+  // Whether 'traj' is clear of the segments and residual points of the 'map'
+  bool ObstacleMap::isClearOfSegments(const MapSnapshot &map, const Trajectory &traj) const
+  {
+    const std::vector<Obstacle> &obstacles = map.obstacles;
+    geometry_msgs::Point goal = traj.getGoalPoint();
+    bool straight = almostEqual(goal.y, 0.0);
+    double r = traj.getRadius();
+
+    // The robot turns about (0, r) by 'sweep' along arcs, and shifts by the goal along straight lines
+    geometry_msgs::Point c;
+    c.x = c.z = 0.0;
+    c.y = straight ? 0.0 : r;
+    double sweep = straight ? 0.0 : std::atan2(r * goal.x, r * (r - goal.y));
+
+    // Points checked one by one: the residuals, and the runs of the segments the grown footprint already meets
+    std::vector<double> obs_x, obs_y;
+    obs_x.reserve(map.residuals.size());
+    obs_y.reserve(map.residuals.size());
+    for (std::size_t k = 0; k < map.residuals.size(); ++k)
+    {
+      obs_x.push_back(obstacles[map.residuals[k]].point.x);
+      obs_y.push_back(obstacles[map.residuals[k]].point.y);
+    }
+
+    // A segment can only collide if it comes within 'seg_fp_radius_' of the base along the way
+    double lim = seg_fp_radius_ + epsilon;
+    double box[4];
+    reachBox(traj, lim, box);
+    double lo = std::abs(r) - lim - 1e-9 * std::abs(r);
+    double hi = std::abs(r) + lim + 1e-9 * std::abs(r);
+
+    const std::vector<geometry_msgs::Point> &fp = seg_footprint_;
+    for (std::size_t i = 0; i < map.segments.size(); ++i)
+    {
+      const Segment &seg = map.segments[i];
+      if ((std::max(seg.start.x, seg.end.x) < box[0]) || (std::min(seg.start.x, seg.end.x) > box[1]) ||
+          (std::max(seg.start.y, seg.end.y) < box[2]) || (std::min(seg.start.y, seg.end.y) > box[3]))
+      {
+        continue;
+      }
+      if (!straight && ((segmentDistance(c, seg.start, seg.end) > hi) ||
+                        (std::max(dist(seg.start, c), dist(seg.end, c)) < lo)))
+      {
+        continue;
+      }
+
+      if (touchesSegmentFootprint(seg))
+      {
+        for (std::size_t k = seg.first; k <= seg.last; ++k)
+        {
+          obs_x.push_back(obstacles[k].point.x);
+          obs_y.push_back(obstacles[k].point.y);
+        }
+        continue;
+      }
+
+      // Clear of the grown footprint at the start, the segment first meets it either as one of its end points crosses a
+      // footprint edge, the segment moving the opposite way to the robot, or as a footprint vertex crosses the segment
+      for (std::size_t j = 0; j < fp.size(); ++j)
+      {
+        const geometry_msgs::Point &v = fp[j];
+        const geometry_msgs::Point &w = fp[(j + 1) % fp.size()];
+        bool hit;
+        if (straight)
+        {
+          hit = shiftCrossesSegment(seg.start, -goal.x, -goal.y, v, w) || shiftCrossesSegment(seg.end, -goal.x, -goal.y, v, w) ||
+                shiftCrossesSegment(v, goal.x, goal.y, seg.start, seg.end);
+        }
+        else
+        {
+          hit = arcCrossesSegment(seg.start, c, -sweep, v, w) || arcCrossesSegment(seg.end, c, -sweep, v, w) ||
+                arcCrossesSegment(v, c, sweep, seg.start, seg.end);
+        }
+
+        if (hit)
+        {
+          return false;
+        }
+      }
+    }
+
+    if (obs_x.empty())
+    {
+      return true;
+    }
+
+    PointSpan obs_pts = {obs_x.data(), obs_y.data(), obs_x.size()};
+    CollisionScratch scratch;
+    return isClear(traj, obs_pts, scratch);
+  }
+
+  // Whether the 'seg' meets the grown footprint at the start of the path: an end point lies inside it, or the segment
+  // crosses one of its edges
+  bool ObstacleMap::touchesSegmentFootprint(const Segment &seg) const
+  {
+    geometry_msgs::Point base;
+    base.x = base.y = base.z = 0.0;
+    if (segmentDistance(base, seg.start, seg.end) > seg_fp_radius_)
+    {
+      return false;
+    }
+
+    const std::vector<geometry_msgs::Point> &fp = seg_footprint_;
+    bool inside = false;
+    for (std::size_t i = 0, j = fp.size() - 1; i < fp.size(); j = i++)
+    {
+      if ((fp[i].y > seg.start.y) != (fp[j].y > seg.start.y) &&
+          (seg.start.x < fp[j].x + (seg.start.y - fp[j].y) * (fp[i].x - fp[j].x) / (fp[i].y - fp[j].y)))
+      {
+        inside = !inside;
+      }
+
+      if (shiftCrossesSegment(fp[j], fp[i].x - fp[j].x, fp[i].y - fp[j].y, seg.start, seg.end))
+      {
+        return true;
+      }
+    }
+
+    return inside;
+  }
+
+  // Whether 'traj' is clear of the obstacles 'obs', only testing those within reach of the footprint along it
+  bool ObstacleMap::isClear(const Trajectory &traj, const PointSpan &obs, CollisionScratch &scratch) const
+  {
+    std::size_t obs_size = obs.size;
+    std::vector<unsigned char> &in_band = scratch.in_band;
+    in_band.resize(obs_size);
+
+    // An obstacle can only collide if it comes within 'fp_radius_' of the base along the way, i.e. lies within the
+    // bounding box of the path grown by 'fp_radius_', so every other obstacle is dropped in a single branch-free pass
+    double cy = traj.getRadius();
+    bool straight = almostEqual(traj.getGoalPoint().y, 0.0);
+    double box[4];
+    reachBox(traj, fp_radius_ + epsilon, box);
+    double x_min = box[0], x_max = box[1], y_min = box[2], y_max = box[3];
+    for (std::size_t k = 0; k < obs_size; ++k)
+    {
+      in_band[k] = (obs.x[k] >= x_min) & (obs.x[k] <= x_max) & (obs.y[k] >= y_min) & (obs.y[k] <= y_max);
+    }
+
+    // On an arc, the circle about (0, r) an obstacle moves along must also pass within 'fp_radius_' of the base
+    if (!straight)
+    {
+      // Squared band radii about the centre, padded for the rounding of very large radii
+      double slack = epsilon + 1e-9 * std::abs(cy);
+      double lo = std::max(0.0, std::abs(cy) - fp_radius_ - slack);
+      double hi = std::abs(cy) + fp_radius_ + slack;
+      double lo2 = lo * lo;
+      double hi2 = hi * hi;
+      for (std::size_t k = 0; k < obs_size; ++k)
+      {
+        double dy = obs.y[k] - cy;
+        double d2 = obs.x[k] * obs.x[k] + dy * dy;
+        in_band[k] &= (d2 >= lo2) & (d2 <= hi2);
+      }
+    }
+
+    // Compact the obstacles left
+    scratch.band_x.resize(obs_size);
+    scratch.band_y.resize(obs_size);
+    std::size_t band_size = 0;
+    for (std::size_t k = 0; k < obs_size; ++k)
+    {
+      scratch.band_x[band_size] = obs.x[k];
+      scratch.band_y[band_size] = obs.y[k];
+      band_size += in_band[k];
+    }
+
+    if (band_size == 0)
+    {
+      return true;
+    }
+
+    PointSpan band_pts = {scratch.band_x.data(), scratch.band_y.data(), band_size};
+    scratch.coll.clear();
+    findCollisions(traj, band_pts, true, scratch, scratch.coll);
+    return scratch.coll.empty();
+  }
+
+  // Indices into 'obs' of the obstacles colliding along 'traj', once per footprint edge they meet
+  void ObstacleMap::findCollisions(const Trajectory &traj, const PointSpan &obs, bool first_only, CollisionScratch &scratch,
+                                   std::vector<std::size_t> &coll) const
   {
     // Origin of circle at (0, r)
     geometry_msgs::Point c;
@@ -435,37 +886,73 @@ namespace reactive_assistance
     Rc = -Rb;
 
     int footprint_length = robot_profile_.footprint.size();
+    bool straight = almostEqual(goal.y, 0.0);
+
+    std::size_t obs_size = obs.size;
+    std::vector<double> &aux = scratch.aux;
+    aux.resize(obs_size);
+    for (std::size_t k = 0; k < obs_size; ++k)
+    {
+      // Start of line to obstacle point (x) if straight, else radius of circle through obstacle point
+      aux[k] = (straight) ? 0.0 : std::hypot(obs.x[k] - c.x, obs.y[k] - c.y);
+    }
+
+    PointSpan start_pts = {aux.data(), obs.y, obs_size};
+
+    // Batched intersection results per edge
+    scratch.hits.resize(obs_size);
+    scratch.pe_x.resize(obs_size);
+    scratch.pe_y.resize(obs_size);
+    unsigned char *hits = scratch.hits.data();
 
     // Loop over each edge of robot polygon shape
     for (int i = 0; i < footprint_length; ++i)
     {
-      // Loop over obstacles to find colliding ones
-      for (std::vector<Obstacle>::const_iterator it = obstacles.begin(); it != obstacles.end(); ++it)
+      int next = (i + 1) % footprint_length;
+
+      std::size_t num_hits;
+      if (straight)
+      {
+        // Check whether the lines parallel to the trajectory and positioned by each obstacle point (start shifted along
+        // the horizontal axis) intersect the edge line
+        num_hits = lineIntersect(start_pts, obs, robot_profile_.footprint[i], robot_profile_.footprint[next],
+                                 hits, scratch.pe_x.data(), scratch.pe_y.data());
+      }
+      else
       {
-        int next = (i + 1) % footprint_length;
+        num_hits = circleIntersect(robot_profile_.footprint[i], robot_profile_.footprint[next], c, aux.data(), obs_size,
+                                   hits, scratch.pe_x.data(), scratch.pe_y.data());
+      }
+
+      // Loop over the intersecting obstacles to find colliding ones
+      for (std::size_t k = 0; (k < obs_size) && (num_hits > 0); ++k)
+      {
+        if (!hits[k])
+        {
+          continue;
+        }
+        --num_hits;
+
+        geometry_msgs::Point obs_pt;
+        obs_pt.x = obs.x[k];
+        obs_pt.y = obs.y[k];
+        obs_pt.z = 0.0;
 
         // Potential intersection pe and the shifted point pe_star with gap goal reached
         geometry_msgs::Point pe, pe_star;
-        if (almostEqual(goal.y, 0.0))
-        {
-          // Start of line to obstacle point is shifted along the horizontal axis
-          geometry_msgs::Point start;
-          start.x = start.z = 0.0;
-          start.y = it->point.y;
+        pe.x = scratch.pe_x[k];
+        pe.y = scratch.pe_y[k];
+        pe.z = 0.0;
 
-          // Check whether the line parallel to the trajectory and positioned by an obstacle point intersects the edge line
-          if (lineIntersect(start, it->point, robot_profile_.footprint[i], robot_profile_.footprint[next], pe))
-          {
-            pe_star.x = pe.x + goal.x;
-            pe_star.y = pe.y + goal.y;
+        bool collides;
+        if (straight)
+        {
+          pe_star.x = pe.x + goal.x;
+          pe_star.y = pe.y + goal.y;
 
-            if ((sgnx * pe.x <= sgnx * it->point.x) && (sgnx * it->point.x <= sgnx * pe_star.x))
-            {
-              coll_obstacles.push_back(*it);
-            }
-          }
+          collides = (sgnx * pe.x <= sgnx * obs_pt.x) && (sgnx * obs_pt.x <= sgnx * pe_star.x);
         }
-        else if (circleIntersect(robot_profile_.footprint[i], robot_profile_.footprint[next], c, dist(c, it->point), pe))
+        else
         {
           pe_star.x = (Ra * pe.x + Rb * pe.y) + goal.x;
           pe_star.y = (Rc * pe.x + Rd * pe.y) + goal.y;
@@ -473,89 +960,164 @@ namespace reactive_assistance
           // Frame F for intersecting edge point
           double th = std::atan2(pe.y - traj.getRadius(), pe.x);
 
-          geometry_msgs::Point trans_obs = it->point;
+          geometry_msgs::Point trans_obs = obs_pt;
           transformPoint(c, th, trans_obs);
           geometry_msgs::Point trans_pe = pe_star;
           transformPoint(c, th, trans_pe);
 
-          if (mod2pi(delta * std::atan2(trans_obs.y, trans_obs.x)) <= mod2pi(delta * std::atan2(trans_pe.y, trans_pe.x)))
+          collides = (mod2pi(delta * std::atan2(trans_obs.y, trans_obs.x)) <= mod2pi(delta * std::atan2(trans_pe.y, trans_pe.x)));
+        }
+
+        if (collides)
+        {
+          coll.push_back(k);
+
+          if (first_only)
           {
-            coll_obstacles.push_back(*it);
+            return;
           }
         }
       }
     }
-
-    return (coll_obstacles.size() <= 0);
   }
 
-  //==============================================================================
-  // PRIVATE OBSTACLE MAP METHODS (Utilities)
-  //==============================================================================
-
-  void ObstacleMap::updateObstacles()
+  void ObstacleMap::updateObstacles(const sensor_msgs::LaserScan &scan, const geometry_msgs::Transform &laser_to_base, MapSnapshot &map) const
   {
     //将每个点作为激光的障碍物进行更新
-    // Get appropriate transform， 获得变化矩阵
-    geometry_msgs::TransformStamped transform;
-    try
+    //进行障碍物更新
+    std::vector<Obstacle> &obstacles = map.obstacles; //初始化障碍物列表
+    unsigned int obs_size = scan.ranges.size(); //将雷达的size作为障碍物的size
+    obstacles.reserve(obs_size);
+    map.min_obs_dist = scan.ranges[0]; //最小障碍物距离
+
+    // Beam directions from the shared table of this scan geometry, if any
+    BeamTableConstPtr beams;
+    if (beam_tables_ != NULL)
     {
-      transform = tf_buffer_.lookupTransform(
-          robot_frame_,
-          scan_.header.frame_id,
-          ros::Time(0),
-          ros::Duration(3.0));
+      beams = beam_tables_->get(scan);
     }
 
-
-    catch (const tf2::TransformException &ex)
-    {
-      ROS_ERROR("Error during transform: %s", ex.what());
-    }
-    
-    //进行障碍物更新
-    std::vector<Obstacle> obstacles; //初始化障碍物列表
-    unsigned int obs_size = scan_.ranges.size(); //将雷达的size作为障碍物的size
-    min_obs_dist_ = scan_.ranges[0]; //最小障碍物距离
     // Populate the obstacles vector from scanner readings
     for (unsigned int i = 0; i < obs_size; ++i) //遍历所有的激光雷达数据
     {
       //激光点转化到当前的机器人坐标系中
-      const double &range = scan_.ranges[i];
-      double angle = scan_.angle_min + i * scan_.angle_increment;
-
-      geometry_msgs::PointStamped base_point;
-      geometry_msgs::PointStamped scan_point;
-
-      scan_point.point.x = range * std::cos(angle);
-      scan_point.point.y = range * std::sin(angle);
-      scan_point.point.z = 0.0;
+      const double range = scan.ranges[i];
+      double angle, cos_angle, sin_angle;
+      if (beams != NULL)
+      {
+        angle = beams->angle(i);
+        cos_angle = beams->cosAt(i);
+        sin_angle = beams->sinAt(i);
+      }
+      else
+      {
+        angle = scan.angle_min + i * scan.angle_increment;
+        cos_angle = std::cos(angle);
+        sin_angle = std::sin(angle);
+      }
 
+      geometry_msgs::Point base_point;
+      base_point.x = range * cos_angle;
+      base_point.y = range * sin_angle;
+      base_point.z = 0.0;
 
       // Transform scan point to base p2. Gap Searching
-      tf2::doTransform(scan_point, base_point, transform);
+      applyTransform(laser_to_base, base_point);
       if (!std::isinf(range))
       {
-        obstacles.push_back(Obstacle(base_point.point, angle, range));
+        obstacles.push_back(Obstacle(base_point, angle, range));
       }
       else
       {
-        obstacles.push_back(Obstacle(base_point.point, angle, scan_.range_max));
+        obstacles.push_back(Obstacle(base_point, angle, scan.range_max));
       }
 
       // Track closest obstacle distance
-      if (range < min_obs_dist_)
+      if (range < map.min_obs_dist)
       {
-        min_obs_dist_ = range;
+        map.min_obs_dist = range;
       }
     }
 
-    // Overwrite obstacles vector property
-    obstacles_ = obstacles;
+    map.range_index.build(obstacles);
+
+    if (segment_tol_ > 0.0)
+    {
+      updateSegments(map);
+    }
   }
 
-  void ObstacleMap::gapSearch(const Obstacle &obs, int n, bool right, std::vector<Gap> &gaps, int &next_ind) const
+  // Fit the obstacles of the 'map' into line segments within the tolerance
+  void ObstacleMap::updateSegments(MapSnapshot &map) const
   {
+    const std::vector<Obstacle> &obstacles = map.obstacles;
+    std::vector<Segment> &segments = map.segments;
+    std::vector<std::size_t> &residuals = map.residuals;
+    segments.clear();
+    residuals.clear();
+    if (segment_tol_ <= 0.0)
+    {
+      return;
+    }
+
+    // Runs of consecutive points closer than the robot could fit between, so that a segment only closes openings
+    // the base would not pass through anyway
+    double max_step = (fp_inner_ > 0.0) ? fp_inner_ : (2.0 * segment_tol_);
+    std::size_t obs_size = obstacles.size();
+    std::vector<std::pair<std::size_t, std::size_t> > pending;
+    for (std::size_t run = 0, i = 1; i <= obs_size; ++i)
+    {
+      if ((i < obs_size) && (dist(obstacles[i - 1].point, obstacles[i].point) <= max_step))
+      {
+        continue;
+      }
+
+      // Split: a run whose points do not all lie within the tolerance of the segment between its ends is cut at the
+      // furthest one, the pieces being handled in beam order
+      pending.push_back(std::make_pair(run, i - 1));
+      while (!pending.empty())
+      {
+        std::size_t first = pending.back().first;
+        std::size_t last = pending.back().second;
+        pending.pop_back();
+
+        std::size_t far;
+        if (last + 1 < first + MIN_SEGMENT_POINTS)
+        {
+          for (std::size_t k = first; k <= last; ++k)
+          {
+            residuals.push_back(k);
+          }
+        }
+        else if (fitError(obstacles, first, last, far) > segment_tol_)
+        {
+          pending.push_back(std::make_pair(far + 1, last));
+          pending.push_back(std::make_pair(first, far));
+        }
+        else
+        {
+          // Merge: a segment following on from the previous one replaces both if the points of both fit it
+          if (!segments.empty() && (segments.back().last + 1 == first) &&
+              (fitError(obstacles, segments.back().first, last, far) <= segment_tol_))
+          {
+            segments.back().end = obstacles[last].point;
+            segments.back().last = last;
+          }
+          else
+          {
+            segments.push_back(Segment(obstacles[first].point, obstacles[last].point, first, last));
+          }
+        }
+      }
+
+      run = i;
+    }
+  }
+
+  void ObstacleMap::gapSearch(const MapSnapshot &map, const Obstacle &obs, int n, bool right, std::vector<Gap> &gaps, int &next_ind) const
+  {
+    const std::vector<Obstacle> &obstacles = map.obstacles;
+
     // 输入：障碍物，搜索半径，搜索方向，输出：间隙向量，下一个间隙的索引
     //搜索障碍物地图中机器人能够通过的间隙
     // Wrap around effect for checking next index
@@ -566,11 +1128,11 @@ namespace reactive_assistance
     // either measurement is a non-obstacle point (unilateral: basis at unique endpoint)
     // 寻找深度不连续的点，判断深度不连续点是否大于机器人的通过距离
     // 搜索机器人能够通过的间隙
-    // 通过计算下一个障碍物点和当前障碍物之间的距离差，判断计算机是否能够通过间隙 dist(obstacles_[next].point, obs.point) > robot_profile_.min_gap_width
-    // 为什么需要(obs.distance < obstacles_[next].distance))这个判断条件呢？为什么要求当前观测点距离机器人的距离一定要比下一个障碍物点距离小呢？
-    // (!almostEqual(obs.distance, scan_.range_max) && almostEqual(obstacles_[next].distance, scan_.range_max))
+    // 通过计算下一个障碍物点和当前障碍物之间的距离差，判断计算机是否能够通过间隙 dist(obstacles[next].point, obs.point) > robot_profile_.min_gap_width
+    // 为什么需要(obs.distance < obstacles[next].distance))这个判断条件呢？为什么要求当前观测点距离机器人的距离一定要比下一个障碍物点距离小呢？
+    // (!almostEqual(obs.distance, map.range_max) && almostEqual(obstacles[next].distance, map.range_max))
     // 如果当前点在range内，下一个点超过了range，那么也可以认为是一个gap
-    if (((dist(obstacles_[next].point, obs.point) > robot_profile_.min_gap_width) && (obs.distance < obstacles_[next].distance)) || (!almostEqual(obs.distance, scan_.range_max) && almostEqual(obstacles_[next].distance, scan_.range_max)))
+    if (((dist(obstacles[next].point, obs.point) > robot_profile_.min_gap_width) && (obs.distance < obstacles[next].distance)) || (!almostEqual(obs.distance, map.range_max) && almostEqual(obstacles[next].distance, map.range_max)))
     {
       //如果搜索到一个gap，进入if执行程序
       // Initialise min variables
@@ -586,15 +1148,15 @@ namespace reactive_assistance
       // O+ points are those in which the angular distance does not exceed PI
       // O+ points 是角度小于PI的点, 确保搜索的范围合理
       // 根据方向选择计算角度差的方向
-      bool ang_safe = (right) ? (proj(obstacles_[i].angle - obs.angle) > 0.0) : (proj(obstacles_[i].angle - obs.angle) < 0.0);
+      bool ang_safe = (right) ? (proj(obstacles[i].angle - obs.angle) > 0.0) : (proj(obstacles[i].angle - obs.angle) < 0.0);
       while (ang_safe) // 如果角度茶位正时差，则继续判断
       {
-        if (!almostEqual(obstacles_[i].distance, scan_.range_max)) // 判断障碍物点是否在有效的距离内
+        if (!almostEqual(obstacles[i].distance, map.range_max)) // 判断障碍物点是否在有效的距离内
         {
           // Determine whether these O+ points are valid or not
-          double distp = dist(obs.point, obstacles_[i].point); // 计算当前点到障碍物点之间的距离
+          double distp = dist(obs.point, obstacles[i].point); // 计算当前点到障碍物点之间的距离
           // 计算当前点和障碍物点形成的直线的与机器人当前方向形成的夹角
-          double visibility = std::acos((dist_gap + distp * distp - obstacles_[i].distance * obstacles_[i].distance) / (2 * distp * obs.distance));
+          double visibility = std::acos((dist_gap + distp * distp - obstacles[i].distance * obstacles[i].distance) / (2 * distp * obs.distance));
 
           // Valid O+ point if visibility condition met
           // 角度越小则观测点和障碍物点形成的直线和机器人方向的夹角越小i，说明更好
@@ -614,7 +1176,7 @@ namespace reactive_assistance
         // Next point to evaluate and angular safety check
         i = (right) ? ((i + 1) % n) : ((n + (i - 1)) % n); //根据检索的方向，更新下一个点。 使用取模运算，保证当前的点都在点云中进行处理。
         // 进行角度安全检查，确保当前的角度差一直为正。如果为负，则说明已经遍历了一遍了，进入了[-π, π]另一个区间中了。
-        ang_safe = (right) ? (proj(obstacles_[i].angle - obs.angle) > 0.0) : (proj(obstacles_[i].angle - obs.angle) < 0.0); 
+        ang_safe = (right) ? (proj(obstacles[i].angle - obs.angle) > 0.0) : (proj(obstacles[i].angle - obs.angle) < 0.0); 
       }
 
       // If there is an empty set of valid O+ points
@@ -626,21 +1188,21 @@ namespace reactive_assistance
         double virt_safe = robot_profile_.radius + robot_profile_.d_safe;
         // 设置一个虚拟点，虚拟点的是由机器人当前的位置和虚拟的半径得到的
         // 计算虚拟点的x y z
-        virtual_point.x = obs.point.x + virt_safe * std::cos(obstacles_[next].angle);
-        virtual_point.y = obs.point.y + virt_safe * std::sin(obstacles_[next].angle);
+        virtual_point.x = obs.point.x + virt_safe * std::cos(obstacles[next].angle);
+        virtual_point.y = obs.point.y + virt_safe * std::sin(obstacles[next].angle);
         virtual_point.z = 0.0;
 
         // Law of cosines for distance to virtual point
         // 计算当前观测点obs到虚拟点之间的距离
-        double range = std::sqrt(virt_safe * virt_safe + dist_gap - 2 * virt_safe * obs.distance * std::cos(obstacles_[next].angle - obs.angle));
+        double range = std::sqrt(virt_safe * virt_safe + dist_gap - 2 * virt_safe * obs.distance * std::cos(obstacles[next].angle - obs.angle));
 
         if (right) //根据左右的搜索方向，将gap的开始点和结束点放入到GAP list中。
         {
-          gaps.push_back(Gap(obs, Obstacle(virtual_point, obstacles_[next].angle, range)));
+          gaps.push_back(Gap(obs, Obstacle(virtual_point, obstacles[next].angle, range)));
         }
         else
         {
-          gaps.push_back(Gap(Obstacle(virtual_point, obstacles_[next].angle, range), obs));
+          gaps.push_back(Gap(Obstacle(virtual_point, obstacles[next].angle, range), obs));
         }
 
         // Resume scanning from left neighbour
@@ -649,14 +1211,14 @@ namespace reactive_assistance
       else if (right)
       {
         // Add gap to the vector with the basis right side and determined left side
-        gaps.push_back(Gap(obs, obstacles_[min_ind]));
+        gaps.push_back(Gap(obs, obstacles[min_ind]));
         // Resume scanning from left side, unless it exceeds last sensor point
         next_ind = (min_ind < next_ind) ? 0 : min_ind;
       }
       else
       {
         // Add gap to the vector with the basis right side and determined left side
-        gaps.push_back(Gap(obstacles_[min_ind], obs));
+        gaps.push_back(Gap(obstacles[min_ind], obs));
         // Resume scanning from right side, unless it exceeds last sensor point
         next_ind = (min_ind > next_ind) ? (n - 1) : min_ind;
       }
@@ -669,32 +1231,34 @@ namespace reactive_assistance
 
   // Admissible Gap method of evaluating each range reading to detect gaps (treating each scan as a sector)
   // 更新地图中的间隙(gap)
-  void ObstacleMap::updateGaps()
+  void ObstacleMap::updateGaps(MapSnapshot &map) const
   {
     std::vector<Gap> gaps; // 初始化一个空的gap
-    int n = obstacles_.size(); //使用障碍物的数量作为循环的次数
+    searchGaps(map, gaps);
+
+    // Filter the gaps detected into the snapshot
+    filterGaps(gaps, map.gaps); // 过滤gap
+  }
+
+  // Detect the raw gaps between the obstacles of the 'map', before filtering
+  void ObstacleMap::searchGaps(const MapSnapshot &map, std::vector<Gap> &gaps) const
+  {
+    int n = map.obstacles.size(); //使用障碍物的数量作为循环的次数
 
     // Counterclockwise search is to check for the existence of RIGHT discontinuities
     //使用逆时针搜索，判断是否有不连续点， 右查找
     int k = 0;
     do
     {
-      gapSearch(obstacles_[k], n, true, gaps, k);
+      gapSearch(map, map.obstacles[k], n, true, gaps, k);
     } while (k != 0); //找到所有的gap
 
     // Clockwise search is to check for the existence of LEFT discontinuities， 左查找
     k = n - 1;
     do
     {
-      gapSearch(obstacles_[k], n, false, gaps, k);
+      gapSearch(map, map.obstacles[k], n, false, gaps, k);
     } while (k != (n - 1));
-
-    // Filter the gaps detected
-    std::vector<Gap> filt_gaps; // 初始化filt_gaps
-    filterGaps(gaps, filt_gaps); // 过滤gap
-
-    // Overwrite gaps property
-    gaps_ = filt_gaps;
   }
 
   // Filter out gaps to eliminate duplicates and gaps that do not exceed the required width
@@ -704,10 +1268,6 @@ namespace reactive_assistance
     // 输入：in_gaps，输出：out_gaps
     std::vector<Gap> filt_gaps; 
 
-    // Initialise point cloud to visualise the gaps
-    PointCloudPtr point_cloud(new PointCloud); // 初始化可视化点云
-    point_cloud->header.frame_id = robot_frame_;
-
     unsigned int gaps_size = in_gaps.size(); // 将gap的数量保存在gaps_size中
     // Evaluate each gap to determine whether to eliminate it if it exists within another gap
     for (unsigned int i = 0; i < gaps_size; ++i) //遍历所有的gap
@@ -748,30 +1308,50 @@ namespace reactive_assistance
       if (filt_gaps[i].width > robot_profile_.min_gap_width)
       {
         out_gaps.push_back(filt_gaps[i]);
-
-        point_cloud->points.push_back(pcl::PointXYZ(out_gaps[i].right.point.x, out_gaps[i].right.point.y, out_gaps[i].right.point.z));
-        point_cloud->points.push_back(pcl::PointXYZ(out_gaps[i].left.point.x, out_gaps[i].left.point.y, out_gaps[i].left.point.z));
       }
     }
-
-    if (out_gaps.size() > 0)
-    {
-      gaps_pub_.publish(point_cloud);
-    }
   }
 
   // Compute clearance to obstacles while traversing a gap via an input trajectory
-  double ObstacleMap::computeClearance(const Trajectory &traj) const
+  double ObstacleMap::computeClearance(const MapSnapshot &map, const Trajectory &traj) const
   {
-    unsigned int obs_size = obstacles_.size();
+    const std::vector<Obstacle> &obstacles = map.obstacles;
+    unsigned int obs_size = obstacles.size();
     double min_d = std::numeric_limits<double>::max();
 
+    // Segmented: the distance of a segment to the circle of the trajectory is zero if it crosses the circle, else that
+    // of its closest or furthest point from the centre
+    if (!map.segments.empty() || !map.residuals.empty())
+    {
+      geometry_msgs::Point c, p;
+      c.x = c.z = 0.0;
+      c.y = traj.getRadius();
+      double r = std::abs(traj.getRadius());
+
+      for (std::size_t i = 0; i < map.segments.size(); ++i)
+      {
+        const Segment &seg = map.segments[i];
+        double d_min = segmentDistance(c, seg.start, seg.end);
+        double d_max = std::max(dist(seg.start, c), dist(seg.end, c));
+        min_d = std::min(min_d, (r < d_min) ? (d_min - r) : ((r > d_max) ? (r - d_max) : 0.0));
+      }
+
+      for (std::size_t k = 0; k < map.residuals.size(); ++k)
+      {
+        const geometry_msgs::Point &obs = obstacles[map.residuals[k]].point;
+        traj.getClosestPoint(obs, p);
+        min_d = std::min(min_d, dist(obs, p));
+      }
+
+      return min_d;
+    }
+
     for (unsigned int i = 0; i < obs_size; i++)
     {
       geometry_msgs::Point p;
 
-      traj.getClosestPoint(obstacles_[i].point, p);
-      double distp = dist(obstacles_[i].point, p);
+      traj.getClosestPoint(obstacles[i].point, p);
+      double distp = dist(obstacles[i].point, p);
 
       if (distp < min_d)
       {
@@ -0,0 +1,101 @@
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <boost/thread/tss.hpp>
+
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/perf_counters.hpp>
+
+namespace reactive_assistance
+{
+  // Generic hardware event of every counter
+  static const boost::uint64_t PERF_COUNTER_CONFIGS[NUM_PERF_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+  };
+
+  // Layout of a PERF_FORMAT_GROUP read
+  struct PerfGroupRead
+  {
+    boost::uint64_t nr;
+    boost::uint64_t values[NUM_PERF_COUNTERS];
+  };
+
+  PerfCounterGroup::PerfCounterGroup()
+                                    : open_(true)
+  {
+    for (int i = 0; i < NUM_PERF_COUNTERS; ++i)
+    {
+      struct perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNTER_CONFIGS[i];
+      attr.read_format = PERF_FORMAT_GROUP;
+      attr.disabled = (i == 0);
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+
+      // Calling thread on any CPU, the first counter leads the group
+      int group_fd = (i == 0) ? -1 : fds_[0];
+      fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+
+      if (fds_[i] < 0)
+      {
+        open_ = false;
+      }
+    }
+
+    if (open_)
+    {
+      ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+
+  PerfCounterGroup::~PerfCounterGroup()
+  {
+    for (int i = NUM_PERF_COUNTERS - 1; i >= 0; --i)
+    {
+      if (fds_[i] >= 0)
+      {
+        close(fds_[i]);
+      }
+    }
+  }
+
+  bool PerfCounterGroup::read(PerfSample &sample) const
+  {
+    if (!open_)
+    {
+      return false;
+    }
+
+    PerfGroupRead group;
+    if ((::read(fds_[0], &group, sizeof(group)) != sizeof(group)) || (group.nr != NUM_PERF_COUNTERS))
+    {
+      return false;
+    }
+
+    std::memcpy(sample.values, group.values, sizeof(sample.values));
+    return true;
+  }
+
+  PerfCounterGroup &PerfCounterGroup::forThisThread()
+  {
+    static boost::thread_specific_ptr<PerfCounterGroup> group;
+
+    if (group.get() == NULL)
+    {
+      group.reset(new PerfCounterGroup());
+    }
+
+    return *group;
+  }
+} /* namespace reactive_assistance */
@@ -0,0 +1,917 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <reactive_assistance/obstacle.hpp>
+#include <reactive_assistance/gap.hpp>
+#include <reactive_assistance/dist_util.hpp>
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/planning_engine.hpp>
+
+namespace reactive_assistance
+{
+  //==============================================================================
+  // PUBLIC PLANNING ENGINE METHODS
+  //==============================================================================
+
+  PlanningEngine::PlanningEngine(const RobotProfile &rp, const EngineConfig &config)
+                                : config_(config)
+                                , robot_profile_(NULL)
+                                , profiler_(NULL)
+                                , obs_map_(NULL)
+                                , trace_(NULL)
+                                , assist_cache_(NULL)
+                                , assist_requested_(false)
+  {
+    if (config_.beam_tables == NULL)
+    {
+      config_.beam_tables.reset(new BeamTableCache);
+    }
+
+    robot_profile_ = new RobotProfile(rp);
+    profiler_ = new StageProfiler();
+    obs_map_ = new ObstacleMap(*robot_profile_, profiler_, config_.beam_tables.get(), config_.segment_tolerance);
+    trace_ = new TraceRecorder(std::max(config_.trace_capacity, static_cast<std::size_t>(1)));
+
+    if (config_.assist_cache_size > 0)
+    {
+      assist_cache_ = new AssistCache(config_.assist_cache_size, config_.assist_cache_lin_quantum, config_.assist_cache_ang_quantum);
+    }
+  }
+
+  PlanningEngine::~PlanningEngine()
+  {
+    if (assist_cache_ != NULL)
+    {
+      delete assist_cache_;
+    }
+
+    if (trace_ != NULL)
+    {
+      delete trace_;
+    }
+
+    if (obs_map_ != NULL)
+    {
+      delete obs_map_;
+    }
+
+    if (profiler_ != NULL)
+    {
+      delete profiler_;
+    }
+
+    if (robot_profile_ != NULL)
+    {
+      delete robot_profile_;
+    }
+  }
+
+  void PlanningEngine::updateScan(const sensor_msgs::LaserScan &scan, const geometry_msgs::Transform &laser_to_base)
+  {
+    obs_map_->updateScan(scan, laser_to_base);
+  }
+
+  void PlanningEngine::updateScan(const sensor_msgs::LaserScan &scan)
+  {
+    obs_map_->updateScan(scan, config_.laser_to_base);
+  }
+
+  void PlanningEngine::computeCommand(const geometry_msgs::Twist &input, const nav_msgs::Odometry &odom, const geometry_msgs::Point *goal,
+                                      PlanningResult &result, VisualFrame *frame) const
+  {
+    // Every query of this call is made against the same map snapshot
+    initResult(TRACE_SHARED_CONTROL, result);
+    const MapSnapshot &map = *result.map;
+
+    // Decision trace of this cycle
+    TraceRecord &rec = result.trace;
+    rec.in_vx = input.linear.x;
+    rec.in_wz = input.angular.z;
+
+    if (frame != NULL)
+    {
+      frame->map = result.map;
+    }
+
+    // Joystick deadzone
+    bool deadzone = (std::abs(input.linear.x) < 0.1 && std::abs(input.angular.z) < 0.1);
+
+    // Serve the cycle from the cache if it was already planned against this snapshot, unless pursuing a global goal,
+    // which moves in the robot frame from cycle to cycle, or gathering the debug data
+    AssistKey key;
+    bool cacheable = (assist_cache_ != NULL) && (goal == NULL) && (frame == NULL) && !deadzone;
+    if (cacheable)
+    {
+      assist_cache_->makeKey(map.version, input, odom, key);
+
+      TraceRecord cached;
+      // The cached command is sent as is even on a free path, as the current input itself was never checked
+      if (assist_cache_->lookup(key, result.cmd, cached))
+      {
+        rec.outcome = cached.outcome;
+        rec.flags |= TRACE_FLAG_CACHED;
+        rec.gaps_evaluated = cached.gaps_evaluated;
+        rec.virt_iterations = cached.virt_iterations;
+        rec.gap_right_x = cached.gap_right_x;
+        rec.gap_right_y = cached.gap_right_y;
+        rec.gap_left_x = cached.gap_left_x;
+        rec.gap_left_y = cached.gap_left_y;
+        rec.clearance_min = cached.clearance_min;
+        rec.clearance_max = cached.clearance_max;
+        rec.out_vx = result.cmd.linear.x;
+        rec.out_wz = result.cmd.angular.z;
+        return;
+      }
+    }
+
+    // Goal trajectory to pursue
+    TrajPtr goal_traj;
+    {
+      StageCounterScope counters(profiler_, STAGE_SIMULATE_TRAJECTORY);
+
+      // Get simulated goal trajectory if one hasn't been specified by a 'global' source
+      if (goal != NULL)
+      {
+        goal_traj.reset(new Trajectory(*goal));
+      }
+      else
+      {
+        goal_traj = simulateTrajectory(input, odom, frame);
+      }
+    }
+    boost::int64_t t_sim = monotonicNanos();
+    rec.stage_ns[STAGE_SIMULATE_TRAJECTORY] = t_sim - result.start_ns;
+
+    // Assistive command
+    geometry_msgs::Twist &assist = result.cmd;
+    // Colliding obstacles vector
+    std::vector<Obstacle> obstacles;
+
+    // Handle different drive scenarios:
+    // a) Joystick deadzone
+    if (deadzone)
+    {
+      assist.linear.x = 0.0;
+      assist.angular.z = 0.0;
+
+      rec.outcome = TRACE_DEADZONE;
+    }
+    else
+    {
+      bool navigable;
+      {
+        StageCounterScope counters(profiler_, STAGE_IS_NAVIGABLE);
+        navigable = obs_map_->isNavigable(map, *goal_traj);
+      }
+      rec.stage_ns[STAGE_IS_NAVIGABLE] = monotonicNanos() - t_sim;
+
+      // b) Free-path to goal situation
+      if (navigable)
+      {
+        assist = input;
+
+        rec.outcome = TRACE_FREE_PATH;
+      }
+      // c) Dangerous-path to goal situation
+      else
+      {
+        // Visualise the colliding obstacles, gathered point by point apart from the verdict
+        if (frame != NULL)
+        {
+          obs_map_->isNavigable(*goal_traj, map.obstacles, obstacles);
+          frame->coll_obstacles = obstacles;
+        }
+
+        // Find the assistive command, gaps are ranked by Euclidean distance to a global goal
+        findAssistiveCommand(map, *goal_traj, (goal != NULL), assist, rec, frame);
+
+        // d) No admissible gap: rather than stopping dead, take the closest safe command to the user's
+        if (rec.outcome == TRACE_NO_GAP)
+        {
+          boost::int64_t t_sample = monotonicNanos();
+          if (sampleCommand(map, input, odom, assist))
+          {
+            rec.outcome = TRACE_SAMPLED;
+          }
+          rec.stage_ns[STAGE_ASSISTIVE_COMMAND] += monotonicNanos() - t_sample;
+        }
+      }
+    }
+
+    rec.out_vx = assist.linear.x;
+    rec.out_wz = assist.angular.z;
+
+    if (cacheable)
+    {
+      assist_cache_->insert(key, assist, rec);
+    }
+  }
+
+  void PlanningEngine::planAssist(const geometry_msgs::Twist &input, const nav_msgs::Odometry &odom)
+  {
+    // Inputs within the joystick deadzone have no direction to plan for, the previous decision stands
+    if (std::abs(input.linear.x) < 0.1 && std::abs(input.angular.z) < 0.1)
+    {
+      return;
+    }
+
+    MapSnapshotConstPtr snapshot = obs_map_->getSnapshot();
+    const MapSnapshot &map = *snapshot;
+
+    AssistDecision decision;
+    decision.valid = true;
+    TraceRecord &rec = decision.trace;
+    rec.map_version = map.version;
+    rec.source = TRACE_SHARED_CONTROL;
+    rec.in_vx = input.linear.x;
+    rec.in_wz = input.angular.z;
+
+    // The gap is searched whether or not the input is blocked now, so that a direction is ready when it is
+    TrajPtr traj = simulateTrajectory(input, odom, NULL);
+
+    boost::int64_t start = monotonicNanos();
+    {
+      StageCounterScope counters(profiler_, STAGE_ASSISTIVE_COMMAND);
+      if (!findSafeGoal(map, *traj, false, decision.goal, rec, NULL) && sampleCommand(map, input, odom, decision.cmd))
+      {
+        rec.outcome = TRACE_SAMPLED;
+
+        double y_goal;
+        simulateGoal(decision.cmd, odom, decision.goal, y_goal);
+      }
+    }
+    rec.stage_ns[STAGE_ASSISTIVE_COMMAND] = monotonicNanos() - start;
+
+    // The cycles of the fast tier do not run these stages, they are recorded here once per decision
+    profiler_->record(STAGE_ASSISTIVE_COMMAND, rec.stage_ns[STAGE_ASSISTIVE_COMMAND]);
+    if (rec.gaps_evaluated > 0)
+    {
+      profiler_->record(STAGE_FIND_VIRTUAL_GAPS, rec.stage_ns[STAGE_FIND_VIRTUAL_GAPS]);
+    }
+
+    boost::mutex::scoped_lock lock(decision_mutex_);
+    decision_ = decision;
+  }
+
+  bool PlanningEngine::waitForAssist(boost::uint64_t &version, const boost::posix_time::time_duration &timeout)
+  {
+    boost::uint64_t latest = obs_map_->waitForSnapshot(version, timeout, &assist_requested_)->version;
+    bool requested = assist_requested_.exchange(false, boost::memory_order_acq_rel);
+    if ((latest == version) && !requested)
+    {
+      return false;
+    }
+
+    version = latest;
+    return true;
+  }
+
+  void PlanningEngine::computeFastCommand(const geometry_msgs::Twist &input, const nav_msgs::Odometry &odom, PlanningResult &result,
+                                          VisualFrame *frame) const
+  {
+    initResult(TRACE_SHARED_CONTROL, result);
+    const MapSnapshot &map = *result.map;
+
+    TraceRecord &rec = result.trace;
+    rec.in_vx = input.linear.x;
+    rec.in_wz = input.angular.z;
+
+    if (frame != NULL)
+    {
+      frame->map = result.map;
+    }
+
+    TrajPtr goal_traj;
+    {
+      StageCounterScope counters(profiler_, STAGE_SIMULATE_TRAJECTORY);
+      goal_traj = simulateTrajectory(input, odom, frame);
+    }
+    boost::int64_t t_sim = monotonicNanos();
+    rec.stage_ns[STAGE_SIMULATE_TRAJECTORY] = t_sim - result.start_ns;
+
+    geometry_msgs::Twist &assist = result.cmd;
+
+    // a) Joystick deadzone
+    if (std::abs(input.linear.x) < 0.1 && std::abs(input.angular.z) < 0.1)
+    {
+      assist.linear.x = 0.0;
+      assist.angular.z = 0.0;
+
+      rec.outcome = TRACE_DEADZONE;
+    }
+    else
+    {
+      bool navigable;
+      {
+        StageCounterScope counters(profiler_, STAGE_IS_NAVIGABLE);
+        navigable = obs_map_->isNavigable(map, *goal_traj);
+      }
+
+      // b) Free-path to goal situation
+      if (navigable)
+      {
+        assist = input;
+
+        rec.outcome = TRACE_FREE_PATH;
+      }
+      // c) Dangerous-path to goal situation: follow the decision of the slow tier, stop if there is none
+      else
+      {
+        AssistDecision decision;
+        {
+          boost::mutex::scoped_lock lock(decision_mutex_);
+          decision = decision_;
+        }
+
+        assist.linear.x = 0.0;
+        assist.angular.z = 0.0;
+
+        rec.outcome = TRACE_NO_GAP;
+
+        // A decision planned for another input, e.g. before the user turned or reversed, says nothing about this one
+        bool planned = decision.valid && (sgn(decision.trace.in_vx) == sgn(input.linear.x)) &&
+                       (std::abs(decision.trace.in_vx - input.linear.x) <= config_.decision_lin_tolerance) &&
+                       (std::abs(decision.trace.in_wz - input.angular.z) <= config_.decision_ang_tolerance);
+        rec.flags |= TRACE_FLAG_DEFERRED;
+
+        StageCounterScope counters(profiler_, STAGE_IS_NAVIGABLE);
+        if (!planned)
+        {
+          // Stop rather than search the gaps on the input path, and have the slow tier plan for this input now
+          if (!assist_requested_.exchange(true, boost::memory_order_acq_rel))
+          {
+            obs_map_->wakeWaiters();
+          }
+        }
+        else if (decision.trace.outcome == TRACE_ASSISTED)
+        {
+          // The decision may have been planned against an older snapshot, so its trajectory is checked against this one
+          Trajectory safe_traj(decision.goal);
+          if (obs_map_->isNavigable(map, safe_traj))
+          {
+            computeMotionCommand(map, safe_traj, assist);
+            rec.outcome = TRACE_ASSISTED;
+          }
+        }
+        // No admissible gap: sample the fallback from the current velocities, as the single tier would
+        else if (sampleCommand(map, input, odom, assist))
+        {
+          rec.outcome = TRACE_SAMPLED;
+        }
+
+        if (rec.outcome != TRACE_NO_GAP)
+        {
+          rec.gaps_evaluated = decision.trace.gaps_evaluated;
+          rec.virt_iterations = decision.trace.virt_iterations;
+          rec.gap_right_x = decision.trace.gap_right_x;
+          rec.gap_right_y = decision.trace.gap_right_y;
+          rec.gap_left_x = decision.trace.gap_left_x;
+          rec.gap_left_y = decision.trace.gap_left_y;
+          rec.clearance_min = decision.trace.clearance_min;
+          rec.clearance_max = decision.trace.clearance_max;
+        }
+      }
+
+      if (rec.stage_ns[STAGE_IS_NAVIGABLE] == 0)
+      {
+        rec.stage_ns[STAGE_IS_NAVIGABLE] = monotonicNanos() - t_sim;
+      }
+    }
+
+    rec.out_vx = assist.linear.x;
+    rec.out_wz = assist.angular.z;
+  }
+
+  void PlanningEngine::computeAutonomousCommand(const geometry_msgs::Point &goal, PlanningResult &result, VisualFrame *frame) const
+  {
+    // Every query of this call is made against the same map snapshot
+    initResult(TRACE_AUTONOMOUS, result);
+    const MapSnapshot &map = *result.map;
+
+    // Decision trace of this cycle
+    TraceRecord &rec = result.trace;
+
+    if (frame != NULL)
+    {
+      frame->map = result.map;
+    }
+
+    // Goal trajectory to pursue
+    TrajPtr goal_traj;
+    {
+      StageCounterScope counters(profiler_, STAGE_SIMULATE_TRAJECTORY);
+      goal_traj.reset(new Trajectory(goal));
+    }
+    boost::int64_t t_sim = monotonicNanos();
+    rec.stage_ns[STAGE_SIMULATE_TRAJECTORY] = t_sim - result.start_ns;
+
+    // Assistive command
+    geometry_msgs::Twist &assist = result.cmd;
+    // Colliding obstacles vector
+    std::vector<Obstacle> obstacles;
+
+    computeMotionCommand(map, *goal_traj, assist);
+    rec.in_vx = assist.linear.x;
+    rec.in_wz = assist.angular.z;
+    rec.outcome = TRACE_FREE_PATH;
+
+    bool navigable;
+    {
+      StageCounterScope counters(profiler_, STAGE_IS_NAVIGABLE);
+      navigable = obs_map_->isNavigable(map, *goal_traj);
+    }
+    rec.stage_ns[STAGE_IS_NAVIGABLE] = monotonicNanos() - t_sim;
+
+    if (!navigable)
+    {
+      // Visualise the colliding obstacles, gathered point by point apart from the verdict
+      if (frame != NULL)
+      {
+        obs_map_->isNavigable(*goal_traj, map.obstacles, obstacles);
+        frame->coll_obstacles = obstacles;
+      }
+
+      // Find the assistive command
+      findAssistiveCommand(map, *goal_traj, true, assist, rec, frame);
+    }
+
+    rec.out_vx = assist.linear.x;
+    rec.out_wz = assist.angular.z;
+  }
+
+  void PlanningEngine::recordCycle(PlanningResult &result, const ros::Time &now)
+  {
+    TraceRecord &rec = result.trace;
+    rec.stamp_ns = now.toNSec();
+    trace_->record(rec);
+
+    // Age of the scan at the time the command went out
+    boost::int64_t scan_to_cmd = result.map->stamp.isZero() ? 0 : (now - result.map->stamp).toNSec();
+    profiler_->recordCycle(rec, monotonicNanos() - result.start_ns, scan_to_cmd);
+  }
+
+  void PlanningEngine::step(const sensor_msgs::LaserScan &scan, const nav_msgs::Odometry &odom, const geometry_msgs::Twist &input,
+                            const geometry_msgs::Point *goal, PlanningResult &result)
+  {
+    boost::int64_t start = monotonicNanos();
+    updateScan(scan);
+    computeCommand(input, odom, goal, result);
+
+    // The command goes out once the whole cycle has run, its time on the clock of the scan stamps
+    recordCycle(result, scan.header.stamp + ros::Duration().fromNSec(monotonicNanos() - start));
+  }
+
+  bool PlanningEngine::sampleCommand(const MapSnapshot &map, const geometry_msgs::Twist &input, const nav_msgs::Odometry &odom,
+                                     geometry_msgs::Twist &cmd) const
+  {
+    std::size_t num_vx = config_.fallback_samples_vx;
+    std::size_t num_vth = config_.fallback_samples_vth;
+    if ((num_vx == 0) || (num_vth == 0))
+    {
+      return false;
+    }
+
+    // Dynamic window: velocities reachable from the current ones over the simulated horizon, within the robot limits
+    const RobotProfile &rp = *robot_profile_;
+    double vx = odom.twist.twist.linear.x;
+    double vth = odom.twist.twist.angular.z;
+    double vx_min = std::max(-rp.max_vx, vx - rp.acc_vx_lim * config_.sim_time);
+    double vx_max = std::min(rp.max_vx, vx + rp.acc_vx_lim * config_.sim_time);
+    double vth_min = std::max(-rp.max_vth, vth - rp.acc_vth_lim * config_.sim_time);
+    double vth_max = std::min(rp.max_vth, vth + rp.acc_vth_lim * config_.sim_time);
+
+    // Never drive against the direction the user is pushing
+    if (input.linear.x >= 0.0)
+    {
+      vx_min = std::max(vx_min, 0.0);
+    }
+    else
+    {
+      vx_max = std::min(vx_max, 0.0);
+    }
+
+    if ((vx_min > vx_max) || (vth_min > vth_max))
+    {
+      return false;
+    }
+
+    double vx_step = (num_vx > 1) ? (vx_max - vx_min) / (num_vx - 1) : 0.0;
+    double vth_step = (num_vth > 1) ? (vth_max - vth_min) / (num_vth - 1) : 0.0;
+
+    // Candidate commands, leaving out those within the joystick deadzone as they would only stop the robot anyway
+    std::vector<geometry_msgs::Twist> samples;
+    samples.reserve(num_vx * num_vth);
+    geometry_msgs::Twist sample;
+    for (std::size_t i = 0; i < num_vx; ++i)
+    {
+      sample.linear.x = vx_min + i * vx_step;
+      for (std::size_t j = 0; j < num_vth; ++j)
+      {
+        sample.angular.z = vth_min + j * vth_step;
+        if ((std::abs(sample.linear.x) >= 0.1) || (std::abs(sample.angular.z) >= 0.1))
+        {
+          samples.push_back(sample);
+        }
+      }
+    }
+
+    // Circular arcs to the simulated goals of every candidate, checked together
+    std::vector<geometry_msgs::Point> goals;
+    simulateGoals(samples, odom, goals);
+
+    std::vector<Trajectory> trajs;
+    trajs.reserve(goals.size());
+    for (std::size_t i = 0; i < goals.size(); ++i)
+    {
+      trajs.push_back(Trajectory(goals[i]));
+    }
+
+    std::vector<unsigned char> navigable;
+    obs_map_->isNavigable(trajs, map.obstacles, navigable);
+
+    // A rotation from standstill never leaves the base, its goal only stands in for a heading on the virtual radius,
+    // so the arc to it says nothing about the corners sweeping around: it is only safe if no obstacle lies within
+    // reach of the footprint as it turns. The first step of the rollout already brings a speed within one velocity
+    // step of zero down to a stop
+    int num_steps = std::ceil(config_.sim_time / config_.sim_granularity);
+    bool standstill = (std::abs(vx) <= rp.acc_vx_lim * config_.sim_time / std::max(num_steps, 1));
+    int turn_clear = -1;
+    for (std::size_t i = 0; standstill && (i < samples.size()); ++i)
+    {
+      if (samples[i].linear.x != 0.0)
+      {
+        continue;
+      }
+
+      if (turn_clear < 0)
+      {
+        double reach = 0.0;
+        for (std::size_t k = 0; k < rp.footprint.size(); ++k)
+        {
+          reach = std::max(reach, std::hypot(rp.footprint[k].x, rp.footprint[k].y));
+        }
+
+        turn_clear = 1;
+        for (std::size_t k = 0; k < map.obstacles.size(); ++k)
+        {
+          if (std::hypot(map.obstacles[k].point.x, map.obstacles[k].point.y) <= reach)
+          {
+            turn_clear = 0;
+            break;
+          }
+        }
+      }
+
+      navigable[i] = static_cast<unsigned char>(turn_clear);
+    }
+
+    // Closest navigable candidate to the input, each velocity normalised by its limit
+    int best = -1;
+    double best_cost = 0.0;
+    for (std::size_t i = 0; i < samples.size(); ++i)
+    {
+      if (!navigable[i])
+      {
+        continue;
+      }
+
+      double dvx = (samples[i].linear.x - input.linear.x) / rp.max_vx;
+      double dvth = (samples[i].angular.z - input.angular.z) / rp.max_vth;
+      double cost = dvx * dvx + dvth * dvth;
+      if ((best < 0) || (cost < best_cost))
+      {
+        best = i;
+        best_cost = cost;
+      }
+    }
+
+    if (best < 0)
+    {
+      return false;
+    }
+
+    cmd = samples[best];
+    return true;
+  }
+
+  //==============================================================================
+  // PRIVATE PLANNING ENGINE METHODS (Utilities)
+  //==============================================================================
+
+  // Compute motion commands to navigate a safe trajectory
+  void PlanningEngine::computeMotionCommand(const MapSnapshot &map, const Trajectory &safe_traj, geometry_msgs::Twist &assist) const
+  {
+    // Safe trajectory tangent direction
+    double safe_heading = std::atan(1.0 / safe_traj.getRadius());
+
+    // Only the obstacles ahead of the robot slow it down, both as it starts and as it ends up heading along the arc,
+    // those behind it do not come any closer
+    double min_dist = map.min_obs_dist;
+    if (!map.range_index.empty())
+    {
+      const geometry_msgs::Point &goal = safe_traj.getGoalPoint();
+      double start_dir = (goal.x >= 0.0) ? 0.0 : M_PI;
+      double turn = proj(std::atan2(goal.y, goal.x) - start_dir);
+      double from = start_dir + std::min(turn, 0.0) - M_PI_2;
+      double to = start_dir + std::max(turn, 0.0) + M_PI_2;
+      min_dist = map.range_index.minDistance(from, to);
+    }
+
+    // Compute velocity limit
+    double vlim = std::sqrt(1.0 - sat((robot_profile_->dvel_safe - min_dist) / robot_profile_->dvel_safe, 0.0, 1.0)) * robot_profile_->max_vx;
+
+    // Generate motion commands to simulate trajectory
+    assist.linear.x = sgn(safe_traj.getGoalPoint().x) * vlim * std::cos(safe_heading);
+    assist.angular.z = sgn(safe_traj.getGoalPoint().x) * vlim * std::sin(safe_heading);
+  }
+
+  // Find assistive command for the simulated trajectory 'traj'
+  void PlanningEngine::findAssistiveCommand(const MapSnapshot &map, const Trajectory &traj, bool euclid, geometry_msgs::Twist &assist,
+                                            TraceRecord &rec, VisualFrame *frame) const
+  {
+    boost::int64_t start = monotonicNanos();
+    StageCounterScope counters(profiler_, STAGE_ASSISTIVE_COMMAND);
+
+    geometry_msgs::Point safe_goal;
+    if (findSafeGoal(map, traj, euclid, safe_goal, rec, frame))
+    {
+      computeMotionCommand(map, Trajectory(safe_goal), assist);
+    }
+    else
+    {
+      // Non-admissible gap
+      assist.linear.x = 0.0;
+      assist.angular.z = 0.0;
+    }
+
+    rec.stage_ns[STAGE_ASSISTIVE_COMMAND] = monotonicNanos() - start;
+  }
+
+  bool PlanningEngine::findSafeGoal(const MapSnapshot &map, const Trajectory &traj, bool euclid, geometry_msgs::Point &safe_goal,
+                                    TraceRecord &rec, VisualFrame *frame) const
+  {
+    bool gap_search_fin = false;
+    std::vector<Gap> gaps_check = map.gaps;
+
+    while (!gap_search_fin)
+    {
+      // Retrieve the best gap for "free walking"
+      GapPtr closest;
+      int close_idx;
+
+      // If global plan is available then use Euclidean distance
+      closest = obs_map_->findClosestGap(traj, gaps_check, euclid, close_idx);
+
+      // If no best gap identified, break loop
+      if (closest != NULL)
+      {
+        // Construct a vector of virtually admissible gaps for navigation
+        std::vector<GapPtr> virt_gaps;
+        // Clearances to virtual gaps
+        std::vector<double> clearances;
+
+        boost::int64_t t_virt = monotonicNanos();
+        {
+          StageCounterScope virt_counters(profiler_, STAGE_FIND_VIRTUAL_GAPS);
+          obs_map_->findVirtualGaps(map, *closest, virt_gaps, clearances);
+        }
+        rec.stage_ns[STAGE_FIND_VIRTUAL_GAPS] += monotonicNanos() - t_virt;
+
+        rec.gaps_evaluated++;
+        rec.virt_iterations = virt_gaps.size();
+
+        if (frame != NULL)
+        {
+          frame->closest_gap = closest;
+          frame->virt_gaps = virt_gaps;
+        }
+
+        // Found an admissible gap
+        if (virt_gaps.back() != NULL)
+        {
+          gap_search_fin = true;
+
+          // Compute clearance max and min values
+          double cl_max = *std::max_element(clearances.begin(), clearances.end());
+          double cl_min = *std::min_element(clearances.begin(), clearances.end());
+
+          rec.outcome = TRACE_ASSISTED;
+          rec.gap_right_x = closest->right.point.x;
+          rec.gap_right_y = closest->right.point.y;
+          rec.gap_left_x = closest->left.point.x;
+          rec.gap_left_y = closest->left.point.y;
+          rec.clearance_min = cl_min;
+          rec.clearance_max = cl_max;
+
+          std::vector<double> gap_weights;
+          double w_total = 0.0;
+          // Loop over virtual gaps and compute weights
+          for (unsigned int i = 0; i < virt_gaps.size(); ++i)
+          {
+            double weight = (cl_max == cl_min) ? 1.0 : sat(1.0 - ((cl_max - clearances[i]) / (cl_max - cl_min)), 0.0, 1.0);
+            w_total += (weight * weight);
+            gap_weights.push_back(weight);
+          }
+
+          geometry_msgs::Point sub_goal;
+          double x, y;
+          x = y = 0.0;
+          // Compute sub goals
+          for (unsigned int i = 0; i < virt_gaps.size(); ++i)
+          {
+            obs_map_->findSubGoal(*virt_gaps[i], sub_goal);
+            double relative_weight = ((gap_weights[i] * gap_weights[i]) / w_total);
+            x += (relative_weight * sub_goal.x);
+            y += (relative_weight * sub_goal.y);
+          }
+
+          geometry_msgs::Point avg_goal;
+          avg_goal.x = x;
+          avg_goal.y = y;
+          avg_goal.z = 0.0;
+
+          // Trajectory to the weighted average goal, else to the last constructed virtual gap goal
+          Trajectory avg(avg_goal);
+
+          if (obs_map_->isNavigable(map, avg))
+          {
+            safe_goal = avg_goal;
+          }
+          else
+          {
+            safe_goal = sub_goal;
+          }
+        }
+        else
+        {
+          // Delete the non-admissible closest gap and loop through algorithm again
+          gaps_check.erase(gaps_check.begin() + close_idx);
+        }
+      }
+      else
+      {
+        rec.outcome = TRACE_NO_GAP;
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Initialise the result of a planning cycle against the latest map snapshot
+  void PlanningEngine::initResult(TraceSource source, PlanningResult &result) const
+  {
+    result.start_ns = monotonicNanos();
+    result.map = obs_map_->getSnapshot();
+    result.cmd = geometry_msgs::Twist();
+
+    TraceRecord &rec = result.trace;
+    std::memset(&rec, 0, sizeof(TraceRecord));
+
+    rec.map_version = result.map->version;
+    rec.source = source;
+    rec.stage_ns[STAGE_UPDATE_OBSTACLES] = result.map->obstacles_ns;
+    rec.stage_ns[STAGE_UPDATE_GAPS] = result.map->gaps_ns;
+  }
+
+  TrajPtr PlanningEngine::simulateTrajectory(const geometry_msgs::Twist &twist_msg, const nav_msgs::Odometry &odom, VisualFrame *frame) const
+  {
+    double y_goal;
+    geometry_msgs::Point goal;
+    simulateGoal(twist_msg, odom, goal, y_goal);
+
+    // Trajectory of robot as a pose array for visualisation, only stepped through if anyone looks at it
+    if (frame != NULL)
+    {
+      simulatePoses(twist_msg, odom, frame->traj_poses);
+
+      // Visualise simulated goal of robot trajectory
+      frame->sim_goal.reset(new geometry_msgs::PoseStamped);
+      frame->sim_goal->pose.position = goal;
+      frame->sim_goal->pose.orientation = quaternionFromYaw(y_goal);
+    }
+
+    return TrajPtr(new Trajectory(goal));
+  }
+
+  void PlanningEngine::simulateGoals(const std::vector<geometry_msgs::Twist> &inputs, const nav_msgs::Odometry &odom,
+                                     std::vector<geometry_msgs::Point> &goals) const
+  {
+    goals.resize(inputs.size());
+
+    double y_goal;
+    for (std::size_t i = 0; i < inputs.size(); ++i)
+    {
+      simulateGoal(inputs[i], odom, goals[i], y_goal);
+    }
+  }
+
+  void PlanningEngine::simulateGoal(const geometry_msgs::Twist &twist_msg, const nav_msgs::Odometry &odom,
+                                    geometry_msgs::Point &goal, double &y_goal) const
+  {
+    // The motion does not depend on the starting pose, so roll out from the robot frame origin and the end pose is
+    // the simulated goal as is
+    double x = 0.0;
+    double y = 0.0;
+    double th = 0.0;
+
+    double vx = odom.twist.twist.linear.x;
+    double vth = odom.twist.twist.angular.z;
+
+    // User's intended commands
+    double vel_lin = twist_msg.linear.x;
+    double vel_ang = twist_msg.angular.z;
+
+    // Compute the number of steps to project along the trajectory
+    int num_steps = std::ceil(config_.sim_time / config_.sim_granularity);
+    double dt = config_.sim_time / num_steps;
+
+    // Acceleration phase: step while either velocity is still ramping towards the command. The heading is then
+    // quadratic in the step, and its sums of sines and cosines have no closed form
+    int i = 0;
+    for (; (i < num_steps) && ((vx != vel_lin) || (vth != vel_ang)); ++i)
+    {
+      vx = (vx < vel_lin) ? std::min(vel_lin, vx + robot_profile_->acc_vx_lim * dt) : std::max(vel_lin, vx - robot_profile_->acc_vx_lim * dt);
+      vth = (vth < vel_ang) ? std::min(vel_ang, vth + robot_profile_->acc_vth_lim * dt) : std::max(vel_ang, vth - robot_profile_->acc_vth_lim * dt);
+
+      x += (vx * std::cos(th) * dt);
+      y += (vx * std::sin(th) * dt);
+      th += (vth * dt);
+    }
+
+    // Constant velocity phase in closed form: the headings of the 'n' remaining steps are th + k * d, and
+    //   sum_k cos(th + k * d) = sin(n * d / 2) / sin(d / 2) * cos(th + (n - 1) * d / 2), likewise for the sines
+    int n = num_steps - i;
+    if (n > 0)
+    {
+      double d = vth * dt;
+      double half_sin = std::sin(0.5 * d);
+      double gain = (std::abs(half_sin) > 1e-12) ? (std::sin(0.5 * n * d) / half_sin) : n;
+      double th_mid = th + 0.5 * (n - 1) * d;
+
+      x += vx * dt * gain * std::cos(th_mid);
+      y += vx * dt * gain * std::sin(th_mid);
+      th += n * d;
+    }
+
+    goal.x = x;
+    goal.y = y;
+    goal.z = 0.0;
+    y_goal = th;
+
+    // If an invalid circular arc due to a purely rotational motion
+    if (almostEqual(goal.y, 0.0) && almostEqual(goal.x, 0.0))
+    {
+      // Assume goal is at rotated edge of robot's virtual radius
+      goal.x = robot_profile_->radius * std::cos(y_goal);
+      goal.y = robot_profile_->radius * std::sin(y_goal);
+    }
+
+    // If invalid due to a straight trajectory, slightly offset the 'y'
+    if (almostEqual(goal.y, 0.0))
+    {
+      goal.y += epsilon;
+    }
+  }
+
+  void PlanningEngine::simulatePoses(const geometry_msgs::Twist &twist_msg, const nav_msgs::Odometry &odom,
+                                     std::vector<geometry_msgs::Pose> &poses) const
+  {
+    // Current odometry info
+    double x = odom.pose.pose.position.x;
+    double y = odom.pose.pose.position.y;
+    double th = getYaw(odom.pose.pose.orientation);
+
+    double vx = odom.twist.twist.linear.x;
+    double vth = odom.twist.twist.angular.z;
+
+    // User's intended commands
+    double vel_lin = twist_msg.linear.x;
+    double vel_ang = twist_msg.angular.z;
+
+    // Compute the number of steps to project along the trajectory
+    int num_steps = std::ceil(config_.sim_time / config_.sim_granularity);
+    double dt = config_.sim_time / num_steps;
+
+    geometry_msgs::Pose pose;
+    pose.position.z = 0.0;
+    // Loop over forward simulation steps to generate trajectory
+    for (int i = 0; i < num_steps; ++i)
+    {
+      // Compute updated velocities given current speed
+      vx = (vx < vel_lin) ? std::min(vel_lin, vx + robot_profile_->acc_vx_lim * dt) : std::max(vel_lin, vx - robot_profile_->acc_vx_lim * dt);
+      vth = (vth < vel_ang) ? std::min(vel_ang, vth + robot_profile_->acc_vth_lim * dt) : std::max(vel_ang, vth - robot_profile_->acc_vth_lim * dt);
+
+      // Compute updated position of robot given the new velocities
+      x += (vx * std::cos(th) * dt);
+      y += (vx * std::sin(th) * dt);
+      th += (vth * dt);
+
+      pose.position.x = x;
+      pose.position.y = y;
+      pose.orientation = quaternionFromYaw(th);
+      poses.push_back(pose);
+    }
+  }
+} /* namespace reactive_assistance */
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <reactive_assistance/dist_util.hpp>
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/range_index.hpp>
+
+namespace reactive_assistance
+{
+  // Pseudo-angle of the direction of ('x', 'y') in [0, 4), increasing with the angle counterclockwise from the x-axis
+  // Binning by it saves an arc tangent per obstacle, a pseudo-angle unit spanning between one and two radians
+  static inline double pseudoAngle(double x, double y)
+  {
+    if (y >= 0.0)
+    {
+      return (x >= 0.0) ? (y / (x + y)) : (1.0 - x / (y - x));
+    }
+    else
+    {
+      return (x < 0.0) ? (2.0 - y / (-x - y)) : (3.0 + x / (x - y));
+    }
+  }
+
+  // Index the 'obstacles', the buffers of a previous build are reused
+  void RangeIndex::build(const std::vector<Obstacle> &obstacles, std::size_t bins)
+  {
+    bins_ = std::max<std::size_t>(bins, 1);
+    levels_ = 1;
+    while ((static_cast<std::size_t>(1) << levels_) <= bins_)
+    {
+      levels_++;
+    }
+
+    const float inf = std::numeric_limits<float>::infinity();
+    table_.resize(levels_ * bins_);
+    std::fill(table_.begin(), table_.begin() + bins_, inf);
+    global_min_ = std::numeric_limits<double>::infinity();
+
+    // Level 0: closest distance per bin
+    const double scale = bins_ / 4.0;
+    bool at_base = false;
+    for (std::size_t k = 0; k < obstacles.size(); ++k)
+    {
+      double x = obstacles[k].point.x;
+      double y = obstacles[k].point.y;
+      double d = std::sqrt(x * x + y * y);
+      if (!(d == d))
+      {
+        continue;
+      }
+      global_min_ = std::min(global_min_, d);
+      if (d <= 0.0)
+      {
+        at_base = true;
+        continue;
+      }
+
+      std::size_t b = std::min(static_cast<std::size_t>(pseudoAngle(x, y) * scale), bins_ - 1);
+      // Rounded down, the index must never see an obstacle further than it is
+      float f = static_cast<float>(d);
+      if (f > d)
+      {
+        f = std::nextafter(f, 0.0f);
+      }
+      table_[b] = std::min(table_[b], f);
+    }
+
+    // An obstacle on the base itself lies in every direction
+    if (at_base)
+    {
+      std::fill(table_.begin(), table_.begin() + bins_, 0.0f);
+    }
+
+    // Level k: min of the two halves of every run of 2^k bins
+    for (std::size_t k = 1; k < levels_; ++k)
+    {
+      const float *prev = &table_[(k - 1) * bins_];
+      float *curr = &table_[k * bins_];
+      std::size_t half = static_cast<std::size_t>(1) << (k - 1);
+      std::size_t runs = bins_ + 1 - (half << 1);
+      for (std::size_t i = 0; i < runs; ++i)
+      {
+        curr[i] = std::min(prev[i], prev[i + half]);
+      }
+    }
+  }
+
+  // Closest obstacle distance to the robot base over the directions from 'from' counterclockwise to 'to'
+  double RangeIndex::minDistance(double from, double to) const
+  {
+    if (bins_ == 0)
+    {
+      return 0.0;
+    }
+
+    // Windows about as wide as the whole turn once padded see every bin
+    double width = ((to - from) >= M_2PI) ? M_2PI : mod2pi(to - from);
+    if (width + 2.0 * getSlack() >= M_2PI)
+    {
+      return global_min_;
+    }
+
+    // One more bin on either side against the rounding of the bin edges
+    std::size_t first = binOf(from);
+    std::size_t last = binOf(to);
+    std::size_t count = ((last + bins_ - first) % bins_) + 3;
+    std::size_t start = (first + bins_ - 1) % bins_;
+
+    float dist;
+    if (start + count <= bins_)
+    {
+      dist = runMin(start, start + count - 1);
+    }
+    else
+    {
+      dist = std::min(runMin(start, bins_ - 1), runMin(0, start + count - 1 - bins_));
+    }
+
+    return dist;
+  }
+
+  // Largest angle an obstacle looked up by 'minDistance' may lie outside its window: two bins of at most two radians
+  // per pseudo-angle unit
+  double RangeIndex::getSlack() const
+  {
+    return (bins_ > 0) ? (2.0 * 2.0 * 4.0 / bins_) : M_2PI;
+  }
+
+  //==============================================================================
+  // PRIVATE RANGE INDEX METHODS (Utilities)
+  //==============================================================================
+
+  // Bin of the direction 'th'
+  std::size_t RangeIndex::binOf(double th) const
+  {
+    return std::min(static_cast<std::size_t>(pseudoAngle(std::cos(th), std::sin(th)) * (bins_ / 4.0)), bins_ - 1);
+  }
+
+  // Closest distance over the bins 'first' to 'last' included, as the min of the two runs of 2^k bins covering them
+  float RangeIndex::runMin(std::size_t first, std::size_t last) const
+  {
+    std::size_t len = last - first + 1;
+    std::size_t k = 0;
+    while ((static_cast<std::size_t>(2) << k) <= len)
+    {
+      k++;
+    }
+
+    return std::min(table_[k * bins_ + first], table_[k * bins_ + last + 1 - (static_cast<std::size_t>(1) << k)]);
+  }
+} /* namespace reactive_assistance */
@@ -1,3 +1,5 @@
+#include <stdexcept>
+
 #include <ros/ros.h>
 #include <tf2_ros/transform_listener.h>
 
@@ -11,8 +13,16 @@ int main(int argc, char **argv)
   tf2_ros::TransformListener tf(buffer);
 
   ROS_INFO_STREAM("Initialiasing the reactive_assistance node");
-  reactive_assistance::ObstacleAvoidance obs_avoid(buffer);
-  ros::spin();
+  try
+  {
+    reactive_assistance::ObstacleAvoidance obs_avoid(buffer);
+    ros::spin();
+  }
+  catch (const std::invalid_argument &ex)
+  {
+    ROS_FATAL("Shutting down the reactive_assistance node: %s", ex.what());
+    return 1;
+  }
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include <stdexcept>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <tf2_ros/transform_listener.h>
+
+#include <reactive_assistance/obstacle_avoidance.hpp>
+
+namespace reactive_assistance
+{
+  // The obstacle avoidance as a nodelet, so that a scan driver and a base controller loaded into the same manager
+  // hand over the scans and commands as shared pointers rather than serialising them
+  // The scan callback already keeps the received message, the pipeline stages share it without a copy
+  class ReactiveAssistanceNodelet : public nodelet::Nodelet
+  {
+    public:
+      ReactiveAssistanceNodelet() {}
+      // Stop the obstacle avoidance before the transform listener it depends on
+      ~ReactiveAssistanceNodelet()
+      {
+        obs_avoid_.reset();
+        tf_listener_.reset();
+        tf_buffer_.reset();
+      }
+
+    private:
+      virtual void onInit()
+      {
+        tf_buffer_.reset(new tf2_ros::Buffer(ros::Duration(10)));
+        tf_listener_.reset(new tf2_ros::TransformListener(*tf_buffer_));
+
+        NODELET_INFO_STREAM("Initialising the reactive_assistance nodelet");
+        // A bad configuration only disables this nodelet, the others of the manager keep running
+        try
+        {
+          obs_avoid_.reset(new ObstacleAvoidance(*tf_buffer_, getNodeHandle(), getPrivateNodeHandle(), false));
+        }
+        catch (const std::invalid_argument &ex)
+        {
+          NODELET_ERROR("The reactive_assistance nodelet is not running: %s", ex.what());
+        }
+      }
+
+      boost::scoped_ptr<tf2_ros::Buffer> tf_buffer_;
+      boost::scoped_ptr<tf2_ros::TransformListener> tf_listener_;
+      boost::scoped_ptr<ObstacleAvoidance> obs_avoid_;
+  };
+} /* namespace reactive_assistance */
+
+PLUGINLIB_EXPORT_CLASS(reactive_assistance::ReactiveAssistanceNodelet, nodelet::Nodelet)
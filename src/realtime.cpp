@@ -0,0 +1,91 @@
+#include <alloca.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+
+#include <reactive_assistance/stage_timing.hpp>
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/realtime.hpp>
+
+namespace reactive_assistance
+{
+  bool lockProcessMemory(std::size_t heap_bytes)
+  {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+      return false;
+    }
+
+    // Keep freed memory in the heap, and serve large blocks from it rather than from fresh mappings
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    // Grow the heap once and touch every page of it, the memory stays with the process once freed
+    if (heap_bytes > 0)
+    {
+      long page = sysconf(_SC_PAGESIZE);
+      char *heap = static_cast<char *>(std::malloc(heap_bytes));
+      if (heap != NULL)
+      {
+        for (std::size_t i = 0; i < heap_bytes; i += page)
+        {
+          heap[i] = 0;
+        }
+        std::free(heap);
+      }
+    }
+
+    return true;
+  }
+
+  void prefaultStack(std::size_t bytes)
+  {
+    // Volatile so that the writes are not optimised away
+    volatile char *stack = static_cast<volatile char *>(alloca(bytes));
+    long page = sysconf(_SC_PAGESIZE);
+    for (std::size_t i = 0; i < bytes; i += page)
+    {
+      stack[i] = 0;
+    }
+  }
+
+  JitterMonitor::JitterMonitor(double rate)
+                              : period_ns_(static_cast<boost::int64_t>(1e9 / rate))
+                              , next_ns_(monotonicNanos() + period_ns_)
+                              , missed_(0)
+  {}
+
+  void JitterMonitor::waitNextPeriod()
+  {
+    boost::int64_t now = monotonicNanos();
+    if (now > next_ns_)
+    {
+      // Still running when the period started, move on to the next period that has not begun. Every period start
+      // overrun is a deadline missed, so a cycle that ran over several periods misses as many
+      boost::int64_t skipped = (now - next_ns_) / period_ns_ + 1;
+      missed_.fetch_add(static_cast<boost::uint64_t>(skipped), boost::memory_order_relaxed);
+      next_ns_ += skipped * period_ns_;
+    }
+
+    struct timespec deadline;
+    deadline.tv_sec = next_ns_ / 1000000000LL;
+    deadline.tv_nsec = next_ns_ % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+    {
+      // Interrupted by a signal, the deadline is absolute so simply sleep again
+    }
+
+    wakeup_.record(monotonicNanos() - next_ns_);
+    next_ns_ += period_ns_;
+  }
+
+  void JitterMonitor::collect(LatencySummary &jitter, boost::uint64_t &missed)
+  {
+    wakeup_.collect(jitter);
+    missed = missed_.exchange(0, boost::memory_order_relaxed);
+  }
+} /* namespace reactive_assistance */
@@ -0,0 +1,140 @@
+#include <reactive_assistance/dist_util.hpp>
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/scan_pipeline.hpp>
+
+namespace reactive_assistance
+{
+  ScanPipeline::ScanPipeline(PlanningEngine &engine, std::size_t queue_size, const SpinnerSchedule schedules[NUM_PIPELINE_STAGES])
+                            : engine_(engine)
+                            , running_(true)
+  {
+    for (int i = 0; i < NUM_PIPELINE_STAGES; ++i)
+    {
+      schedules_[i] = schedules[i];
+      queues_[i] = new SpscQueue<JobPtr>(queue_size);
+      processed_[i].store(0, boost::memory_order_relaxed);
+      overflow_[i].store(0, boost::memory_order_relaxed);
+      stale_[i].store(0, boost::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < NUM_PIPELINE_STAGES; ++i)
+    {
+      threads_[i] = new boost::thread(boost::bind(&ScanPipeline::stageLoop, this, static_cast<PipelineStage>(i)));
+    }
+  }
+
+  ScanPipeline::~ScanPipeline()
+  {
+    running_.store(false, boost::memory_order_release);
+
+    for (int i = 0; i < NUM_PIPELINE_STAGES; ++i)
+    {
+      if (threads_[i] != NULL)
+      {
+        threads_[i]->join();
+        delete threads_[i];
+      }
+    }
+
+    for (int i = 0; i < NUM_PIPELINE_STAGES; ++i)
+    {
+      if (queues_[i] != NULL)
+      {
+        delete queues_[i];
+      }
+    }
+  }
+
+  bool ScanPipeline::push(const sensor_msgs::LaserScan::ConstPtr &scan, const geometry_msgs::Transform &laser_to_base)
+  {
+    JobPtr job(new Job);
+    job->scan = scan;
+    job->laser_to_base = laser_to_base;
+
+    if (!queues_[0]->push(job))
+    {
+      overflow_[0].fetch_add(1, boost::memory_order_relaxed);
+      return false;
+    }
+
+    return true;
+  }
+
+  void ScanPipeline::getStats(PipelineStageStats stats[NUM_PIPELINE_STAGES]) const
+  {
+    for (int i = 0; i < NUM_PIPELINE_STAGES; ++i)
+    {
+      stats[i].processed = processed_[i].load(boost::memory_order_relaxed);
+      stats[i].overflow = overflow_[i].load(boost::memory_order_relaxed);
+      stats[i].stale = stale_[i].load(boost::memory_order_relaxed);
+    }
+  }
+
+  void ScanPipeline::stageLoop(PipelineStage stage)
+  {
+    applyThreadSchedule(std::string(PIPELINE_STAGE_NAMES[stage]) + " stage", schedules_[stage]);
+
+    // Wake up now and then to notice the shutdown
+    const boost::posix_time::time_duration poll = boost::posix_time::milliseconds(100);
+
+    while (running_.load(boost::memory_order_acquire))
+    {
+      JobPtr job;
+      std::size_t skipped = 0;
+      if (!queues_[stage]->waitPopLatest(job, skipped, poll))
+      {
+        continue;
+      }
+      stale_[stage].fetch_add(skipped, boost::memory_order_relaxed);
+
+      process(stage, *job);
+      processed_[stage].fetch_add(1, boost::memory_order_relaxed);
+
+      // Hand the scan over to the next stage
+      int next = stage + 1;
+      if ((next < NUM_PIPELINE_STAGES) && !queues_[next]->push(job))
+      {
+        overflow_[next].fetch_add(1, boost::memory_order_relaxed);
+      }
+    }
+  }
+
+  void ScanPipeline::process(PipelineStage stage, Job &job)
+  {
+    const ObstacleMap &obs_map = engine_.getObstacleMap();
+    StageProfiler *profiler = &engine_.getProfiler();
+
+    boost::int64_t start = monotonicNanos();
+    switch (stage)
+    {
+      case PIPELINE_OBSTACLES:
+      {
+        job.map.reset(new MapSnapshot);
+        job.map->stamp = job.scan->header.stamp;
+        job.map->range_max = job.scan->range_max;
+        {
+          StageCounterScope counters(profiler, STAGE_UPDATE_OBSTACLES);
+          obs_map.updateObstacles(*job.scan, job.laser_to_base, *job.map);
+        }
+        job.map->obstacles_ns = monotonicNanos() - start;
+        break;
+      }
+
+      case PIPELINE_GAPS:
+      {
+        {
+          StageCounterScope counters(profiler, STAGE_UPDATE_GAPS);
+          obs_map.updateGaps(*job.map);
+        }
+        job.map->gaps_ns = monotonicNanos() - start;
+
+        // Last stage, the planning threads pick the snapshot up from here
+        engine_.publishSnapshot(job.map);
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+} /* namespace reactive_assistance */
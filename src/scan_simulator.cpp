@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <limits>
+#include <random>
+
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/scan_simulator.hpp>
+
+namespace reactive_assistance
+{
+  namespace
+  {
+    // Upper bound of the grid cells, coarser cells are used for very large worlds
+    const double MAX_GRID_CELLS = 1 << 20;
+
+    // Finaliser of the splitmix64 generator, spreads consecutive ids over unrelated seeds
+    boost::uint64_t mixSeed(boost::uint64_t x)
+    {
+      x += 0x9E3779B97F4A7C15ULL;
+      x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+      return x ^ (x >> 31);
+    }
+
+    // Whether the segment crosses the axis-aligned box, the bounding boxes are known to overlap
+    bool segmentInBox(const WorldSegment &seg, double x_min, double y_min, double x_max, double y_max)
+    {
+      // Separating axis: the box lies strictly on one side of the segment line
+      double ex = seg.x2 - seg.x1;
+      double ey = seg.y2 - seg.y1;
+      double s1 = ex * (y_min - seg.y1) - ey * (x_min - seg.x1);
+      double s2 = ex * (y_min - seg.y1) - ey * (x_max - seg.x1);
+      double s3 = ex * (y_max - seg.y1) - ey * (x_min - seg.x1);
+      double s4 = ex * (y_max - seg.y1) - ey * (x_max - seg.x1);
+
+      return !((s1 > 0 && s2 > 0 && s3 > 0 && s4 > 0) || (s1 < 0 && s2 < 0 && s3 < 0 && s4 < 0));
+    }
+  }
+
+  ScanSimulator::ScanSimulator(const ScanWorld &world, const ScanConfig &config)
+                              : world_(world)
+                              , config_(config)
+                              , grid_x0_(0.0)
+                              , grid_y0_(0.0)
+                              , grid_nx_(0)
+                              , grid_ny_(0)
+                              , inv_cell_(1.0)
+  {
+    buildGrid();
+  }
+
+  void ScanSimulator::buildGrid()
+  {
+    double x_min, y_min, x_max, y_max;
+    
+    if (!world_.getBounds(x_min, y_min, x_max, y_max))
+    {
+      return;
+    }
+
+    // Pad the bounds so that shapes on the border fall strictly inside the grid
+    double cell = std::max(config_.cell_size, 1e-3);
+    x_min -= cell * 0.5;
+    y_min -= cell * 0.5;
+    x_max += cell * 0.5;
+    y_max += cell * 0.5;
+
+    double area_cells = ((x_max - x_min) / cell) * ((y_max - y_min) / cell);
+    if (area_cells > MAX_GRID_CELLS)
+    {
+      cell *= std::sqrt(area_cells / MAX_GRID_CELLS);
+    }
+
+    grid_x0_ = x_min;
+    grid_y0_ = y_min;
+    grid_nx_ = std::max(1, static_cast<int>(std::ceil((x_max - x_min) / cell)));
+    grid_ny_ = std::max(1, static_cast<int>(std::ceil((y_max - y_min) / cell)));
+    inv_cell_ = 1.0 / cell;
+
+    const int num_cells = grid_nx_ * grid_ny_;
+    const boost::uint32_t num_segments = world_.segments.size();
+
+    // Two passes over the shapes: count the items per cell, then fill the CSR arrays
+    std::vector<boost::uint32_t> cell_count(num_cells + 1, 0);
+    std::vector<boost::uint32_t> fill;
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+      for (boost::uint32_t i = 0; i < num_segments + world_.circles.size(); ++i)
+      {
+        double bx_min, by_min, bx_max, by_max;
+
+        if (i < num_segments)
+        {
+          const WorldSegment &seg = world_.segments[i];
+          bx_min = std::min(seg.x1, seg.x2);
+          by_min = std::min(seg.y1, seg.y2);
+          bx_max = std::max(seg.x1, seg.x2);
+          by_max = std::max(seg.y1, seg.y2);
+        }
+        else
+        {
+          const WorldCircle &circle = world_.circles[i - num_segments];
+          bx_min = circle.x - circle.r;
+          by_min = circle.y - circle.r;
+          bx_max = circle.x + circle.r;
+          by_max = circle.y + circle.r;
+        }
+
+        int ix_min = std::max(0, static_cast<int>((bx_min - grid_x0_) * inv_cell_));
+        int iy_min = std::max(0, static_cast<int>((by_min - grid_y0_) * inv_cell_));
+        int ix_max = std::min(grid_nx_ - 1, static_cast<int>((bx_max - grid_x0_) * inv_cell_));
+        int iy_max = std::min(grid_ny_ - 1, static_cast<int>((by_max - grid_y0_) * inv_cell_));
+
+        for (int iy = iy_min; iy <= iy_max; ++iy)
+        {
+          for (int ix = ix_min; ix <= ix_max; ++ix)
+          {
+            if (i < num_segments)
+            {
+              double cx = grid_x0_ + ix * cell;
+              double cy = grid_y0_ + iy * cell;
+
+              if (!segmentInBox(world_.segments[i], cx, cy, cx + cell, cy + cell))
+              {
+                continue;
+              }
+            }
+
+            int c = iy * grid_nx_ + ix;
+            if (pass == 0)
+            {
+              cell_count[c + 1]++;
+            }
+            else
+            {
+              cell_items_[fill[c]++] = i;
+            }
+          }
+        }
+      }
+
+      if (pass == 0)
+      {
+        for (int c = 0; c < num_cells; ++c)
+        {
+          cell_count[c + 1] += cell_count[c];
+        }
+
+        cell_start_.swap(cell_count);
+        cell_items_.resize(cell_start_[num_cells]);
+        fill.assign(cell_start_.begin(), cell_start_.end() - 1);
+      }
+    }
+  }
+
+  double ScanSimulator::castCell(int cell, double ox, double oy, double dx, double dy) const
+  {
+    double best = std::numeric_limits<double>::infinity();
+    const boost::uint32_t num_segments = world_.segments.size();
+
+    for (boost::uint32_t k = cell_start_[cell]; k < cell_start_[cell + 1]; ++k)
+    {
+      boost::uint32_t i = cell_items_[k];
+
+      if (i < num_segments)
+      {
+        // Ray o + t * d against segment p1 + u * (p2 - p1)
+        const WorldSegment &seg = world_.segments[i];
+        double ex = seg.x2 - seg.x1;
+        double ey = seg.y2 - seg.y1;
+        double denom = dx * ey - dy * ex;
+
+        if (std::fabs(denom) < 1e-12)
+        {
+          continue;
+        }
+
+        double wx = seg.x1 - ox;
+        double wy = seg.y1 - oy;
+        double t = (wx * ey - wy * ex) / denom;
+        double u = (wx * dy - wy * dx) / denom;
+
+        if (t >= 0.0 && u >= 0.0 && u <= 1.0 && t < best)
+        {
+          best = t;
+        }
+      }
+      else
+      {
+        const WorldCircle &circle = world_.circles[i - num_segments];
+        double fx = ox - circle.x;
+        double fy = oy - circle.y;
+        double b = fx * dx + fy * dy;
+        double c = fx * fx + fy * fy - circle.r * circle.r;
+
+        // A ray starting inside the obstacle is blocked straight away
+        if (c <= 0.0)
+        {
+          return 0.0;
+        }
+
+        double disc = b * b - c;
+        if (disc < 0.0)
+        {
+          continue;
+        }
+
+        double t = -b - std::sqrt(disc);
+        if (t >= 0.0 && t < best)
+        {
+          best = t;
+        }
+      }
+    }
+
+    return best;
+  }
+
+  double ScanSimulator::castRay(double x, double y, double angle, double max_range) const
+  {
+    const double inf = std::numeric_limits<double>::infinity();
+
+    if (cell_start_.empty())
+    {
+      return inf;
+    }
+
+    double dx = std::cos(angle);
+    double dy = std::sin(angle);
+    double cell = 1.0 / inv_cell_;
+    double gx_max = grid_x0_ + grid_nx_ * cell;
+    double gy_max = grid_y0_ + grid_ny_ * cell;
+
+    // Clip the ray against the grid box (slab test)
+    double t_enter = 0.0;
+    double t_exit = max_range;
+    const double o[2] = {x, y};
+    const double d[2] = {dx, dy};
+    const double lo[2] = {grid_x0_, grid_y0_};
+    const double hi[2] = {gx_max, gy_max};
+
+    for (int axis = 0; axis < 2; ++axis)
+    {
+      if (std::fabs(d[axis]) < 1e-12)
+      {
+        if (o[axis] < lo[axis] || o[axis] > hi[axis])
+        {
+          return inf;
+        }
+        continue;
+      }
+
+      double t1 = (lo[axis] - o[axis]) / d[axis];
+      double t2 = (hi[axis] - o[axis]) / d[axis];
+      t_enter = std::max(t_enter, std::min(t1, t2));
+      t_exit = std::min(t_exit, std::max(t1, t2));
+    }
+
+    if (t_enter > t_exit)
+    {
+      return inf;
+    }
+
+    // Walk the cells along the ray (Amanatides & Woo), stopping at the first cell whose closest hit lies within it
+    double px = x + dx * t_enter;
+    double py = y + dy * t_enter;
+    int ix = std::min(grid_nx_ - 1, std::max(0, static_cast<int>((px - grid_x0_) * inv_cell_)));
+    int iy = std::min(grid_ny_ - 1, std::max(0, static_cast<int>((py - grid_y0_) * inv_cell_)));
+
+    int step_x = (dx > 0.0) ? 1 : -1;
+    int step_y = (dy > 0.0) ? 1 : -1;
+    double t_delta_x = (std::fabs(dx) < 1e-12) ? inf : cell / std::fabs(dx);
+    double t_delta_y = (std::fabs(dy) < 1e-12) ? inf : cell / std::fabs(dy);
+    double t_max_x = (std::fabs(dx) < 1e-12) ? inf : (grid_x0_ + (ix + (step_x > 0)) * cell - x) / dx;
+    double t_max_y = (std::fabs(dy) < 1e-12) ? inf : (grid_y0_ + (iy + (step_y > 0)) * cell - y) / dy;
+
+    double best = inf;
+
+    while (true)
+    {
+      best = std::min(best, castCell(iy * grid_nx_ + ix, x, y, dx, dy));
+
+      double t_cell_exit = std::min(t_max_x, t_max_y);
+      if (best <= t_cell_exit || t_cell_exit > t_exit)
+      {
+        break;
+      }
+
+      if (t_max_x < t_max_y)
+      {
+        ix += step_x;
+        t_max_x += t_delta_x;
+      }
+      else
+      {
+        iy += step_y;
+        t_max_y += t_delta_y;
+      }
+
+      if (ix < 0 || ix >= grid_nx_ || iy < 0 || iy >= grid_ny_)
+      {
+        break;
+      }
+    }
+
+    return (best <= max_range) ? best : inf;
+  }
+
+  void ScanSimulator::simulate(const geometry_msgs::Pose2D &pose, boost::uint64_t scan_id, sensor_msgs::LaserScan &scan) const
+  {
+    const int beams = std::max(1, config_.beams);
+    const bool full_circle = (config_.fov >= 2.0 * M_PI - 1e-9);
+
+    scan.header.seq = static_cast<boost::uint32_t>(scan_id);
+    scan.header.frame_id = config_.frame_id;
+    scan.angle_increment = full_circle ? (2.0 * M_PI / beams) : ((beams > 1) ? config_.fov / (beams - 1) : 0.0);
+    scan.angle_min = full_circle ? -M_PI : -config_.fov / 2.0;
+    scan.angle_max = scan.angle_min + (beams - 1) * scan.angle_increment;
+    scan.time_increment = 0.0;
+    scan.scan_time = 0.0;
+    scan.range_min = config_.range_min;
+    scan.range_max = config_.range_max;
+    scan.ranges.resize(beams);
+    scan.intensities.clear();
+
+    // Every scan owns a random stream, so scans can be generated in any order or in parallel
+    std::mt19937_64 rng(mixSeed(config_.seed ^ mixSeed(scan_id)));
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    const bool noisy = (config_.noise_std > 0.0 || config_.noise_range_std > 0.0);
+    const float no_return = config_.no_return_inf ? std::numeric_limits<float>::infinity() : config_.range_max;
+
+    for (int i = 0; i < beams; ++i)
+    {
+      double range = castRay(pose.x, pose.y, pose.theta + scan.angle_min + i * scan.angle_increment, config_.range_max);
+
+      // Draw both variates for every beam so that the stream stays aligned whatever the geometry
+      bool dropped = (config_.dropout_prob > 0.0 && uniform(rng) < config_.dropout_prob);
+      double noise = noisy ? normal(rng) : 0.0;
+
+      if (dropped || std::isinf(range))
+      {
+        scan.ranges[i] = no_return;
+        continue;
+      }
+
+      range += noise * (config_.noise_std + config_.noise_range_std * range);
+      scan.ranges[i] = (range >= config_.range_max) ? no_return : std::max(range, static_cast<double>(config_.range_min));
+    }
+  }
+} /* namespace reactive_assistance */
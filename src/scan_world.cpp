@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/scan_world.hpp>
+
+namespace reactive_assistance
+{
+  void ScanWorld::addPolygon(const double *xs, const double *ys, int n)
+  {
+    addPolyline(xs, ys, n);
+
+    if (n > 2)
+    {
+      addSegment(xs[n - 1], ys[n - 1], xs[0], ys[0]);
+    }
+  }
+
+  void ScanWorld::addPolyline(const double *xs, const double *ys, int n)
+  {
+    for (int i = 0; i + 1 < n; ++i)
+    {
+      addSegment(xs[i], ys[i], xs[i + 1], ys[i + 1]);
+    }
+  }
+
+  void ScanWorld::addSegment(double x1, double y1, double x2, double y2)
+  {
+    WorldSegment seg = {x1, y1, x2, y2};
+    segments.push_back(seg);
+  }
+
+  void ScanWorld::addCircle(double x, double y, double r)
+  {
+    WorldCircle circle = {x, y, r};
+    circles.push_back(circle);
+  }
+
+  bool ScanWorld::parse(const std::string &text, std::string &error)
+  {
+    std::istringstream in(text);
+    std::string line;
+    int line_num = 0;
+
+    while (std::getline(in, line))
+    {
+      ++line_num;
+
+      // Strip comments
+      std::string::size_type hash = line.find('#');
+      if (hash != std::string::npos)
+      {
+        line.erase(hash);
+      }
+
+      std::istringstream fields(line);
+      std::string shape;
+      if (!(fields >> shape))
+      {
+        continue;
+      }
+
+      std::vector<double> values;
+      double v;
+      while (fields >> v)
+      {
+        values.push_back(v);
+      }
+
+      std::ostringstream msg;
+      msg << "line " << line_num << ": ";
+      if (!fields.eof())
+      {
+        error = msg.str() + "expected numbers after '" + shape + "'";
+        return false;
+      }
+
+      if (shape == "circle")
+      {
+        if ((values.size() != 3) || (values[2] <= 0.0))
+        {
+          error = msg.str() + "circle takes x, y and a positive radius";
+          return false;
+        }
+
+        addCircle(values[0], values[1], values[2]);
+      }
+      else if ((shape == "polygon") || (shape == "polyline"))
+      {
+        if ((values.size() < 4) || (values.size() % 2 != 0))
+        {
+          error = msg.str() + shape + " takes at least two x y points";
+          return false;
+        }
+
+        // Split the interleaved coordinates
+        int n = values.size() / 2;
+        std::vector<double> xs(n), ys(n);
+        for (int i = 0; i < n; ++i)
+        {
+          xs[i] = values[2 * i];
+          ys[i] = values[2 * i + 1];
+        }
+
+        if (shape == "polygon")
+        {
+          addPolygon(xs.data(), ys.data(), n);
+        }
+        else
+        {
+          addPolyline(xs.data(), ys.data(), n);
+        }
+      }
+      else
+      {
+        error = msg.str() + "unknown shape '" + shape + "'";
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool ScanWorld::load(const std::string &path, std::string &error)
+  {
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+      error = "cannot open " + path;
+      return false;
+    }
+
+    std::ostringstream text;
+    text << file.rdbuf();
+
+    if (!parse(text.str(), error))
+    {
+      error = path + ", " + error;
+      return false;
+    }
+
+    return true;
+  }
+
+  // Distance from (x, y) to the segment (x1, y1)->(x2, y2)
+  static double pointToSegment(double x, double y, double x1, double y1, double x2, double y2)
+  {
+    // Project onto the segment, clamped to its end points
+    double ex = x2 - x1;
+    double ey = y2 - y1;
+    double len2 = ex * ex + ey * ey;
+    double u = (len2 > 0.0) ? std::min(1.0, std::max(0.0, ((x - x1) * ex + (y - y1) * ey) / len2)) : 0.0;
+
+    return std::hypot(x - (x1 + u * ex), y - (y1 + u * ey));
+  }
+
+  // Check if the segments (ax, ay)->(bx, by) and (cx, cy)->(dx, dy) cross or touch
+  static bool segmentsMeet(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy)
+  {
+    double d1 = (dx - cx) * (ay - cy) - (dy - cy) * (ax - cx);
+    double d2 = (dx - cx) * (by - cy) - (dy - cy) * (bx - cx);
+    double d3 = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+    double d4 = (bx - ax) * (dy - ay) - (by - ay) * (dx - ax);
+
+    return (d1 * d2 <= 0.0) && (d3 * d4 <= 0.0) && !((d1 == 0.0) && (d2 == 0.0) && (d3 == 0.0) && (d4 == 0.0) &&
+           ((std::max(ax, bx) < std::min(cx, dx)) || (std::max(cx, dx) < std::min(ax, bx)) ||
+            (std::max(ay, by) < std::min(cy, dy)) || (std::max(cy, dy) < std::min(ay, by))));
+  }
+
+  // Check if (x, y) lies inside the closed outline through the 'n' points (xs[i], ys[i])
+  static bool insideOutline(double x, double y, const double *xs, const double *ys, int n)
+  {
+    bool inside = false;
+    for (int i = 0, j = n - 1; i < n; j = i++)
+    {
+      if (((ys[i] > y) != (ys[j] > y)) && (x < xs[j] + (y - ys[j]) * (xs[i] - xs[j]) / (ys[i] - ys[j])))
+      {
+        inside = !inside;
+      }
+    }
+
+    return inside;
+  }
+
+  double ScanWorld::distanceTo(double x, double y) const
+  {
+    double best = std::numeric_limits<double>::infinity();
+
+    for (std::vector<WorldSegment>::const_iterator it = segments.begin(); it != segments.end(); ++it)
+    {
+      best = std::min(best, pointToSegment(x, y, it->x1, it->y1, it->x2, it->y2));
+    }
+
+    for (std::vector<WorldCircle>::const_iterator it = circles.begin(); it != circles.end(); ++it)
+    {
+      best = std::min(best, std::max(0.0, std::hypot(x - it->x, y - it->y) - it->r));
+    }
+
+    return best;
+  }
+
+  double ScanWorld::distanceTo(const double *xs, const double *ys, int n) const
+  {
+    double best = std::numeric_limits<double>::infinity();
+
+    for (std::vector<WorldSegment>::const_iterator it = segments.begin(); it != segments.end(); ++it)
+    {
+      // A wall overlaps the outline if it crosses an edge or lies inside it
+      if (insideOutline(it->x1, it->y1, xs, ys, n))
+      {
+        return 0.0;
+      }
+
+      for (int i = 0, j = n - 1; i < n; j = i++)
+      {
+        if (segmentsMeet(xs[j], ys[j], xs[i], ys[i], it->x1, it->y1, it->x2, it->y2))
+        {
+          return 0.0;
+        }
+
+        // Apart, the closest points of two segments include an end point of either
+        best = std::min(best, pointToSegment(it->x1, it->y1, xs[j], ys[j], xs[i], ys[i]));
+        best = std::min(best, pointToSegment(it->x2, it->y2, xs[j], ys[j], xs[i], ys[i]));
+        best = std::min(best, pointToSegment(xs[i], ys[i], it->x1, it->y1, it->x2, it->y2));
+      }
+    }
+
+    for (std::vector<WorldCircle>::const_iterator it = circles.begin(); it != circles.end(); ++it)
+    {
+      if (insideOutline(it->x, it->y, xs, ys, n))
+      {
+        return 0.0;
+      }
+
+      for (int i = 0, j = n - 1; i < n; j = i++)
+      {
+        best = std::min(best, std::max(0.0, pointToSegment(it->x, it->y, xs[j], ys[j], xs[i], ys[i]) - it->r));
+      }
+    }
+
+    return best;
+  }
+
+  bool ScanWorld::getBounds(double &x_min, double &y_min, double &x_max, double &y_max) const
+  {
+    x_min = y_min = std::numeric_limits<double>::max();
+    x_max = y_max = -std::numeric_limits<double>::max();
+
+    for (std::vector<WorldSegment>::const_iterator it = segments.begin(); it != segments.end(); ++it)
+    {
+      x_min = std::min(x_min, std::min(it->x1, it->x2));
+      y_min = std::min(y_min, std::min(it->y1, it->y2));
+      x_max = std::max(x_max, std::max(it->x1, it->x2));
+      y_max = std::max(y_max, std::max(it->y1, it->y2));
+    }
+
+    for (std::vector<WorldCircle>::const_iterator it = circles.begin(); it != circles.end(); ++it)
+    {
+      x_min = std::min(x_min, it->x - it->r);
+      y_min = std::min(y_min, it->y - it->r);
+      x_max = std::max(x_max, it->x + it->r);
+      y_max = std::max(y_max, it->y + it->r);
+    }
+
+    return !(segments.empty() && circles.empty());
+  }
+} /* namespace reactive_assistance */
@@ -0,0 +1,396 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <reactive_assistance/dist_util.hpp>
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/snapshot_export.hpp>
+
+namespace reactive_assistance
+{
+  // Round 'size' up to a multiple of 'align', a power of two
+  static std::size_t alignUp(std::size_t size, std::size_t align)
+  {
+    return (size + align - 1) & ~(align - 1);
+  }
+
+  // Byte offsets of the arrays within a slot, and the slot size, rounded to cache lines so that slots share none
+  struct SlotLayout
+  {
+    std::size_t obstacles;
+    std::size_t gaps;
+    std::size_t virt_gaps;
+    std::size_t traj_poses;
+    std::size_t bytes;
+  };
+
+  static SlotLayout slotLayout(std::size_t max_obstacles, std::size_t max_gaps, std::size_t max_virt_gaps,
+                               std::size_t max_traj_poses)
+  {
+    SlotLayout layout;
+    layout.obstacles = alignUp(sizeof(ShmSlotHeader), 8);
+    layout.gaps = alignUp(layout.obstacles + max_obstacles * sizeof(ShmObstacle), 8);
+    layout.virt_gaps = alignUp(layout.gaps + max_gaps * sizeof(ShmGap), 8);
+    layout.traj_poses = alignUp(layout.virt_gaps + max_virt_gaps * sizeof(ShmGap), 8);
+    layout.bytes = alignUp(layout.traj_poses + max_traj_poses * sizeof(ShmPose), 64);
+    return layout;
+  }
+
+  static void toShmGap(const Gap &gap, ShmGap &out)
+  {
+    out.right_x = gap.right.point.x;
+    out.right_y = gap.right.point.y;
+    out.left_x = gap.left.point.x;
+    out.left_y = gap.left.point.y;
+    out.flags = SHM_GAP_VALID | (gap.front ? SHM_GAP_FRONT : 0) | (gap.close_right ? SHM_GAP_CLOSE_RIGHT : 0);
+  }
+
+  //==============================================================================
+  // SNAPSHOT EXPORTER
+  //==============================================================================
+
+  SnapshotExporter::SnapshotExporter(const SnapshotExportConfig &config)
+                                    : config_(config)
+                                    , base_(NULL)
+                                    , size_(0)
+                                    , header_(NULL)
+                                    , cycle_(0)
+                                    , pending_(NULL)
+                                    , spare_(NULL)
+                                    , thread_(NULL)
+                                    , running_(true)
+                                    , written_(0)
+  {
+    config_.slot_count = std::max<std::size_t>(config_.slot_count, 2);
+    SlotLayout layout = slotLayout(config_.max_obstacles, config_.max_gaps, config_.max_virt_gaps, config_.max_traj_poses);
+    std::size_t slots_offset = alignUp(sizeof(ShmExportHeader), 64);
+    size_ = slots_offset + config_.slot_count * layout.bytes;
+
+    // Start from a fresh object, readers of a previous run keep their mapping of the old one
+    shm_unlink(config_.name.c_str());
+    int fd = shm_open(config_.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+      return;
+    }
+
+    void *base = MAP_FAILED;
+    if (ftruncate(fd, size_) == 0)
+    {
+      base = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (base == MAP_FAILED)
+    {
+      shm_unlink(config_.name.c_str());
+      return;
+    }
+
+    // The object is zero filled, so every slot starts with an even sequence and no cycle is published
+    base_ = static_cast<boost::uint8_t *>(base);
+    header_ = reinterpret_cast<ShmExportHeader *>(base_);
+    header_->version = SHM_EXPORT_VERSION;
+    header_->slot_count = config_.slot_count;
+    header_->max_obstacles = config_.max_obstacles;
+    header_->max_gaps = config_.max_gaps;
+    header_->max_virt_gaps = config_.max_virt_gaps;
+    header_->max_traj_poses = config_.max_traj_poses;
+    header_->slots_offset = slots_offset;
+    header_->slot_bytes = layout.bytes;
+    header_->latest.store(0, boost::memory_order_relaxed);
+
+    // Readers only trust the layout once the magic is set
+    boost::atomic_thread_fence(boost::memory_order_release);
+    header_->magic = SHM_EXPORT_MAGIC;
+
+    thread_ = new boost::thread(boost::bind(&SnapshotExporter::exportLoop, this));
+  }
+
+  SnapshotExporter::~SnapshotExporter()
+  {
+    running_.store(false, boost::memory_order_release);
+
+    if (thread_ != NULL)
+    {
+      thread_->join();
+      delete thread_;
+    }
+
+    delete pending_.exchange(NULL, boost::memory_order_acquire);
+    delete spare_.exchange(NULL, boost::memory_order_acquire);
+
+    if (base_ != NULL)
+    {
+      munmap(base_, size_);
+      shm_unlink(config_.name.c_str());
+    }
+  }
+
+  void SnapshotExporter::post(const MapSnapshotConstPtr &map, const TraceRecord &trace, const VisualFramePtr &frame)
+  {
+    if (base_ == NULL)
+    {
+      return;
+    }
+
+    // Only the first cycles allocate, later ones reuse the cycle the export thread is done with
+    PendingCycle *pending = spare_.exchange(NULL, boost::memory_order_acquire);
+    if (pending == NULL)
+    {
+      pending = new PendingCycle;
+    }
+    pending->map = map;
+    pending->trace = trace;
+    pending->frame = frame;
+
+    // A cycle still waiting is dropped for this newer one, and kept for reuse in turn
+    PendingCycle *stale = pending_.exchange(pending, boost::memory_order_acq_rel);
+    if (stale != NULL)
+    {
+      delete spare_.exchange(stale, boost::memory_order_acq_rel);
+    }
+  }
+
+  void SnapshotExporter::exportLoop()
+  {
+    // Poll rather than wait on a condition, so that the planning threads never take a lock or make a system call
+    while (running_.load(boost::memory_order_acquire))
+    {
+      PendingCycle *pending = pending_.exchange(NULL, boost::memory_order_acquire);
+      if (pending == NULL)
+      {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(2));
+        continue;
+      }
+
+      write(*pending);
+      written_.fetch_add(1, boost::memory_order_relaxed);
+
+      // Let go of the snapshot right away rather than when the cycle is next reused
+      pending->map.reset();
+      pending->frame.reset();
+      delete spare_.exchange(pending, boost::memory_order_acq_rel);
+    }
+  }
+
+  void SnapshotExporter::write(const PendingCycle &pending)
+  {
+    const TraceRecord &trace = pending.trace;
+
+    cycle_++;
+
+    SlotLayout layout = slotLayout(config_.max_obstacles, config_.max_gaps, config_.max_virt_gaps, config_.max_traj_poses);
+    boost::uint8_t *slot = base_ + header_->slots_offset + (cycle_ % config_.slot_count) * layout.bytes;
+    ShmSlotHeader *sh = reinterpret_cast<ShmSlotHeader *>(slot);
+
+    // Odd while writing, readers that see it or see it change retry
+    sh->seq.store(2 * cycle_ - 1, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_release);
+
+    sh->trace = trace;
+    sh->map_version = 0;
+    sh->map_stamp_ns = 0;
+    sh->range_max = 0.0f;
+    sh->min_obs_dist = 0.0f;
+    sh->num_obstacles = 0;
+    sh->num_gaps = 0;
+
+    const MapSnapshot *map = pending.map.get();
+    if (map != NULL)
+    {
+      sh->map_version = map->version;
+      sh->map_stamp_ns = map->stamp.toNSec();
+      sh->range_max = map->range_max;
+      sh->min_obs_dist = map->min_obs_dist;
+
+      ShmObstacle *obstacles = reinterpret_cast<ShmObstacle *>(slot + layout.obstacles);
+      sh->num_obstacles = std::min(map->obstacles.size(), config_.max_obstacles);
+      for (std::size_t i = 0; i < sh->num_obstacles; ++i)
+      {
+        const Obstacle &obs = map->obstacles[i];
+        obstacles[i].x = obs.point.x;
+        obstacles[i].y = obs.point.y;
+        obstacles[i].angle = obs.angle;
+        obstacles[i].distance = obs.distance;
+      }
+
+      ShmGap *gaps = reinterpret_cast<ShmGap *>(slot + layout.gaps);
+      sh->num_gaps = std::min(map->gaps.size(), config_.max_gaps);
+      for (std::size_t i = 0; i < sh->num_gaps; ++i)
+      {
+        toShmGap(map->gaps[i], gaps[i]);
+      }
+    }
+
+    // The chosen gap is in the trace, only its side flags need the debug data
+    std::memset(&sh->closest_gap, 0, sizeof(sh->closest_gap));
+    const VisualFrame *frame = pending.frame.get();
+    if ((frame != NULL) && (frame->closest_gap != NULL))
+    {
+      toShmGap(*frame->closest_gap, sh->closest_gap);
+    }
+    else if (trace.outcome == TRACE_ASSISTED)
+    {
+      sh->closest_gap.right_x = trace.gap_right_x;
+      sh->closest_gap.right_y = trace.gap_right_y;
+      sh->closest_gap.left_x = trace.gap_left_x;
+      sh->closest_gap.left_y = trace.gap_left_y;
+      sh->closest_gap.flags = SHM_GAP_VALID;
+    }
+
+    sh->num_virt_gaps = 0;
+    sh->num_traj_poses = 0;
+    if (frame != NULL)
+    {
+      // Non-admissible virtual gaps keep their place, marked invalid
+      ShmGap *virt_gaps = reinterpret_cast<ShmGap *>(slot + layout.virt_gaps);
+      sh->num_virt_gaps = std::min(frame->virt_gaps.size(), config_.max_virt_gaps);
+      for (std::size_t i = 0; i < sh->num_virt_gaps; ++i)
+      {
+        if (frame->virt_gaps[i] != NULL)
+        {
+          toShmGap(*frame->virt_gaps[i], virt_gaps[i]);
+        }
+        else
+        {
+          std::memset(&virt_gaps[i], 0, sizeof(ShmGap));
+        }
+      }
+
+      ShmPose *traj_poses = reinterpret_cast<ShmPose *>(slot + layout.traj_poses);
+      sh->num_traj_poses = std::min(frame->traj_poses.size(), config_.max_traj_poses);
+      for (std::size_t i = 0; i < sh->num_traj_poses; ++i)
+      {
+        traj_poses[i].x = frame->traj_poses[i].position.x;
+        traj_poses[i].y = frame->traj_poses[i].position.y;
+        traj_poses[i].yaw = getYaw(frame->traj_poses[i].orientation);
+      }
+    }
+
+    sh->seq.store(2 * cycle_, boost::memory_order_release);
+    header_->latest.store(cycle_, boost::memory_order_release);
+  }
+
+  //==============================================================================
+  // SNAPSHOT READER
+  //==============================================================================
+
+  SnapshotReader::SnapshotReader(const std::string &name)
+                                : base_(NULL)
+                                , size_(0)
+                                , header_(NULL)
+  {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+      return;
+    }
+
+    struct stat fst;
+    void *base = MAP_FAILED;
+    if ((fstat(fd, &fst) == 0) && (static_cast<std::size_t>(fst.st_size) >= sizeof(ShmExportHeader)))
+    {
+      base = mmap(NULL, fst.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (base == MAP_FAILED)
+    {
+      return;
+    }
+
+    base_ = static_cast<const boost::uint8_t *>(base);
+    size_ = fst.st_size;
+
+    const ShmExportHeader *header = reinterpret_cast<const ShmExportHeader *>(base_);
+    bool valid = (header->magic == SHM_EXPORT_MAGIC);
+    boost::atomic_thread_fence(boost::memory_order_acquire);
+
+    SlotLayout layout = slotLayout(header->max_obstacles, header->max_gaps, header->max_virt_gaps, header->max_traj_poses);
+    valid = valid && (header->version == SHM_EXPORT_VERSION) && (header->slot_count > 0) &&
+            (header->slot_bytes == layout.bytes) && (header->slots_offset + header->slot_count * header->slot_bytes <= size_);
+    if (valid)
+    {
+      header_ = header;
+    }
+  }
+
+  SnapshotReader::~SnapshotReader()
+  {
+    if (base_ != NULL)
+    {
+      munmap(const_cast<boost::uint8_t *>(base_), size_);
+    }
+  }
+
+  boost::uint64_t SnapshotReader::latestCycle() const
+  {
+    return (header_ != NULL) ? header_->latest.load(boost::memory_order_acquire) : 0;
+  }
+
+  bool SnapshotReader::readLatest(ExportedCycle &out, int max_retries) const
+  {
+    if (header_ == NULL)
+    {
+      return false;
+    }
+
+    SlotLayout layout = slotLayout(header_->max_obstacles, header_->max_gaps, header_->max_virt_gaps, header_->max_traj_poses);
+
+    for (int attempt = 0; attempt <= max_retries; ++attempt)
+    {
+      boost::uint64_t cycle = header_->latest.load(boost::memory_order_acquire);
+      if (cycle == 0)
+      {
+        return false;
+      }
+
+      const boost::uint8_t *slot = base_ + header_->slots_offset + (cycle % header_->slot_count) * header_->slot_bytes;
+      const ShmSlotHeader *sh = reinterpret_cast<const ShmSlotHeader *>(slot);
+
+      // Already being overwritten by a newer cycle
+      boost::uint64_t seq = sh->seq.load(boost::memory_order_acquire);
+      if (seq != 2 * cycle)
+      {
+        continue;
+      }
+
+      out.trace = sh->trace;
+      out.map_version = sh->map_version;
+      out.map_stamp_ns = sh->map_stamp_ns;
+      out.range_max = sh->range_max;
+      out.min_obs_dist = sh->min_obs_dist;
+      out.closest_gap = sh->closest_gap;
+
+      // A torn copy may hold any counts, clamp them before copying the arrays
+      std::size_t num_obstacles = std::min<std::size_t>(sh->num_obstacles, header_->max_obstacles);
+      std::size_t num_gaps = std::min<std::size_t>(sh->num_gaps, header_->max_gaps);
+      std::size_t num_virt_gaps = std::min<std::size_t>(sh->num_virt_gaps, header_->max_virt_gaps);
+      std::size_t num_traj_poses = std::min<std::size_t>(sh->num_traj_poses, header_->max_traj_poses);
+
+      const ShmObstacle *obstacles = reinterpret_cast<const ShmObstacle *>(slot + layout.obstacles);
+      const ShmGap *gaps = reinterpret_cast<const ShmGap *>(slot + layout.gaps);
+      const ShmGap *virt_gaps = reinterpret_cast<const ShmGap *>(slot + layout.virt_gaps);
+      const ShmPose *traj_poses = reinterpret_cast<const ShmPose *>(slot + layout.traj_poses);
+      out.obstacles.assign(obstacles, obstacles + num_obstacles);
+      out.gaps.assign(gaps, gaps + num_gaps);
+      out.virt_gaps.assign(virt_gaps, virt_gaps + num_virt_gaps);
+      out.traj_poses.assign(traj_poses, traj_poses + num_traj_poses);
+
+      // The copy is consistent if the writer did not touch the slot meanwhile
+      boost::atomic_thread_fence(boost::memory_order_acquire);
+      if (sh->seq.load(boost::memory_order_relaxed) == seq)
+      {
+        out.cycle = cycle;
+        return true;
+      }
+    }
+
+    return false;
+  }
+} /* namespace reactive_assistance */
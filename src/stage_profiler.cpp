@@ -0,0 +1,107 @@
+#include <cstdio>
+
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/stage_profiler.hpp>
+
+namespace reactive_assistance
+{
+  StageProfiler::StageProfiler()
+                              : counters_enabled_(false)
+  {
+    for (int i = 0; i < NUM_PLANNING_STAGES; ++i)
+    {
+      counter_runs_[i].store(0, boost::memory_order_relaxed);
+      for (int j = 0; j < NUM_PERF_COUNTERS; ++j)
+      {
+        counters_[i][j].store(0, boost::memory_order_relaxed);
+      }
+    }
+  }
+
+  void StageProfiler::record(PlanningStage stage, boost::int64_t ns)
+  {
+    stages_[stage].record(ns);
+  }
+
+  void StageProfiler::recordCycle(const TraceRecord &rec, boost::int64_t cycle_ns, boost::int64_t scan_to_cmd_ns)
+  {
+    // None of the command stages ran for a cached cycle
+    if (!(rec.flags & TRACE_FLAG_CACHED))
+    {
+      // Scan stages are recorded once per scan by the obstacle map, not once per cycle
+      stages_[STAGE_SIMULATE_TRAJECTORY].record(rec.stage_ns[STAGE_SIMULATE_TRAJECTORY]);
+
+      if (rec.outcome != TRACE_DEADZONE)
+      {
+        stages_[STAGE_IS_NAVIGABLE].record(rec.stage_ns[STAGE_IS_NAVIGABLE]);
+      }
+
+      // The gap search of a fast tier cycle is recorded with the slow tier decision it used
+      bool deferred = (rec.flags & TRACE_FLAG_DEFERRED);
+
+      if (!deferred && ((rec.outcome == TRACE_ASSISTED) || (rec.outcome == TRACE_NO_GAP) || (rec.outcome == TRACE_SAMPLED)))
+      {
+        stages_[STAGE_ASSISTIVE_COMMAND].record(rec.stage_ns[STAGE_ASSISTIVE_COMMAND]);
+      }
+
+      if (!deferred && (rec.gaps_evaluated > 0))
+      {
+        stages_[STAGE_FIND_VIRTUAL_GAPS].record(rec.stage_ns[STAGE_FIND_VIRTUAL_GAPS]);
+      }
+    }
+
+    stages_[STAGE_PUBLISH].record(rec.stage_ns[STAGE_PUBLISH]);
+
+    cycle_.record(cycle_ns);
+    scan_to_cmd_.record(scan_to_cmd_ns);
+  }
+
+  void StageProfiler::recordCounters(PlanningStage stage, const PerfSample &begin, const PerfSample &end)
+  {
+    counter_runs_[stage].fetch_add(1, boost::memory_order_relaxed);
+    for (int j = 0; j < NUM_PERF_COUNTERS; ++j)
+    {
+      counters_[stage][j].fetch_add(end.values[j] - begin.values[j], boost::memory_order_relaxed);
+    }
+  }
+
+  void StageProfiler::collect(StageReport &report)
+  {
+    report.counters_enabled = countersEnabled();
+
+    for (int i = 0; i < NUM_PLANNING_STAGES; ++i)
+    {
+      stages_[i].collect(report.stages[i]);
+
+      report.counter_runs[i] = counter_runs_[i].exchange(0, boost::memory_order_relaxed);
+      for (int j = 0; j < NUM_PERF_COUNTERS; ++j)
+      {
+        report.counters[i][j] = counters_[i][j].exchange(0, boost::memory_order_relaxed);
+      }
+    }
+
+    cycle_.collect(report.cycle);
+    scan_to_cmd_.collect(report.scan_to_cmd);
+    input_to_cmd_.collect(report.input_to_cmd);
+  }
+
+  void printStageReport(const StageReport &report, std::ostream &out)
+  {
+    char line[128];
+    std::snprintf(line, sizeof(line), "  %-22s %10s %10s %10s %10s\n", "latency (us)", "count", "p50", "p99", "max");
+    out << line;
+
+    for (int i = -1; i < NUM_PLANNING_STAGES; ++i)
+    {
+      const LatencySummary &summary = (i < 0) ? report.cycle : report.stages[i];
+      if (summary.count == 0 || summary.max <= 0.0)
+      {
+        continue;
+      }
+
+      std::snprintf(line, sizeof(line), "  %-22s %10llu %10.1f %10.1f %10.1f\n", (i < 0) ? "cycle" : PLANNING_STAGE_NAMES[i],
+                    static_cast<unsigned long long>(summary.count), summary.p50 / 1000.0, summary.p99 / 1000.0, summary.max / 1000.0);
+      out << line;
+    }
+  }
+} /* namespace reactive_assistance */
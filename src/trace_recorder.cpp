@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/trace_recorder.hpp>
+
+namespace reactive_assistance
+{
+  TraceRecorder::TraceRecorder(std::size_t capacity)
+                              : mask_(0)
+                              , head_(0)
+  {
+    std::size_t size = 1;
+    while (size < capacity)
+    {
+      size <<= 1;
+    }
+
+    mask_ = size - 1;
+    slots_.reset(new Slot[size]);
+  }
+
+  void TraceRecorder::record(const TraceRecord &rec)
+  {
+    boost::uint64_t idx = head_.fetch_add(1, boost::memory_order_relaxed);
+    Slot &slot = slots_[idx & mask_];
+
+    // Mark the slot as being written before touching the record
+    slot.seq.store(2 * idx + 1, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_release);
+
+    std::memcpy(&slot.rec, &rec, sizeof(TraceRecord));
+
+    slot.seq.store(2 * idx + 2, boost::memory_order_release);
+  }
+
+  void TraceRecorder::getRecords(std::vector<TraceRecord> &records) const
+  {
+    boost::uint64_t head = head_.load(boost::memory_order_acquire);
+    boost::uint64_t size = mask_ + 1;
+    boost::uint64_t first = (head > size) ? (head - size) : 0;
+
+    records.clear();
+    records.reserve(head - first);
+    for (boost::uint64_t idx = first; idx < head; ++idx)
+    {
+      const Slot &slot = slots_[idx & mask_];
+
+      // Skip records still being written or already overwritten by a newer cycle
+      boost::uint64_t seq = slot.seq.load(boost::memory_order_acquire);
+      if (seq != 2 * idx + 2)
+      {
+        continue;
+      }
+
+      TraceRecord rec;
+      std::memcpy(&rec, &slot.rec, sizeof(TraceRecord));
+
+      boost::atomic_thread_fence(boost::memory_order_acquire);
+      if (slot.seq.load(boost::memory_order_relaxed) == seq)
+      {
+        records.push_back(rec);
+      }
+    }
+  }
+
+  bool TraceRecorder::dump(const std::string &path) const
+  {
+    std::vector<TraceRecord> records;
+    getRecords(records);
+
+    return writeTraceCsv(records, path);
+  }
+
+  bool writeTraceCsv(const std::vector<TraceRecord> &records, const std::string &path)
+  {
+    std::ofstream out(path.c_str());
+    if (!out)
+    {
+      return false;
+    }
+
+    // Enough digits for the floats to read back exactly
+    out.precision(std::numeric_limits<float>::max_digits10);
+
+    out << "stamp_ns,map_version,source,outcome,gaps_evaluated,virt_iterations,flags,in_vx,in_wz,out_vx,out_wz,"
+        << "gap_right_x,gap_right_y,gap_left_x,gap_left_y,clearance_min,clearance_max";
+    for (int s = 0; s < NUM_PLANNING_STAGES; ++s)
+    {
+      out << "," << PLANNING_STAGE_NAMES[s] << "_ns";
+    }
+    out << "\n";
+
+    for (std::vector<TraceRecord>::const_iterator it = records.begin(); it != records.end(); ++it)
+    {
+      out << it->stamp_ns << "," << it->map_version << ","
+          << TRACE_SOURCE_NAMES[it->source] << "," << TRACE_OUTCOME_NAMES[it->outcome] << ","
+          << it->gaps_evaluated << "," << it->virt_iterations << "," << it->flags << ","
+          << it->in_vx << "," << it->in_wz << "," << it->out_vx << "," << it->out_wz << ","
+          << it->gap_right_x << "," << it->gap_right_y << "," << it->gap_left_x << "," << it->gap_left_y << ","
+          << it->clearance_min << "," << it->clearance_max;
+      for (int s = 0; s < NUM_PLANNING_STAGES; ++s)
+      {
+        out << "," << it->stage_ns[s];
+      }
+      out << "\n";
+    }
+
+    return static_cast<bool>(out);
+  }
+
+  // Read the next field of 'fields' as a float. Unlike operator>>, strtod also takes the inf and nan the CSV writer
+  // prints, e.g. for the clearances of a cycle without any gap
+  static bool readFloat(std::istream &fields, float &value)
+  {
+    std::string token;
+    if (!(fields >> token))
+    {
+      return false;
+    }
+
+    char *end = NULL;
+    value = static_cast<float>(std::strtod(token.c_str(), &end));
+    return (end != token.c_str()) && (*end == '\0');
+  }
+
+  bool readTraceCsv(const std::string &path, std::vector<TraceRecord> &records)
+  {
+    std::ifstream in(path.c_str());
+    if (!in)
+    {
+      return false;
+    }
+
+    records.clear();
+
+    // Skip the header
+    std::string line;
+    std::getline(in, line);
+
+    while (std::getline(in, line))
+    {
+      if (line.empty())
+      {
+        continue;
+      }
+
+      // Fields are read in the order they are written
+      std::replace(line.begin(), line.end(), ',', ' ');
+      std::istringstream fields(line);
+
+      TraceRecord rec;
+      std::memset(&rec, 0, sizeof(TraceRecord));
+      std::string source, outcome;
+      unsigned int gaps_evaluated, virt_iterations, flags;
+
+      fields >> rec.stamp_ns >> rec.map_version >> source >> outcome >> gaps_evaluated >> virt_iterations >> flags;
+
+      float *values[] = {&rec.in_vx, &rec.in_wz, &rec.out_vx, &rec.out_wz, &rec.gap_right_x, &rec.gap_right_y,
+                         &rec.gap_left_x, &rec.gap_left_y, &rec.clearance_min, &rec.clearance_max};
+      bool parsed = static_cast<bool>(fields);
+      for (std::size_t v = 0; parsed && (v < sizeof(values) / sizeof(values[0])); ++v)
+      {
+        parsed = readFloat(fields, *values[v]);
+      }
+
+      for (int s = 0; s < NUM_PLANNING_STAGES; ++s)
+      {
+        fields >> rec.stage_ns[s];
+      }
+
+      if (!parsed || !fields)
+      {
+        return false;
+      }
+
+      rec.gaps_evaluated = gaps_evaluated;
+      rec.virt_iterations = virt_iterations;
+      rec.flags = flags;
+      rec.source = (source == TRACE_SOURCE_NAMES[TRACE_AUTONOMOUS]) ? TRACE_AUTONOMOUS : TRACE_SHARED_CONTROL;
+
+      rec.outcome = NUM_TRACE_OUTCOMES;
+      for (int o = 0; o < NUM_TRACE_OUTCOMES; ++o)
+      {
+        if (outcome == TRACE_OUTCOME_NAMES[o])
+        {
+          rec.outcome = o;
+        }
+      }
+
+      if (rec.outcome == NUM_TRACE_OUTCOMES)
+      {
+        return false;
+      }
+
+      records.push_back(rec);
+    }
+
+    return true;
+  }
+} /* namespace reactive_assistance */
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <geometry_msgs/PoseArray.h>
+
+#include <reactive_assistance/obstacle_map.hpp>
+// All the other necessary headers included in the class declaration files
+#include <reactive_assistance/visualiser.hpp>
+
+namespace reactive_assistance
+{
+  //==============================================================================
+  // PUBLIC VISUALISER METHODS
+  //==============================================================================
+
+  Visualiser::Visualiser(const ObstacleMap &obs_map, const RobotProfile &rp, ros::NodeHandle nh, ros::NodeHandle nh_priv)
+                        : obs_map_(obs_map)
+                        , gaps_version_(0)
+                        , active_(false)
+                        , running_(true)
+                        , vis_thread_(NULL)
+  {
+    nh_priv.param<std::string>("base_frame", robot_frame_, std::string("base_link"));
+    nh_priv.param<std::string>("odom_frame", odom_frame_, std::string("odom"));
+
+    // Create footprint polygon visualisation as a list of lines, only the pose changes afterwards
+    footprint_marker_.type = visualization_msgs::Marker::LINE_LIST;
+    footprint_marker_.header.frame_id = odom_frame_;
+    footprint_marker_.action = visualization_msgs::Marker::ADD;
+    footprint_marker_.scale.x = 0.03;
+
+    // Coloured green
+    footprint_marker_.color.g = 1.0;
+    footprint_marker_.color.a = 1.0;
+
+    int fp_length = rp.footprint.size();
+    // Loop over each edge of robot polygon shape
+    for (int i = 0; i < fp_length; ++i)
+    {
+      int next = (i + 1) % fp_length;
+      footprint_marker_.points.push_back(rp.footprint[i]);
+      footprint_marker_.points.push_back(rp.footprint[next]);
+    }
+
+    std::string gaps_pub_topic, virt_gaps_pub_topic, closest_gap_pub_topic;
+    nh_priv.param<std::string>("gaps_pub_topic", gaps_pub_topic, std::string("gaps"));
+    nh_priv.param<std::string>("virt_gaps_pub_topic", virt_gaps_pub_topic, std::string("virt_gaps"));
+    nh_priv.param<std::string>("closest_gap_pub_topic", closest_gap_pub_topic, std::string("closest_gap"));
+
+    std::string traj_pub_topic, obs_pub_topic, footprint_pub_topic, goal_pub_topic;
+    nh_priv.param<std::string>("traj_pub_topic", traj_pub_topic, std::string("desired_traj"));
+    nh_priv.param<std::string>("obs_pub_topic", obs_pub_topic, std::string("collision_obstacles"));
+    nh_priv.param<std::string>("footprint_pub_topic", footprint_pub_topic, std::string("footprint"));
+    nh_priv.param<std::string>("goal_pub_topic", goal_pub_topic, std::string("nav_goal"));
+
+    gaps_pub_ = nh.advertise<PointCloud>(gaps_pub_topic, 10);
+    virt_gaps_pub_ = nh.advertise<PointCloud>(virt_gaps_pub_topic, 10);
+    closest_gap_pub_ = nh.advertise<PointCloud>(closest_gap_pub_topic, 10);
+    traj_pub_ = nh.advertise<geometry_msgs::PoseArray>(traj_pub_topic, 10);
+    obs_pub_ = nh.advertise<PointCloud>(obs_pub_topic, 10);
+    footprint_pub_ = nh.advertise<visualization_msgs::Marker>(footprint_pub_topic, 10);
+    goal_pub_ = nh.advertise<geometry_msgs::PoseStamped>(goal_pub_topic, 10);
+
+    // Visualisations are capped at their own rate, independently of the scan and command rates
+    double vis_rate;
+    nh_priv.param<double>("visualisation_rate", vis_rate, 10.0);
+    vis_thread_ = new boost::thread(boost::bind(&Visualiser::visualisationLoop, this, vis_rate));
+  }
+
+  Visualiser::~Visualiser()
+  {
+    if (vis_thread_ != NULL)
+    {
+      running_ = false;
+      vis_thread_->join();
+      delete vis_thread_;
+    }
+  }
+
+  void Visualiser::post(const VisualFramePtr &frame)
+  {
+    boost::mutex::scoped_lock lock(pending_mutex_);
+    pending_frame_ = frame;
+  }
+
+  void Visualiser::postOdometry(const nav_msgs::Odometry::ConstPtr &odom)
+  {
+    boost::mutex::scoped_lock lock(pending_mutex_);
+    pending_odom_ = odom;
+  }
+
+  void Visualiser::postGoal(const geometry_msgs::PoseStamped::ConstPtr &goal)
+  {
+    boost::mutex::scoped_lock lock(pending_mutex_);
+    pending_goal_ = goal;
+  }
+
+  //==============================================================================
+  // PRIVATE VISUALISER METHODS
+  //==============================================================================
+
+  void Visualiser::publish()
+  {
+    // Planning calls only build frames whilst someone is listening to them
+    active_ = (virt_gaps_pub_.getNumSubscribers() > 0) || (closest_gap_pub_.getNumSubscribers() > 0) ||
+              (traj_pub_.getNumSubscribers() > 0) || (obs_pub_.getNumSubscribers() > 0) ||
+              (goal_pub_.getNumSubscribers() > 0);
+
+    // Take ownership of the pending data
+    VisualFramePtr frame;
+    nav_msgs::Odometry::ConstPtr odom;
+    geometry_msgs::PoseStamped::ConstPtr goal;
+    {
+      boost::mutex::scoped_lock lock(pending_mutex_);
+      frame.swap(pending_frame_);
+      odom.swap(pending_odom_);
+      goal.swap(pending_goal_);
+    }
+
+    if ((goal != NULL) && (goal_pub_.getNumSubscribers() > 0))
+    {
+      goal_pub_.publish(*goal);
+    }
+
+    if ((odom != NULL) && (footprint_pub_.getNumSubscribers() > 0))
+    {
+      footprint_marker_.header.stamp = ros::Time::now();
+      footprint_marker_.pose = odom->pose.pose;
+      footprint_pub_.publish(footprint_marker_);
+    }
+
+    // Gaps are published once per new snapshot
+    if (gaps_pub_.getNumSubscribers() > 0)
+    {
+      MapSnapshotConstPtr map = obs_map_.getSnapshot();
+      if ((map->version != gaps_version_) && (map->gaps.size() > 0))
+      {
+        gaps_version_ = map->version;
+
+        PointCloudPtr cloud(new PointCloud);
+        cloud->header.frame_id = robot_frame_;
+        for (std::vector<Gap>::const_iterator it = map->gaps.begin(); it != map->gaps.end(); ++it)
+        {
+          cloud->points.push_back(pcl::PointXYZ(it->right.point.x, it->right.point.y, it->right.point.z));
+          cloud->points.push_back(pcl::PointXYZ(it->left.point.x, it->left.point.y, it->left.point.z));
+        }
+
+        gaps_pub_.publish(cloud);
+      }
+    }
+
+    if (frame == NULL)
+    {
+      return;
+    }
+
+    if (!frame->traj_poses.empty() && (traj_pub_.getNumSubscribers() > 0))
+    {
+      geometry_msgs::PoseArray traj_cloud;
+      traj_cloud.header.frame_id = odom_frame_;
+      traj_cloud.poses = frame->traj_poses;
+
+      traj_pub_.publish(traj_cloud);
+    }
+
+    if ((frame->sim_goal != NULL) && (goal_pub_.getNumSubscribers() > 0))
+    {
+      // Poses computed by the planning engine carry no frame
+      geometry_msgs::PoseStamped sim_goal = *frame->sim_goal;
+      sim_goal.header.frame_id = robot_frame_;
+
+      goal_pub_.publish(sim_goal);
+    }
+
+    if (!frame->coll_obstacles.empty() && (obs_pub_.getNumSubscribers() > 0))
+    {
+      PointCloudPtr cloud(new PointCloud);
+      cloud->header.frame_id = robot_frame_;
+      for (std::vector<Obstacle>::const_iterator it = frame->coll_obstacles.begin(); it != frame->coll_obstacles.end(); ++it)
+      {
+        cloud->points.push_back(pcl::PointXYZ(it->point.x, it->point.y, 0.0));
+      }
+
+      obs_pub_.publish(cloud);
+    }
+
+    if ((frame->closest_gap != NULL) && (closest_gap_pub_.getNumSubscribers() > 0))
+    {
+      PointCloudPtr cloud(new PointCloud);
+      cloud->header.frame_id = robot_frame_;
+      addGaps(std::vector<GapPtr>(1, frame->closest_gap), *cloud);
+
+      closest_gap_pub_.publish(cloud);
+    }
+
+    if (!frame->virt_gaps.empty() && (virt_gaps_pub_.getNumSubscribers() > 0))
+    {
+      PointCloudPtr cloud(new PointCloud);
+      cloud->header.frame_id = robot_frame_;
+      addGaps(frame->virt_gaps, *cloud);
+
+      virt_gaps_pub_.publish(cloud);
+    }
+  }
+
+  void Visualiser::visualisationLoop(double rate)
+  {
+    // Lowest scheduling priority, visualisations must never compete with the planning
+    if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19) != 0)
+    {
+      ROS_WARN("Could not lower the priority of the visualisation thread");
+    }
+
+    ros::NodeHandle nh;
+    ros::Rate r(rate);
+
+    while (nh.ok() && running_)
+    {
+      publish();
+      r.sleep();
+    }
+  }
+
+  void Visualiser::addGaps(const std::vector<GapPtr> &gaps, PointCloud &cloud) const
+  {
+    for (std::vector<GapPtr>::const_iterator it = gaps.begin(); it != gaps.end(); ++it)
+    {
+      // Non-admissible gaps are marked by a NULL entry
+      if (*it == NULL)
+      {
+        continue;
+      }
+
+      const Gap &gap = **it;
+      cloud.points.push_back(pcl::PointXYZ(gap.right.point.x, gap.right.point.y, gap.right.point.z));
+      cloud.points.push_back(pcl::PointXYZ(gap.left.point.x, gap.left.point.y, gap.left.point.z));
+    }
+  }
+} /* namespace reactive_assistance */
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include <reactive_assistance/dist_util.hpp>
+#include <reactive_assistance/obstacle_map.hpp>
+
+#include "synthetic_scenes.hpp"
+
+namespace reactive_assistance
+{
+  // Default fitting tolerance of the node
+  static const double SEGMENT_TOLERANCE = 0.02;
+
+  // Segmented snapshot of a synthetic scene, and a copy that only holds its points
+  static void makeSnapshots(SceneType scene, int beams, const geometry_msgs::Transform &laser_to_base,
+                            MapSnapshot &segmented, MapSnapshot &points)
+  {
+    ObstacleMap obs_map(makeSceneRobot(), NULL, NULL, SEGMENT_TOLERANCE);
+    sensor_msgs::LaserScan scan;
+    makeSceneScan(scene, beams, scan);
+
+    obs_map.updateObstacles(scan, laser_to_base, segmented);
+    obs_map.updateGaps(segmented);
+
+    points = segmented;
+    points.segments.clear();
+    points.residuals.clear();
+  }
+
+  // Arcs to goals on a grid around the robot, straight ahead and behind included
+  static void makeTrajectories(std::vector<Trajectory> &trajs)
+  {
+    for (double x = -2.95; x < 3.0; x += 0.1)
+    {
+      for (double y = -2.95; y < 3.0; y += 0.1)
+      {
+        geometry_msgs::Point goal;
+        goal.x = x;
+        goal.y = y;
+        trajs.push_back(Trajectory(goal));
+      }
+
+      geometry_msgs::Point goal;
+      goal.x = x;
+      goal.y = 0.5 * epsilon;
+      trajs.push_back(Trajectory(goal));
+    }
+  }
+
+  // Laser mounted on the base, and mounted off centre and turned
+  static void makeTransforms(std::vector<geometry_msgs::Transform> &transforms)
+  {
+    geometry_msgs::Transform tf;
+    tf.rotation.w = 1.0;
+    transforms.push_back(tf);
+
+    tf.translation.x = 0.25;
+    tf.translation.y = -0.1;
+    tf.rotation.z = std::sin(0.15);
+    tf.rotation.w = std::cos(0.15);
+    transforms.push_back(tf);
+  }
+
+  TEST(SegmentedMap, CoversEveryPointWithinTolerance)
+  {
+    std::vector<geometry_msgs::Transform> transforms;
+    makeTransforms(transforms);
+
+    for (int scene = 0; scene < NUM_SCENES; ++scene)
+    {
+      for (std::size_t t = 0; t < transforms.size(); ++t)
+      {
+        MapSnapshot segmented, points;
+        makeSnapshots(static_cast<SceneType>(scene), 1440, transforms[t], segmented, points);
+
+        // Every point is stood for by exactly one segment or kept as a residual
+        std::vector<int> covered(segmented.obstacles.size(), 0);
+        for (std::size_t s = 0; s < segmented.segments.size(); ++s)
+        {
+          const Segment &seg = segmented.segments[s];
+          for (std::size_t k = seg.first; k <= seg.last; ++k)
+          {
+            covered[k]++;
+            EXPECT_LE(segmentDistance(segmented.obstacles[k].point, seg.start, seg.end), SEGMENT_TOLERANCE + 1e-9)
+              << SCENE_NAMES[scene] << ", point " << k;
+          }
+        }
+
+        for (std::size_t r = 0; r < segmented.residuals.size(); ++r)
+        {
+          covered[segmented.residuals[r]]++;
+        }
+
+        for (std::size_t k = 0; k < covered.size(); ++k)
+        {
+          ASSERT_EQ(covered[k], 1) << SCENE_NAMES[scene] << ", point " << k;
+        }
+      }
+    }
+  }
+
+  TEST(SegmentedMap, NeverAcceptsWhatThePointsReject)
+  {
+    std::vector<Trajectory> trajs;
+    makeTrajectories(trajs);
+    std::vector<geometry_msgs::Transform> transforms;
+    makeTransforms(transforms);
+
+    const int beams[] = {360, 1440, 4096};
+    for (int scene = 0; scene < NUM_SCENES; ++scene)
+    {
+      for (int b = 0; b < 3; ++b)
+      {
+        for (std::size_t t = 0; t < transforms.size(); ++t)
+        {
+          ObstacleMap obs_map(makeSceneRobot(), NULL, NULL, SEGMENT_TOLERANCE);
+          MapSnapshot segmented, points;
+          makeSnapshots(static_cast<SceneType>(scene), beams[b], transforms[t], segmented, points);
+
+          // Without the range index the segments alone settle every verdict
+          MapSnapshot unindexed = segmented;
+          unindexed.range_index = RangeIndex();
+
+          std::vector<unsigned char> batched;
+          obs_map.isNavigable(trajs, points.obstacles, batched);
+
+          int rejected = 0;
+          for (std::size_t i = 0; i < trajs.size(); ++i)
+          {
+            bool by_points = obs_map.isNavigable(trajs[i], points.obstacles);
+            ASSERT_EQ(by_points, static_cast<bool>(batched[i]));
+            rejected += !by_points;
+
+            if (!by_points)
+            {
+              EXPECT_FALSE(obs_map.isNavigable(segmented, trajs[i]))
+                << SCENE_NAMES[scene] << " at " << beams[b] << " beams, goal " << trajs[i].getGoalPoint().x << ", "
+                << trajs[i].getGoalPoint().y;
+              EXPECT_FALSE(obs_map.isNavigable(unindexed, trajs[i]))
+                << SCENE_NAMES[scene] << " at " << beams[b] << " beams without the range index, goal "
+                << trajs[i].getGoalPoint().x << ", " << trajs[i].getGoalPoint().y;
+            }
+          }
+
+          // The grid must actually reach the obstacles of every scene
+          EXPECT_GT(rejected, 0) << SCENE_NAMES[scene];
+        }
+      }
+    }
+  }
+
+  TEST(SegmentedMap, ClearanceWithinToleranceOfThePoints)
+  {
+    std::vector<geometry_msgs::Transform> transforms;
+    makeTransforms(transforms);
+
+    for (int scene = 0; scene < NUM_SCENES; ++scene)
+    {
+      for (std::size_t t = 0; t < transforms.size(); ++t)
+      {
+        ObstacleMap obs_map(makeSceneRobot(), NULL, NULL, SEGMENT_TOLERANCE);
+        MapSnapshot segmented, points;
+        makeSnapshots(static_cast<SceneType>(scene), 1440, transforms[t], segmented, points);
+
+        // The virtual gaps are built from the points, so both snapshots give the same ones to compare clearances over
+        for (std::size_t g = 0; g < segmented.gaps.size(); ++g)
+        {
+          std::vector<GapPtr> seg_gaps, point_gaps;
+          std::vector<double> seg_clearances, point_clearances;
+          obs_map.findVirtualGaps(segmented, segmented.gaps[g], seg_gaps, seg_clearances);
+          obs_map.findVirtualGaps(points, points.gaps[g], point_gaps, point_clearances);
+
+          ASSERT_EQ(seg_clearances.size(), point_clearances.size());
+          for (std::size_t v = 0; v < seg_clearances.size(); ++v)
+          {
+            // Points lie within the tolerance of their segment, so the segments may only be closer or that much further
+            EXPECT_LE(seg_clearances[v], point_clearances[v] + SEGMENT_TOLERANCE + 1e-9)
+              << SCENE_NAMES[scene] << ", gap " << g << ", virtual gap " << v;
+            EXPECT_GE(seg_clearances[v], 0.0);
+          }
+        }
+      }
+    }
+  }
+} /* namespace reactive_assistance */
\ No newline at end of file
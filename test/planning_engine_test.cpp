@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <geometry_msgs/Pose2D.h>
+
+#include <reactive_assistance/planning_engine.hpp>
+#include <reactive_assistance/scan_simulator.hpp>
+
+namespace reactive_assistance
+{
+  // Long rectangular robot, whose corners reach 0.67 m from the base while its sides are only 0.3 m away
+  static RobotProfile makeLongRobot()
+  {
+    return RobotProfile::rectangular(0.3, 0.6, 0.9, 1.0, 1.0, 1.0, 1.0);
+  }
+
+  // Noise free scan of 'world' from the origin
+  static void makeScan(const ScanWorld &world, sensor_msgs::LaserScan &scan)
+  {
+    ScanConfig config;
+    config.beams = 720;
+    config.range_max = 10.0;
+
+    ScanSimulator sim(world, config);
+    sim.simulate(geometry_msgs::Pose2D(), 0, scan);
+  }
+
+  // Legs behind the sides of the robot, outside of its footprint and clear of the arcs of the sampled rotations, but
+  // swept by a rear corner as soon as it turns in place either way
+  static void addLegsBeside(ScanWorld &world)
+  {
+    world.addCircle(-0.5, 0.41, 0.02);
+    world.addCircle(-0.5, -0.41, 0.02);
+  }
+
+  TEST(SampleCommand, RejectsRotationSweepingIntoObstacles)
+  {
+    ScanWorld world;
+    addLegsBeside(world);
+    sensor_msgs::LaserScan scan;
+    makeScan(world, scan);
+
+    PlanningEngine engine(makeLongRobot());
+    engine.updateScan(scan);
+
+    // From standstill, the closest sample to a pure rotation input is that rotation
+    nav_msgs::Odometry odom;
+    odom.pose.pose.orientation.w = 1.0;
+    MapSnapshotConstPtr map = engine.getObstacleMap().getSnapshot();
+
+    const double turns[] = {-0.8, 0.8};
+    for (int i = 0; i < 2; ++i)
+    {
+      geometry_msgs::Twist input, cmd;
+      input.angular.z = turns[i];
+
+      if (engine.sampleCommand(*map, input, odom, cmd))
+      {
+        EXPECT_NE(cmd.linear.x, 0.0) << "rotated in place with a corner sweeping through a leg, w = " << cmd.angular.z;
+      }
+    }
+  }
+
+  TEST(SampleCommand, AcceptsRotationInTheOpen)
+  {
+    ScanWorld world;
+    world.addCircle(1.5, 1.5, 0.03);
+    sensor_msgs::LaserScan scan;
+    makeScan(world, scan);
+
+    PlanningEngine engine(makeLongRobot());
+    engine.updateScan(scan);
+
+    nav_msgs::Odometry odom;
+    odom.pose.pose.orientation.w = 1.0;
+    geometry_msgs::Twist input, cmd;
+    input.angular.z = 0.8;
+
+    MapSnapshotConstPtr map = engine.getObstacleMap().getSnapshot();
+    ASSERT_TRUE(engine.sampleCommand(*map, input, odom, cmd));
+    EXPECT_EQ(cmd.linear.x, 0.0);
+    EXPECT_NEAR(cmd.angular.z, 0.8, 1e-9);
+  }
+  TEST(FastCommand, StopsAndWakesSlowTierOnMismatchedDecision)
+  {
+    ScanWorld world;
+    world.addSegment(1.0, -1.0, 1.0, 1.0);
+    sensor_msgs::LaserScan scan;
+    makeScan(world, scan);
+
+    PlanningEngine engine(makeLongRobot());
+    engine.updateScan(scan);
+
+    nav_msgs::Odometry odom;
+    odom.pose.pose.orientation.w = 1.0;
+    geometry_msgs::Twist turn, input;
+    turn.linear.x = 0.5;
+    turn.angular.z = 0.8;
+    input.linear.x = 0.5;
+
+    // The decision was planned while the user was still turning
+    boost::uint64_t version = engine.getObstacleMap().getSnapshot()->version;
+    engine.planAssist(turn, odom);
+
+    PlanningResult fast;
+    engine.computeFastCommand(input, odom, fast);
+    ASSERT_NE(fast.trace.outcome, TRACE_FREE_PATH);
+    EXPECT_EQ(fast.cmd.linear.x, 0.0);
+    EXPECT_EQ(fast.cmd.angular.z, 0.0);
+    EXPECT_TRUE(fast.trace.flags & TRACE_FLAG_DEFERRED);
+
+    // The slow tier wakes without a new snapshot, and its decision then gives the single tier's command
+    EXPECT_TRUE(engine.waitForAssist(version, boost::posix_time::milliseconds(0)));
+    EXPECT_FALSE(engine.waitForAssist(version, boost::posix_time::milliseconds(0)));
+    engine.planAssist(input, odom);
+
+    PlanningResult full;
+    engine.computeFastCommand(input, odom, fast);
+    engine.computeCommand(input, odom, NULL, full);
+    EXPECT_EQ(fast.trace.outcome, full.trace.outcome);
+    EXPECT_NEAR(fast.cmd.linear.x, full.cmd.linear.x, 1e-9);
+    EXPECT_NEAR(fast.cmd.angular.z, full.cmd.angular.z, 1e-9);
+  }
+} /* namespace reactive_assistance */
@@ -0,0 +1,642 @@
+// Replay a recorded bag through the planning engine, profiling every cycle and diffing the decisions
+//
+// Usage: bag_replay <bag> [--radius m | --footprint-width m --footprint-length m] [--dvel-safe m] [--max-lin-vel m/s]
+//                   [--max-ang-vel rad/s] [--acc-vx-lim a] [--acc-vth-lim a] [--sim-time s] [--sim-granularity s]
+//                   [--scan-topic t] [--odom-topic t] [--cmd-topic t] [--goal-topic t] [--cmd-vel-topic t]
+//                   [--auto-vel-topic t] [--base-frame f] [--odom-frame f] [--world-frame f] [--control-rate hz]
+//                   [--planner-patience s] [--realtime] [--rate r] [--out file] [--baseline file] [--tolerance x]
+//                   [--assist-cache-size N] [--segment-tolerance m] [--flight]
+//
+// The robot and topic options take the node parameters of the same name. The node's callbacks are mirrored: scans
+// update the map, joystick commands run shared control cycles, and a goal runs autonomous cycles at the control rate.
+// Messages are processed one at a time in bag order on a single thread, each scan being fully processed before the
+// next message is looked at, so the decisions are the same at any replay speed and however the stages are scheduled.
+// Only the latencies vary between runs.
+//
+// Every cycle is written to --out in the decision trace CSV format, stamped with the bag time. The commands are diffed
+// against the recorded cmd_vel and auto_vel messages and, given a --baseline trace of an earlier replay, against it
+// cycle by cycle. The exit code is 2 if the baseline diff finds any mismatch
+//
+// With --flight the input is a flight log directory or segment written by the node's flight recorder. Its scans are
+// replayed with their recorded transforms, and its cycles are recomputed from the recorded input, odometry and goal
+// and diffed against the recorded output commands. No transforms or topics are involved
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ros/time.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include <geometry_msgs/Point.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <geometry_msgs/Twist.h>
+#include <nav_msgs/Odometry.h>
+#include <sensor_msgs/LaserScan.h>
+#include <tf2/buffer_core.h>
+#include <tf2/exceptions.h>
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+#include <tf2_msgs/TFMessage.h>
+
+#include <reactive_assistance/dist_util.hpp>
+#include <reactive_assistance/flight_log.hpp>
+#include <reactive_assistance/planning_engine.hpp>
+#include <reactive_assistance/robot_profile.hpp>
+#include <reactive_assistance/stage_profiler.hpp>
+#include <reactive_assistance/trace_recorder.hpp>
+
+using namespace reactive_assistance;
+
+static void usage()
+{
+  std::cerr << "usage: bag_replay <bag> [--radius m | --footprint-width m --footprint-length m] [--dvel-safe m]\n"
+               "                  [--max-lin-vel m/s] [--max-ang-vel rad/s] [--acc-vx-lim a] [--acc-vth-lim a]\n"
+               "                  [--sim-time s] [--sim-granularity s] [--scan-topic t] [--odom-topic t] [--cmd-topic t]\n"
+               "                  [--goal-topic t] [--cmd-vel-topic t] [--auto-vel-topic t] [--base-frame f]\n"
+               "                  [--odom-frame f] [--world-frame f] [--control-rate hz] [--planner-patience s]\n"
+               "                  [--realtime] [--rate r] [--out file] [--baseline file] [--tolerance x]\n"
+               "                  [--assist-cache-size N] [--segment-tolerance m] [--flight]"
+            << std::endl;
+}
+
+// Running comparison of produced commands against reference ones
+class CommandDiff
+{
+  public:
+    CommandDiff(double tol) : tolerance(tol), compared(0), mismatches(0), max_dvx(0.0), max_dwz(0.0) {}
+    ~CommandDiff() {}
+
+    // Compare a produced command with its reference, return true if they differ by more than the tolerance
+    bool add(double vx, double wz, double ref_vx, double ref_wz)
+    {
+      double dvx = std::abs(vx - ref_vx);
+      double dwz = std::abs(wz - ref_wz);
+      max_dvx = std::max(max_dvx, dvx);
+      max_dwz = std::max(max_dwz, dwz);
+      compared++;
+
+      bool mismatch = (dvx > tolerance) || (dwz > tolerance);
+      if (mismatch)
+      {
+        mismatches++;
+      }
+      return mismatch;
+    }
+
+    void print(const char *name) const
+    {
+      std::printf("  vs %-10s %8zu compared, %8zu differ by > %g, max |dvx| %.6f, max |dwz| %.6f\n", name, compared,
+                  mismatches, tolerance, max_dvx, max_dwz);
+    }
+
+    double tolerance;
+    std::size_t compared;
+    std::size_t mismatches;
+    double max_dvx;
+    double max_dwz;
+};
+
+// Drives the engine from the bag messages the way the node's callbacks do
+class BagReplay
+{
+  public:
+    BagReplay(const RobotProfile &rp, const EngineConfig &config, double control_rate, double patience, double tolerance)
+             : engine(rp, config)
+             , tf_buffer(ros::Duration(3600.0))
+             , available_goal(false)
+             , control_period(1.0 / control_rate)
+             , planner_patience(patience)
+             , pending_shared(-1)
+             , pending_auto(-1)
+             , tf_failures(0)
+             , recorded_shared(tolerance)
+             , recorded_auto(tolerance)
+    {}
+    ~BagReplay() {}
+
+    void addTransforms(const tf2_msgs::TFMessage &msg, bool is_static)
+    {
+      for (std::size_t i = 0; i < msg.transforms.size(); ++i)
+      {
+        tf_buffer.setTransform(msg.transforms[i], "bag", is_static);
+      }
+    }
+
+    void scan(const sensor_msgs::LaserScan &scan)
+    {
+      geometry_msgs::TransformStamped transform;
+      if (!lookup(base_frame, scan.header.frame_id, transform))
+      {
+        return;
+      }
+
+      engine.updateScan(scan, transform.transform);
+    }
+
+    void goal(const geometry_msgs::PoseStamped &goal, const ros::Time &now)
+    {
+      curr_goal = goal;
+      available_goal = true;
+      last_valid_plan = now;
+      next_tick = now;
+    }
+
+    void cmd(const geometry_msgs::Twist &input, const ros::Time &now)
+    {
+      PlanningResult result;
+      if (available_goal)
+      {
+        geometry_msgs::Point goal;
+        if (!getGlobalGoal(goal))
+        {
+          return;
+        }
+
+        engine.computeCommand(input, odom, &goal, result);
+      }
+      else
+      {
+        engine.computeCommand(input, odom, NULL, result);
+      }
+
+      pending_shared = record(result, now);
+    }
+
+    // Run the autonomous cycles of the control loop that fall before 'now'
+    void tick(const ros::Time &now)
+    {
+      while (available_goal && (next_tick <= now))
+      {
+        if (isGoalReached() || (next_tick > last_valid_plan + ros::Duration(planner_patience)))
+        {
+          available_goal = false;
+          break;
+        }
+
+        geometry_msgs::Point goal;
+        if (getGlobalGoal(goal))
+        {
+          PlanningResult result;
+          engine.computeAutonomousCommand(goal, result);
+          pending_auto = record(result, next_tick);
+        }
+
+        next_tick = next_tick + ros::Duration(control_period);
+      }
+    }
+
+    // Recompute a flight log cycle from the inputs it recorded and diff it against the recorded output
+    void flightCycle(const FlightCycleRecord &cycle)
+    {
+      const TraceRecord &rec = cycle.trace;
+
+      geometry_msgs::Point goal;
+      goal.x = cycle.goal_x;
+      goal.y = cycle.goal_y;
+
+      PlanningResult result;
+      if (rec.source == TRACE_AUTONOMOUS)
+      {
+        engine.computeAutonomousCommand(goal, result);
+      }
+      else
+      {
+        geometry_msgs::Twist input;
+        input.linear.x = rec.in_vx;
+        input.angular.z = rec.in_wz;
+
+        nav_msgs::Odometry flight_odom;
+        flight_odom.pose.pose.position.x = cycle.odom[0];
+        flight_odom.pose.pose.position.y = cycle.odom[1];
+        flight_odom.pose.pose.orientation = quaternionFromYaw(cycle.odom[2]);
+        flight_odom.twist.twist.linear.x = cycle.odom[3];
+        flight_odom.twist.twist.angular.z = cycle.odom[4];
+
+        engine.computeCommand(input, flight_odom, cycle.has_goal ? &goal : NULL, result);
+      }
+
+      long index = record(result, ros::Time().fromNSec(rec.stamp_ns));
+      (rec.source == TRACE_AUTONOMOUS ? recorded_auto : recorded_shared).add(records[index].out_vx, records[index].out_wz,
+                                                                               rec.out_vx, rec.out_wz);
+    }
+
+    // Pair a recorded output command with the latest cycle of its source that has not been paired yet
+    void recordedCommand(const geometry_msgs::Twist &cmd, bool autonomous)
+    {
+      long &pending = autonomous ? pending_auto : pending_shared;
+      if (pending < 0)
+      {
+        return;
+      }
+
+      const TraceRecord &rec = records[pending];
+      (autonomous ? recorded_auto : recorded_shared).add(rec.out_vx, rec.out_wz, cmd.linear.x, cmd.angular.z);
+      pending = -1;
+    }
+
+    PlanningEngine engine;
+    tf2::BufferCore tf_buffer;
+
+    std::string base_frame;
+    std::string odom_frame;
+    std::string world_frame;
+
+    nav_msgs::Odometry odom;
+    geometry_msgs::PoseStamped curr_goal;
+    bool available_goal;
+    ros::Time last_valid_plan;
+    ros::Time next_tick;
+    double control_period;
+    double planner_patience;
+
+    // Every cycle in replay order, and the last cycles of each source awaiting their recorded command
+    std::vector<TraceRecord> records;
+    long pending_shared;
+    long pending_auto;
+
+    std::size_t tf_failures;
+    CommandDiff recorded_shared;
+    CommandDiff recorded_auto;
+
+  private:
+    long record(PlanningResult &result, const ros::Time &now)
+    {
+      engine.recordCycle(result, now);
+      records.push_back(result.trace);
+      return static_cast<long>(records.size()) - 1;
+    }
+
+    // Latest transform, as the node looks it up
+    bool lookup(const std::string &target, const std::string &source, geometry_msgs::TransformStamped &transform)
+    {
+      try
+      {
+        transform = tf_buffer.lookupTransform(target, source, ros::Time(0));
+      }
+      catch (const tf2::TransformException &)
+      {
+        tf_failures++;
+        return false;
+      }
+
+      return true;
+    }
+
+    bool getGlobalGoal(geometry_msgs::Point &goal)
+    {
+      geometry_msgs::TransformStamped transform;
+      if (!lookup(base_frame, world_frame, transform))
+      {
+        return false;
+      }
+
+      geometry_msgs::PoseStamped goal_robot;
+      tf2::doTransform(curr_goal, goal_robot, transform);
+
+      goal = goal_robot.pose.position;
+      return true;
+    }
+
+    bool isGoalReached()
+    {
+      geometry_msgs::TransformStamped transform;
+      if (!lookup(odom_frame, world_frame, transform))
+      {
+        return false;
+      }
+
+      geometry_msgs::PoseStamped goal_odom;
+      tf2::doTransform(curr_goal, goal_odom, transform);
+
+      return (dist(goal_odom.pose.position, odom.pose.pose.position) < engine.getRobotProfile().radius);
+    }
+};
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    usage();
+    return 1;
+  }
+
+  std::string bag_path = argv[1];
+  std::string scan_topic = "scan", odom_topic = "odom", cmd_topic = "input_vel", goal_topic = "goal";
+  std::string cmd_vel_topic = "cmd_vel", auto_vel_topic = "auto_vel";
+  std::string base_frame = "base_link", odom_frame = "odom", world_frame = "map";
+  std::string out_path, baseline_path;
+  double radius = 0.4, fp_wid = 0.0, fp_len = 0.0;
+  double dvel_safe = 0.9, max_vx = 1.0, max_vth = 1.0, acc_x = 1.0, acc_th = 1.0;
+  double control_rate = 10.0, planner_patience = 15.0;
+  double rate = 1.0, tolerance = 1e-6;
+  // Same assist cache and segmentation as the node by default, so that recorded decisions can be reproduced
+  double assist_cache_size = 64.0;
+  bool realtime = false, flight = false;
+  EngineConfig config;
+  config.segment_tolerance = 0.02;
+
+  for (int i = 2; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+
+    if ((arg == "--realtime") || (arg == "--flight"))
+    {
+      (arg == "--realtime" ? realtime : flight) = true;
+      continue;
+    }
+
+    if (i + 1 >= argc)
+    {
+      usage();
+      return 1;
+    }
+
+    // Numeric and string options
+    const struct { const char *name; double *value; } numbers[] = {
+      {"--radius", &radius}, {"--footprint-width", &fp_wid}, {"--footprint-length", &fp_len},
+      {"--dvel-safe", &dvel_safe}, {"--max-lin-vel", &max_vx}, {"--max-ang-vel", &max_vth},
+      {"--acc-vx-lim", &acc_x}, {"--acc-vth-lim", &acc_th}, {"--sim-time", &config.sim_time},
+      {"--sim-granularity", &config.sim_granularity}, {"--control-rate", &control_rate},
+      {"--planner-patience", &planner_patience}, {"--rate", &rate}, {"--tolerance", &tolerance},
+      {"--assist-cache-size", &assist_cache_size}, {"--segment-tolerance", &config.segment_tolerance}
+    };
+    const struct { const char *name; std::string *value; } strings[] = {
+      {"--scan-topic", &scan_topic}, {"--odom-topic", &odom_topic}, {"--cmd-topic", &cmd_topic},
+      {"--goal-topic", &goal_topic}, {"--cmd-vel-topic", &cmd_vel_topic}, {"--auto-vel-topic", &auto_vel_topic},
+      {"--base-frame", &base_frame}, {"--odom-frame", &odom_frame}, {"--world-frame", &world_frame},
+      {"--out", &out_path}, {"--baseline", &baseline_path}
+    };
+
+    bool known = false;
+    for (std::size_t k = 0; (k < sizeof(numbers) / sizeof(numbers[0])) && !known; ++k)
+    {
+      if (arg == numbers[k].name)
+      {
+        *numbers[k].value = std::atof(argv[i + 1]);
+        known = true;
+      }
+    }
+    for (std::size_t k = 0; (k < sizeof(strings) / sizeof(strings[0])) && !known; ++k)
+    {
+      if (arg == strings[k].name)
+      {
+        *strings[k].value = argv[i + 1];
+        known = true;
+      }
+    }
+
+    if (!known)
+    {
+      usage();
+      return 1;
+    }
+    ++i;
+  }
+
+  if ((control_rate <= 0.0) || (rate <= 0.0))
+  {
+    std::cerr << "--control-rate and --rate must be positive" << std::endl;
+    return 1;
+  }
+  config.assist_cache_size = static_cast<std::size_t>(std::max(assist_cache_size, 0.0));
+
+  RobotProfile rp = ((fp_wid > 0.0) && (fp_len > 0.0)) ? RobotProfile::rectangular(fp_wid, fp_len, dvel_safe, max_vx, max_vth, acc_x, acc_th)
+                                                       : RobotProfile::circular(radius, dvel_safe, max_vx, max_vth, acc_x, acc_th);
+
+  BagReplay replay(rp, config, control_rate, planner_patience, tolerance);
+  replay.base_frame = base_frame;
+  replay.odom_frame = odom_frame;
+  replay.world_frame = world_frame;
+
+  // Recorded timing, scaled by the replay rate
+  std::chrono::steady_clock::time_point wall_start = std::chrono::steady_clock::now();
+  ros::Time log_start, log_end;
+  std::size_t messages = 0;
+
+  if (flight)
+  {
+    FlightLogReader reader;
+    if (!reader.open(bag_path))
+    {
+      std::cerr << "cannot open the flight log " << bag_path << std::endl;
+      return 1;
+    }
+
+    FlightRecordView rec;
+    sensor_msgs::LaserScan scan;
+    geometry_msgs::Transform laser_to_base;
+
+    while (reader.next(rec))
+    {
+      ros::Time now = ros::Time().fromNSec(rec.stamp());
+      if (messages == 0)
+      {
+        log_start = now;
+      }
+      log_end = std::max(log_end, now);
+
+      if (realtime)
+      {
+        std::this_thread::sleep_until(wall_start +
+            std::chrono::nanoseconds(static_cast<boost::int64_t>((now - log_start).toNSec() / rate)));
+      }
+      messages++;
+
+      if (rec.type() == FLIGHT_CYCLE)
+      {
+        replay.flightCycle(*rec.cycle());
+      }
+      else if (rec.decodeScan(scan, laser_to_base))
+      {
+        replay.engine.updateScan(scan, laser_to_base);
+      }
+    }
+  }
+  else
+  {
+    rosbag::Bag bag;
+    try
+    {
+      bag.open(bag_path, rosbag::bagmode::Read);
+    }
+    catch (const rosbag::BagException &ex)
+    {
+      std::cerr << "cannot open " << bag_path << ": " << ex.what() << std::endl;
+      return 1;
+    }
+
+    std::vector<std::string> topics;
+    topics.push_back(scan_topic);
+    topics.push_back(odom_topic);
+    topics.push_back(cmd_topic);
+    topics.push_back(goal_topic);
+    topics.push_back(cmd_vel_topic);
+    topics.push_back(auto_vel_topic);
+    topics.push_back("/tf");
+    topics.push_back("/tf_static");
+    rosbag::View view(bag, rosbag::TopicQuery(topics));
+
+    // Topics are compared without the leading slash, as recorded names may or may not carry it
+    log_start = view.getBeginTime();
+    log_end = view.getEndTime();
+
+    for (rosbag::View::iterator it = view.begin(); it != view.end(); ++it)
+    {
+      const rosbag::MessageInstance &m = *it;
+      const ros::Time &now = m.getTime();
+      std::string topic = m.getTopic();
+      if (!topic.empty() && (topic[0] == '/'))
+      {
+        topic.erase(0, 1);
+      }
+
+      if (realtime)
+      {
+        std::this_thread::sleep_until(wall_start +
+            std::chrono::nanoseconds(static_cast<boost::int64_t>((now - log_start).toNSec() / rate)));
+      }
+
+      replay.tick(now);
+      messages++;
+
+      if ((topic == "tf") || (topic == "tf_static"))
+      {
+        tf2_msgs::TFMessage::ConstPtr msg = m.instantiate<tf2_msgs::TFMessage>();
+        if (msg != NULL)
+        {
+          replay.addTransforms(*msg, topic == "tf_static");
+        }
+      }
+      else if (topic == scan_topic)
+      {
+        sensor_msgs::LaserScan::ConstPtr msg = m.instantiate<sensor_msgs::LaserScan>();
+        if (msg != NULL)
+        {
+          replay.scan(*msg);
+        }
+      }
+      else if (topic == odom_topic)
+      {
+        nav_msgs::Odometry::ConstPtr msg = m.instantiate<nav_msgs::Odometry>();
+        if (msg != NULL)
+        {
+          replay.odom = *msg;
+        }
+      }
+      else if (topic == goal_topic)
+      {
+        geometry_msgs::PoseStamped::ConstPtr msg = m.instantiate<geometry_msgs::PoseStamped>();
+        if (msg != NULL)
+        {
+          replay.goal(*msg, now);
+        }
+      }
+      else if (topic == cmd_topic)
+      {
+        geometry_msgs::Twist::ConstPtr msg = m.instantiate<geometry_msgs::Twist>();
+        if (msg != NULL)
+        {
+          replay.cmd(*msg, now);
+        }
+      }
+      else if ((topic == cmd_vel_topic) || (topic == auto_vel_topic))
+      {
+        geometry_msgs::Twist::ConstPtr msg = m.instantiate<geometry_msgs::Twist>();
+        if (msg != NULL)
+        {
+          replay.recordedCommand(*msg, topic == auto_vel_topic);
+        }
+      }
+    }
+
+    bag.close();
+  }
+
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  double log_s = (log_end - log_start).toSec();
+
+  // Summary
+  const std::vector<TraceRecord> &records = replay.records;
+  std::size_t outcomes[NUM_TRACE_OUTCOMES] = {0};
+  for (std::size_t i = 0; i < records.size(); ++i)
+  {
+    outcomes[records[i].outcome]++;
+  }
+
+  std::printf("%zu messages, %zu cycles replayed in %.2f s, %.1fx the recorded %.1f s\n", messages, records.size(), wall_s,
+              (wall_s > 0.0) ? log_s / wall_s : 0.0, log_s);
+  for (int o = 0; o < NUM_TRACE_OUTCOMES; ++o)
+  {
+    std::printf("  %-10s %8zu\n", TRACE_OUTCOME_NAMES[o], outcomes[o]);
+  }
+  if (replay.tf_failures > 0)
+  {
+    std::printf("  %zu transform lookups failed, the matching scans or cycles were skipped\n", replay.tf_failures);
+  }
+
+  StageReport report;
+  replay.engine.getProfiler().collect(report);
+  printStageReport(report, std::cout);
+
+  replay.recorded_shared.print(cmd_vel_topic.c_str());
+  replay.recorded_auto.print(auto_vel_topic.c_str());
+
+  if (!out_path.empty() && !writeTraceCsv(records, out_path))
+  {
+    std::cerr << "cannot write " << out_path << std::endl;
+    return 1;
+  }
+
+  // Decision diff against an earlier replay, cycle by cycle
+  int status = 0;
+  if (!baseline_path.empty())
+  {
+    std::vector<TraceRecord> baseline;
+    if (!readTraceCsv(baseline_path, baseline))
+    {
+      std::cerr << "cannot read the trace " << baseline_path << std::endl;
+      return 1;
+    }
+
+    CommandDiff diff(tolerance);
+    std::size_t outcome_changes = 0;
+    std::size_t reported = 0;
+
+    for (std::size_t i = 0; i < std::min(baseline.size(), records.size()); ++i)
+    {
+      const TraceRecord &a = baseline[i];
+      const TraceRecord &b = records[i];
+
+      bool moved = diff.add(b.out_vx, b.out_wz, a.out_vx, a.out_wz);
+      outcome_changes += (a.outcome != b.outcome);
+      bool changed = moved || (a.outcome != b.outcome) || (a.stamp_ns != b.stamp_ns);
+
+      // The first differing cycles, to start investigating from
+      if (changed && (reported++ < 10))
+      {
+        std::printf("  cycle %zu at %.3f s: %s (%.4f, %.4f) -> %s (%.4f, %.4f)\n", i,
+                    (ros::Time().fromNSec(b.stamp_ns) - log_start).toSec(), TRACE_OUTCOME_NAMES[a.outcome], a.out_vx,
+                    a.out_wz, TRACE_OUTCOME_NAMES[b.outcome], b.out_vx, b.out_wz);
+      }
+    }
+
+    diff.print("baseline");
+    std::printf("  %zu outcome changes, %zu baseline cycles and %zu replayed\n", outcome_changes, baseline.size(),
+                records.size());
+
+    if ((reported > 0) || (baseline.size() != records.size()))
+    {
+      status = 2;
+    }
+  }
+
+  return status;
+}
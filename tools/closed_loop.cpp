@@ -0,0 +1,256 @@
+// Run closed-loop episodes of the planner in a polygon world, faster than real time and across cores
+//
+// Usage: closed_loop <world file> [--mode shared|auto] [--episodes N] [--threads N] [--seed S] [--max-time s]
+//                    [--min-dist m] [--beams N] [--noise m] [--dropout p] [--radius m] [--max-vx m/s]
+//                    [--max-vth rad/s] [--acc a] [--csv file]
+//
+// Start and goal poses are drawn at random from the free space of the world, so a seed fixes the whole run. The
+// outcome counts, time-to-goal, planner latencies and episodes per second are reported on stdout
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <reactive_assistance/closed_loop_sim.hpp>
+#include <reactive_assistance/scan_simulator.hpp>
+#include <reactive_assistance/scan_world.hpp>
+#include <reactive_assistance/stage_profiler.hpp>
+
+using namespace reactive_assistance;
+
+static void usage()
+{
+  std::cerr << "usage: closed_loop <world file> [--mode shared|auto] [--episodes N] [--threads N] [--seed S]\n"
+               "                   [--max-time s] [--min-dist m] [--beams N] [--noise m] [--dropout p] [--radius m]\n"
+               "                   [--max-vx m/s] [--max-vth rad/s] [--acc a] [--csv file]" << std::endl;
+}
+
+// Worker thread: run episodes until none is left
+static void runEpisodes(const ScanSimulator *sim, const RobotProfile *rp, const EpisodeConfig *config,
+                        const std::vector<Episode> *episodes, boost::atomic<std::size_t> *next,
+                        std::vector<EpisodeResult> *results, StageProfiler *profiler)
+{
+  ClosedLoopSimulator loop(*sim, *rp, *config);
+
+  for (std::size_t id = next->fetch_add(1); id < episodes->size(); id = next->fetch_add(1))
+  {
+    loop.run((*episodes)[id], id, (*results)[id], profiler);
+  }
+}
+
+// Value below which 'q' of the sorted 'values' lie
+static double percentile(const std::vector<double> &values, double q)
+{
+  if (values.empty())
+  {
+    return 0.0;
+  }
+
+  return values[std::min(values.size() - 1, static_cast<std::size_t>(q * values.size()))];
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    usage();
+    return 1;
+  }
+
+  std::string world_path = argv[1];
+  std::string csv_path;
+  std::size_t num_episodes = 1000;
+  unsigned int num_threads = std::max(1u, boost::thread::hardware_concurrency());
+  boost::uint64_t seed = 0;
+  double min_dist = 2.0;
+  double radius = 0.3;
+  double max_vx = 0.9;
+  double max_vth = 1.5;
+  double acc = 1.5;
+  EpisodeConfig config;
+  ScanConfig scan_config;
+  scan_config.beams = 360;
+
+  for (int i = 2; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+
+    if (i + 1 >= argc)
+    {
+      usage();
+      return 1;
+    }
+    else if (arg == "--mode")
+    {
+      std::string mode = argv[++i];
+      if ((mode != "shared") && (mode != "auto"))
+      {
+        usage();
+        return 1;
+      }
+      config.mode = (mode == "auto") ? EPISODE_AUTONOMOUS : EPISODE_SHARED_CONTROL;
+    }
+    else if (arg == "--episodes")
+    {
+      num_episodes = std::strtoul(argv[++i], NULL, 10);
+    }
+    else if (arg == "--threads")
+    {
+      num_threads = std::max(1, std::atoi(argv[++i]));
+    }
+    else if (arg == "--seed")
+    {
+      seed = std::strtoull(argv[++i], NULL, 10);
+    }
+    else if (arg == "--max-time")
+    {
+      config.max_time = std::atof(argv[++i]);
+    }
+    else if (arg == "--min-dist")
+    {
+      min_dist = std::atof(argv[++i]);
+    }
+    else if (arg == "--beams")
+    {
+      scan_config.beams = std::atoi(argv[++i]);
+    }
+    else if (arg == "--noise")
+    {
+      scan_config.noise_std = std::atof(argv[++i]);
+    }
+    else if (arg == "--dropout")
+    {
+      scan_config.dropout_prob = std::atof(argv[++i]);
+    }
+    else if (arg == "--radius")
+    {
+      radius = std::atof(argv[++i]);
+    }
+    else if (arg == "--max-vx")
+    {
+      max_vx = std::atof(argv[++i]);
+    }
+    else if (arg == "--max-vth")
+    {
+      max_vth = std::atof(argv[++i]);
+    }
+    else if (arg == "--acc")
+    {
+      acc = std::atof(argv[++i]);
+    }
+    else if (arg == "--csv")
+    {
+      csv_path = argv[++i];
+    }
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  ScanWorld world;
+  std::string error;
+  if (!world.load(world_path, error))
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  scan_config.seed = seed;
+  ScanSimulator sim(world, scan_config);
+  RobotProfile rp = RobotProfile::circular(radius, 3.0 * radius, max_vx, max_vth, acc, acc);
+
+  // Episodes are drawn up front so that they do not depend on the number of threads
+  std::vector<Episode> episodes;
+  if (!sampleEpisodes(world, num_episodes, 2.0 * radius, min_dist, seed, episodes))
+  {
+    std::cerr << "cannot find free start and goal poses " << min_dist << " m apart" << std::endl;
+    return 1;
+  }
+
+  std::vector<EpisodeResult> results(num_episodes);
+  boost::atomic<std::size_t> next(0);
+  StageProfiler profiler;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  boost::thread_group workers;
+  for (unsigned int i = 0; i < num_threads; ++i)
+  {
+    workers.create_thread(boost::bind(&runEpisodes, &sim, &rp, &config, &episodes, &next, &results, &profiler));
+  }
+  workers.join_all();
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // Summary
+  std::size_t outcomes[NUM_EPISODE_OUTCOMES] = {0};
+  std::vector<double> times_to_goal;
+  double sim_s = 0.0;
+  boost::uint64_t cycles = 0, assisted = 0;
+
+  for (std::size_t i = 0; i < num_episodes; ++i)
+  {
+    const EpisodeResult &res = results[i];
+    outcomes[res.outcome]++;
+    sim_s += res.time;
+    cycles += res.cycles;
+    assisted += res.assisted_cycles;
+
+    if (res.outcome == EPISODE_REACHED)
+    {
+      times_to_goal.push_back(res.time);
+    }
+  }
+  std::sort(times_to_goal.begin(), times_to_goal.end());
+
+  std::printf("%zu %s episodes on %u threads in %.2f s: %.1f episodes/s, %.0fx real time\n", num_episodes,
+              (config.mode == EPISODE_AUTONOMOUS) ? "autonomous" : "shared control", num_threads, wall_s,
+              num_episodes / wall_s, sim_s / wall_s);
+  for (int o = 0; o < NUM_EPISODE_OUTCOMES; ++o)
+  {
+    std::printf("  %-10s %6zu (%.1f%%)\n", EPISODE_OUTCOME_NAMES[o], outcomes[o],
+                num_episodes ? 100.0 * outcomes[o] / num_episodes : 0.0);
+  }
+  std::printf("  time to goal: p50 %.2f s, p90 %.2f s, max %.2f s\n", percentile(times_to_goal, 0.5),
+              percentile(times_to_goal, 0.9), times_to_goal.empty() ? 0.0 : times_to_goal.back());
+  std::printf("  %llu planning cycles, %.1f%% assisted\n", static_cast<unsigned long long>(cycles),
+              cycles ? 100.0 * assisted / cycles : 0.0);
+
+  StageReport report;
+  profiler.collect(report);
+  printStageReport(report, std::cout);
+
+  // Per-episode results for regression tracking
+  if (!csv_path.empty())
+  {
+    std::ofstream csv(csv_path.c_str());
+    if (!csv)
+    {
+      std::cerr << "cannot open " << csv_path << std::endl;
+      return 1;
+    }
+
+    csv << "id,start_x,start_y,start_th,goal_x,goal_y,outcome,time,path_length,min_clearance,cycles,assisted_cycles,cmd_variation,planner_us\n";
+    for (std::size_t i = 0; i < num_episodes; ++i)
+    {
+      const Episode &ep = episodes[i];
+      const EpisodeResult &res = results[i];
+      csv << i << ',' << ep.start.x << ',' << ep.start.y << ',' << ep.start.theta << ',' << ep.goal.x << ',' << ep.goal.y
+          << ',' << EPISODE_OUTCOME_NAMES[res.outcome] << ',' << res.time << ',' << res.path_length << ','
+          << res.min_clearance << ',' << res.cycles << ',' << res.assisted_cycles << ',' << res.cmd_variation << ','
+          << res.planner_ns * 1e-3 << '\n';
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,235 @@
+// Drive a fleet of simulated robots in one polygon world, every robot planning with its own instance of an engine host
+//
+// Usage: fleet_sim <world file> [--robots N] [--threads N] [--ticks N] [--rate Hz] [--seed S] [--beams N]
+//                  [--radius m] [--max-vx m/s] [--max-vth rad/s]
+//
+// Every tick, each robot is scanned, plans autonomously towards its goal and moves under the command for one control
+// period. Robots that reach their goal head back to their start, robots that collide are put back at their start.
+// The planning cycles per second and the number of robots a core can serve at the control rate are reported on stdout
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/bind/bind.hpp>
+
+#include <reactive_assistance/closed_loop_sim.hpp>
+#include <reactive_assistance/dist_util.hpp>
+#include <reactive_assistance/engine_host.hpp>
+#include <reactive_assistance/scan_simulator.hpp>
+#include <reactive_assistance/scan_world.hpp>
+#include <reactive_assistance/stage_timing.hpp>
+
+using namespace reactive_assistance;
+
+static void usage()
+{
+  std::cerr << "usage: fleet_sim <world file> [--robots N] [--threads N] [--ticks N] [--rate Hz] [--seed S]\n"
+               "                 [--beams N] [--radius m] [--max-vx m/s] [--max-vth rad/s]" << std::endl;
+}
+
+// State of a simulated robot, only touched by the jobs of its own instance
+struct Robot
+{
+  Episode episode;
+  geometry_msgs::Pose2D pose;
+  boost::uint64_t steps;
+  int reached;
+  int collisions;
+  boost::int64_t planner_ns;
+};
+
+// Job of a robot for one tick: sense, plan and act
+static void stepRobot(PlanningEngine &engine, Robot *robot, std::size_t id, const ScanSimulator *sim, double period)
+{
+  geometry_msgs::Pose2D &pose = robot->pose;
+  const RobotProfile &rp = engine.getRobotProfile();
+
+  sensor_msgs::LaserScan scan;
+  sim->simulate(pose, (static_cast<boost::uint64_t>(id) << 32) | robot->steps, scan);
+  scan.header.stamp.fromNSec(static_cast<boost::uint64_t>(robot->steps * period * 1e9));
+
+  // Goal in the robot frame
+  double dx = robot->episode.goal.x - pose.x;
+  double dy = robot->episode.goal.y - pose.y;
+  geometry_msgs::Point goal;
+  goal.x = std::cos(pose.theta) * dx + std::sin(pose.theta) * dy;
+  goal.y = -std::sin(pose.theta) * dx + std::cos(pose.theta) * dy;
+
+  boost::int64_t start = monotonicNanos();
+  PlanningResult plan;
+  engine.updateScan(scan);
+  engine.computeAutonomousCommand(goal, plan);
+  robot->planner_ns += monotonicNanos() - start;
+  robot->steps++;
+
+  // Unicycle motion under the command over the period
+  double vx = sat(plan.cmd.linear.x, -rp.max_vx, rp.max_vx);
+  double vth = sat(plan.cmd.angular.z, -rp.max_vth, rp.max_vth);
+  pose.x += vx * std::cos(pose.theta + 0.5 * vth * period) * period;
+  pose.y += vx * std::sin(pose.theta + 0.5 * vth * period) * period;
+  pose.theta = proj(pose.theta + vth * period);
+
+  if (std::hypot(robot->episode.goal.x - pose.x, robot->episode.goal.y - pose.y) <= 2.0 * rp.radius)
+  {
+    robot->reached++;
+    std::swap(robot->episode.start, robot->episode.goal);
+  }
+  else if (sim->getWorld().distanceTo(pose.x, pose.y) <= rp.radius)
+  {
+    robot->collisions++;
+    pose = robot->episode.start;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    usage();
+    return 1;
+  }
+
+  std::string world_path = argv[1];
+  std::size_t num_robots = 50;
+  std::size_t num_threads = 0;
+  std::size_t ticks = 600;
+  double rate = 10.0;
+  boost::uint64_t seed = 0;
+  double radius = 0.3;
+  double max_vx = 0.9;
+  double max_vth = 1.5;
+  ScanConfig scan_config;
+  scan_config.beams = 360;
+
+  for (int i = 2; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+
+    if (i + 1 >= argc)
+    {
+      usage();
+      return 1;
+    }
+    else if (arg == "--robots")
+    {
+      num_robots = std::max(1ul, std::strtoul(argv[++i], NULL, 10));
+    }
+    else if (arg == "--threads")
+    {
+      num_threads = std::strtoul(argv[++i], NULL, 10);
+    }
+    else if (arg == "--ticks")
+    {
+      ticks = std::strtoul(argv[++i], NULL, 10);
+    }
+    else if (arg == "--rate")
+    {
+      rate = std::atof(argv[++i]);
+    }
+    else if (arg == "--seed")
+    {
+      seed = std::strtoull(argv[++i], NULL, 10);
+    }
+    else if (arg == "--beams")
+    {
+      scan_config.beams = std::atoi(argv[++i]);
+    }
+    else if (arg == "--radius")
+    {
+      radius = std::atof(argv[++i]);
+    }
+    else if (arg == "--max-vx")
+    {
+      max_vx = std::atof(argv[++i]);
+    }
+    else if (arg == "--max-vth")
+    {
+      max_vth = std::atof(argv[++i]);
+    }
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  ScanWorld world;
+  std::string error;
+  if (!world.load(world_path, error))
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  scan_config.seed = seed;
+  ScanSimulator sim(world, scan_config);
+  RobotProfile rp = RobotProfile::circular(radius, 3.0 * radius, max_vx, max_vth, 1.5, 1.5);
+
+  std::vector<Episode> episodes;
+  if (!sampleEpisodes(world, num_robots, 2.0 * radius, 2.0, seed, episodes))
+  {
+    std::cerr << "cannot find free start and goal poses for " << num_robots << " robots" << std::endl;
+    return 1;
+  }
+
+  // Small decision traces, a fleet of engines keeping 4096 cycles each adds up
+  EngineConfig engine_config;
+  engine_config.trace_capacity = 256;
+
+  EngineHost host(num_threads);
+  std::vector<Robot> robots(num_robots);
+  for (std::size_t i = 0; i < num_robots; ++i)
+  {
+    host.addInstance(rp, engine_config);
+
+    robots[i].episode = episodes[i];
+    robots[i].pose = episodes[i].start;
+    robots[i].steps = 0;
+    robots[i].reached = 0;
+    robots[i].collisions = 0;
+    robots[i].planner_ns = 0;
+  }
+
+  // Ticks run in lockstep, every robot sensing the world as it was at the start of the tick
+  const double period = 1.0 / rate;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (std::size_t t = 0; t < ticks; ++t)
+  {
+    for (std::size_t i = 0; i < num_robots; ++i)
+    {
+      host.post(i, boost::bind(&stepRobot, boost::placeholders::_1, &robots[i], i, &sim, period));
+    }
+    host.wait();
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  boost::uint64_t cycles = 0;
+  boost::int64_t planner_ns = 0;
+  int reached = 0, collisions = 0;
+  for (std::size_t i = 0; i < num_robots; ++i)
+  {
+    cycles += robots[i].steps;
+    planner_ns += robots[i].planner_ns;
+    reached += robots[i].reached;
+    collisions += robots[i].collisions;
+  }
+
+  // Workers beyond the cores only share them
+  std::size_t cores = std::min<std::size_t>(host.getThreadCount(), std::max(1u, boost::thread::hardware_concurrency()));
+  std::size_t threads = host.getThreadCount();
+  double cycles_per_s = cycles / wall_s;
+  std::printf("%zu robots on %zu threads, %zu ticks in %.2f s: %.0f cycles/s, %.0fx real time\n", num_robots, threads,
+              ticks, wall_s, cycles_per_s, ticks * period / wall_s);
+  std::printf("  %.1f robots served per core at %.0f Hz, planner %.1f us per cycle\n", cycles_per_s / cores / rate,
+              rate, cycles ? planner_ns * 1e-3 / cycles : 0.0);
+  std::printf("  %d goals reached, %d collisions, %zu beam tables shared\n", reached, collisions,
+              host.getBeamTables().size());
+
+  return 0;
+}
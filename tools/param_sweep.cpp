@@ -0,0 +1,587 @@
+// Sweep a grid of planner parameters over a corpus of closed-loop scenarios, in parallel across cores
+//
+// Usage: param_sweep <corpus file> --param name=v1,v2,... [--param ...] [--threads N] [--radius m] [--max-time s]
+//                    [--beams N] [--noise m] [--dropout p] [--top N] [--csv file]
+//
+// Swept parameters: dvel_safe, sim_time, sim_granularity, inflation (footprint inflation of the planner), max_lin_vel,
+// max_ang_vel and acc_lim. The node's planner_patience only gives up on a goal once it has been pursued that long, which
+// in closed loop is the --max-time limit of every run, so it is not swept. The corpus lists one scenario per line, world
+// paths being relative to the corpus file and '#' starting a comment:
+//   episode <world file> <shared|auto> start_x start_y start_th goal_x goal_y
+//   random <world file> <shared|auto> <count> <seed>
+//
+// Every run of a scenario under a combination is a work item of its own, on its own engine instance, so that a few long
+// scenarios or a single combination still keep every core busy and runs share nothing but the read-only worlds.
+// Configurations are ranked by Pareto front over the collision rate, the mean safety margin, the command
+// variation (smoothness) and the planner time per cycle, then by success rate within a front
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <reactive_assistance/closed_loop_sim.hpp>
+#include <reactive_assistance/scan_simulator.hpp>
+#include <reactive_assistance/scan_world.hpp>
+
+using namespace reactive_assistance;
+
+static void usage()
+{
+  std::cerr << "usage: param_sweep <corpus file> --param name=v1,v2,... [--param ...] [--threads N] [--radius m]\n"
+               "                   [--max-time s] [--beams N] [--noise m] [--dropout p] [--top N] [--csv file]" << std::endl;
+}
+
+// Parameters that can be swept, in the order of the combination vectors
+enum SweepParam
+{
+  SWEEP_DVEL_SAFE = 0,
+  SWEEP_SIM_TIME,
+  SWEEP_SIM_GRANULARITY,
+  SWEEP_INFLATION,
+  SWEEP_MAX_LIN_VEL,
+  SWEEP_MAX_ANG_VEL,
+  SWEEP_ACC_LIM,
+  NUM_SWEEP_PARAMS
+};
+
+static const char *const SWEEP_PARAM_NAMES[NUM_SWEEP_PARAMS] = {
+  "dvel_safe",
+  "sim_time",
+  "sim_granularity",
+  "inflation",
+  "max_lin_vel",
+  "max_ang_vel",
+  "acc_lim"
+};
+
+// A single episode of the corpus, run in one of the loaded worlds
+struct Scenario
+{
+  std::size_t world;
+  EpisodeMode mode;
+  Episode episode;
+};
+
+// Aggregated results of a configuration over the corpus
+struct SweepResult
+{
+  std::size_t outcomes[NUM_EPISODE_OUTCOMES];
+  double mean_margin;
+  double worst_margin;
+  double mean_variation;
+  double ns_per_cycle;
+  double mean_time_to_goal;
+  int front;
+};
+
+// Shared, read-only inputs of the sweep
+struct SweepSetup
+{
+  std::vector<boost::shared_ptr<ScanSimulator> > sims;
+  std::vector<Scenario> scenarios;
+  std::vector<std::vector<double> > combinations;
+  double radius;
+  double max_time;
+};
+
+// Split "name=v1,v2,..." into the parameter and its values
+static bool parseParam(const std::string &arg, int &param, std::vector<double> &values)
+{
+  std::string::size_type eq = arg.find('=');
+  if (eq == std::string::npos)
+  {
+    return false;
+  }
+
+  std::string name = arg.substr(0, eq);
+  param = -1;
+  for (int p = 0; p < NUM_SWEEP_PARAMS; ++p)
+  {
+    if (name == SWEEP_PARAM_NAMES[p])
+    {
+      param = p;
+    }
+  }
+
+  std::string list = arg.substr(eq + 1);
+  std::replace(list.begin(), list.end(), ',', ' ');
+  std::istringstream in(list);
+  double v;
+  values.clear();
+  while (in >> v)
+  {
+    values.push_back(v);
+  }
+
+  return (param >= 0) && in.eof() && !values.empty();
+}
+
+// Read the scenarios of a corpus file, loading every world it refers to once
+static bool loadCorpus(const std::string &path, const ScanConfig &scan_config, double clearance, SweepSetup &setup,
+                       std::string &error)
+{
+  std::ifstream file(path.c_str());
+  if (!file)
+  {
+    error = "cannot open " + path;
+    return false;
+  }
+
+  std::string dir = (path.find('/') != std::string::npos) ? path.substr(0, path.rfind('/') + 1) : std::string();
+  std::map<std::string, std::size_t> world_ids;
+  std::string line;
+  int line_num = 0;
+
+  while (std::getline(file, line))
+  {
+    ++line_num;
+    std::string::size_type hash = line.find('#');
+    if (hash != std::string::npos)
+    {
+      line.erase(hash);
+    }
+
+    std::istringstream fields(line);
+    std::string kind, world_path, mode;
+    if (!(fields >> kind))
+    {
+      continue;
+    }
+
+    std::ostringstream where;
+    where << path << ", line " << line_num << ": ";
+
+    if (!(fields >> world_path >> mode) || ((mode != "shared") && (mode != "auto")))
+    {
+      error = where.str() + "expected a world file and shared or auto";
+      return false;
+    }
+
+    // Worlds are loaded once, whatever the number of scenarios in them
+    if (world_path[0] != '/')
+    {
+      world_path = dir + world_path;
+    }
+    if (world_ids.find(world_path) == world_ids.end())
+    {
+      ScanWorld world;
+      if (!world.load(world_path, error))
+      {
+        return false;
+      }
+
+      world_ids[world_path] = setup.sims.size();
+      setup.sims.push_back(boost::shared_ptr<ScanSimulator>(new ScanSimulator(world, scan_config)));
+    }
+
+    Scenario scenario;
+    scenario.world = world_ids[world_path];
+    scenario.mode = (mode == "auto") ? EPISODE_AUTONOMOUS : EPISODE_SHARED_CONTROL;
+
+    if (kind == "episode")
+    {
+      Episode &ep = scenario.episode;
+      if (!(fields >> ep.start.x >> ep.start.y >> ep.start.theta >> ep.goal.x >> ep.goal.y))
+      {
+        error = where.str() + "episode takes the start x y theta and the goal x y";
+        return false;
+      }
+
+      setup.scenarios.push_back(scenario);
+    }
+    else if (kind == "random")
+    {
+      std::size_t count;
+      boost::uint64_t seed;
+      std::vector<Episode> episodes;
+      if (!(fields >> count >> seed))
+      {
+        error = where.str() + "random takes a count and a seed";
+        return false;
+      }
+
+      if (!sampleEpisodes(setup.sims[scenario.world]->getWorld(), count, clearance, 2.0, seed, episodes))
+      {
+        error = where.str() + "cannot find enough free start and goal poses";
+        return false;
+      }
+
+      for (std::size_t i = 0; i < episodes.size(); ++i)
+      {
+        scenario.episode = episodes[i];
+        setup.scenarios.push_back(scenario);
+      }
+    }
+    else
+    {
+      error = where.str() + "unknown scenario kind '" + kind + "'";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Run scenario 'i' of the corpus under one parameter combination
+static void evaluate(const SweepSetup &setup, const std::vector<double> &values, std::size_t i, EpisodeResult &res)
+{
+  RobotProfile rp = RobotProfile::circular(setup.radius, values[SWEEP_DVEL_SAFE], values[SWEEP_MAX_LIN_VEL],
+                                           values[SWEEP_MAX_ANG_VEL], values[SWEEP_ACC_LIM], values[SWEEP_ACC_LIM]);
+
+  EngineConfig engine_config;
+  engine_config.sim_time = values[SWEEP_SIM_TIME];
+  engine_config.sim_granularity = values[SWEEP_SIM_GRANULARITY];
+  engine_config.trace_capacity = 1;
+
+  const Scenario &scenario = setup.scenarios[i];
+
+  EpisodeConfig config;
+  config.mode = scenario.mode;
+  config.inflation = values[SWEEP_INFLATION];
+  config.max_time = setup.max_time;
+
+  // A fresh engine for every run, nothing carries over between runs or combinations
+  ClosedLoopSimulator loop(*setup.sims[scenario.world], rp, config, engine_config);
+  loop.run(scenario.episode, i, res);
+}
+
+// Aggregate the runs of the whole corpus under one combination, 'runs' being in scenario order
+static void aggregate(const EpisodeResult *runs, std::size_t count, SweepResult &result)
+{
+  std::fill(result.outcomes, result.outcomes + NUM_EPISODE_OUTCOMES, 0);
+  result.mean_margin = 0.0;
+  result.worst_margin = (count == 0) ? 0.0 : 1e9;
+  result.mean_variation = 0.0;
+  result.mean_time_to_goal = 0.0;
+
+  boost::int64_t planner_ns = 0;
+  boost::uint64_t cycles = 0;
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const EpisodeResult &res = runs[i];
+
+    result.outcomes[res.outcome]++;
+    result.mean_margin += res.min_clearance;
+    result.worst_margin = std::min(result.worst_margin, res.min_clearance);
+    result.mean_variation += res.cmd_variation;
+    planner_ns += res.planner_ns;
+    cycles += res.cycles;
+
+    if (res.outcome == EPISODE_REACHED)
+    {
+      result.mean_time_to_goal += res.time;
+    }
+  }
+
+  std::size_t n = std::max<std::size_t>(count, 1);
+  result.mean_margin /= n;
+  result.mean_variation /= n;
+  result.ns_per_cycle = cycles ? static_cast<double>(planner_ns) / cycles : 0.0;
+  result.mean_time_to_goal /= std::max<std::size_t>(result.outcomes[EPISODE_REACHED], 1);
+}
+
+// Worker thread: run (combination, scenario) pairs until none is left, 'runs' being indexed by combination first
+static void runSweep(const SweepSetup *setup, boost::atomic<std::size_t> *next, std::vector<EpisodeResult> *runs)
+{
+  std::size_t num_scenarios = setup->scenarios.size();
+  for (std::size_t k = next->fetch_add(1); k < runs->size(); k = next->fetch_add(1))
+  {
+    evaluate(*setup, setup->combinations[k / num_scenarios], k % num_scenarios, (*runs)[k]);
+  }
+}
+
+// Whether 'a' is at least as good as 'b' on every objective and better on one
+static bool dominates(const SweepResult &a, const SweepResult &b)
+{
+  const double ka[4] = {static_cast<double>(a.outcomes[EPISODE_COLLISION]), -a.mean_margin, a.mean_variation, a.ns_per_cycle};
+  const double kb[4] = {static_cast<double>(b.outcomes[EPISODE_COLLISION]), -b.mean_margin, b.mean_variation, b.ns_per_cycle};
+
+  bool better = false;
+  for (int k = 0; k < 4; ++k)
+  {
+    if (ka[k] > kb[k])
+    {
+      return false;
+    }
+    better = better || (ka[k] < kb[k]);
+  }
+
+  return better;
+}
+
+// Number the Pareto fronts, 0 being the non-dominated configurations
+static void rankFronts(std::vector<SweepResult> &results)
+{
+  std::vector<bool> ranked(results.size(), false);
+  std::size_t left = results.size();
+
+  for (int front = 0; left > 0; ++front)
+  {
+    std::vector<std::size_t> members;
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+      if (ranked[i])
+      {
+        continue;
+      }
+
+      bool dominated = false;
+      for (std::size_t j = 0; (j < results.size()) && !dominated; ++j)
+      {
+        dominated = !ranked[j] && (j != i) && dominates(results[j], results[i]);
+      }
+
+      if (!dominated)
+      {
+        members.push_back(i);
+      }
+    }
+
+    for (std::size_t k = 0; k < members.size(); ++k)
+    {
+      results[members[k]].front = front;
+      ranked[members[k]] = true;
+    }
+    left -= members.size();
+  }
+}
+
+// Ordering of the ranked configurations
+struct ByRank
+{
+  const std::vector<SweepResult> *results;
+
+  bool operator()(std::size_t a, std::size_t b) const
+  {
+    const SweepResult &ra = (*results)[a];
+    const SweepResult &rb = (*results)[b];
+
+    if (ra.front != rb.front)
+    {
+      return ra.front < rb.front;
+    }
+    if (ra.outcomes[EPISODE_REACHED] != rb.outcomes[EPISODE_REACHED])
+    {
+      return ra.outcomes[EPISODE_REACHED] > rb.outcomes[EPISODE_REACHED];
+    }
+    return ra.mean_margin > rb.mean_margin;
+  }
+};
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    usage();
+    return 1;
+  }
+
+  std::string corpus_path = argv[1];
+  std::string csv_path;
+  unsigned int num_threads = std::max(1u, boost::thread::hardware_concurrency());
+  std::size_t top = 10;
+  ScanConfig scan_config;
+  scan_config.beams = 360;
+
+  SweepSetup setup;
+  setup.radius = 0.3;
+  setup.max_time = 60.0;
+
+  // Defaults of the node for the parameters that are not swept
+  std::vector<std::vector<double> > grid(NUM_SWEEP_PARAMS);
+  const double defaults[NUM_SWEEP_PARAMS] = {0.9, 1.0, 0.1, 0.0, 1.0, 1.0, 1.0};
+  for (int p = 0; p < NUM_SWEEP_PARAMS; ++p)
+  {
+    grid[p].push_back(defaults[p]);
+  }
+
+  for (int i = 2; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      usage();
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "--param")
+    {
+      int param;
+      std::vector<double> values;
+      if (!parseParam(value, param, values))
+      {
+        std::cerr << "bad --param " << value << ", expected one of";
+        for (int p = 0; p < NUM_SWEEP_PARAMS; ++p)
+        {
+          std::cerr << " " << SWEEP_PARAM_NAMES[p];
+        }
+        std::cerr << " with comma separated values" << std::endl;
+        return 1;
+      }
+      grid[param] = values;
+    }
+    else if (arg == "--threads")
+    {
+      num_threads = std::max(1, std::atoi(value.c_str()));
+    }
+    else if (arg == "--radius")
+    {
+      setup.radius = std::atof(value.c_str());
+    }
+    else if (arg == "--max-time")
+    {
+      setup.max_time = std::atof(value.c_str());
+    }
+    else if (arg == "--beams")
+    {
+      scan_config.beams = std::atoi(value.c_str());
+    }
+    else if (arg == "--noise")
+    {
+      scan_config.noise_std = std::atof(value.c_str());
+    }
+    else if (arg == "--dropout")
+    {
+      scan_config.dropout_prob = std::atof(value.c_str());
+    }
+    else if (arg == "--top")
+    {
+      top = std::strtoul(value.c_str(), NULL, 10);
+    }
+    else if (arg == "--csv")
+    {
+      csv_path = value;
+    }
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  std::string error;
+  if (!loadCorpus(corpus_path, scan_config, 2.0 * setup.radius, setup, error))
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  // Cartesian product of the grid, last parameter varying fastest
+  setup.combinations.push_back(std::vector<double>());
+  for (int p = 0; p < NUM_SWEEP_PARAMS; ++p)
+  {
+    std::vector<std::vector<double> > expanded;
+    for (std::size_t c = 0; c < setup.combinations.size(); ++c)
+    {
+      for (std::size_t v = 0; v < grid[p].size(); ++v)
+      {
+        expanded.push_back(setup.combinations[c]);
+        expanded.back().push_back(grid[p][v]);
+      }
+    }
+    setup.combinations.swap(expanded);
+  }
+
+  std::size_t runs = setup.combinations.size() * setup.scenarios.size();
+  std::cerr << setup.combinations.size() << " configurations x " << setup.scenarios.size() << " scenarios = " << runs
+            << " runs on " << num_threads << " threads" << std::endl;
+
+  std::vector<EpisodeResult> episodes(runs);
+  boost::atomic<std::size_t> next(0);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  boost::thread_group workers;
+  for (unsigned int i = 0; i < num_threads; ++i)
+  {
+    workers.create_thread(boost::bind(&runSweep, &setup, &next, &episodes));
+  }
+  workers.join_all();
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::vector<SweepResult> results(setup.combinations.size());
+  for (std::size_t c = 0; c < results.size(); ++c)
+  {
+    aggregate(episodes.empty() ? NULL : &episodes[c * setup.scenarios.size()], setup.scenarios.size(), results[c]);
+  }
+
+  rankFronts(results);
+  std::vector<std::size_t> order(results.size());
+  for (std::size_t c = 0; c < order.size(); ++c)
+  {
+    order[c] = c;
+  }
+  ByRank by_rank = {&results};
+  std::sort(order.begin(), order.end(), by_rank);
+
+  std::printf("%zu runs in %.1f s, %.1f runs/s\n", runs, wall_s, runs / wall_s);
+  std::printf("%5s %6s %9s %9s %9s %9s %9s  %s\n", "front", "reach%", "collide%", "margin", "worst", "variation",
+              "us/cycle", "parameters");
+
+  for (std::size_t k = 0; k < std::min(top, order.size()); ++k)
+  {
+    const SweepResult &res = results[order[k]];
+    const std::vector<double> &values = setup.combinations[order[k]];
+    double n = std::max<std::size_t>(setup.scenarios.size(), 1);
+
+    std::ostringstream params;
+    for (int p = 0; p < NUM_SWEEP_PARAMS; ++p)
+    {
+      // Only the swept parameters, the others are at their defaults
+      if (grid[p].size() > 1)
+      {
+        params << SWEEP_PARAM_NAMES[p] << "=" << values[p] << " ";
+      }
+    }
+
+    std::printf("%5d %6.1f %9.1f %9.3f %9.3f %9.3f %9.1f  %s\n", res.front, 100.0 * res.outcomes[EPISODE_REACHED] / n,
+                100.0 * res.outcomes[EPISODE_COLLISION] / n, res.mean_margin, res.worst_margin, res.mean_variation,
+                res.ns_per_cycle * 1e-3, params.str().c_str());
+  }
+
+  if (!csv_path.empty())
+  {
+    std::ofstream csv(csv_path.c_str());
+    if (!csv)
+    {
+      std::cerr << "cannot open " << csv_path << std::endl;
+      return 1;
+    }
+
+    for (int p = 0; p < NUM_SWEEP_PARAMS; ++p)
+    {
+      csv << SWEEP_PARAM_NAMES[p] << ",";
+    }
+    csv << "front,reached,collision,timeout,mean_margin,worst_margin,mean_variation,us_per_cycle,mean_time_to_goal\n";
+
+    for (std::size_t k = 0; k < order.size(); ++k)
+    {
+      const SweepResult &res = results[order[k]];
+      const std::vector<double> &values = setup.combinations[order[k]];
+
+      for (int p = 0; p < NUM_SWEEP_PARAMS; ++p)
+      {
+        csv << values[p] << ",";
+      }
+      csv << res.front << "," << res.outcomes[EPISODE_REACHED] << "," << res.outcomes[EPISODE_COLLISION] << ","
+          << res.outcomes[EPISODE_TIMEOUT] << "," << res.mean_margin << "," << res.worst_margin << ","
+          << res.mean_variation << "," << res.ns_per_cycle * 1e-3 << "," << res.mean_time_to_goal << "\n";
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,241 @@
+// Generate reproducible laser scans of a polygon world from a list of poses or from random free poses
+//
+// Usage: scan_generator <world file> [--beams N] [--fov rad] [--range-max m] [--noise m] [--noise-range k]
+//                       [--dropout p] [--inf] [--seed S] [--cell m] (--poses file | --random N) [--out file]
+//
+// Poses are read as "x y theta" lines. Each scan is written as one CSV line "id,x,y,theta,r0,r1,...", and the
+// generation rate is reported on stderr
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <geometry_msgs/Pose2D.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <reactive_assistance/scan_simulator.hpp>
+#include <reactive_assistance/scan_world.hpp>
+
+using namespace reactive_assistance;
+
+static void usage()
+{
+  std::cerr << "usage: scan_generator <world file> [--beams N] [--fov rad] [--range-max m] [--noise m]\n"
+               "                      [--noise-range k] [--dropout p] [--inf] [--seed S] [--cell m]\n"
+               "                      (--poses file | --random N) [--out file]" << std::endl;
+}
+
+// Read "x y theta" lines, '#' starts a comment
+static bool readPoses(const std::string &path, std::vector<geometry_msgs::Pose2D> &poses)
+{
+  std::ifstream file(path.c_str());
+  if (!file)
+  {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(file, line))
+  {
+    std::string::size_type hash = line.find('#');
+    if (hash != std::string::npos)
+    {
+      line.erase(hash);
+    }
+
+    geometry_msgs::Pose2D pose;
+    if (std::sscanf(line.c_str(), "%lf %lf %lf", &pose.x, &pose.y, &pose.theta) == 3)
+    {
+      poses.push_back(pose);
+    }
+  }
+
+  return true;
+}
+
+// Draw poses uniformly within the world bounds, rejecting those closer than 'clearance' to any shape
+static void randomPoses(const ScanSimulator &sim, std::size_t count, double clearance, boost::uint64_t seed,
+                        std::vector<geometry_msgs::Pose2D> &poses)
+{
+  double x_min, y_min, x_max, y_max;
+  if (!sim.getWorld().getBounds(x_min, y_min, x_max, y_max))
+  {
+    x_min = y_min = -1.0;
+    x_max = y_max = 1.0;
+  }
+
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> ux(x_min, x_max), uy(y_min, y_max), uth(-M_PI, M_PI);
+
+  // Bounded number of attempts in case the world is too cluttered
+  for (std::size_t attempt = 0; (poses.size() < count) && (attempt < 100 * count); ++attempt)
+  {
+    geometry_msgs::Pose2D pose;
+    pose.x = ux(rng);
+    pose.y = uy(rng);
+    pose.theta = uth(rng);
+
+    bool free = true;
+    for (int k = 0; (k < 16) && free; ++k)
+    {
+      free = !(sim.castRay(pose.x, pose.y, k * M_PI / 8.0, clearance) <= clearance);
+    }
+
+    if (free)
+    {
+      poses.push_back(pose);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    usage();
+    return 1;
+  }
+
+  std::string world_path = argv[1];
+  std::string poses_path, out_path;
+  std::size_t random_count = 0;
+  ScanConfig config;
+
+  for (int i = 2; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    bool has_value = (i + 1 < argc);
+
+    if (arg == "--inf")
+    {
+      config.no_return_inf = true;
+    }
+    else if (!has_value)
+    {
+      usage();
+      return 1;
+    }
+    else if (arg == "--beams")
+    {
+      config.beams = std::atoi(argv[++i]);
+    }
+    else if (arg == "--fov")
+    {
+      config.fov = std::atof(argv[++i]);
+    }
+    else if (arg == "--range-max")
+    {
+      config.range_max = std::atof(argv[++i]);
+    }
+    else if (arg == "--noise")
+    {
+      config.noise_std = std::atof(argv[++i]);
+    }
+    else if (arg == "--noise-range")
+    {
+      config.noise_range_std = std::atof(argv[++i]);
+    }
+    else if (arg == "--dropout")
+    {
+      config.dropout_prob = std::atof(argv[++i]);
+    }
+    else if (arg == "--seed")
+    {
+      config.seed = std::strtoull(argv[++i], NULL, 10);
+    }
+    else if (arg == "--cell")
+    {
+      config.cell_size = std::atof(argv[++i]);
+    }
+    else if (arg == "--poses")
+    {
+      poses_path = argv[++i];
+    }
+    else if (arg == "--random")
+    {
+      random_count = std::strtoul(argv[++i], NULL, 10);
+    }
+    else if (arg == "--out")
+    {
+      out_path = argv[++i];
+    }
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  if (poses_path.empty() == (random_count == 0))
+  {
+    std::cerr << "exactly one of --poses and --random is required" << std::endl;
+    return 1;
+  }
+
+  ScanWorld world;
+  std::string error;
+  if (!world.load(world_path, error))
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  ScanSimulator sim(world, config);
+
+  std::vector<geometry_msgs::Pose2D> poses;
+  if (!poses_path.empty())
+  {
+    if (!readPoses(poses_path, poses))
+    {
+      std::cerr << "cannot open " << poses_path << std::endl;
+      return 1;
+    }
+  }
+  else
+  {
+    randomPoses(sim, random_count, 0.3, config.seed, poses);
+  }
+
+  std::ofstream out_file;
+  if (!out_path.empty())
+  {
+    out_file.open(out_path.c_str());
+    if (!out_file)
+    {
+      std::cerr << "cannot open " << out_path << std::endl;
+      return 1;
+    }
+  }
+  std::ostream &out = out_path.empty() ? std::cout : out_file;
+  out.precision(std::numeric_limits<float>::max_digits10);
+
+  sensor_msgs::LaserScan scan;
+  double sim_s = 0.0;
+
+  for (std::size_t id = 0; id < poses.size(); ++id)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    sim.simulate(poses[id], id, scan);
+    sim_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    out << id << ',' << poses[id].x << ',' << poses[id].y << ',' << poses[id].theta;
+    for (std::size_t i = 0; i < scan.ranges.size(); ++i)
+    {
+      out << ',' << scan.ranges[i];
+    }
+    out << '\n';
+  }
+
+  std::cerr << poses.size() << " scans of " << config.beams << " beams, " << world.segments.size() << " segments and "
+            << world.circles.size() << " circles, " << (sim_s > 0.0 ? poses.size() / sim_s : 0.0) << " scans/s"
+            << std::endl;
+
+  return 0;
+}
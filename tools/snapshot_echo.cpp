@@ -0,0 +1,86 @@
+// Print the planning cycles of a running planner's shared-memory snapshot export, one line per cycle read
+//
+// Usage: snapshot_echo <object name> [--count N] [--poll-ms M]
+//
+// Cycles written between two polls are skipped, the readers always get the latest one. The number of skipped cycles
+// is reported at the end on stderr
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <boost/thread.hpp>
+
+#include <reactive_assistance/snapshot_export.hpp>
+
+using namespace reactive_assistance;
+
+static void usage()
+{
+  std::cerr << "usage: snapshot_echo <object name> [--count N] [--poll-ms M]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    usage();
+    return 1;
+  }
+
+  std::string name = argv[1];
+  long count = -1;
+  int poll_ms = 1;
+  for (int i = 2; i < argc; ++i)
+  {
+    if ((std::strcmp(argv[i], "--count") == 0) && (i + 1 < argc))
+    {
+      count = std::atol(argv[++i]);
+    }
+    else if ((std::strcmp(argv[i], "--poll-ms") == 0) && (i + 1 < argc))
+    {
+      poll_ms = std::atoi(argv[++i]);
+    }
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  SnapshotReader reader(name);
+  if (!reader.isOpen())
+  {
+    std::cerr << "Cannot open the snapshot export " << name << std::endl;
+    return 1;
+  }
+
+  ExportedCycle cycle;
+  boost::uint64_t last = reader.latestCycle();
+  boost::uint64_t skipped = 0;
+  for (long read = 0; (count < 0) || (read < count); )
+  {
+    if ((reader.latestCycle() == last) || !reader.readLatest(cycle) || (cycle.cycle == last))
+    {
+      boost::this_thread::sleep(boost::posix_time::milliseconds(poll_ms));
+      continue;
+    }
+
+    if (last > 0)
+    {
+      skipped += cycle.cycle - last - 1;
+    }
+    last = cycle.cycle;
+    read++;
+
+    std::cout << cycle.cycle << " map " << cycle.map_version
+              << " " << TRACE_OUTCOME_NAMES[cycle.trace.outcome % NUM_TRACE_OUTCOMES]
+              << " cmd " << cycle.trace.out_vx << " " << cycle.trace.out_wz
+              << " obstacles " << cycle.obstacles.size() << " gaps " << cycle.gaps.size()
+              << " virt_gaps " << cycle.virt_gaps.size() << " traj " << cycle.traj_poses.size() << std::endl;
+  }
+
+  std::cerr << skipped << " cycles skipped" << std::endl;
+  return 0;
+}